@@ -8,113 +8,12 @@ static inline uint32_t aircraftHash(uint32_t addr) {
     return addrHash(addr, AIRCRAFT_HASH_BITS);
 }
 
-#define EMPTY 0xFFFFFFFF
-#define quickMinBits 8
-#define quickMaxBits 16
-#define quickStride 8
-static int quickBits;
-static int quickBuckets;
-static int quickSize;
-
-struct ap {
-    uint32_t addr;
-    struct aircraft *ptr;
-};
-
-static struct ap *quick;
-
-static void quickResize(int bits) {
-    quickBits = bits;
-    quickBuckets = (1LL << bits) + quickStride;
-    quickSize = sizeof(struct ap) * quickBuckets;
-
-    if (quickBuckets > 256000)
-        fprintf(stderr, "quickLookup: changing size to %d!\n", (int) quickBuckets);
-
-    sfree(quick);
-    quick = cmalloc(quickSize);
-    memset(quick, 0xFF, quickSize);
-}
-
-static struct ap *quickGet(uint32_t addr) {
-    uint32_t hash = addrHash(addr, quickBits);
-    for (unsigned i = 0; i < quickStride; i++) {
-        struct ap *q = &(quick[hash + i]);
-        if (q->addr == addr) {
-            return q;
-        }
-    }
-    return NULL;
-}
-void quickRemove(struct aircraft *a) {
-    struct ap *q = quickGet(a->addr);
-    if (q) {
-        q->addr = EMPTY;
-        q->ptr = NULL;
-    }
-    //fprintf(stderr, "r: %06x\n", a->addr);
-}
-void quickAdd(struct aircraft *a) {
-    struct ap *q = quickGet(a->addr);
-    if (q)
-        return;
-
-    uint32_t hash = addrHash(a->addr, quickBits);
-
-    for (unsigned i = 0; i < quickStride; i++) {
-        q = &quick[hash + i];
-        if (q->addr == EMPTY) {
-            q->addr = a->addr;
-            q->ptr = a;
-            return;
-        }
-    }
-}
-
-void quickInit() {
-    if (quickBits > quickMinBits && Modes.aircraftActive.len < quickBuckets / 9) {
-        quickResize(quickBits - 1);
-    } else if (quickBits < quickMinBits) {
-        quickResize(quickMinBits);
-    } else if (quickBits < quickMaxBits && Modes.aircraftActive.len > quickBuckets / 3) {
-        quickResize(quickBits + 1);
-    }
-
-    /*
-    for (int i = 0; i < quickBuckets; i++) {
-        if (quick[i].addr == EMPTY)
-            fprintf(stderr, " ");
-        else
-            fprintf(stderr, ".");
-    }
-    fprintf(stderr, "\n");
-    */
-}
-void quickDestroy() {
-    sfree(quick);
-}
-
-
 struct aircraft *aircraftGet(uint32_t addr) {
-
-    struct ap *q = quickGet(addr);
-    if (q) {
-        return q->ptr;
-    }
-
-    struct aircraft *a = Modes.aircraft[aircraftHash(addr)];
-
-    while (a && a->addr != addr) {
-        a = a->next;
-    }
-    if (a) {
-        quickAdd(a);
-    }
-    return a;
+    return aircraftIndexGet(&Modes.aircraftIndex, addr);
 }
 
 void freeAircraft(struct aircraft *a) {
-    quickRemove(a);
+    aircraftIndexRemove(&Modes.aircraftIndex, a->addr);
 
     // remove from the globeList
     set_globe_index(a, -5);
@@ -124,15 +23,35 @@ void freeAircraft(struct aircraft *a) {
     }
     traceCleanup(a);
 
+    memset(a->cold, 0xff, sizeof (struct aircraftCold));
+    free(a->cold);
     memset(a, 0xff, sizeof (struct aircraft));
     free(a);
 }
 
 void aircraftZeroTail(struct aircraft *a) {
     memset(&a->zeroStart, 0x0, &a->zeroEnd - &a->zeroStart);
+    memset(&a->cold->zeroStart, 0x0, &a->cold->zeroEnd - &a->cold->zeroStart);
 }
 
+static struct aircraft *aircraftCreateLocked(uint32_t addr);
+
 struct aircraft *aircraftCreate(uint32_t addr) {
+    struct aircraft *a = aircraftGet(addr);
+    if (a) {
+        return a;
+    }
+    // with multiple decode threads, aircraft are also created outside of the track shards
+    if (Modes.decodeThreads > 1) {
+        pthread_mutex_lock(&Modes.trackSharedLock);
+        a = aircraftCreateLocked(addr);
+        pthread_mutex_unlock(&Modes.trackSharedLock);
+        return a;
+    }
+    return aircraftCreateLocked(addr);
+}
+
+static struct aircraft *aircraftCreateLocked(uint32_t addr) {
     struct aircraft *a = aircraftGet(addr);
     if (a) {
         return a;
@@ -142,6 +61,9 @@ struct aircraft *aircraftCreate(uint32_t addr) {
     // Default everything to zero/NULL
     memset(a, 0, sizeof (struct aircraft));
 
+    a->cold = cmalloc(sizeof(struct aircraftCold));
+    memset(a->cold, 0, sizeof(struct aircraftCold));
+
     // Now initialise things that should not be 0/NULL to their defaults
     a->addr = addr;
     a->addrtype = ADDR_UNKNOWN;
@@ -165,36 +87,46 @@ struct aircraft *aircraftCreate(uint32_t addr) {
     a->next = Modes.aircraft[hash];
     Modes.aircraft[hash] = a;
 
+    aircraftIndexAdd(&Modes.aircraftIndex, addr, a);
+
     return a;
 }
 
+void binCraftAges(struct aircraft *a, struct binCraft *new, int64_t seen, int64_t seenPos, int64_t now) {
+    new->seen = (int32_t) nearbyint((now - seen) / 100.0);
+
+    if (new->position_valid || now < seenPos + 14 * 24 * HOURS) {
+        new->seen_pos = (int32_t) nearbyint((now - seenPos) / 100.0);
+    }
+
+    if (Modes.json_globe_index || Modes.apiShutdownDelay) {
+        new->messages = (uint16_t) nearbyint(10 * a->messageRate);
+    }
+}
+
 void toBinCraft(struct aircraft *a, struct binCraft *new, int64_t now) {
 
     memset(new, 0, sizeof(struct binCraft));
     new->hex = a->addr;
-    new->seen = (int32_t) nearbyint((now - a->seen) / 100.0);
 
     new->callsign_valid = trackDataValid(&a->callsign_valid);
     for (unsigned i = 0; i < sizeof(new->callsign); i++)
         new->callsign[i] = a->callsign[i] * new->callsign_valid;
 
     if (Modes.db) {
-        memcpy(new->registration, a->registration, sizeof(new->registration));
-        memcpy(new->typeCode, a->typeCode, sizeof(new->typeCode));
-        new->dbFlags = a->dbFlags;
+        memcpy(new->registration, a->cold->registration, sizeof(new->registration));
+        memcpy(new->typeCode, a->cold->typeCode, sizeof(new->typeCode));
+        new->dbFlags = a->cold->dbFlags;
     }
     new->extraFlags |= ((nogps(now, a)) << 0);
 
-    if (Modes.json_globe_index || Modes.apiShutdownDelay) {
-        new->messages = (uint16_t) nearbyint(10 * a->messageRate);
-    } else {
-        new->messages = (uint16_t) a->messages;
-    }
+    new->messages = (uint16_t) a->messages;
 
     new->position_valid = trackDataValid(&a->pos_reliable_valid);
 
+    binCraftAges(a, new, a->seen, a->seenPosReliable, now);
+
     if (new->position_valid || now < a->seenPosReliable + 14 * 24 * HOURS) {
-        new->seen_pos = (int32_t) nearbyint((now - a->seenPosReliable) / 100.0);
         new->lat = (int32_t) nearbyint(a->latReliable * 1E6);
         new->lon = (int32_t) nearbyint(a->lonReliable * 1E6);
         new->pos_nic = a->pos_nic_reliable;
@@ -689,15 +621,15 @@ void dbPut(uint32_t addr, dbEntry **index, dbEntry *d) {
 void updateTypeReg(struct aircraft *a) {
     dbEntry *d = dbGet(a->addr, Modes.dbIndex);
     if (d) {
-        memcpy(a->registration, d->registration, sizeof(a->registration));
-        memcpy(a->typeCode, d->typeCode, sizeof(a->typeCode));
-        memcpy(a->typeLong, d->typeLong, sizeof(a->typeLong));
-        a->dbFlags = d->dbFlags;
+        memcpy(a->cold->registration, d->registration, sizeof(a->cold->registration));
+        memcpy(a->cold->typeCode, d->typeCode, sizeof(a->cold->typeCode));
+        memcpy(a->cold->typeLong, d->typeLong, sizeof(a->cold->typeLong));
+        a->cold->dbFlags = d->dbFlags;
     } else {
-        memset(a->registration, 0, sizeof(a->registration));
-        memset(a->typeCode, 0, sizeof(a->typeCode));
-        memset(a->typeLong, 0, sizeof(a->typeLong));
-        a->dbFlags = 0;
+        memset(a->cold->registration, 0, sizeof(a->cold->registration));
+        memset(a->cold->typeCode, 0, sizeof(a->cold->typeCode));
+        memset(a->cold->typeLong, 0, sizeof(a->cold->typeLong));
+        a->cold->dbFlags = 0;
     }
     uint32_t i = a->addr;
     if (
@@ -816,6 +748,7 @@ void updateTypeReg(struct aircraft *a) {
             //|| (i >= 0xe80600 && i <= 0xe806ff)
             // disabled due to civilian aircraft in hex range
     ) {
-        a->dbFlags |= 1;
+        a->cold->dbFlags |= 1;
     }
+    aircraftChanged(a);
 }
@@ -26,10 +26,38 @@ static inline uint32_t addrHash(uint32_t addr, uint32_t bits) {
     return (uint32_t) res;
 }
 
-void quickInit();
-void quickDestroy();
-void quickAdd(struct aircraft *a);
-void quickRemove(struct aircraft *a);
+struct aircraftSlot {
+    uint32_t addr;
+    uint32_t dist; // probe distance + 1, 0 for an empty slot
+    struct aircraft *ptr;
+};
+
+struct aircraftTable {
+    struct aircraftTable *next; // list of retired tables
+    uint32_t bits;
+    uint32_t mask;
+    uint32_t count;
+    uint32_t migrated; // while resizing: slots of the old table below this index are empty
+    struct aircraftSlot slots[];
+};
+
+// aircraft by address, see aircraft_index.c
+struct aircraftIndex {
+    pthread_mutex_t mutex; // serializes writers
+    atomic_uint seq; // odd while a writer modifies the tables
+    struct aircraftTable *cur;
+    struct aircraftTable *old; // non-NULL while resizing
+    struct aircraftTable *retired; // freed by aircraftIndexMaintenance
+};
+
+void aircraftIndexInit(struct aircraftIndex *idx);
+void aircraftIndexDestroy(struct aircraftIndex *idx);
+struct aircraft *aircraftIndexGet(struct aircraftIndex *idx, uint32_t addr);
+void aircraftIndexAdd(struct aircraftIndex *idx, uint32_t addr, struct aircraft *ptr);
+void aircraftIndexRemove(struct aircraftIndex *idx, uint32_t addr);
+uint32_t aircraftIndexCount(struct aircraftIndex *idx);
+// shrinks the index and frees replaced tables, no aircraftIndexGet may run concurrently
+void aircraftIndexMaintenance(struct aircraftIndex *idx);
 
 void aircraftZeroTail(struct aircraft *a);
 struct aircraft *aircraftGet(uint32_t addr);
@@ -184,6 +212,8 @@ struct binCraft {
 } __attribute__ ((__packed__));
 
 void toBinCraft(struct aircraft *a, struct binCraft *new, int64_t now);
+// the fields of a binCraft which change with now alone, seen / seenPos are a->seen / a->seenPosReliable
+void binCraftAges(struct aircraft *a, struct binCraft *new, int64_t seen, int64_t seenPos, int64_t now);
 int dbUpdate(int64_t now);
 int dbFinishUpdate();
 
@@ -0,0 +1,244 @@
+#include "readsb.h"
+
+// Open addressing index of the aircraft by address (Robin Hood hashing with backward shift deletion).
+//
+// Slots hold the address next to the pointer so a lookup usually touches a single cache line
+// and never dereferences aircraft it doesn't return.
+//
+// Lookups don't take a lock, they retry if a writer modified the tables meanwhile (seqlock).
+// Writers are serialized by the index mutex.
+// Resizing is incremental: the old table stays readable and every write moves a few
+// of its slots to the new table until it's empty.
+// Tables replaced while lookups might still be reading them are only freed by
+// aircraftIndexMaintenance which is called when no lookups can run.
+
+#define INDEX_MIN_BITS 10
+#define INDEX_MIGRATE_STEP 16
+
+static inline uint32_t slotHash(uint32_t addr) {
+    return addrHash(addr, 32);
+}
+
+static struct aircraftTable *tableAlloc(uint32_t bits) {
+    uint32_t size = ((uint32_t) 1) << bits;
+    size_t bytes = sizeof(struct aircraftTable) + size * sizeof(struct aircraftSlot);
+    struct aircraftTable *t = cmalloc(bytes);
+    memset(t, 0x0, bytes);
+    t->bits = bits;
+    t->mask = size - 1;
+    return t;
+}
+
+static inline void writeBegin(struct aircraftIndex *idx) {
+    atomic_store_explicit(&idx->seq, atomic_load_explicit(&idx->seq, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static inline void writeEnd(struct aircraftIndex *idx) {
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&idx->seq, atomic_load_explicit(&idx->seq, memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+static inline struct aircraftSlot *tableFind(struct aircraftTable *t, uint32_t addr, uint32_t hash) {
+    if (!t) {
+        return NULL;
+    }
+    uint32_t mask = t->mask;
+    uint32_t pos = hash & mask;
+    // dist is 1 for an entry in its home slot
+    for (uint32_t dist = 1; dist <= mask + 1; dist++) {
+        struct aircraftSlot *s = &t->slots[pos];
+        if (s->addr == addr && s->dist) {
+            return s;
+        }
+        // an entry closer to its home slot than we would be: addr isn't in the table
+        if (s->dist < dist) {
+            return NULL;
+        }
+        pos = (pos + 1) & mask;
+    }
+    return NULL;
+}
+
+static void tableInsert(struct aircraftTable *t, uint32_t addr, struct aircraft *ptr) {
+    struct aircraftSlot in = { .addr = addr, .dist = 1, .ptr = ptr };
+    uint32_t mask = t->mask;
+    uint32_t pos = slotHash(addr) & mask;
+    while (1) {
+        struct aircraftSlot *s = &t->slots[pos];
+        if (!s->dist) {
+            *s = in;
+            t->count++;
+            return;
+        }
+        // take from the rich: the entry closer to its home slot moves on
+        if (s->dist < in.dist) {
+            struct aircraftSlot tmp = *s;
+            *s = in;
+            in = tmp;
+        }
+        in.dist++;
+        pos = (pos + 1) & mask;
+    }
+}
+
+static void tableDelete(struct aircraftTable *t, struct aircraftSlot *s) {
+    uint32_t mask = t->mask;
+    uint32_t pos = s - t->slots;
+    // shift the following entries back until one is in its home slot or the slot is empty
+    while (1) {
+        uint32_t next = (pos + 1) & mask;
+        struct aircraftSlot *n = &t->slots[next];
+        if (n->dist <= 1) {
+            break;
+        }
+        t->slots[pos] = *n;
+        t->slots[pos].dist--;
+        pos = next;
+    }
+    memset(&t->slots[pos], 0x0, sizeof(struct aircraftSlot));
+    t->count--;
+}
+
+// move up to step slots of the old table to the current table, call within writeBegin / writeEnd
+static void migrate(struct aircraftIndex *idx, uint32_t step) {
+    struct aircraftTable *old = idx->old;
+    if (!old) {
+        return;
+    }
+    for (uint32_t k = 0; k < step && old->count; k++) {
+        // deleting shifts the rest of the cluster into this slot, move until it's empty
+        // this keeps the old table valid for lookups
+        struct aircraftSlot *s = &old->slots[old->migrated];
+        while (s->dist) {
+            tableInsert(idx->cur, s->addr, s->ptr);
+            tableDelete(old, s);
+        }
+        old->migrated++;
+    }
+    if (old->count == 0) {
+        __atomic_store_n(&idx->old, NULL, __ATOMIC_RELAXED);
+        // lookups might still be reading it
+        old->next = idx->retired;
+        idx->retired = old;
+    }
+}
+
+// start moving all entries to a table with 1 << bits slots, call within writeBegin / writeEnd
+static void resize(struct aircraftIndex *idx, uint32_t bits) {
+    // finish a resize in progress first
+    while (idx->old) {
+        migrate(idx, idx->old->mask + 1);
+    }
+    struct aircraftTable *t = tableAlloc(bits);
+    __atomic_store_n(&idx->old, idx->cur, __ATOMIC_RELAXED);
+    __atomic_store_n(&idx->cur, t, __ATOMIC_RELAXED);
+    if (idx->old->count == 0) {
+        migrate(idx, 0);
+    }
+}
+
+void aircraftIndexInit(struct aircraftIndex *idx) {
+    memset(idx, 0x0, sizeof(struct aircraftIndex));
+    pthread_mutex_init(&idx->mutex, NULL);
+    idx->cur = tableAlloc(INDEX_MIN_BITS);
+}
+
+static void freeRetired(struct aircraftIndex *idx) {
+    struct aircraftTable *t = idx->retired;
+    while (t) {
+        struct aircraftTable *next = t->next;
+        sfree(t);
+        t = next;
+    }
+    idx->retired = NULL;
+}
+
+void aircraftIndexDestroy(struct aircraftIndex *idx) {
+    freeRetired(idx);
+    sfree(idx->old);
+    sfree(idx->cur);
+    pthread_mutex_destroy(&idx->mutex);
+}
+
+struct aircraft *aircraftIndexGet(struct aircraftIndex *idx, uint32_t addr) {
+    uint32_t hash = slotHash(addr);
+    while (1) {
+        unsigned seq = atomic_load_explicit(&idx->seq, memory_order_acquire);
+        if (seq & 1) {
+            // writer active
+            continue;
+        }
+        struct aircraftSlot *s = tableFind(__atomic_load_n(&idx->cur, __ATOMIC_RELAXED), addr, hash);
+        if (!s) {
+            s = tableFind(__atomic_load_n(&idx->old, __ATOMIC_RELAXED), addr, hash);
+        }
+        struct aircraft *ptr = s ? s->ptr : NULL;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&idx->seq, memory_order_relaxed) == seq) {
+            return ptr;
+        }
+    }
+}
+
+void aircraftIndexAdd(struct aircraftIndex *idx, uint32_t addr, struct aircraft *ptr) {
+    pthread_mutex_lock(&idx->mutex);
+    writeBegin(idx);
+
+    struct aircraftTable *cur = idx->cur;
+    uint32_t total = cur->count + (idx->old ? idx->old->count : 0);
+    // grow at a load factor of 7/8
+    if (total + 1 > (cur->mask + 1) / 8 * 7) {
+        resize(idx, cur->bits + 1);
+    }
+    migrate(idx, INDEX_MIGRATE_STEP);
+    tableInsert(idx->cur, addr, ptr);
+
+    writeEnd(idx);
+    pthread_mutex_unlock(&idx->mutex);
+}
+
+void aircraftIndexRemove(struct aircraftIndex *idx, uint32_t addr) {
+    uint32_t hash = slotHash(addr);
+    pthread_mutex_lock(&idx->mutex);
+    writeBegin(idx);
+
+    migrate(idx, INDEX_MIGRATE_STEP);
+    struct aircraftSlot *s = tableFind(idx->cur, addr, hash);
+    if (s) {
+        tableDelete(idx->cur, s);
+    } else if ((s = tableFind(idx->old, addr, hash))) {
+        tableDelete(idx->old, s);
+        migrate(idx, 0);
+    }
+
+    writeEnd(idx);
+    pthread_mutex_unlock(&idx->mutex);
+}
+
+uint32_t aircraftIndexCount(struct aircraftIndex *idx) {
+    pthread_mutex_lock(&idx->mutex);
+    uint32_t count = idx->cur->count + (idx->old ? idx->old->count : 0);
+    pthread_mutex_unlock(&idx->mutex);
+    return count;
+}
+
+void aircraftIndexMaintenance(struct aircraftIndex *idx) {
+    pthread_mutex_lock(&idx->mutex);
+    writeBegin(idx);
+
+    struct aircraftTable *cur = idx->cur;
+    uint32_t total = cur->count + (idx->old ? idx->old->count : 0);
+    // shrink at a load factor below 1/8, the new table is at most half full
+    if (!idx->old && cur->bits > INDEX_MIN_BITS && total < (cur->mask + 1) / 8) {
+        resize(idx, cur->bits - 1);
+    }
+    // no lookups running, finish any resize and free the old tables
+    while (idx->old) {
+        migrate(idx, idx->old->mask + 1);
+    }
+    freeRetired(idx);
+
+    writeEnd(idx);
+    pthread_mutex_unlock(&idx->mutex);
+}
@@ -60,57 +60,6 @@ static int compareLon(const void *p1, const void *p2) {
     return (a1->bin.lon > a2->bin.lon) - (a1->bin.lon < a2->bin.lon);
 }
 
-static struct range findLonRange(int32_t ref_from, int32_t ref_to, struct apiEntry *list, int len) {
-    struct range res;
-    memset(&res, 0, sizeof(res));
-    if (len == 0 || ref_from > ref_to)
-        return res;
-
-    // get lower bound
-    int i = 0;
-    int j = len - 1;
-    while (j > i + 1) {
-
-        int pivot = (i + j) / 2;
-
-        if (list[pivot].bin.lon < ref_from)
-            i = pivot;
-        else
-            j = pivot;
-    }
-
-    if (list[j].bin.lon < ref_from) {
-        res.from = j + 1;
-    } else if (list[i].bin.lon < ref_from) {
-        res.from = i + 1;
-    } else {
-        res.from = i;
-    }
-
-
-    // get upper bound (exclusive)
-    i = imin(res.from, len - 1);
-    j = len - 1;
-    while (j > i + 1) {
-
-        int pivot = (i + j) / 2;
-        if (list[pivot].bin.lon <= ref_to)
-            i = pivot;
-        else
-            j = pivot;
-    }
-
-    if (list[j].bin.lon <= ref_to) {
-        res.to = j + 1;
-    } else if (list[i].bin.lon <= ref_to) {
-        res.to = i + 1;
-    } else {
-        res.to = i;
-    }
-
-    return res;
-}
-
 static int filter_alt_baro(struct apiEntry *haystack, int haylen, struct apiEntry *matches, size_t *alloc, struct apiOptions *options) {
     int count = 0;
     float reverse_alt_factor = 1.0f / BINCRAFT_ALT_FACTOR;
@@ -233,7 +182,7 @@ static int inLatRange(struct apiEntry *e, int32_t lat1, int32_t lat2, struct api
     return (e->bin.lat >= lat1 && e->bin.lat <= lat2 && (e->bin.position_valid || options->binCraft));
 }
 
-static int findInBox(struct apiEntry *haystack, int haylen, struct apiOptions *options, struct apiEntry *matches, size_t *alloc) {
+static int findInBox(struct apiEntry *haystack, int haylen, struct apiGrid *grid, struct apiOptions *options, struct apiEntry *matches, size_t *alloc) {
     double *box = options->box;
     struct range r[2];
     memset(r, 0, sizeof(r));
@@ -252,15 +201,19 @@ static int findInBox(struct apiEntry *haystack, int haylen, struct apiOptions *o
         r[1] = findLonRange(-180E6, lon2, haystack, haylen);
         //fprintf(stderr, "%.1f to 180 and -180 to %1.f\n", lon1 / 1E6, lon2 / 1E6);
     }
+    // apiGridFind only returns entries within the longitude ranges
+    int32_t *candidates = cmalloc(imax(1, (r[0].to - r[0].from) + (r[1].to - r[1].from)) * sizeof(int32_t));
     for (int k = 0; k < 2; k++) {
-        for (int j = r[k].from; j < r[k].to; j++) {
-            struct apiEntry *e = &haystack[j];
+        int candidateCount = apiGridFind(grid, haystack, r[k], lat1, lat2, candidates);
+        for (int i = 0; i < candidateCount; i++) {
+            struct apiEntry *e = &haystack[candidates[i]];
             if (inLatRange(e, lat1, lat2, options)) {
                 matches[count++] = *e;
                 *alloc += e->jsonOffset.len;
             }
         }
     }
+    sfree(candidates);
     //fprintf(stderr, "box: lat %.1f to %.1f, lon %.1f to %.1f, count: %d\n", box[0], box[1], box[2], box[3], count);
     return count;
 }
@@ -329,7 +282,7 @@ static int findHexList(struct apiEntry **hashList, uint32_t *hexList, int hexCou
     }
     return count;
 }
-static int findInCircle(struct apiEntry *haystack, int haylen, struct apiOptions *options, struct apiEntry *matches, size_t *alloc) {
+static int findInCircle(struct apiEntry *haystack, int haylen, struct apiGrid *grid, struct apiOptions *options, struct apiEntry *matches, size_t *alloc) {
     struct apiCircle *circle = &options->circle;
     struct range r[2];
     memset(r, 0, sizeof(r));
@@ -375,21 +328,25 @@ static int findInCircle(struct apiEntry *haystack, int haylen, struct apiOptions
         r[1] = findLonRange(-180E6, lon2, haystack, haylen);
         //fprintf(stderr, "%.1f to 180 and -180 to %1.f\n", lon1 / 1E6, lon2 / 1E6);
     }
+    // apiGridFind only returns entries within the longitude ranges
+    int32_t *candidates = cmalloc(imax(1, (r[0].to - r[0].from) + (r[1].to - r[1].from)) * sizeof(int32_t));
+    int candidateCount = 0;
+    for (int k = 0; k < 2; k++) {
+        candidateCount += apiGridFind(grid, haystack, r[k], lat1, lat2, candidates + candidateCount);
+    }
     if (onlyClosest) {
         bool found = false;
         double minDistance = 300E6; // larger than any distances we encounter, also how far light travels in a second
-        for (int k = 0; k < 2; k++) {
-            for (int j = r[k].from; j < r[k].to; j++) {
-                struct apiEntry *e = &haystack[j];
-                if (inLatRange(e, lat1, lat2, options)) {
-                    double dist = greatcircle(lat, lon, e->bin.lat / 1E6, e->bin.lon / 1E6, 0);
-                    if (dist < radius && dist < minDistance) {
-                        // first match is overwritten repeatedly
-                        matches[0] = *e;
-                        matches[0].distance = (float) dist;
-                        minDistance = dist;
-                        found = true;
-                    }
+        for (int i = 0; i < candidateCount; i++) {
+            struct apiEntry *e = &haystack[candidates[i]];
+            if (inLatRange(e, lat1, lat2, options)) {
+                double dist = greatcircle(lat, lon, e->bin.lat / 1E6, e->bin.lon / 1E6, 0);
+                if (dist < radius && dist < minDistance) {
+                    // first match is overwritten repeatedly
+                    matches[0] = *e;
+                    matches[0].distance = (float) dist;
+                    minDistance = dist;
+                    found = true;
                 }
             }
         }
@@ -402,22 +359,21 @@ static int findInCircle(struct apiEntry *haystack, int haylen, struct apiOptions
         }
     }
     if (!onlyClosest) {
-        for (int k = 0; k < 2; k++) {
-            for (int j = r[k].from; j < r[k].to; j++) {
-                struct apiEntry *e = &haystack[j];
-                if (inLatRange(e, lat1, lat2, options)) {
-                    double dist = greatcircle(lat, lon, e->bin.lat / 1E6, e->bin.lon / 1E6, 0);
-                    if (dist < radius) {
-                        matches[count] = *e;
-                        matches[count].distance = (float) dist;
-                        matches[count].direction = (float) bearing(lat, lon, e->bin.lat / 1E6, e->bin.lon / 1E6);
-                        *alloc += e->jsonOffset.len;
-                        count++;
-                    }
+        for (int i = 0; i < candidateCount; i++) {
+            struct apiEntry *e = &haystack[candidates[i]];
+            if (inLatRange(e, lat1, lat2, options)) {
+                double dist = greatcircle(lat, lon, e->bin.lat / 1E6, e->bin.lon / 1E6, 0);
+                if (dist < radius) {
+                    matches[count] = *e;
+                    matches[count].distance = (float) dist;
+                    matches[count].direction = (float) bearing(lat, lon, e->bin.lat / 1E6, e->bin.lon / 1E6);
+                    *alloc += e->jsonOffset.len;
+                    count++;
                 }
             }
         }
     }
+    sfree(candidates);
     //fprintf(stderr, "circle count: %d\n", count);
     return count;
 }
@@ -432,18 +388,256 @@ static struct apiEntry *apiAlloc(int count) {
     return buf;
 }
 
-static struct char_buffer apiReq(struct apiThread *thread, struct apiOptions *options) {
+static void apiSliceReserve(struct apiCon *con, int count) {
+    if (con->sliceAlloc >= count) {
+        return;
+    }
+    sfree(con->slices);
+    con->sliceAlloc = count + 64;
+    con->slices = cmalloc(con->sliceAlloc * sizeof(struct iovec));
+}
 
-    int flip = atomic_load(&Modes.apiFlip[thread->index]);
+// append to the slices, extending the last slice if the data follows it directly
+static inline void apiSliceAdd(struct apiCon *con, char *data, size_t len) {
+    if (con->sliceCount > 0) {
+        struct iovec *last = &con->slices[con->sliceCount - 1];
+        if ((char *) last->iov_base + last->iov_len == data) {
+            last->iov_len += len;
+            return;
+        }
+    }
+    con->slices[con->sliceCount].iov_base = data;
+    con->slices[con->sliceCount].iov_len = len;
+    con->sliceCount++;
+}
 
-    struct apiBuffer *buffer = &Modes.apiBuffer[flip];
+static void apiStreamRelease(struct apiCon *con, struct apiThread *thread) {
+    if (con->stream) {
+        atomic_fetch_sub(&con->stream->streams, 1);
+        con->stream = NULL;
+        thread->streamCount--;
+    }
+    con->sliceCount = 0;
+    con->sliceNext = 0;
+}
+
+// copy what's left to send of a streaming reply into the reply buffer, the apiBuffer is about to be rewritten
+static void apiStreamMaterialize(struct apiCon *con, struct apiThread *thread) {
+    size_t remaining = 0;
+    for (int i = con->sliceNext; i < con->sliceCount; i++) {
+        remaining += con->slices[i].iov_len;
+    }
+    char *buf = cmalloc(remaining + 1);
+    char *p = buf;
+    for (int i = con->sliceNext; i < con->sliceCount; i++) {
+        memcpy(p, con->slices[i].iov_base, con->slices[i].iov_len);
+        p += con->slices[i].iov_len;
+    }
+
+    struct char_buffer *reply = &con->reply;
+    thread->responseBytesBuffered += remaining - reply->len;
+    sfree(reply->buffer);
+    reply->buffer = buf;
+    reply->len = remaining;
+    reply->alloc = remaining + 1;
+
+    apiStreamRelease(con, thread);
+    con->slices[0].iov_base = buf;
+    con->slices[0].iov_len = remaining;
+    con->sliceCount = 1;
+}
+
+static void apiStreamReclaim(struct apiThread *thread) {
+    uint64_t one;
+    if (read(thread->eventfd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        perror("apiStreamReclaim: eventfd read");
+    }
+    if (!thread->streamCount) {
+        return;
+    }
+    for (int j = 0; j < Modes.api_fds_per_thread; j++) {
+        struct apiCon *con = &thread->cons[j];
+        if (con->open && con->stream && atomic_load(&con->stream->reclaim)) {
+            apiStreamMaterialize(con, thread);
+        }
+    }
+}
+
+// compress the payload of cb which starts after API_REQ_PADSTART, frees cb
+static struct char_buffer apiCompress(struct apiThread *thread, struct char_buffer cb, int encoding) {
+    char *payload = cb.buffer + API_REQ_PADSTART;
+    size_t payload_len = cb.len - API_REQ_PADSTART;
+
+    struct char_buffer new = { 0 };
+    size_t bound = (encoding == API_ENCODING_GZIP) ? deflateBound(&thread->gzip, payload_len) : ZSTD_compressBound(payload_len);
+    size_t new_alloc = API_REQ_PADSTART + bound;
+    new.buffer = cmalloc(new_alloc);
+
+    struct char_buffer dst;
+    dst.buffer = new.buffer + API_REQ_PADSTART;
+    dst.len = new_alloc - API_REQ_PADSTART;
+
+    size_t compressedSize = 0;
+    int error = 0;
+    if (encoding == API_ENCODING_GZIP) {
+        z_stream *strm = &thread->gzip;
+        deflateReset(strm);
+        strm->next_in = (Bytef *) payload;
+        strm->avail_in = payload_len;
+        strm->next_out = (Bytef *) dst.buffer;
+        strm->avail_out = dst.len;
+        int res = deflate(strm, Z_FINISH);
+        if (res != Z_STREAM_END) {
+            fprintf(stderr, "API gzip error: %d\n", res);
+            error = 1;
+        }
+        compressedSize = strm->total_out;
+    } else {
+        compressedSize = ZSTD_compressCCtx(thread->cctx,
+                dst.buffer, dst.len,
+                payload, payload_len,
+                API_ZSTD_LVL);
+        if (ZSTD_isError(compressedSize)) {
+            fprintf(stderr, "API zstd error: %s\n", ZSTD_getErrorName(compressedSize));
+            error = 1;
+        }
+    }
+
+    //free uncompressed buffer
+    sfree(cb.buffer);
+
+    if (error) {
+        sfree(new.buffer);
+        new.len = 0;
+        return new;
+    }
+
+    new.len = API_REQ_PADSTART + compressedSize;
+    return new;
+}
+
+static int compareStrings(const void *p1, const void *p2) {
+    return strcmp(*(char * const *) p1, *(char * const *) p2);
+}
+
+// normalized cache key: encoding and the query options in sorted order
+// returns 0 if the query can't be cached
+static int apiCacheKey(char *query, char *eoq, char encoding, char *key) {
+    char copy[API_CACHE_KEY_MAX];
+    char *tokens[64];
+    int count = 0;
+
+    int len = eoq - query;
+    if (len + 3 > API_CACHE_KEY_MAX) {
+        return 0;
+    }
+    memcpy(copy, query, len);
+    copy[len] = '\0';
+
+    char *p = copy;
+    char *token;
+    while ((token = strsep(&p, "&"))) {
+        if (!*token)
+            continue;
+        if (count == 64)
+            return 0;
+        tokens[count++] = token;
+    }
+    qsort(tokens, count, sizeof(char *), compareStrings);
+
+    char *k = key;
+    *k++ = encoding;
+    *k++ = ':';
+    for (int i = 0; i < count; i++) {
+        int tlen = strlen(tokens[i]);
+        memcpy(k, tokens[i], tlen);
+        k += tlen;
+        *k++ = '&';
+    }
+    *k = '\0';
+    return 1;
+}
+
+// copy of the cached reply, len 0 if not cached
+// generation is set for apiCachePut
+static struct char_buffer apiCacheGet(struct apiBuffer *buffer, char *key, uint32_t *generation, char **content_encoding) {
+    struct apiCache *cache = &buffer->cache;
+    struct char_buffer cb = { 0 };
+
+    pthread_mutex_lock(&cache->mutex);
+    *generation = cache->generation;
+    for (int i = 0; i < API_CACHE_ENTRIES; i++) {
+        struct apiCacheEntry *entry = &cache->entries[i];
+        if (entry->body && !strcmp(entry->key, key)) {
+            entry->lastUsed = ++cache->useCounter;
+            cb.len = API_REQ_PADSTART + entry->len;
+            cb.buffer = cmalloc(cb.len);
+            memcpy(cb.buffer + API_REQ_PADSTART, entry->body, entry->len);
+            *content_encoding = entry->content_encoding;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&cache->mutex);
+    return cb;
+}
+
+static void apiCachePut(struct apiBuffer *buffer, char *key, uint32_t generation, struct char_buffer cb, char *content_encoding) {
+    struct apiCache *cache = &buffer->cache;
+
+    pthread_mutex_lock(&cache->mutex);
+    // apiUpdate has rewritten the buffer or is rewriting it since the lookup, don't cache the reply
+    if (generation != cache->generation || (generation & 1)) {
+        pthread_mutex_unlock(&cache->mutex);
+        return;
+    }
+    struct apiCacheEntry *victim = &cache->entries[0];
+    for (int i = 0; i < API_CACHE_ENTRIES; i++) {
+        struct apiCacheEntry *entry = &cache->entries[i];
+        if (entry->body && !strcmp(entry->key, key)) {
+            // another thread was quicker
+            pthread_mutex_unlock(&cache->mutex);
+            return;
+        }
+        if (!entry->body || entry->lastUsed < victim->lastUsed) {
+            victim = entry;
+        }
+        if (!victim->body) {
+            break;
+        }
+    }
+    sfree(victim->body);
+    victim->len = cb.len - API_REQ_PADSTART;
+    victim->body = cmalloc(victim->len);
+    memcpy(victim->body, cb.buffer + API_REQ_PADSTART, victim->len);
+    victim->content_encoding = content_encoding;
+    strcpy(victim->key, key);
+    victim->lastUsed = ++cache->useCounter;
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+static void apiCacheClear(struct apiBuffer *buffer) {
+    struct apiCache *cache = &buffer->cache;
+
+    pthread_mutex_lock(&cache->mutex);
+    cache->generation++;
+    for (int i = 0; i < API_CACHE_ENTRIES; i++) {
+        sfree(cache->entries[i].body);
+        cache->entries[i].len = 0;
+        cache->entries[i].lastUsed = 0;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+static struct char_buffer apiReq(struct apiCon *con, struct apiThread *thread, struct apiBuffer *buffer, struct apiOptions *options) {
     struct apiEntry *haystack;
     int haylen;
+    struct apiGrid *grid;
     struct range pos_range;
     struct range all_range;
     if (options->filter_dbFlag) {
         haystack = buffer->list_flag;
         haylen = buffer->len_flag;
+        grid = &buffer->grid_flag;
 
         pos_range = buffer->list_flag_pos_range;
 
@@ -452,6 +646,7 @@ static struct char_buffer apiReq(struct apiThread *thread, struct apiOptions *op
     } else {
         haystack = buffer->list;
         haylen = buffer->len;
+        grid = &buffer->grid;
 
         pos_range = buffer->list_pos_range;
 
@@ -480,7 +675,7 @@ static struct char_buffer apiReq(struct apiThread *thread, struct apiOptions *op
         doFree = 1; matches = apiAlloc(combined_len); if (!matches) { return cb; };
 
         // first get matches for the box
-        count = findInBox(haystack, haylen, options, matches, &alloc);
+        count = findInBox(haystack, haylen, grid, options, matches, &alloc);
 
         if (options->is_hexList) {
             // optionally add matches for &find_hex
@@ -489,7 +684,7 @@ static struct char_buffer apiReq(struct apiThread *thread, struct apiOptions *op
     } else if (options->is_circle) {
         doFree = 1; matches = apiAlloc(haylen); if (!matches) { return cb; };
 
-        count = findInCircle(haystack, haylen, options, matches, &alloc);
+        count = findInCircle(haystack, haylen, grid, options, matches, &alloc);
 
         alloc += count * 30; // adding 27 characters per entry: ,"dst":1000.000, "dir":357
     } else if (options->is_hexList) {
@@ -533,7 +728,41 @@ static struct char_buffer apiReq(struct apiThread *thread, struct apiOptions *op
         }
     }
 
-    if (options->filter_squawk) {
+    int filter_squawk = options->filter_squawk;
+    int filter_with_pos = (options->filter_with_pos || options->all_with_pos);
+    int filter_alt = options->filter_alt_baro;
+
+    if (!doFree && count > 0 && haystack == buffer->list && (filter_squawk || filter_with_pos || filter_alt)) {
+        // matches is a slice of the list: evaluate these filters over the columns
+        // and only copy the entries passing all of them
+        struct apiColumnFilter filter;
+        apiColumnFilterInit(&filter);
+        if (filter_squawk) {
+            filter.squawk = options->squawk;
+        }
+        if (filter_with_pos) {
+            filter.flags |= API_COL_POS;
+        }
+        if (filter_alt) {
+            // aircraft without altitude don't pass
+            filter.altMin = imax(options->above_alt_baro, INT32_MIN + 1);
+            filter.altMax = options->below_alt_baro;
+        }
+        int from = matches - buffer->list;
+        int32_t *selected = cmalloc(count * sizeof(int32_t));
+        count = apiColumnsSelect(&buffer->cols, &filter, from, from + count, selected);
+
+        struct apiEntry *filtered = apiAlloc(count); if (!filtered) { sfree(selected); return cb; }
+        for (int i = 0; i < count; i++) {
+            filtered[i] = buffer->list[selected[i]];
+        }
+        sfree(selected);
+
+        doFree = 1; matches = filtered;
+        filter_squawk = filter_with_pos = filter_alt = 0;
+    }
+
+    if (filter_squawk) {
         struct apiEntry *filtered = apiAlloc(count); if (!filtered) { return cb; }
 
         size_t alloc = alloc_base;
@@ -542,7 +771,7 @@ static struct char_buffer apiReq(struct apiThread *thread, struct apiOptions *op
         if (doFree) { sfree(matches); }; doFree = 1; matches = filtered;
     }
     // filter all_with_pos as pos_range unreliable due do gpsOkBefore f***ery
-    if (options->filter_with_pos || options->all_with_pos) {
+    if (filter_with_pos) {
         struct apiEntry *filtered = apiAlloc(count); if (!filtered) { return cb; }
 
         size_t alloc = alloc_base;
@@ -558,7 +787,7 @@ static struct char_buffer apiReq(struct apiThread *thread, struct apiOptions *op
 
         if (doFree) { sfree(matches); }; doFree = 1; matches = filtered;
     }
-    if (options->filter_alt_baro) {
+    if (filter_alt) {
         struct apiEntry *filtered = apiAlloc(count); if (!filtered) { return cb; }
 
         size_t alloc = alloc_base;
@@ -597,6 +826,22 @@ static struct char_buffer apiReq(struct apiThread *thread, struct apiOptions *op
         alloc = API_REQ_PADSTART + 2 * elementSize + count * elementSize;
     }
 
+    // send the aircraft objects directly from buffer->json unless they need to be modified or compressed
+    int stream = (!options->binCraft && !options->zstd && !options->encoding && !options->is_circle && count > 0);
+    if (stream) {
+        atomic_fetch_add(&buffer->streams, 1);
+        if (atomic_load(&buffer->reclaim)) {
+            // apiUpdate is about to rewrite this buffer, copy instead
+            atomic_fetch_sub(&buffer->streams, 1);
+            stream = 0;
+        } else {
+            con->stream = buffer;
+            thread->streamCount++;
+            alloc = alloc_base;
+            apiSliceReserve(con, count + 2);
+        }
+    }
+
     cb.buffer = cmalloc(alloc);
     if (!cb.buffer)
         return cb;
@@ -679,7 +924,20 @@ static struct char_buffer apiReq(struct apiThread *thread, struct apiOptions *op
 
         char *json = buffer->json;
 
-        for (int i = 0; i < count; i++) {
+        if (stream) {
+            apiSliceAdd(con, payload, p - payload);
+            char *prefixEnd = p;
+            for (int i = 0; i < count; i++) {
+                struct offset off = matches[i].jsonOffset; // READ-ONLY here
+                apiSliceAdd(con, json + off.offset, off.len);
+            }
+            // json objects in cache are terminated by a comma: \n{ .... },
+            con->slices[con->sliceCount - 1].iov_len--;
+            // the rest is generated into the reply buffer again
+            p = prefixEnd;
+        }
+
+        for (int i = 0; i < (stream ? 0 : count); i++) {
             struct apiEntry *e = &matches[i];
             struct offset off = e->jsonOffset; // READ-ONLY here
             if (unlikely(p + off.len + 100 >= end)) {
@@ -713,6 +971,11 @@ static struct char_buffer apiReq(struct apiThread *thread, struct apiOptions *op
             p = safe_snprintf(p, end, "\n,\"ptime\": %.3f", (options->request_processed - options->request_received) / 1000.0);
         }
         p = safe_snprintf(p, end, "\n}\n");
+
+        if (stream) {
+            char *suffix = (char *) con->slices[0].iov_base + con->slices[0].iov_len;
+            apiSliceAdd(con, suffix, p - suffix);
+        }
     }
 
     cb.len = p - cb.buffer;
@@ -727,53 +990,63 @@ static struct char_buffer apiReq(struct apiThread *thread, struct apiOptions *op
         sfree(matches);
     }
 
-    if (options->zstd) {
-        struct char_buffer new = { 0 };
-        size_t new_alloc = API_REQ_PADSTART + ZSTD_compressBound(alloc);
-        new.buffer = cmalloc(new_alloc);
-        memset(new.buffer, 0x0, new_alloc);
-
-        struct char_buffer dst;
-        dst.buffer = new.buffer + API_REQ_PADSTART;
-        dst.len = new_alloc - API_REQ_PADSTART;
-
-        //fprintf(stderr, "payload_len %ld\n", (long) payload_len);
-
-        size_t compressedSize = ZSTD_compressCCtx(thread->cctx,
-                dst.buffer, dst.len,
-                payload, payload_len,
-                API_ZSTD_LVL);
-
-        dst.len = compressedSize;
-        new.len = API_REQ_PADSTART + compressedSize;
-        ident(dst);
-
-        //free uncompressed buffer
-        sfree(cb.buffer);
-
-        cb = new;
-
-        if (ZSTD_isError(compressedSize)) {
-            fprintf(stderr, "API zstd error: %s\n", ZSTD_getErrorName(compressedSize));
-            sfree(cb.buffer);
-            cb.buffer = NULL;
-            cb.len = 0;
-            return cb;
+    int encoding = options->zstd ? API_ENCODING_ZSTD : options->encoding;
+    if (!options->zstd && payload_len < API_COMPRESS_MIN) {
+        // not worth it
+        encoding = API_ENCODING_NONE;
+    }
+    if (encoding) {
+        cb = apiCompress(thread, cb, encoding);
+        if (!options->zstd && cb.len) {
+            con->content_encoding = (encoding == API_ENCODING_GZIP) ? "gzip" : "zstd";
         }
-        //fprintf(stderr, "first 4 bytes: %08x len: %ld\n", *((uint32_t *) cb.buffer), (long) cb.len);
     }
 
     return cb;
 }
 
-static inline void apiAdd(struct apiBuffer *buffer, struct aircraft *a, int64_t now) {
+static inline struct apiEntry *apiPrevEntry(struct apiBuffer *prev, uint32_t hex) {
+    for (struct apiEntry *e = prev->hexHash[hexHash(hex)]; e; e = e->nextHex) {
+        if (e->bin.hex == hex) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static inline void apiAdd(struct apiBuffer *buffer, struct apiBuffer *prev, struct aircraft *a, int64_t now) {
     if (!(includeAircraftJson(now, a)))
         return;
 
     struct apiEntry *entry = &(buffer->list[buffer->len]);
     memset(entry, 0, sizeof(struct apiEntry));
 
-    toBinCraft(a, &entry->bin, now);
+    // read before looking at the aircraft, a change while bin / json are generated will cause them to be generated again next time
+    uint32_t jsonGen = __atomic_load_n(&a->jsonGen, __ATOMIC_ACQUIRE);
+
+    struct apiEntry *old = apiPrevEntry(prev, a->addr);
+    entry->prev = old ? old - prev->list : -1;
+
+    if (old && old->craft == a && old->jsonGen == jsonGen && now < old->reuseUntil) {
+        // unchanged aircraft, only the ages need updating
+        entry->bin = old->bin;
+        entry->bin.lat = old->lat;
+        entry->bin.lon = old->lon;
+        entry->reuseUntil = old->reuseUntil;
+        entry->seenTs = old->seenTs;
+        entry->seenPosTs = old->seenPosTs;
+        binCraftAges(a, &entry->bin, entry->seenTs, entry->seenPosTs, now);
+        entry->reused = 1;
+    } else {
+        entry->reuseUntil = aircraftReuseUntil(a, now);
+        entry->seenTs = a->seen;
+        entry->seenPosTs = a->seenPosReliable;
+        toBinCraft(a, &entry->bin, now);
+    }
+    entry->craft = a;
+    entry->jsonGen = jsonGen;
+    entry->lat = entry->bin.lat;
+    entry->lon = entry->bin.lon;
 
     if (trackDataValid(&a->pos_reliable_valid)) {
         // position valid
@@ -793,12 +1066,16 @@ static inline void apiAdd(struct apiBuffer *buffer, struct aircraft *a, int64_t
     buffer->len++;
 }
 
-static inline void apiGenerateJson(struct apiBuffer *buffer, int64_t now) {
-    sfree(buffer->json);
-    buffer->json = NULL;
-
-    size_t alloc = buffer->len * 1024 + 4096; // The initial buffer is resized as needed
-    buffer->json = (char *) cmalloc(alloc);
+// with json false only the hash lists are built, the json is only needed for the API and aircraft.json
+// objects of aircraft unchanged since the previous snapshot are copied from its json with updated ages
+static inline void apiGenerateJson(struct apiBuffer *buffer, struct apiBuffer *prev, int64_t now, int json) {
+    // keep the allocation from the last time this buffer was used, avoids page faulting in a fresh buffer every update
+    size_t alloc = buffer->jsonAlloc;
+    if (!buffer->json || alloc < (size_t) buffer->len * 1024 + 4096) {
+        sfree(buffer->json);
+        alloc = buffer->len * 1024 + 4096; // The initial buffer is resized as needed
+        buffer->json = (char *) cmalloc(alloc);
+    }
     char *p = buffer->json;
     char *end = buffer->json + alloc;
 
@@ -812,9 +1089,14 @@ static inline void apiGenerateJson(struct apiBuffer *buffer, int64_t now) {
         }
 
         struct apiEntry *entry = &buffer->list[i];
-        struct aircraft *a = aircraftGet(entry->bin.hex);
+        struct apiEntry *old = NULL;
+        if (json && entry->reused && prev->userLocationValid == buffer->userLocationValid
+                && prev->list[entry->prev].jsonOffset.len > 0) {
+            old = &prev->list[entry->prev];
+        }
+        struct aircraft *a = (json && !old) ? aircraftGet(entry->bin.hex) : NULL;
 
-        if (!a) {
+        if (json && !old && !a) {
             fprintf(stderr, "FATAL: apiGenerateJson: aircraft missing, this shouldn't happen.");
             setExit(2);
             entry->jsonOffset.offset = 0;
@@ -836,10 +1118,22 @@ static inline void apiGenerateJson(struct apiBuffer *buffer, int64_t now) {
         buffer->callsignHash[hash] = entry;
         //fprintf(stderr, "callsign: %8s hash: %u\n", entry->bin.callsign, hash);
 
+        if (!json) {
+            entry->jsonOffset.offset = 0;
+            entry->jsonOffset.len = 0;
+            continue;
+        }
+
         char *start = p;
 
         *p++ = '\n';
-        p = sprintAircraftObject(p, end, a, now, 0, NULL);
+        if (old) {
+            // without the newline and comma
+            char *obj = prev->json + old->jsonOffset.offset + 1;
+            p = reprintAircraftObject(p, end, obj, old->jsonOffset.len - 2, &old->ages, &entry->ages, now);
+        } else {
+            p = sprintAircraftObjectAges(p, end, a, now, &entry->ages);
+        }
         *p++ = ',';
 
 
@@ -848,6 +1142,7 @@ static inline void apiGenerateJson(struct apiBuffer *buffer, int64_t now) {
     }
 
     buffer->jsonLen = p - buffer->json;
+    buffer->jsonAlloc = alloc;
 
     if (p >= end) {
         fprintf(stderr, "FATAL: buffer full apiAdd\n");
@@ -856,18 +1151,133 @@ static inline void apiGenerateJson(struct apiBuffer *buffer, int64_t now) {
 }
 
 
+// bring the new entries into the longitude order of the previous snapshot
+// entries not in the previous snapshot are appended in the order they were added
+// the result is nearly sorted by longitude as aircraft move slowly relative to the update interval
+static void apiPrevOrder(struct apiBuffer *buffer, struct apiBuffer *prev) {
+    static int *slots;
+    static int slotsAlloc;
+
+    int slotCount = prev->len + buffer->len;
+    if (slotsAlloc < slotCount) {
+        sfree(slots);
+        slotsAlloc = slotCount + 1024;
+        slots = cmalloc(slotsAlloc * sizeof(int));
+    }
+    for (int k = 0; k < slotCount; k++) {
+        slots[k] = -1;
+    }
+
+    for (int i = 0; i < buffer->len; i++) {
+        int slot = buffer->list[i].prev;
+        if (slot < 0) {
+            slot = prev->len + i;
+        }
+        slots[slot] = i;
+    }
+
+    int j = 0;
+    for (int k = 0; k < slotCount; k++) {
+        if (slots[k] >= 0) {
+            buffer->list_flag[j++] = buffer->list[slots[k]];
+        }
+    }
+
+    // list_flag is rebuilt from list later, swap them instead of copying back
+    struct apiEntry *tmp = buffer->list;
+    buffer->list = buffer->list_flag;
+    buffer->list_flag = tmp;
+}
+
+// insertion sort by longitude, cheap for a nearly sorted list
+// gives up and returns 0 once more than maxMoves entries had to be moved
+static int apiSortNearlySorted(struct apiEntry *list, int len, int64_t maxMoves) {
+    int64_t moves = 0;
+    for (int i = 1; i < len; i++) {
+        if (list[i - 1].bin.lon <= list[i].bin.lon) {
+            continue;
+        }
+        struct apiEntry tmp = list[i];
+        int j = i;
+        while (j > 0 && list[j - 1].bin.lon > tmp.bin.lon) {
+            list[j] = list[j - 1];
+            j--;
+        }
+        list[j] = tmp;
+        moves += i - j;
+        if (moves > maxMoves) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// make sure no API connection is still sending directly from the buffer
+// returns 0 if we are exiting before that is the case
+static int apiReclaim(struct apiBuffer *buffer) {
+    atomic_store(&buffer->reclaim, 1);
+    if (!atomic_load(&buffer->streams)) {
+        return 1;
+    }
+    // wake the API threads, they copy the remaining data of those replies
+    uint64_t one = 1;
+    for (int i = 0; i < Modes.apiThreadCount; i++) {
+        if (Modes.apiThread[i].eventfd > 0 && write(Modes.apiThread[i].eventfd, &one, sizeof(one)) != sizeof(one)) {
+            perror("apiReclaim: eventfd write");
+        }
+    }
+    while (atomic_load(&buffer->streams)) {
+        if (Modes.exit) {
+            return 0;
+        }
+        msleep(1);
+    }
+    return 1;
+}
+
 static int apiUpdate() {
     struct craftArray *ca = &Modes.aircraftActive;
 
     // always clear and update the inactive apiBuffer
     int flip = (atomic_load(&Modes.apiFlip[0]) + 1) % 2;
     struct apiBuffer *buffer = &Modes.apiBuffer[flip];
+    // the published snapshot, only read here
+    struct apiBuffer *prev = &Modes.apiBuffer[(flip + 1) % 2];
+
+    if (!apiReclaim(buffer)) {
+        return 0;
+    }
+
+    // odd generation while the buffer is rewritten, nothing is cached until it's even again
+    apiCacheClear(buffer);
+
+    // reset hashList to NULL, only the buckets used by the old contents of this buffer need clearing
+    for (int i = 0; i < buffer->len; i++) {
+        struct apiEntry *entry = &buffer->list[i];
+        buffer->hexHash[hexHash(entry->bin.hex)] = NULL;
+        buffer->regHash[regHash(entry->bin.registration)] = NULL;
+        buffer->callsignHash[callsignHash(entry->bin.callsign)] = NULL;
+    }
 
     // reset buffer lengths
     buffer->len = 0;
     buffer->len_flag = 0;
 
+    // the read lock only prevents reallocation of ca->list, aircraft can still be added at the end
+    // only look at the aircraft present now so the entries fit the allocation
+    // aircraft are only freed while this thread is locked out, hold the lock just for copying the pointers
+    static struct aircraft **craft;
+    static int craftAlloc;
+    ca_lock_read(ca);
     int acCount = ca->len;
+    if (craftAlloc < acCount) {
+        sfree(craft);
+        craftAlloc = acCount + 1024;
+        craft = cmalloc(craftAlloc * sizeof(struct aircraft *));
+    }
+    memcpy(craft, ca->list, acCount * sizeof(struct aircraft *));
+    ca_unlock_read(ca);
+
     if (buffer->alloc < acCount) {
         if (acCount > 100000) {
             fprintf(stderr, "<3> this is strange, too many aircraft!\n");
@@ -883,33 +1293,31 @@ static int apiUpdate() {
         }
     }
 
-    // reset hashList to NULL
-    memset(buffer->hexHash, 0x0, API_BUCKETS * sizeof(struct apiEntry*));
-    memset(buffer->regHash, 0x0, API_BUCKETS * sizeof(struct apiEntry*));
-    memset(buffer->callsignHash, 0x0, API_BUCKETS * sizeof(struct apiEntry*));
-
-    // reset api list, just in case we don't set the entries completely due to oversight
-    memset(buffer->list, 0x0, buffer->alloc * sizeof(struct apiEntry));
-    memset(buffer->list_flag, 0x0, buffer->alloc * sizeof(struct apiEntry));
+    // apiAdd clears each entry before use, list_flag is completely overwritten before use
 
     buffer->aircraftJsonCount = 0;
+    buffer->userLocationValid = Modes.userLocationValid;
 
     int64_t now = mstime();
-    ca_lock_read(ca);
-    for (int i = 0; i < ca->len; i++) {
-        struct aircraft *a = ca->list[i];
+    for (int i = 0; i < acCount; i++) {
+        struct aircraft *a = craft[i];
 
         if (a == NULL)
             continue;
 
-        apiAdd(buffer, a, now);
+        apiAdd(buffer, prev, a, now);
     }
-    ca_unlock_read(ca);
 
     // sort api lists
-    qsort(buffer->list, buffer->len, sizeof(struct apiEntry), compareLon);
+    // start from the order of the previous snapshot, usually only few entries need moving
+    apiPrevOrder(buffer, prev);
+    if (!apiSortNearlySorted(buffer->list, buffer->len, 4 * (int64_t) buffer->len + 1024)) {
+        qsort(buffer->list, buffer->len, sizeof(struct apiEntry), compareLon);
+    }
+
+    apiGenerateJson(buffer, prev, now, Modes.api || Modes.onlyBin < 2);
 
-    apiGenerateJson(buffer, now);
+    apiColumnsBuild(&buffer->cols, buffer->list, buffer->len);
 
     for (int i = 0; i < buffer->len; i++) {
         struct apiEntry entry = buffer->list[i];
@@ -923,12 +1331,19 @@ static int apiUpdate() {
     buffer->list_pos_range = findLonRange(-180 * 1E6, 180 * 1E6, buffer->list, buffer->len);
     buffer->list_flag_pos_range = findLonRange(-180 * 1E6, 180 * 1E6, buffer->list_flag, buffer->len_flag);
 
+    apiGridBuild(&buffer->grid, buffer->list, buffer->len);
+    apiGridBuild(&buffer->grid_flag, buffer->list_flag, buffer->len_flag);
+
     buffer->timestamp = now;
 
+    // generation even again, replies for the new contents can be cached
+    apiCacheClear(buffer);
+
     // doesn't matter which of the 2 buffers the api req will use they are both pretty current
     for (int i = 0; i < Modes.apiThreadCount; i++) {
         atomic_store(&Modes.apiFlip[i], flip);
     }
+    atomic_store(&buffer->reclaim, 0);
 
     pthread_cond_signal(&Threads.json.cond);
     pthread_cond_signal(&Threads.globeJson.cond);
@@ -969,6 +1384,10 @@ static void apiCloseCon(struct apiCon *con, struct apiThread *thread) {
     con->request.len = 0;
     con->request.alloc = 0;
 
+    apiStreamRelease(con, thread);
+    sfree(con->slices);
+    con->sliceAlloc = 0;
+
     struct char_buffer *reply = &con->reply;
 
     thread->responseBytesBuffered -= reply->len;
@@ -1003,6 +1422,8 @@ static void apiResetCon(struct apiCon *con, struct apiThread *thread) {
 
     con->bytesSent = 0;
 
+    apiStreamRelease(con, thread);
+
     struct char_buffer *reply = &con->reply;
 
     thread->responseBytesBuffered -= reply->len;
@@ -1100,6 +1521,10 @@ static struct char_buffer parseFetch(struct apiCon *con, struct char_buffer *req
     // we only want the URL
     *eoq = '\0';
 
+    // the tokenizer below modifies the query, build the cache key first
+    char cacheKey[API_CACHE_KEY_MAX];
+    int cacheKeyValid = apiCacheKey(query, eoq, 'n', cacheKey);
+
     struct apiOptions optionsBack = { 0 };
     struct apiOptions *options = &optionsBack;
 
@@ -1353,10 +1778,97 @@ static struct char_buffer parseFetch(struct apiCon *con, struct char_buffer *req
          con->content_type = "application/json";
     }
 
-    return apiReq(thread, options);
+    char encodingKey = 'n';
+    if (options->zstd) {
+        encodingKey = 'r'; // raw zstd requested as a query option
+    } else if (con->acceptEncoding & API_ENCODING_ZSTD) {
+        options->encoding = API_ENCODING_ZSTD;
+        encodingKey = 'z';
+    } else if (con->acceptEncoding & API_ENCODING_GZIP) {
+        options->encoding = API_ENCODING_GZIP;
+        encodingKey = 'g';
+    }
+
+    int flip = atomic_load(&Modes.apiFlip[thread->index]);
+    struct apiBuffer *buffer = &Modes.apiBuffer[flip];
+
+    // uncompressed replies are sent straight from the apiBuffer, caching only helps when compressing
+    if (encodingKey == 'n' || !cacheKeyValid) {
+        return apiReq(con, thread, buffer, options);
+    }
+    cacheKey[0] = encodingKey;
+
+    uint32_t generation;
+    struct char_buffer cb = apiCacheGet(buffer, cacheKey, &generation, &con->content_encoding);
+    if (cb.len) {
+        return cb;
+    }
+    cb = apiReq(con, thread, buffer, options);
+    if (cb.len) {
+        apiCachePut(buffer, cacheKey, generation, cb, con->content_encoding);
+    }
+    return cb;
+}
+
+static void apiSetEpollOut(struct apiCon *con, struct apiThread *thread) {
+    if (!(con->events & EPOLLOUT)) {
+        con->events = EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP | EPOLLOUT;
+        struct epoll_event epollEvent = { .events = con->events };
+        epollEvent.data.ptr = con;
+
+        if (epoll_ctl(thread->epfd, EPOLL_CTL_MOD, con->fd, &epollEvent)) {
+            perror("apiSendData() epoll_ctl fail:");
+        }
+    }
+}
+
+static void apiSendSlices(struct apiCon *con, struct apiThread *thread) {
+    while (con->sliceNext < con->sliceCount) {
+        int iovcnt = imin(con->sliceCount - con->sliceNext, IOV_MAX);
+        ssize_t nwritten = writev(con->fd, &con->slices[con->sliceNext], iovcnt);
+
+        if (nwritten < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                // no progress, make sure EPOLLOUT is set.
+                apiSetEpollOut(con, thread);
+            } else {
+                // non recoverable error, close connection
+                if (antiSpam(&thread->antiSpam[0], 5 * SECONDS)) {
+                    fprintf(stderr, "apiSendData fail: %s\n", strerror(errno));
+                }
+                apiCloseCon(con, thread);
+            }
+            return;
+        }
+
+        con->bytesSent += nwritten;
+        while (nwritten > 0) {
+            struct iovec *slice = &con->slices[con->sliceNext];
+            if ((size_t) nwritten >= slice->iov_len) {
+                nwritten -= slice->iov_len;
+                con->sliceNext++;
+            } else {
+                slice->iov_base = (char *) slice->iov_base + nwritten;
+                slice->iov_len -= nwritten;
+                nwritten = 0;
+            }
+        }
+        // skip empty slices so the loop condition reflects the remaining data
+        while (con->sliceNext < con->sliceCount && con->slices[con->sliceNext].iov_len == 0) {
+            con->sliceNext++;
+        }
+    }
+
+    // all data has been sent, reset the connection
+    apiResetCon(con, thread);
 }
 
 static void apiSendData(struct apiCon *con, struct apiThread *thread) {
+    if (con->sliceCount) {
+        apiSendSlices(con, thread);
+        return;
+    }
+
     struct char_buffer *reply = &con->reply;
     int toSend = reply->len - con->bytesSent;
 
@@ -1406,15 +1918,7 @@ static void apiSendData(struct apiCon *con, struct apiThread *thread) {
     //fprintf(stderr, "wrote only %d of %d\n", nwritten, toSend);
 
     // couldn't write everything, set EPOLLOUT
-    if (!(con->events & EPOLLOUT)) {
-        con->events = EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP | EPOLLOUT;
-        struct epoll_event epollEvent = { .events = con->events };
-        epollEvent.data.ptr = con;
-
-        if (epoll_ctl(thread->epfd, EPOLL_CTL_MOD, con->fd, &epollEvent)) {
-            perror("apiSendData() epoll_ctl fail:");
-        }
-    }
+    apiSetEpollOut(con, thread);
 
     return;
 }
@@ -1549,9 +2053,18 @@ static void apiReadRequest(struct apiCon *con, struct apiThread *thread) {
     // header parsing
     char *hl = eol;
     con->keepalive = con->http_minor_version == 1 ? 1 : 0;
+    con->acceptEncoding = API_ENCODING_NONE;
     while (hl < req_end && (eol = memchr(hl, '\n', req_end - hl))) {
         *eol = '\0';
 
+        if (byteMatchStart(hl, "accept-encoding")) {
+            if (strstr(hl, "zstd")) {
+                con->acceptEncoding |= API_ENCODING_ZSTD;
+            }
+            if (strstr(hl, "gzip")) {
+                con->acceptEncoding |= API_ENCODING_GZIP;
+            }
+        }
         if (byteMatchStart(hl, "connection")) {
             if (strstr(hl, "close")) {
                 con->keepalive = 0;
@@ -1589,6 +2102,7 @@ static void apiReadRequest(struct apiCon *con, struct apiThread *thread) {
     }
 
     con->content_type = "multipart/mixed";
+    con->content_encoding = NULL;
     struct char_buffer reply = parseFetch(con, request, thread);
     if (reply.len == 0) {
         //fprintf(stderr, "parseFetch returned invalid\n");
@@ -1605,17 +2119,28 @@ static void apiReadRequest(struct apiCon *con, struct apiThread *thread) {
     char *end = header + API_REQ_PADSTART;
 
     int content_len = reply.len - API_REQ_PADSTART;
+    if (con->sliceCount) {
+        // streaming reply, the slices cover the whole body
+        content_len = 0;
+        for (int i = 0; i < con->sliceCount; i++) {
+            content_len += con->slices[i].iov_len;
+        }
+    }
 
     p = safe_snprintf(p, end,
             "HTTP/1.1 200 OK\r\n"
             "server: readsb/3.1442\r\n"
             "%s"
             "content-type: %s\r\n"
+            "%s%s%s"
             "connection: %s\r\n"
             "cache-control: no-store\r\n"
             "content-length: %d\r\n\r\n",
             con->include_version ? "readsb_version: "MODES_READSB_VERSION"\r\n" : "",
             con->content_type,
+            con->content_encoding ? "content-encoding: " : "",
+            con->content_encoding ? con->content_encoding : "",
+            con->content_encoding ? "\r\n" : "",
             con->keepalive ? "keep-alive" : "close",
             content_len);
 
@@ -1633,6 +2158,12 @@ static void apiReadRequest(struct apiCon *con, struct apiThread *thread) {
     // copy the header into the correct position immediately before the payload (which we already have)
     memcpy(reply.buffer + con->bytesSent, header, hlen);
 
+    if (con->sliceCount) {
+        // the first slice starts with the payload, include the header
+        con->slices[0].iov_base = reply.buffer + con->bytesSent;
+        con->slices[0].iov_len += hlen;
+    }
+
     con->reply = reply;
     apiSendData(con, thread);
 }
@@ -1742,6 +2273,11 @@ static void *apiThreadEntryPoint(void *arg) {
     }
 
     thread->cctx = ZSTD_createCCtx();
+    // windowBits 15 + 16: gzip header and trailer
+    if (deflateInit2(&thread->gzip, API_GZIP_LVL, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        fprintf(stderr, "FATAL: API deflateInit2 failed!\n");
+        setExit(2);
+    }
 
     thread->epfd = my_epoll_create(&Modes.exitNowEventfd);
 
@@ -1755,6 +2291,12 @@ static void *apiThreadEntryPoint(void *arg) {
         }
     }
 
+    struct epoll_event reclaimEvent = { .events = EPOLLIN };
+    reclaimEvent.data.ptr = &thread->eventfd;
+    if (epoll_ctl(thread->epfd, EPOLL_CTL_ADD, thread->eventfd, &reclaimEvent)) {
+        perror("apiThreadEntryPoint() epoll_ctl fail:");
+    }
+
     int count = 0;
     struct epoll_event *events = NULL;
     int maxEvents = 0;
@@ -1788,6 +2330,10 @@ static void *apiThreadEntryPoint(void *arg) {
             struct epoll_event event = events[i];
             if (event.data.ptr == &Modes.exitNowEventfd)
                 continue;
+            if (event.data.ptr == &thread->eventfd) {
+                apiStreamReclaim(thread);
+                continue;
+            }
 
             struct apiCon *con = event.data.ptr;
             if (con->accept && (event.events & EPOLLIN)) {
@@ -1843,6 +2389,7 @@ static void *apiThreadEntryPoint(void *arg) {
     sfree(events);
 
     ZSTD_freeCCtx(thread->cctx);
+    deflateEnd(&thread->gzip);
     close(thread->epfd);
 
     sfree(thread->stack);
@@ -1898,6 +2445,12 @@ void apiBufferInit() {
         buffer->hexHash = cmalloc(API_BUCKETS * sizeof(struct apiEntry*));
         buffer->regHash = cmalloc(API_BUCKETS * sizeof(struct apiEntry*));
         buffer->callsignHash = cmalloc(API_BUCKETS * sizeof(struct apiEntry*));
+        // apiUpdate only clears the buckets it used in the previous update
+        memset(buffer->hexHash, 0x0, API_BUCKETS * sizeof(struct apiEntry*));
+        memset(buffer->regHash, 0x0, API_BUCKETS * sizeof(struct apiEntry*));
+        memset(buffer->callsignHash, 0x0, API_BUCKETS * sizeof(struct apiEntry*));
+        memset(&buffer->cache, 0x0, sizeof(struct apiCache));
+        pthread_mutex_init(&buffer->cache.mutex, NULL);
     }
     apiUpdate(); // run an initial apiUpdate
 
@@ -1922,6 +2475,14 @@ void apiBufferCleanup() {
         sfree(Modes.apiBuffer[i].hexHash);
         sfree(Modes.apiBuffer[i].regHash);
         sfree(Modes.apiBuffer[i].callsignHash);
+        apiGridFree(&Modes.apiBuffer[i].grid);
+        apiGridFree(&Modes.apiBuffer[i].grid_flag);
+        apiColumnsFree(&Modes.apiBuffer[i].cols);
+        struct apiCache *cache = &Modes.apiBuffer[i].cache;
+        for (int k = 0; k < API_CACHE_ENTRIES; k++) {
+            sfree(cache->entries[k].body);
+        }
+        pthread_mutex_destroy(&cache->mutex);
     }
 
     sfree(Modes.apiThread);
@@ -1966,12 +2527,15 @@ void apiInit() {
     //fprintf(stderr, "Modes.api_fds_per_thread: %d\n", Modes.api_fds_per_thread);
     for (int i = 0; i < Modes.apiThreadCount; i++) {
         Modes.apiThread[i].index = i;
+        Modes.apiThread[i].eventfd = eventfd(0, EFD_NONBLOCK);
         pthread_create(&Modes.apiThread[i].thread, NULL, apiThreadEntryPoint, &Modes.apiThread[i]);
     }
 }
 void apiCleanup() {
     for (int i = 0; i < Modes.apiThreadCount; i++) {
         pthread_join(Modes.apiThread[i].thread, NULL);
+        close(Modes.apiThread[i].eventfd);
+        Modes.apiThread[i].eventfd = -1;
     }
     struct net_service *service = &Modes.apiService;
 
@@ -1988,12 +2552,27 @@ void apiCleanup() {
     }
 }
 
+// counts as a stream like the API replies sent directly from the json, apiReclaim waits for the release
+struct apiBuffer *apiSnapshotAcquire() {
+    while (1) {
+        struct apiBuffer *buffer = &Modes.apiBuffer[atomic_load(&Modes.apiFlip[0])];
+        atomic_fetch_add(&buffer->streams, 1);
+        if (!atomic_load(&buffer->reclaim)) {
+            return buffer;
+        }
+        // apiUpdate is rewriting it, the flip now points to the other buffer
+        atomic_fetch_sub(&buffer->streams, 1);
+    }
+}
+
+void apiSnapshotRelease(struct apiBuffer *buffer) {
+    atomic_fetch_sub(&buffer->streams, 1);
+}
+
 struct char_buffer apiGenerateAircraftJson(threadpool_buffer_t *pbuffer) {
     struct char_buffer cb = { 0 };
 
-    int flip = atomic_load(&Modes.apiFlip[0]);
-
-    struct apiBuffer *buffer = &Modes.apiBuffer[flip];
+    struct apiBuffer *buffer = apiSnapshotAcquire();
 
     ssize_t alloc = buffer->jsonLen + 2048;
 
@@ -2002,6 +2581,7 @@ struct char_buffer apiGenerateAircraftJson(threadpool_buffer_t *pbuffer) {
     char *end = buf + alloc;
 
     if (!buf) {
+        apiSnapshotRelease(buffer);
         return cb;
     }
 
@@ -2024,6 +2604,8 @@ struct char_buffer apiGenerateAircraftJson(threadpool_buffer_t *pbuffer) {
 
     p = safe_snprintf(p, end, "\n  ]\n}\n");
 
+    apiSnapshotRelease(buffer);
+
     cb.len = p - buf;
     cb.buffer = buf;
     return cb;
@@ -2034,11 +2616,15 @@ struct char_buffer apiGenerateGlobeJson(int globe_index, threadpool_buffer_t *pb
 
     struct char_buffer cb = { 0 };
 
-    int flip = atomic_load(&Modes.apiFlip[0]);
+    struct apiBuffer *buffer = apiSnapshotAcquire();
 
-    struct apiBuffer *buffer = &Modes.apiBuffer[flip];
+    int tileLen;
+    int32_t *tileList = apiColumnsTile(&buffer->cols, globe_index, &tileLen);
 
-    ssize_t alloc = 16 * 1024 + buffer->jsonLen;
+    ssize_t alloc = 16 * 1024;
+    for (int j = 0; j < tileLen; j++) {
+        alloc += buffer->list[tileList[j]].jsonOffset.len;
+    }
 
     char *buf = check_grow_threadpool_buffer_t(pbuffer, alloc);
     char *p = buf;
@@ -2085,11 +2671,8 @@ struct char_buffer apiGenerateGlobeJson(int globe_index, threadpool_buffer_t *pb
 
     p = safe_snprintf(p, end, "  \"aircraft\" : [");
 
-    for (int j = 0; j < buffer->len; j++) {
-
-        struct apiEntry *entry = &buffer->list[j];
-        if (entry->globe_index != globe_index)
-            continue;
+    for (int j = 0; j < tileLen; j++) {
+        struct apiEntry *entry = &buffer->list[tileList[j]];
 
         // check if we have enough space
         if (p + entry->jsonOffset.len >= end) {
@@ -2108,6 +2691,8 @@ struct char_buffer apiGenerateGlobeJson(int globe_index, threadpool_buffer_t *pb
 
     p = safe_snprintf(p, end, "\n  ]\n}\n");
 
+    apiSnapshotRelease(buffer);
+
     cb.len = p - buf;
     cb.buffer = buf;
     return cb;
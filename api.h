@@ -6,6 +6,17 @@
 #define API_REQ_LIST_MAX 1024
 
 #define API_ZSTD_LVL (2)
+#define API_GZIP_LVL (3)
+
+// compressed replies for the same query are cached until the apiBuffer is rewritten
+#define API_CACHE_ENTRIES (32)
+#define API_CACHE_KEY_MAX (256)
+// smaller replies are sent uncompressed
+#define API_COMPRESS_MIN (1024)
+
+#define API_ENCODING_NONE (0)
+#define API_ENCODING_GZIP (1 << 0)
+#define API_ENCODING_ZSTD (1 << 1)
 
 struct apiCon {
     int fd;
@@ -21,6 +32,15 @@ struct apiCon {
     struct char_buffer request;
     int64_t lastReset; // milliseconds
     char *content_type;
+    char *content_encoding; // NULL unless the reply is compressed according to accept-encoding
+    int acceptEncoding; // API_ENCODING_ flags from the request header
+    // JSON replies are sent as a list of slices, most of them pointing directly into the json of an apiBuffer
+    // the reply buffer then only holds the header and the small parts generated for this request
+    struct iovec *slices;
+    int sliceCount;
+    int sliceNext; // first slice not completely sent
+    int sliceAlloc;
+    struct apiBuffer *stream; // apiBuffer the slices point into, NULL if they only point into the reply buffer
 };
 
 struct apiCircle {
@@ -50,6 +70,7 @@ struct apiOptions {
     int filter_squawk;
     int binCraft;
     int zstd;
+    int encoding; // API_ENCODING_ content-encoding of the reply
     unsigned squawk;
     int filter_dbFlag;
     int filter_mil;
@@ -91,6 +112,20 @@ struct apiEntry {
     float distance;
     float direction;
     int32_t globe_index;
+
+    // bin.lat / bin.lon as from toBinCraft, apiAdd moves aircraft without position to the end of the list
+    int32_t lat;
+    int32_t lon;
+
+    // bin and json are copied from the previous snapshot while the aircraft is unchanged, see apiAdd
+    struct aircraft *craft;
+    uint32_t jsonGen; // craft->jsonGen when bin was generated
+    int32_t prev; // index into the list of the previous snapshot, -1 if the aircraft wasn't in it
+    int32_t reused; // bin was copied, the json can be copied as well
+    int64_t reuseUntil; // see aircraftReuseUntil
+    int64_t seenTs; // bin.seen and bin.seen_pos are the ages of these
+    int64_t seenPosTs;
+    struct jsonAges ages;
 };
 
 struct range {
@@ -98,6 +133,63 @@ struct range {
     int to; // exclusive
 };
 
+#define API_GRID_COLUMN_MIN (32)
+
+struct apiGridEntry {
+    int32_t lat;
+    int32_t index; // into the longitude sorted apiEntry list
+};
+
+// see api_grid.c
+struct apiGrid {
+    int len;
+    int alloc;
+    int columnSize;
+    struct apiGridEntry *entries;
+};
+
+#define API_COL_POS (1 << 0) // position_valid
+#define API_COL_MIL (1 << 1) // dbFlags & 1
+
+// see api_columns.c
+struct apiColumns {
+    int alloc;
+    int len;
+    uint32_t *hex;
+    int32_t *lat;
+    int32_t *lon;
+    int32_t *alt; // baro altitude in ft, 0 on the ground, INT32_MIN if unknown
+    int32_t *squawk; // -1 if not valid
+    int32_t *dbFlags;
+    int32_t *flags; // API_COL_
+    int32_t *globe_index;
+    int32_t *tileStart; // GLOBE_MAX_INDEX + 2 offsets into tileOrder
+    int32_t *tileOrder; // list indexes grouped by globe_index
+};
+
+struct apiColumnFilter {
+    int32_t altMin;
+    int32_t altMax;
+    int32_t squawk; // -1 for any
+    int32_t dbFlags; // any of these set, 0 for any
+    int32_t flags; // all of these API_COL_ set
+};
+
+struct apiCacheEntry {
+    char key[API_CACHE_KEY_MAX];
+    char *body;
+    size_t len;
+    char *content_encoding;
+    uint64_t lastUsed;
+};
+
+// LRU cache of compressed replies, cleared when the apiBuffer is rewritten
+struct apiCache {
+    pthread_mutex_t mutex;
+    uint32_t generation;
+    uint64_t useCounter;
+    struct apiCacheEntry entries[API_CACHE_ENTRIES];
+};
 
 struct apiBuffer {
     int len;
@@ -107,21 +199,30 @@ struct apiBuffer {
     struct apiEntry *list_flag;
     struct range list_pos_range;
     struct range list_flag_pos_range;
+    struct apiGrid grid;
+    struct apiGrid grid_flag;
+    struct apiColumns cols;
     int64_t timestamp;
     char *json;
     int jsonLen;
+    size_t jsonAlloc;
     struct apiEntry **hexHash;
     struct apiEntry **regHash;
     struct apiEntry **callsignHash;
     uint32_t focus;
+    int userLocationValid; // Modes.userLocationValid when the json was generated
     int aircraftJsonCount;
+    atomic_int streams; // connections sending directly from json
+    atomic_int reclaim; // set by apiUpdate before this buffer is rewritten
+    struct apiCache cache;
 };
 
 struct apiThread {
     pthread_t thread;
     int index;
     int epfd;
-    int eventfd;
+    int eventfd; // wakes the thread when an apiBuffer is reclaimed
+    int streamCount; // connections with a reply streaming from an apiBuffer
     int responseBytesBuffered;
     uint32_t requestCount;
     int conCount;
@@ -129,6 +230,7 @@ struct apiThread {
     struct apiCon *cons;
     struct apiCon **stack;
     ZSTD_CCtx* cctx;
+    z_stream gzip;
     // for producing average request len numbers
     int64_t request_len_sum;
     int64_t request_count;
@@ -142,6 +244,26 @@ void apiBufferCleanup();
 void apiInit();
 void apiCleanup();
 
+struct range findLonRange(int32_t ref_from, int32_t ref_to, struct apiEntry *list, int len);
+
+void apiGridBuild(struct apiGrid *grid, struct apiEntry *list, int len);
+void apiGridFree(struct apiGrid *grid);
+// indexes of the list entries in the longitude range r with lat1 <= lat <= lat2, in list order
+// out needs room for r.to - r.from entries
+int apiGridFind(struct apiGrid *grid, struct apiEntry *list, struct range r, int32_t lat1, int32_t lat2, int32_t *out);
+
+void apiColumnsBuild(struct apiColumns *cols, struct apiEntry *list, int len);
+void apiColumnsFree(struct apiColumns *cols);
+void apiColumnFilterInit(struct apiColumnFilter *filter);
+// indexes in [from, to) passing the filter, out needs room for to - from entries
+int apiColumnsSelect(struct apiColumns *cols, struct apiColumnFilter *filter, int from, int to, int32_t *out);
+// list indexes of the aircraft on the globe tile
+int32_t *apiColumnsTile(struct apiColumns *cols, int globe_index, int *len);
+
+// the published apiBuffer, it's not rewritten until released
+struct apiBuffer *apiSnapshotAcquire();
+void apiSnapshotRelease(struct apiBuffer *buffer);
+
 struct char_buffer apiGenerateAircraftJson(threadpool_buffer_t *pbuffer);
 struct char_buffer apiGenerateGlobeJson(int globe_index, threadpool_buffer_t *pbuffer);
 
@@ -0,0 +1,158 @@
+#include "readsb.h"
+
+// Columnar copy of an apiBuffer snapshot.
+//
+// apiUpdate fills the columns in list order once per snapshot. The file writers and the filters
+// of whole list API queries evaluate their predicates over these arrays instead of striding through
+// the apiEntry rows and only copy the rows that pass.
+// For the globe tiles the list indexes are grouped by globe_index (counting sort),
+// writing a tile only touches the aircraft on it.
+
+#define COLUMN_BLOCK (16)
+
+static void columnsAlloc(struct apiColumns *cols, int len) {
+    if (cols->alloc >= len && cols->hex) {
+        return;
+    }
+    apiColumnsFree(cols);
+    cols->alloc = len + 1024;
+    size_t bytes = cols->alloc * sizeof(int32_t);
+    cols->hex = cmalloc(bytes);
+    cols->lat = cmalloc(bytes);
+    cols->lon = cmalloc(bytes);
+    cols->alt = cmalloc(bytes);
+    cols->squawk = cmalloc(bytes);
+    cols->dbFlags = cmalloc(bytes);
+    cols->flags = cmalloc(bytes);
+    cols->globe_index = cmalloc(bytes);
+    cols->tileOrder = cmalloc(bytes);
+}
+
+void apiColumnsFree(struct apiColumns *cols) {
+    sfree(cols->hex);
+    sfree(cols->lat);
+    sfree(cols->lon);
+    sfree(cols->alt);
+    sfree(cols->squawk);
+    sfree(cols->dbFlags);
+    sfree(cols->flags);
+    sfree(cols->globe_index);
+    sfree(cols->tileOrder);
+    sfree(cols->tileStart);
+    cols->alloc = 0;
+    cols->len = 0;
+}
+
+static void buildTiles(struct apiColumns *cols) {
+    int tiles = GLOBE_MAX_INDEX + 1;
+    if (!cols->tileStart) {
+        cols->tileStart = cmalloc((tiles + 1) * sizeof(int32_t));
+    }
+    int32_t *start = cols->tileStart;
+    memset(start, 0, (tiles + 1) * sizeof(int32_t));
+
+    // count into start[index + 1], prefix sum, then place
+    for (int i = 0; i < cols->len; i++) {
+        int index = cols->globe_index[i];
+        if (index >= 0 && index < tiles) {
+            start[index + 1]++;
+        }
+    }
+    for (int k = 0; k < tiles; k++) {
+        start[k + 1] += start[k];
+    }
+    for (int i = 0; i < cols->len; i++) {
+        int index = cols->globe_index[i];
+        if (index >= 0 && index < tiles) {
+            cols->tileOrder[start[index]++] = i;
+        }
+    }
+    // placing moved every start to the start of the next tile
+    memmove(start + 1, start, tiles * sizeof(int32_t));
+    start[0] = 0;
+}
+
+void apiColumnsBuild(struct apiColumns *cols, struct apiEntry *list, int len) {
+    columnsAlloc(cols, len);
+    cols->len = len;
+    float reverse_alt_factor = 1.0f / BINCRAFT_ALT_FACTOR;
+    for (int i = 0; i < len; i++) {
+        struct apiEntry *e = &list[i];
+        struct binCraft *bin = &e->bin;
+        cols->hex[i] = bin->hex;
+        cols->lat[i] = e->lat;
+        cols->lon[i] = e->lon;
+
+        // same as filter_alt_baro used to do per entry
+        int32_t alt = INT32_MIN;
+        if (bin->baro_alt_valid) {
+            alt = bin->baro_alt * reverse_alt_factor;
+        } else if (bin->airground == AG_GROUND) {
+            alt = 0;
+        }
+        cols->alt[i] = alt;
+
+        cols->squawk[i] = bin->squawk_valid ? bin->squawk : -1;
+        cols->dbFlags[i] = bin->dbFlags;
+        cols->flags[i] = (bin->position_valid ? API_COL_POS : 0) | ((bin->dbFlags & 1) ? API_COL_MIL : 0);
+        cols->globe_index[i] = e->globe_index;
+    }
+    if (Modes.json_globe_index) {
+        buildTiles(cols);
+    }
+}
+
+void apiColumnFilterInit(struct apiColumnFilter *filter) {
+    filter->altMin = INT32_MIN;
+    filter->altMax = INT32_MAX;
+    filter->squawk = -1;
+    filter->dbFlags = 0;
+    filter->flags = 0;
+}
+
+int apiColumnsSelect(struct apiColumns *cols, struct apiColumnFilter *filter, int from, int to, int32_t *out) {
+    int count = 0;
+    uint8_t pass[COLUMN_BLOCK];
+
+    int32_t altMin = filter->altMin;
+    int32_t altMax = filter->altMax;
+    int32_t squawk = filter->squawk;
+    int32_t anySquawk = (squawk < 0);
+    int32_t dbMask = filter->dbFlags;
+    int32_t anyDb = (dbMask == 0);
+    int32_t flagMask = filter->flags;
+
+    for (int i = from; i < to; i += COLUMN_BLOCK) {
+        int n = imin(COLUMN_BLOCK, to - i);
+        const int32_t *restrict alt = cols->alt + i;
+        const int32_t *restrict sq = cols->squawk + i;
+        const int32_t *restrict db = cols->dbFlags + i;
+        const int32_t *restrict fl = cols->flags + i;
+        // no branches and for full blocks a constant trip count, this is compiled to vector compares
+        if (n == COLUMN_BLOCK) {
+            for (int k = 0; k < COLUMN_BLOCK; k++) {
+                pass[k] = (alt[k] >= altMin) & (alt[k] <= altMax) & ((fl[k] & flagMask) == flagMask)
+                    & (anySquawk | (sq[k] == squawk)) & (anyDb | ((db[k] & dbMask) != 0));
+            }
+        } else {
+            for (int k = 0; k < n; k++) {
+                pass[k] = (alt[k] >= altMin) & (alt[k] <= altMax) & ((fl[k] & flagMask) == flagMask)
+                    & (anySquawk | (sq[k] == squawk)) & (anyDb | ((db[k] & dbMask) != 0));
+            }
+        }
+        for (int k = 0; k < n; k++) {
+            out[count] = i + k;
+            count += pass[k];
+        }
+    }
+    return count;
+}
+
+int32_t *apiColumnsTile(struct apiColumns *cols, int globe_index, int *len) {
+    if (!cols->tileStart || globe_index < 0 || globe_index > GLOBE_MAX_INDEX) {
+        *len = 0;
+        return cols->tileOrder;
+    }
+    *len = cols->tileStart[globe_index + 1] - cols->tileStart[globe_index];
+    return cols->tileOrder + cols->tileStart[globe_index];
+}
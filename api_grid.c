@@ -0,0 +1,156 @@
+#include "readsb.h"
+
+// Density adaptive index for the API box and circle queries.
+//
+// The apiBuffer list is sorted by longitude, cutting it into columns of columnSize consecutive
+// entries gives longitude strips holding the same number of aircraft each, narrow where traffic is dense.
+// Within each column the entries are sorted by latitude, a query binary searches the latitude range
+// in every column overlapping its longitude range and only looks at the entries inside both.
+
+struct range findLonRange(int32_t ref_from, int32_t ref_to, struct apiEntry *list, int len) {
+    struct range res;
+    memset(&res, 0, sizeof(res));
+    if (len == 0 || ref_from > ref_to)
+        return res;
+
+    // get lower bound
+    int i = 0;
+    int j = len - 1;
+    while (j > i + 1) {
+
+        int pivot = (i + j) / 2;
+
+        if (list[pivot].bin.lon < ref_from)
+            i = pivot;
+        else
+            j = pivot;
+    }
+
+    if (list[j].bin.lon < ref_from) {
+        res.from = j + 1;
+    } else if (list[i].bin.lon < ref_from) {
+        res.from = i + 1;
+    } else {
+        res.from = i;
+    }
+
+
+    // get upper bound (exclusive)
+    i = imin(res.from, len - 1);
+    j = len - 1;
+    while (j > i + 1) {
+
+        int pivot = (i + j) / 2;
+        if (list[pivot].bin.lon <= ref_to)
+            i = pivot;
+        else
+            j = pivot;
+    }
+
+    if (list[j].bin.lon <= ref_to) {
+        res.to = j + 1;
+    } else if (list[i].bin.lon <= ref_to) {
+        res.to = i + 1;
+    } else {
+        res.to = i;
+    }
+
+    return res;
+}
+
+static int compareGridLat(const void *p1, const void *p2) {
+    const struct apiGridEntry *e1 = p1;
+    const struct apiGridEntry *e2 = p2;
+    return (e1->lat > e2->lat) - (e1->lat < e2->lat);
+}
+
+// first entry of the latitude sorted column with lat >= ref
+static inline int lowerBound(struct apiGridEntry *column, int len, int32_t ref) {
+    int lo = 0;
+    int hi = len;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (column[mid].lat < ref)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+void apiGridBuild(struct apiGrid *grid, struct apiEntry *list, int len) {
+    if (grid->alloc < len) {
+        sfree(grid->entries);
+        grid->alloc = len + 1024;
+        grid->entries = cmalloc(grid->alloc * sizeof(struct apiGridEntry));
+    }
+    grid->len = len;
+    grid->columnSize = imax(API_GRID_COLUMN_MIN, (int) sqrt(len));
+
+    for (int i = 0; i < len; i++) {
+        grid->entries[i].lat = list[i].bin.lat;
+        grid->entries[i].index = i;
+    }
+    for (int start = 0; start < len; start += grid->columnSize) {
+        int count = imin(grid->columnSize, len - start);
+        qsort(&grid->entries[start], count, sizeof(struct apiGridEntry), compareGridLat);
+    }
+}
+
+void apiGridFree(struct apiGrid *grid) {
+    sfree(grid->entries);
+    grid->alloc = 0;
+    grid->len = 0;
+}
+
+int apiGridFind(struct apiGrid *grid, struct apiEntry *list, struct range r, int32_t lat1, int32_t lat2, int32_t *out) {
+    int count = 0;
+    int cs = grid->columnSize;
+
+    if (!grid->entries || r.to - r.from <= 2 * cs) {
+        // a few columns at most, scanning the longitude band is cheaper
+        for (int j = r.from; j < r.to; j++) {
+            if (list[j].bin.lat >= lat1 && list[j].bin.lat <= lat2) {
+                out[count++] = j;
+            }
+        }
+        return count;
+    }
+
+    for (int start = (r.from / cs) * cs; start < r.to; start += cs) {
+        struct apiGridEntry *column = &grid->entries[start];
+        int len = imin(cs, grid->len - start);
+
+        int lo = lowerBound(column, len, lat1);
+        int hi = lowerBound(column, len, lat2 == INT32_MAX ? lat2 : lat2 + 1);
+
+        int from = imax(start, r.from);
+        int to = imin(start + len, r.to);
+
+        if (hi - lo > len / 4) {
+            // a large part of the column matches, checking the column in list order is cheaper than sorting
+            for (int j = from; j < to; j++) {
+                if (list[j].bin.lat >= lat1 && list[j].bin.lat <= lat2) {
+                    out[count++] = j;
+                }
+            }
+            continue;
+        }
+
+        int columnStart = count;
+        for (int k = lo; k < hi; k++) {
+            int32_t index = column[k].index;
+            // only the first and last column can contain entries outside the longitude range
+            if (index < from || index >= to)
+                continue;
+            // insertion sort to keep the longitude order of the list
+            int i = count++;
+            while (i > columnStart && out[i - 1] > index) {
+                out[i] = out[i - 1];
+                i--;
+            }
+            out[i] = index;
+        }
+    }
+    return count;
+}
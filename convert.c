@@ -23,6 +23,16 @@
 
 #include "readsb.h"
 
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CONVERT_X86
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CONVERT_NEON
+#endif
+#endif
+
 struct converter_state {
     float dc_a;
     float dc_b;
@@ -30,6 +40,23 @@ struct converter_state {
     float z1_Q;
 };
 
+// All converters sum up the 16 bit magnitudes they output in integers:
+// the means don't depend on the order of summation and the vector versions
+// below produce exactly the same values as the scalar ones.
+static void convert_means(uint64_t sum_level,
+        uint64_t sum_power,
+        unsigned nsamples,
+        double *out_mean_level,
+        double *out_mean_power) {
+    if (out_mean_level) {
+        *out_mean_level = sum_level / 65535.0 / nsamples;
+    }
+
+    if (out_mean_power) {
+        *out_mean_power = sum_power / 65535.0 / 65535.0 / nsamples;
+    }
+}
+
 static uint16_t *uc8_lookup;
 
 static bool init_uc8_lookup() {
@@ -98,13 +125,7 @@ static void convert_uc8_nodc(void *iq_data,
 
 #undef DO_ONE_SAMPLE
 
-    if (out_mean_level) {
-        *out_mean_level = sum_level / 65536.0 / nsamples;
-    }
-
-    if (out_mean_power) {
-        *out_mean_power = sum_power / 65535.0 / 65535.0 / nsamples;
-    }
+    convert_means(sum_level, sum_power, nsamples, out_mean_level, out_mean_power);
 }
 
 static void convert_uc8_generic(void *iq_data,
@@ -122,7 +143,8 @@ static void convert_uc8_generic(void *iq_data,
     unsigned i;
     uint8_t I, Q;
     float fI, fQ, magsq;
-    float sum_level = 0, sum_power = 0;
+    uint64_t sum_level = 0;
+    uint64_t sum_power = 0;
 
     for (i = 0; i < nsamples; ++i) {
         I = *in++;
@@ -140,22 +162,16 @@ static void convert_uc8_generic(void *iq_data,
         if (magsq > 1)
             magsq = 1;
 
-        float mag = sqrtf(magsq);
-        sum_power += magsq;
+        uint16_t mag = (uint16_t) (sqrtf(magsq) * 65535.0f + 0.5f);
+        *mag_data++ = mag;
         sum_level += mag;
-        *mag_data++ = (uint16_t) (mag * 65535.0f + 0.5f);
+        sum_power += (uint32_t) mag * (uint32_t) mag;
     }
 
     state->z1_I = z1_I;
     state->z1_Q = z1_Q;
 
-    if (out_mean_level) {
-        *out_mean_level = sum_level / nsamples;
-    }
-
-    if (out_mean_power) {
-        *out_mean_power = sum_power / nsamples;
-    }
+    convert_means(sum_level, sum_power, nsamples, out_mean_level, out_mean_power);
 }
 
 static void convert_sc16_generic(void *iq_data,
@@ -173,7 +189,8 @@ static void convert_sc16_generic(void *iq_data,
     unsigned i;
     int16_t I, Q;
     float fI, fQ, magsq;
-    float sum_level = 0, sum_power = 0;
+    uint64_t sum_level = 0;
+    uint64_t sum_power = 0;
 
     for (i = 0; i < nsamples; ++i) {
         I = (int16_t) le16toh(*in++);
@@ -191,22 +208,16 @@ static void convert_sc16_generic(void *iq_data,
         if (magsq > 1)
             magsq = 1;
 
-        float mag = sqrtf(magsq);
-        sum_power += magsq;
+        uint16_t mag = (uint16_t) (sqrtf(magsq) * 65535.0f + 0.5f);
+        *mag_data++ = mag;
         sum_level += mag;
-        *mag_data++ = (uint16_t) (mag * 65535.0f + 0.5f);
+        sum_power += (uint32_t) mag * (uint32_t) mag;
     }
 
     state->z1_I = z1_I;
     state->z1_Q = z1_Q;
 
-    if (out_mean_level) {
-        *out_mean_level = sum_level / nsamples;
-    }
-
-    if (out_mean_power) {
-        *out_mean_power = sum_power / nsamples;
-    }
+    convert_means(sum_level, sum_power, nsamples, out_mean_level, out_mean_power);
 }
 
 static void convert_sc16_nodc(void *iq_data,
@@ -222,7 +233,8 @@ static void convert_sc16_nodc(void *iq_data,
     unsigned i;
     int16_t I, Q;
     float fI, fQ, magsq;
-    float sum_level = 0, sum_power = 0;
+    uint64_t sum_level = 0;
+    uint64_t sum_power = 0;
 
     for (i = 0; i < nsamples; ++i) {
         I = (int16_t) le16toh(*in++);
@@ -234,19 +246,13 @@ static void convert_sc16_nodc(void *iq_data,
         if (magsq > 1)
             magsq = 1;
 
-        float mag = sqrtf(magsq);
-        sum_power += magsq;
+        uint16_t mag = (uint16_t) (sqrtf(magsq) * 65535.0f + 0.5f);
+        *mag_data++ = mag;
         sum_level += mag;
-        *mag_data++ = (uint16_t) (mag * 65535.0f + 0.5f);
-    }
-
-    if (out_mean_level) {
-        *out_mean_level = sum_level / nsamples;
+        sum_power += (uint32_t) mag * (uint32_t) mag;
     }
 
-    if (out_mean_power) {
-        *out_mean_power = sum_power / nsamples;
-    }
+    convert_means(sum_level, sum_power, nsamples, out_mean_level, out_mean_power);
 }
 
 // SC16Q11_TABLE_BITS controls the size of the lookup table
@@ -315,13 +321,7 @@ static void convert_sc16q11_table(void *iq_data,
         sum_power += (uint32_t) mag * (uint32_t) mag;
     }
 
-    if (out_mean_level) {
-        *out_mean_level = sum_level / 65536.0 / nsamples;
-    }
-
-    if (out_mean_power) {
-        *out_mean_power = sum_power / 65535.0 / 65535.0 / nsamples;
-    }
+    convert_means(sum_level, sum_power, nsamples, out_mean_level, out_mean_power);
 }
 
 #else /* ! defined(SC16Q11_TABLE_BITS) */
@@ -339,7 +339,8 @@ static void convert_sc16q11_nodc(void *iq_data,
     unsigned i;
     int16_t I, Q;
     float fI, fQ, magsq;
-    float sum_level = 0, sum_power = 0;
+    uint64_t sum_level = 0;
+    uint64_t sum_power = 0;
 
     for (i = 0; i < nsamples; ++i) {
         I = (int16_t) le16toh(*in++);
@@ -351,19 +352,13 @@ static void convert_sc16q11_nodc(void *iq_data,
         if (magsq > 1)
             magsq = 1;
 
-        float mag = sqrtf(magsq);
-        sum_power += magsq;
+        uint16_t mag = (uint16_t) (sqrtf(magsq) * 65535.0f + 0.5f);
+        *mag_data++ = mag;
         sum_level += mag;
-        *mag_data++ = (uint16_t) (mag * 65535.0f + 0.5f);
-    }
-
-    if (out_mean_level) {
-        *out_mean_level = sum_level / nsamples;
+        sum_power += (uint32_t) mag * (uint32_t) mag;
     }
 
-    if (out_mean_power) {
-        *out_mean_power = sum_power / nsamples;
-    }
+    convert_means(sum_level, sum_power, nsamples, out_mean_level, out_mean_power);
 }
 
 #endif /* defined(SC16Q11_TABLE_BITS) */
@@ -383,7 +378,8 @@ static void convert_sc16q11_generic(void *iq_data,
     unsigned i;
     int16_t I, Q;
     float fI, fQ, magsq;
-    float sum_level = 0, sum_power = 0;
+    uint64_t sum_level = 0;
+    uint64_t sum_power = 0;
 
     for (i = 0; i < nsamples; ++i) {
         I = (int16_t) le16toh(*in++);
@@ -401,62 +397,443 @@ static void convert_sc16q11_generic(void *iq_data,
         if (magsq > 1)
             magsq = 1;
 
-        float mag = sqrtf(magsq);
-        sum_power += magsq;
+        uint16_t mag = (uint16_t) (sqrtf(magsq) * 65535.0f + 0.5f);
+        *mag_data++ = mag;
         sum_level += mag;
-        *mag_data++ = (uint16_t) (mag * 65535.0f + 0.5f);
+        sum_power += (uint32_t) mag * (uint32_t) mag;
     }
 
     state->z1_I = z1_I;
     state->z1_Q = z1_Q;
 
-    if (out_mean_level) {
-        *out_mean_level = sum_level / nsamples;
+    convert_means(sum_level, sum_power, nsamples, out_mean_level, out_mean_power);
+}
+
+// Vector converters
+//
+// They do the same float operations in the same order as the scalar converters above
+// and output bit for bit the same magnitudes, oneoff/convert_benchmark checks that.
+// The SC16Q11 no DC version computes what the table holds, i.e. it drops the same low bits.
+// There is none for UC8 without DC: real signals only touch a small part of that table,
+// it stays in L1 and the lookups are faster than computing the magnitudes.
+// The DC block is a recurrence from sample to sample, the DC versions run it in scalar code
+// for each vector of samples between the conversion to float and the magnitude.
+// NEON needs vector division and square root, those only exist on aarch64.
+
+#if defined(CONVERT_X86) || defined(CONVERT_NEON)
+
+#define CONVERT_INLINE static inline __attribute__((always_inline))
+
+#if defined(SC16Q11_TABLE_BITS)
+#define SC16Q11_NODC_MASK (2047 & ~((1 << LOSE_BITS) - 1))
+#endif
+
+// one sample converted to float like the scalar converters do it
+CONVERT_INLINE void convert_load_one(input_format_t format, int filter_dc, const void *iq_data, unsigned i, float *fI, float *fQ) {
+    if (format == INPUT_UC8) {
+        const uint8_t *in = iq_data;
+        *fI = (in[2 * i] - 127.5f) / 127.5f;
+        *fQ = (in[2 * i + 1] - 127.5f) / 127.5f;
+        return;
+    }
+    const int16_t *in = iq_data;
+    int I = in[2 * i];
+    int Q = in[2 * i + 1];
+    if (format == INPUT_SC16) {
+        *fI = I / 32768.0f;
+        *fQ = Q / 32768.0f;
+        return;
+    }
+#if defined(SC16Q11_TABLE_BITS)
+    if (!filter_dc) {
+        I = abs(I) & SC16Q11_NODC_MASK;
+        Q = abs(Q) & SC16Q11_NODC_MASK;
+    }
+#else
+    MODES_NOTUSED(filter_dc);
+#endif
+    *fI = I / 2048.0f;
+    *fQ = Q / 2048.0f;
+}
+
+// DC block for n samples, in place
+CONVERT_INLINE void convert_dc_block(float *fI, float *fQ, int n, float *z1_I, float *z1_Q, float dc_a, float dc_b) {
+    for (int k = 0; k < n; k++) {
+        *z1_I = fI[k] * dc_a + *z1_I * dc_b;
+        *z1_Q = fQ[k] * dc_a + *z1_Q * dc_b;
+        fI[k] -= *z1_I;
+        fQ[k] -= *z1_Q;
     }
+}
 
-    if (out_mean_power) {
-        *out_mean_power = sum_power / nsamples;
+// the samples at the end that don't fill a vector
+CONVERT_INLINE void convert_rest(input_format_t format, int filter_dc, const void *iq_data, uint16_t *mag_data,
+        unsigned i, unsigned nsamples, struct converter_state *state, uint64_t *sum_level, uint64_t *sum_power) {
+    for (; i < nsamples; i++) {
+        float fI, fQ;
+        convert_load_one(format, filter_dc, iq_data, i, &fI, &fQ);
+        if (filter_dc) {
+            convert_dc_block(&fI, &fQ, 1, &state->z1_I, &state->z1_Q, state->dc_a, state->dc_b);
+        }
+        float magsq = fI * fI + fQ * fQ;
+        if (magsq > 1)
+            magsq = 1;
+        uint16_t mag = (uint16_t) (sqrtf(magsq) * 65535.0f + 0.5f);
+        mag_data[i] = mag;
+        *sum_level += mag;
+        *sum_power += (uint32_t) mag * (uint32_t) mag;
+    }
+}
+
+#define CONVERT_VARIANTS(isa, target) \
+    target static void convert_uc8_generic_##isa(void *iq_data, uint16_t *mag_data, unsigned nsamples, \
+            struct converter_state *state, double *out_mean_level, double *out_mean_power) { \
+        convert_##isa(INPUT_UC8, 1, iq_data, mag_data, nsamples, state, out_mean_level, out_mean_power); \
+    } \
+    target static void convert_sc16_nodc_##isa(void *iq_data, uint16_t *mag_data, unsigned nsamples, \
+            struct converter_state *state, double *out_mean_level, double *out_mean_power) { \
+        convert_##isa(INPUT_SC16, 0, iq_data, mag_data, nsamples, state, out_mean_level, out_mean_power); \
+    } \
+    target static void convert_sc16_generic_##isa(void *iq_data, uint16_t *mag_data, unsigned nsamples, \
+            struct converter_state *state, double *out_mean_level, double *out_mean_power) { \
+        convert_##isa(INPUT_SC16, 1, iq_data, mag_data, nsamples, state, out_mean_level, out_mean_power); \
+    } \
+    target static void convert_sc16q11_nodc_##isa(void *iq_data, uint16_t *mag_data, unsigned nsamples, \
+            struct converter_state *state, double *out_mean_level, double *out_mean_power) { \
+        convert_##isa(INPUT_SC16Q11, 0, iq_data, mag_data, nsamples, state, out_mean_level, out_mean_power); \
+    } \
+    target static void convert_sc16q11_generic_##isa(void *iq_data, uint16_t *mag_data, unsigned nsamples, \
+            struct converter_state *state, double *out_mean_level, double *out_mean_power) { \
+        convert_##isa(INPUT_SC16Q11, 1, iq_data, mag_data, nsamples, state, out_mean_level, out_mean_power); \
+    }
+
+#endif /* defined(CONVERT_X86) || defined(CONVERT_NEON) */
+
+#ifdef CONVERT_X86
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+
+static bool have_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+static bool have_sse41() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.1");
+}
+
+// 8 samples to float, each 32 bit lane of the input holds one IQ pair
+TARGET_AVX2 CONVERT_INLINE void convert_load_avx2(input_format_t format, int filter_dc, const void *iq_data, unsigned i, __m256 *fI, __m256 *fQ) {
+    __m256i I, Q;
+    if (format == INPUT_UC8) {
+        __m256i pairs = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) ((const uint8_t *) iq_data + 2 * i)));
+        I = _mm256_and_si256(pairs, _mm256_set1_epi32(0xffff));
+        Q = _mm256_srli_epi32(pairs, 16);
+        *fI = _mm256_div_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(I), _mm256_set1_ps(127.5f)), _mm256_set1_ps(127.5f));
+        *fQ = _mm256_div_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(Q), _mm256_set1_ps(127.5f)), _mm256_set1_ps(127.5f));
+        return;
+    }
+    __m256i pairs = _mm256_loadu_si256((const __m256i *) ((const int16_t *) iq_data + 2 * i));
+    I = _mm256_srai_epi32(_mm256_slli_epi32(pairs, 16), 16);
+    Q = _mm256_srai_epi32(pairs, 16);
+    // dividing by a power of two and multiplying by its inverse give the same result
+    __m256 scale = _mm256_set1_ps(1 / 32768.0f);
+    if (format == INPUT_SC16Q11) {
+        scale = _mm256_set1_ps(1 / 2048.0f);
+#if defined(SC16Q11_TABLE_BITS)
+        if (!filter_dc) {
+            I = _mm256_and_si256(_mm256_abs_epi32(I), _mm256_set1_epi32(SC16Q11_NODC_MASK));
+            Q = _mm256_and_si256(_mm256_abs_epi32(Q), _mm256_set1_epi32(SC16Q11_NODC_MASK));
+        }
+#else
+        MODES_NOTUSED(filter_dc);
+#endif
+    }
+    *fI = _mm256_mul_ps(_mm256_cvtepi32_ps(I), scale);
+    *fQ = _mm256_mul_ps(_mm256_cvtepi32_ps(Q), scale);
+}
+
+TARGET_AVX2 CONVERT_INLINE void convert_avx2(input_format_t format, int filter_dc, void *iq_data, uint16_t *mag_data,
+        unsigned nsamples, struct converter_state *state, double *out_mean_level, double *out_mean_power) {
+    __m256i level = _mm256_setzero_si256();
+    __m256i power = _mm256_setzero_si256();
+    const __m256i low = _mm256_set1_epi64x(0xffffffff);
+    unsigned i;
+
+    for (i = 0; i + 8 <= nsamples; i += 8) {
+        __m256 fI, fQ;
+        convert_load_avx2(format, filter_dc, iq_data, i, &fI, &fQ);
+        if (filter_dc) {
+            float bI[8], bQ[8];
+            _mm256_storeu_ps(bI, fI);
+            _mm256_storeu_ps(bQ, fQ);
+            convert_dc_block(bI, bQ, 8, &state->z1_I, &state->z1_Q, state->dc_a, state->dc_b);
+            fI = _mm256_loadu_ps(bI);
+            fQ = _mm256_loadu_ps(bQ);
+        }
+        __m256 magsq = _mm256_add_ps(_mm256_mul_ps(fI, fI), _mm256_mul_ps(fQ, fQ));
+        magsq = _mm256_min_ps(magsq, _mm256_set1_ps(1.0f));
+        __m256i mag = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_sqrt_ps(magsq), _mm256_set1_ps(65535.0f)), _mm256_set1_ps(0.5f)));
+
+        // the pack works per 128 bit lane, the permute puts the samples back in order
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(mag, mag), 0xd8);
+        _mm_storeu_si128((__m128i *) (mag_data + i), _mm256_castsi256_si128(packed));
+
+        // 64 bit sums, even and odd lanes separately
+        __m256i odd = _mm256_srli_epi64(mag, 32);
+        level = _mm256_add_epi64(level, _mm256_add_epi64(_mm256_and_si256(mag, low), odd));
+        power = _mm256_add_epi64(power, _mm256_add_epi64(_mm256_mul_epu32(mag, mag), _mm256_mul_epu32(odd, odd)));
+    }
+
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *) lanes, level);
+    uint64_t sum_level = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    _mm256_storeu_si256((__m256i *) lanes, power);
+    uint64_t sum_power = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+    convert_rest(format, filter_dc, iq_data, mag_data, i, nsamples, state, &sum_level, &sum_power);
+    convert_means(sum_level, sum_power, nsamples, out_mean_level, out_mean_power);
+}
+
+// 4 samples to float, each 32 bit lane of the input holds one IQ pair
+TARGET_SSE41 CONVERT_INLINE void convert_load_sse41(input_format_t format, int filter_dc, const void *iq_data, unsigned i, __m128 *fI, __m128 *fQ) {
+    __m128i I, Q;
+    if (format == INPUT_UC8) {
+        __m128i pairs = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *) ((const uint8_t *) iq_data + 2 * i)));
+        I = _mm_and_si128(pairs, _mm_set1_epi32(0xffff));
+        Q = _mm_srli_epi32(pairs, 16);
+        *fI = _mm_div_ps(_mm_sub_ps(_mm_cvtepi32_ps(I), _mm_set1_ps(127.5f)), _mm_set1_ps(127.5f));
+        *fQ = _mm_div_ps(_mm_sub_ps(_mm_cvtepi32_ps(Q), _mm_set1_ps(127.5f)), _mm_set1_ps(127.5f));
+        return;
+    }
+    __m128i pairs = _mm_loadu_si128((const __m128i *) ((const int16_t *) iq_data + 2 * i));
+    I = _mm_srai_epi32(_mm_slli_epi32(pairs, 16), 16);
+    Q = _mm_srai_epi32(pairs, 16);
+    __m128 scale = _mm_set1_ps(1 / 32768.0f);
+    if (format == INPUT_SC16Q11) {
+        scale = _mm_set1_ps(1 / 2048.0f);
+#if defined(SC16Q11_TABLE_BITS)
+        if (!filter_dc) {
+            I = _mm_and_si128(_mm_abs_epi32(I), _mm_set1_epi32(SC16Q11_NODC_MASK));
+            Q = _mm_and_si128(_mm_abs_epi32(Q), _mm_set1_epi32(SC16Q11_NODC_MASK));
+        }
+#else
+        MODES_NOTUSED(filter_dc);
+#endif
+    }
+    *fI = _mm_mul_ps(_mm_cvtepi32_ps(I), scale);
+    *fQ = _mm_mul_ps(_mm_cvtepi32_ps(Q), scale);
+}
+
+TARGET_SSE41 CONVERT_INLINE void convert_sse41(input_format_t format, int filter_dc, void *iq_data, uint16_t *mag_data,
+        unsigned nsamples, struct converter_state *state, double *out_mean_level, double *out_mean_power) {
+    __m128i level = _mm_setzero_si128();
+    __m128i power = _mm_setzero_si128();
+    const __m128i low = _mm_set1_epi64x(0xffffffff);
+    unsigned i;
+
+    for (i = 0; i + 4 <= nsamples; i += 4) {
+        __m128 fI, fQ;
+        convert_load_sse41(format, filter_dc, iq_data, i, &fI, &fQ);
+        if (filter_dc) {
+            float bI[4], bQ[4];
+            _mm_storeu_ps(bI, fI);
+            _mm_storeu_ps(bQ, fQ);
+            convert_dc_block(bI, bQ, 4, &state->z1_I, &state->z1_Q, state->dc_a, state->dc_b);
+            fI = _mm_loadu_ps(bI);
+            fQ = _mm_loadu_ps(bQ);
+        }
+        __m128 magsq = _mm_add_ps(_mm_mul_ps(fI, fI), _mm_mul_ps(fQ, fQ));
+        magsq = _mm_min_ps(magsq, _mm_set1_ps(1.0f));
+        __m128i mag = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_sqrt_ps(magsq), _mm_set1_ps(65535.0f)), _mm_set1_ps(0.5f)));
+
+        _mm_storel_epi64((__m128i *) (mag_data + i), _mm_packus_epi32(mag, mag));
+
+        __m128i odd = _mm_srli_epi64(mag, 32);
+        level = _mm_add_epi64(level, _mm_add_epi64(_mm_and_si128(mag, low), odd));
+        power = _mm_add_epi64(power, _mm_add_epi64(_mm_mul_epu32(mag, mag), _mm_mul_epu32(odd, odd)));
+    }
+
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i *) lanes, level);
+    uint64_t sum_level = lanes[0] + lanes[1];
+    _mm_storeu_si128((__m128i *) lanes, power);
+    uint64_t sum_power = lanes[0] + lanes[1];
+
+    convert_rest(format, filter_dc, iq_data, mag_data, i, nsamples, state, &sum_level, &sum_power);
+    convert_means(sum_level, sum_power, nsamples, out_mean_level, out_mean_power);
+}
+
+CONVERT_VARIANTS(avx2, TARGET_AVX2)
+CONVERT_VARIANTS(sse41, TARGET_SSE41)
+
+#endif /* CONVERT_X86 */
+
+#ifdef CONVERT_NEON
+
+// 8 samples to float, as two vectors of 4
+CONVERT_INLINE void convert_load_neon(input_format_t format, int filter_dc, const void *iq_data, unsigned i, float32x4_t fI[2], float32x4_t fQ[2]) {
+    int32x4_t I[2], Q[2];
+    if (format == INPUT_UC8) {
+        uint8x8x2_t pairs = vld2_u8((const uint8_t *) iq_data + 2 * i);
+        uint16x8_t wI = vmovl_u8(pairs.val[0]);
+        uint16x8_t wQ = vmovl_u8(pairs.val[1]);
+        I[0] = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(wI)));
+        I[1] = vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(wI)));
+        Q[0] = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(wQ)));
+        Q[1] = vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(wQ)));
+        for (int k = 0; k < 2; k++) {
+            fI[k] = vdivq_f32(vsubq_f32(vcvtq_f32_s32(I[k]), vdupq_n_f32(127.5f)), vdupq_n_f32(127.5f));
+            fQ[k] = vdivq_f32(vsubq_f32(vcvtq_f32_s32(Q[k]), vdupq_n_f32(127.5f)), vdupq_n_f32(127.5f));
+        }
+        return;
+    }
+    int16x8x2_t pairs = vld2q_s16((const int16_t *) iq_data + 2 * i);
+    I[0] = vmovl_s16(vget_low_s16(pairs.val[0]));
+    I[1] = vmovl_s16(vget_high_s16(pairs.val[0]));
+    Q[0] = vmovl_s16(vget_low_s16(pairs.val[1]));
+    Q[1] = vmovl_s16(vget_high_s16(pairs.val[1]));
+    float scale = 1 / 32768.0f;
+    if (format == INPUT_SC16Q11) {
+        scale = 1 / 2048.0f;
+#if defined(SC16Q11_TABLE_BITS)
+        if (!filter_dc) {
+            for (int k = 0; k < 2; k++) {
+                I[k] = vandq_s32(vabsq_s32(I[k]), vdupq_n_s32(SC16Q11_NODC_MASK));
+                Q[k] = vandq_s32(vabsq_s32(Q[k]), vdupq_n_s32(SC16Q11_NODC_MASK));
+            }
+        }
+#else
+        MODES_NOTUSED(filter_dc);
+#endif
+    }
+    for (int k = 0; k < 2; k++) {
+        fI[k] = vmulq_n_f32(vcvtq_f32_s32(I[k]), scale);
+        fQ[k] = vmulq_n_f32(vcvtq_f32_s32(Q[k]), scale);
+    }
+}
+
+CONVERT_INLINE void convert_neon(input_format_t format, int filter_dc, void *iq_data, uint16_t *mag_data,
+        unsigned nsamples, struct converter_state *state, double *out_mean_level, double *out_mean_power) {
+    uint64x2_t level = vdupq_n_u64(0);
+    uint64x2_t power = vdupq_n_u64(0);
+    unsigned i;
+
+    for (i = 0; i + 8 <= nsamples; i += 8) {
+        float32x4_t fI[2], fQ[2];
+        convert_load_neon(format, filter_dc, iq_data, i, fI, fQ);
+        if (filter_dc) {
+            float bI[8], bQ[8];
+            vst1q_f32(bI, fI[0]);
+            vst1q_f32(bI + 4, fI[1]);
+            vst1q_f32(bQ, fQ[0]);
+            vst1q_f32(bQ + 4, fQ[1]);
+            convert_dc_block(bI, bQ, 8, &state->z1_I, &state->z1_Q, state->dc_a, state->dc_b);
+            fI[0] = vld1q_f32(bI);
+            fI[1] = vld1q_f32(bI + 4);
+            fQ[0] = vld1q_f32(bQ);
+            fQ[1] = vld1q_f32(bQ + 4);
+        }
+        for (int k = 0; k < 2; k++) {
+            float32x4_t magsq = vaddq_f32(vmulq_f32(fI[k], fI[k]), vmulq_f32(fQ[k], fQ[k]));
+            magsq = vminq_f32(magsq, vdupq_n_f32(1.0f));
+            uint32x4_t mag = vcvtq_u32_f32(vaddq_f32(vmulq_n_f32(vsqrtq_f32(magsq), 65535.0f), vdupq_n_f32(0.5f)));
+
+            vst1_u16(mag_data + i + 4 * k, vmovn_u32(mag));
+
+            level = vpadalq_u32(level, mag);
+            power = vaddq_u64(power, vmull_u32(vget_low_u32(mag), vget_low_u32(mag)));
+            power = vaddq_u64(power, vmull_high_u32(mag, mag));
+        }
     }
+
+    uint64_t sum_level = vaddvq_u64(level);
+    uint64_t sum_power = vaddvq_u64(power);
+
+    convert_rest(format, filter_dc, iq_data, mag_data, i, nsamples, state, &sum_level, &sum_power);
+    convert_means(sum_level, sum_power, nsamples, out_mean_level, out_mean_power);
 }
 
+CONVERT_VARIANTS(neon, )
+
+#endif /* CONVERT_NEON */
+
 static struct {
     input_format_t format;
     int can_filter_dc;
     iq_convert_fn fn;
     const char *description;
     bool(*init)();
+    bool(*usable)();
 } converters_table[] = {
-    // In order of preference
-    { INPUT_UC8, 0, convert_uc8_nodc, "UC8, integer/table path", init_uc8_lookup},
-    { INPUT_UC8, 1, convert_uc8_generic, "UC8, float path", NULL},
-    { INPUT_SC16, 0, convert_sc16_nodc, "SC16, float path, no DC", NULL},
-    { INPUT_SC16, 1, convert_sc16_generic, "SC16, float path", NULL},
+    // In order of preference, the first usable one is picked
+#ifdef CONVERT_X86
+    { INPUT_UC8, 1, convert_uc8_generic_avx2, "UC8, AVX2 path", NULL, have_avx2},
+    { INPUT_SC16, 0, convert_sc16_nodc_avx2, "SC16, AVX2 path, no DC", NULL, have_avx2},
+    { INPUT_SC16, 1, convert_sc16_generic_avx2, "SC16, AVX2 path", NULL, have_avx2},
+    { INPUT_SC16Q11, 0, convert_sc16q11_nodc_avx2, "SC16Q11, AVX2 path, no DC", NULL, have_avx2},
+    { INPUT_SC16Q11, 1, convert_sc16q11_generic_avx2, "SC16Q11, AVX2 path", NULL, have_avx2},
+    { INPUT_UC8, 1, convert_uc8_generic_sse41, "UC8, SSE4.1 path", NULL, have_sse41},
+    { INPUT_SC16, 0, convert_sc16_nodc_sse41, "SC16, SSE4.1 path, no DC", NULL, have_sse41},
+    { INPUT_SC16, 1, convert_sc16_generic_sse41, "SC16, SSE4.1 path", NULL, have_sse41},
+    { INPUT_SC16Q11, 0, convert_sc16q11_nodc_sse41, "SC16Q11, SSE4.1 path, no DC", NULL, have_sse41},
+    { INPUT_SC16Q11, 1, convert_sc16q11_generic_sse41, "SC16Q11, SSE4.1 path", NULL, have_sse41},
+#endif
+#ifdef CONVERT_NEON
+    { INPUT_UC8, 1, convert_uc8_generic_neon, "UC8, NEON path", NULL, NULL},
+    { INPUT_SC16, 0, convert_sc16_nodc_neon, "SC16, NEON path, no DC", NULL, NULL},
+    { INPUT_SC16, 1, convert_sc16_generic_neon, "SC16, NEON path", NULL, NULL},
+    { INPUT_SC16Q11, 0, convert_sc16q11_nodc_neon, "SC16Q11, NEON path, no DC", NULL, NULL},
+    { INPUT_SC16Q11, 1, convert_sc16q11_generic_neon, "SC16Q11, NEON path", NULL, NULL},
+#endif
+    // scalar versions last, oneoff/convert_benchmark uses them as the reference
+    { INPUT_UC8, 0, convert_uc8_nodc, "UC8, integer/table path", init_uc8_lookup, NULL},
+    { INPUT_UC8, 1, convert_uc8_generic, "UC8, float path", NULL, NULL},
+    { INPUT_SC16, 0, convert_sc16_nodc, "SC16, float path, no DC", NULL, NULL},
+    { INPUT_SC16, 1, convert_sc16_generic, "SC16, float path", NULL, NULL},
 #if defined(SC16Q11_TABLE_BITS)
-    { INPUT_SC16Q11, 0, convert_sc16q11_table, "SC16Q11, integer/table path", init_sc16q11_lookup},
+    { INPUT_SC16Q11, 0, convert_sc16q11_table, "SC16Q11, integer/table path", init_sc16q11_lookup, NULL},
 #else
-    { INPUT_SC16Q11, 0, convert_sc16q11_nodc, "SC16Q11, float path, no DC", NULL},
+    { INPUT_SC16Q11, 0, convert_sc16q11_nodc, "SC16Q11, float path, no DC", NULL, NULL},
 #endif
-    { INPUT_SC16Q11, 1, convert_sc16q11_generic, "SC16Q11, float path", NULL},
-    { 0, 0, NULL, NULL, NULL}
+    { INPUT_SC16Q11, 1, convert_sc16q11_generic, "SC16Q11, float path", NULL, NULL},
+    { 0, 0, NULL, NULL, NULL, NULL}
 };
 
 iq_convert_fn init_converter(input_format_t format,
         double sample_rate,
         int filter_dc,
         struct converter_state **out_state) {
+    return init_converter_variant(format, sample_rate, filter_dc, 0, NULL, out_state);
+}
+
+iq_convert_fn init_converter_variant(input_format_t format,
+        double sample_rate,
+        int filter_dc,
+        int variant,
+        const char **description,
+        struct converter_state **out_state) {
     int i;
 
     for (i = 0; converters_table[i].fn; ++i) {
         if (converters_table[i].format != format)
             continue;
-        if (filter_dc && !converters_table[i].can_filter_dc)
+        if (converters_table[i].can_filter_dc != !!filter_dc)
+            continue;
+        if (converters_table[i].usable && !converters_table[i].usable())
+            continue;
+        if (variant-- > 0)
             continue;
         break;
     }
 
     if (!converters_table[i].fn) {
-        fprintf(stderr, "no suitable converter for format=%d dc=%d\n",
-                format, filter_dc);
+        if (variant < 0) {
+            fprintf(stderr, "no suitable converter for format=%d dc=%d\n",
+                    format, filter_dc);
+        }
         return NULL;
     }
 
@@ -488,6 +865,10 @@ iq_convert_fn init_converter(input_format_t format,
         fprintf(stderr, "init_converter: using %s\n", converters_table[i].description);
     }
 
+    if (description) {
+        *description = converters_table[i].description;
+    }
+
     return converters_table[i].fn;
 }
 
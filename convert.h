@@ -43,6 +43,15 @@ iq_convert_fn init_converter (input_format_t format,
                               int filter_dc,
                               struct converter_state **out_state);
 
+// Like init_converter but picks the n-th usable converter in order of preference,
+// the last one is the plain C version. Returns NULL if there is no n-th converter.
+iq_convert_fn init_converter_variant (input_format_t format,
+                                      double sample_rate,
+                                      int filter_dc,
+                                      int variant,
+                                      const char **description,
+                                      struct converter_state **out_state);
+
 void cleanup_converter (struct converter_state **state);
 
 #endif
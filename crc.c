@@ -24,6 +24,16 @@
 #include "readsb.h"
 #include <assert.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CRC_CLMUL __attribute__((target("pclmul,sse2")))
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#define CRC_CLMUL __attribute__((target("+crypto")))
+#endif
+
 // Errorinfo for "no errors"
 static struct errorinfo NO_ERRORS;
 
@@ -39,6 +49,104 @@ ALIGNED static uint32_t crc_table[256];
 // correction tables.
 ALIGNED static uint32_t single_bit_syndrome[112];
 
+// The checksum of a whole message is the remainder of the message (as a polynomial,
+// first bit highest) divided by the generator: the CRC of all but the last 24 bits
+// xored with the last 24 bits is the same thing.
+// With a carry-less multiply that's a few multiplications per message instead of
+// one table lookup per byte: fold the message down to 64 bits, then Barrett reduction.
+
+#ifdef CRC_CLMUL
+static bool use_clmul;
+static uint64_t clmul_x64; // x^64 mod P
+static uint64_t clmul_x88; // x^88 mod P
+static uint64_t clmul_mu; // x^64 / P
+
+#if defined(__x86_64__) || defined(__i386__)
+CRC_CLMUL static inline uint64_t clmul(uint64_t a, uint64_t b, uint64_t *hi) {
+    __m128i r = _mm_clmulepi64_si128(_mm_set_epi64x(0, a), _mm_set_epi64x(0, b), 0x00);
+    uint64_t out[2];
+    _mm_storeu_si128((__m128i *) out, r);
+    *hi = out[1];
+    return out[0];
+}
+
+static bool clmulSupported() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("pclmul");
+}
+#else
+CRC_CLMUL static inline uint64_t clmul(uint64_t a, uint64_t b, uint64_t *hi) {
+    uint64x2_t r = vreinterpretq_u64_p128(vmull_p64((poly64_t) a, (poly64_t) b));
+    *hi = vgetq_lane_u64(r, 1);
+    return vgetq_lane_u64(r, 0);
+}
+
+static bool clmulSupported() {
+    return (getauxval(AT_HWCAP) & HWCAP_PMULL);
+}
+#endif
+
+// x^n mod P
+static uint32_t xPowMod(int n) {
+    uint32_t r = 1;
+    for (int i = 0; i < n; i++) {
+        r <<= 1;
+        if (r & 0x1000000)
+            r ^= 0x1000000 | MODES_GENERATOR_POLY;
+    }
+    return r;
+}
+
+// x^64 / P by long division, 25 bit window over the remainder
+static uint64_t barrettConstant() {
+    uint32_t w = 0x1000000;
+    uint64_t q = 0;
+    for (int k = 64; k >= 24; k--) {
+        if (w & 0x1000000) {
+            q |= 1ULL << (k - 24);
+            w ^= 0x1000000 | MODES_GENERATOR_POLY;
+        }
+        w <<= 1;
+    }
+    return q;
+}
+
+static void initClmul() {
+    clmul_x64 = xPowMod(64);
+    clmul_x88 = xPowMod(88);
+    clmul_mu = barrettConstant();
+    use_clmul = clmulSupported();
+}
+
+// a mod P for a polynomial of degree < 64
+CRC_CLMUL static inline uint32_t barrettReduce(uint64_t a) {
+    uint64_t hi;
+    uint64_t lo = clmul(a >> 24, clmul_mu, &hi);
+    uint64_t q = (lo >> 40) | (hi << 24);
+    return (uint32_t) (a ^ clmul(q, MODES_GENERATOR_POLY, &hi)) & 0xffffff;
+}
+
+static inline uint64_t loadBigEndian(const uint8_t *p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+CRC_CLMUL static uint32_t checksumShortClmul(uint8_t *message) {
+    return barrettReduce(loadBigEndian(message, 7));
+}
+
+CRC_CLMUL static uint32_t checksumLongClmul(uint8_t *message) {
+    // message = hi * x^64 + lo, hi has 48 bits: fold it in as two 24 bit halves
+    uint64_t hi = loadBigEndian(message, 6);
+    uint64_t lo = loadBigEndian(message + 6, 8);
+    uint64_t unused;
+    lo ^= clmul(hi >> 24, clmul_x88, &unused) ^ clmul(hi & 0xffffff, clmul_x64, &unused);
+    return barrettReduce(lo);
+}
+#endif
+
 static void initLookupTables() {
     int i;
     uint8_t msg[112 / 8];
@@ -56,6 +164,10 @@ static void initLookupTables() {
         crc_table[i] = c & 0x00ffffff;
     }
 
+#ifdef CRC_CLMUL
+    initClmul();
+#endif
+
     memset(msg, 0, sizeof (msg));
     for (i = 0; i < 112; ++i) {
         msg[i / 8] ^= 1 << (7 - (i & 7));
@@ -64,7 +176,7 @@ static void initLookupTables() {
     }
 }
 
-uint32_t modesChecksum(uint8_t *message, int bits) {
+static uint32_t checksumTable(uint8_t *message, int bits) {
     uint32_t rem = 0;
     int i;
     int n = bits / 8;
@@ -81,12 +193,81 @@ uint32_t modesChecksum(uint8_t *message, int bits) {
     return rem;
 }
 
+uint32_t modesChecksum(uint8_t *message, int bits) {
+#ifdef CRC_CLMUL
+    if (use_clmul) {
+        if (bits == MODES_LONG_MSG_BITS)
+            return checksumLongClmul(message);
+        if (bits == MODES_SHORT_MSG_BITS)
+            return checksumShortClmul(message);
+    }
+#endif
+    return checksumTable(message, bits);
+}
+
 static struct errorinfo *bitErrorTable_short;
 static int bitErrorTableSize_short;
 
 static struct errorinfo *bitErrorTable_long;
 static int bitErrorTableSize_long;
 
+// Open addressing hash from syndrome to table entry, replaces a bsearch over the sorted tables.
+// Syndrome 0 never needs a lookup and marks an empty slot.
+struct syndromeSlot {
+    uint32_t syndrome;
+    int32_t index;
+};
+
+struct syndromeHash {
+    struct syndromeSlot *slots;
+    uint32_t mask;
+    int shift;
+};
+
+static struct syndromeHash syndromeHash_short;
+static struct syndromeHash syndromeHash_long;
+
+static inline uint32_t syndromeSlotIndex(const struct syndromeHash *hash, uint32_t syndrome) {
+    return (syndrome * 0x9E3779B1U) >> hash->shift;
+}
+
+static void buildSyndromeHash(struct syndromeHash *hash, struct errorinfo *table, int size) {
+    if (!table) {
+        hash->slots = NULL;
+        return;
+    }
+    // load factor at most 1/2
+    int bits = 4;
+    while ((1 << bits) < 2 * size)
+        ++bits;
+    hash->mask = (1U << bits) - 1;
+    hash->shift = 32 - bits;
+    hash->slots = cmalloc((hash->mask + 1) * sizeof (struct syndromeSlot));
+    memset(hash->slots, 0, (hash->mask + 1) * sizeof (struct syndromeSlot));
+
+    for (int i = 0; i < size; ++i) {
+        if (table[i].syndrome == 0)
+            continue;
+        uint32_t k = syndromeSlotIndex(hash, table[i].syndrome);
+        while (hash->slots[k].syndrome)
+            k = (k + 1) & hash->mask;
+        hash->slots[k].syndrome = table[i].syndrome;
+        hash->slots[k].index = i;
+    }
+}
+
+static struct errorinfo *lookupSyndrome(const struct syndromeHash *hash, struct errorinfo *table, uint32_t syndrome) {
+    if (!hash->slots)
+        return NULL;
+    for (uint32_t k = syndromeSlotIndex(hash, syndrome);; k = (k + 1) & hash->mask) {
+        struct syndromeSlot *slot = &hash->slots[k];
+        if (slot->syndrome == syndrome)
+            return &table[slot->index];
+        if (!slot->syndrome)
+            return NULL;
+    }
+}
+
 // compare two errorinfo structures
 static int syndrome_compare(const void *x, const void *y) {
     struct errorinfo *ex = (struct errorinfo*) x;
@@ -375,34 +556,23 @@ void modesChecksumInit(int fixBits) {
             fprintf(stderr, "done.\n");
             break;
     }
+
+    buildSyndromeHash(&syndromeHash_short, bitErrorTable_short, bitErrorTableSize_short);
+    buildSyndromeHash(&syndromeHash_long, bitErrorTable_long, bitErrorTableSize_long);
 }
 
 // Given an error syndrome and message length, return
 // an error-correction descriptor, or NULL if the
 // syndrome is uncorrectable
 struct errorinfo *modesChecksumDiagnose(uint32_t syndrome, int bitlen) {
-    struct errorinfo *table;
-    int tablesize;
-
-    struct errorinfo ei;
-
     if (syndrome == 0)
         return &NO_ERRORS;
 
     assert(bitlen == 56 || bitlen == 112);
-    if (bitlen == 56) {
-        table = bitErrorTable_short;
-        tablesize = bitErrorTableSize_short;
-    } else {
-        table = bitErrorTable_long;
-        tablesize = bitErrorTableSize_long;
-    }
-
-    if (!table)
-        return NULL;
-
-    ei.syndrome = syndrome;
-    return bsearch(&ei, table, tablesize, sizeof (struct errorinfo), syndrome_compare);
+    if (bitlen == 56)
+        return lookupSyndrome(&syndromeHash_short, bitErrorTable_short, syndrome);
+    else
+        return lookupSyndrome(&syndromeHash_long, bitErrorTable_long, syndrome);
 }
 
 // Given a message and an error-correction descriptor,
@@ -427,23 +597,156 @@ void crcCleanupTables(void) {
 
     if (bitErrorTable_long != NULL)
         free(bitErrorTable_long);
+
+    sfree(syndromeHash_short.slots);
+    sfree(syndromeHash_long.slots);
 }
 
 #ifdef CRCDEBUG
 
+void setExit(int arg) {
+    exit(arg);
+}
+
+#define BENCH_MESSAGES (1 << 20)
+#define BENCH_ROUNDS 5
+
+static int64_t nanotime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void benchReport(const char *name, int64_t best) {
+    fprintf(stderr, "  %-30s %6.2f ns/op\n", name, best / (double) BENCH_MESSAGES);
+}
+
+// Checks the carry-less multiply checksum against the table and the syndrome hash against
+// a bsearch of the sorted table, then times all of them.
+static int benchmark(struct errorinfo *table, int tablesize, struct syndromeHash *hash, int bits) {
+    int bytes = bits / 8;
+    uint8_t *msgs = cmalloc(BENCH_MESSAGES * bytes);
+    uint32_t *syndromes = cmalloc(BENCH_MESSAGES * sizeof (uint32_t));
+    volatile uint32_t sink = 0;
+    int64_t start, best;
+
+    srandom(1);
+    for (int i = 0; i < BENCH_MESSAGES * bytes; ++i)
+        msgs[i] = random();
+
+    fprintf(stderr, "%d bit messages:\n", bits);
+
+#ifdef CRC_CLMUL
+    if (use_clmul) {
+        for (int i = 0; i < BENCH_MESSAGES; ++i) {
+            uint8_t *m = msgs + i * bytes;
+            uint32_t c = (bits == 56) ? checksumShortClmul(m) : checksumLongClmul(m);
+            if (c != checksumTable(m, bits)) {
+                fprintf(stderr, "checksum mismatch for message %d\n", i);
+                return 1;
+            }
+        }
+    }
+#endif
+
+    best = INT64_MAX;
+    for (int r = 0; r < BENCH_ROUNDS; ++r) {
+        uint32_t x = 0;
+        start = nanotime();
+        for (int i = 0; i < BENCH_MESSAGES; ++i)
+            x ^= checksumTable(msgs + i * bytes, bits);
+        best = imin(best, nanotime() - start);
+        sink ^= x;
+    }
+    benchReport("checksum, table", best);
+
+#ifdef CRC_CLMUL
+    if (use_clmul) {
+        best = INT64_MAX;
+        for (int r = 0; r < BENCH_ROUNDS; ++r) {
+            uint32_t x = 0;
+            start = nanotime();
+            if (bits == 56) {
+                for (int i = 0; i < BENCH_MESSAGES; ++i)
+                    x ^= checksumShortClmul(msgs + i * bytes);
+            } else {
+                for (int i = 0; i < BENCH_MESSAGES; ++i)
+                    x ^= checksumLongClmul(msgs + i * bytes);
+            }
+            best = imin(best, nanotime() - start);
+            sink ^= x;
+        }
+        benchReport("checksum, carry-less multiply", best);
+    } else {
+        fprintf(stderr, "  no carry-less multiply on this CPU\n");
+    }
+#endif
+
+    if (!hash->slots) {
+        sfree(msgs);
+        sfree(syndromes);
+        return 0;
+    }
+
+    // every other lookup is a correctable syndrome, the rest mostly misses like random noise
+    for (int i = 0; i < BENCH_MESSAGES; ++i)
+        syndromes[i] = (i & 1) ? table[random() % tablesize].syndrome : (random() & 0xffffff);
+    for (int i = 0; i < BENCH_MESSAGES; ++i) {
+        struct errorinfo key;
+        key.syndrome = syndromes[i];
+        if (lookupSyndrome(hash, table, syndromes[i]) != (syndromes[i] ? bsearch(&key, table, tablesize, sizeof (struct errorinfo), syndrome_compare) : NULL)) {
+            fprintf(stderr, "syndrome lookup mismatch for %06x\n", syndromes[i]);
+            return 1;
+        }
+    }
+
+    best = INT64_MAX;
+    for (int r = 0; r < BENCH_ROUNDS; ++r) {
+        uintptr_t x = 0;
+        start = nanotime();
+        for (int i = 0; i < BENCH_MESSAGES; ++i) {
+            struct errorinfo key;
+            key.syndrome = syndromes[i];
+            x += (uintptr_t) bsearch(&key, table, tablesize, sizeof (struct errorinfo), syndrome_compare);
+        }
+        best = imin(best, nanotime() - start);
+        sink ^= x;
+    }
+    benchReport("syndrome lookup, bsearch", best);
+
+    best = INT64_MAX;
+    for (int r = 0; r < BENCH_ROUNDS; ++r) {
+        uintptr_t x = 0;
+        start = nanotime();
+        for (int i = 0; i < BENCH_MESSAGES; ++i)
+            x += (uintptr_t) lookupSyndrome(hash, table, syndromes[i]);
+        best = imin(best, nanotime() - start);
+        sink ^= x;
+    }
+    benchReport("syndrome lookup, hash", best);
+
+    sfree(msgs);
+    sfree(syndromes);
+    return 0;
+}
+
 int main(int argc, char **argv) {
     int shortlen, longlen;
     int i;
     struct errorinfo *shorttable, *longtable;
+    int ncorrect = 1, ndetect = 1;
 
-    if (argc < 3) {
-        fprintf(stderr, "syntax: crctests <ncorrect> <ndetect>\n");
+    if (argc == 3) {
+        ncorrect = atoi(argv[1]);
+        ndetect = atoi(argv[2]);
+    } else if (argc != 1) {
+        fprintf(stderr, "syntax: crctests [<ncorrect> <ndetect>]\n");
         return 1;
     }
 
     initLookupTables();
-    shorttable = prepareErrorTable(MODES_SHORT_MSG_BITS, atoi(argv[1]), atoi(argv[2]), &shortlen);
-    longtable = prepareErrorTable(MODES_LONG_MSG_BITS, atoi(argv[1]), atoi(argv[2]), &longlen);
+    shorttable = prepareErrorTable(MODES_SHORT_MSG_BITS, ncorrect, ndetect, &shortlen);
+    longtable = prepareErrorTable(MODES_LONG_MSG_BITS, ncorrect, ndetect, &longlen);
 
     // check for DF11 correction syndromes where there is a syndrome with lower 7 bits all zero
     // (which would be used for DF11 error correction), but there's also a syndrome which has
@@ -558,9 +861,18 @@ int main(int argc, char **argv) {
         }
     }
 
+    struct syndromeHash shorthash, longhash;
+    buildSyndromeHash(&shorthash, shorttable, shortlen);
+    buildSyndromeHash(&longhash, longtable, longlen);
+
+    int res = benchmark(shorttable, shortlen, &shorthash, MODES_SHORT_MSG_BITS)
+        || benchmark(longtable, longlen, &longhash, MODES_LONG_MSG_BITS);
+
+    sfree(shorthash.slots);
+    sfree(longhash.slots);
     free(shorttable);
     free(longtable);
 
-    return 0;
+    return res;
 }
 #endif
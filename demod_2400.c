@@ -28,70 +28,6 @@
 #include <gd.h>
 #endif
 
-// 2.4MHz sampling rate version
-//
-// When sampling at 2.4MHz we have exactly 6 samples per 5 symbols.
-// Each symbol is 500ns wide, each sample is 416.7ns wide
-//
-// We maintain a phase offset that is expressed in units of 1/5 of a sample i.e. 1/6 of a symbol, 83.333ns
-// Each symbol we process advances the phase offset by 6 i.e. 6/5 of a sample, 500ns
-//
-// The correlation functions below correlate a 1-0 pair of symbols (i.e. manchester encoded 1 bit)
-// starting at the given sample, and assuming that the symbol starts at a fixed 0-5 phase offset within
-// m[0]. They return a correlation value, generally interpreted as >0 = 1 bit, <0 = 0 bit
-
-// TODO check if there are better (or more balanced) correlation functions to use here
-
-// nb: the correlation functions sum to zero, so we do not need to adjust for the DC offset in the input signal
-// (adding any constant value to all of m[0..3] does not change the result)
-
-
-// Changes 2020 by wiedehopf:
-// 20 units per sample, 24 units per symbol that are distributed according to phase
-// 1 bit has 2 symbols, in a bit representing a one the first symbol is high and the second is low
-
-// The previous assumption was that symbols beyond our control are zero.
-// Let's make the assumption that the symbols beyond our control are a statistical mean of 0 and 1.
-// Such a mean is represented by 12 units per symbol.
-// As an example for the above let's discuss the first slice function:
-// Samples 0 and 1 are completely occupied by the bit we are trying to judge thus no outside symbols.
-// The 3rd sample is 8 units of our bit and 12 units of the following symbol.
-// Our bit contributes part of a low symbol represented by -8 units
-// but we also get 12 units of 0.5 resulting in +6 units from the following symbol.
-//
-// The above comment is how these changes started out, i'll leave them here as food for thought.
-// Using --ifile the coefficients from the above thought process were iteratively tweaked by hand.
-// Note one of the correlation functions is no longer DC balanced (but just slightly)
-// Further testing on your own samples using --ifile --quiet --stats is welcome
-// Note you might need to use --throttle unless your using wiedehopf's readsb fork,
-// otherwise position stats won't work as they rely on realtime differences between
-// reception of CPRs.
-// Creating a 5 minute sample with a gain of 43.9:
-// timeout 300 rtl_sdr -f 1090000000 -s 2400000 -g 43.9 sample.dat
-// Checking a set of correlation functions using the above sample:
-// make && ./readsb --device-type ifile --ifile sample.dat --quiet --stats
-
-static inline __attribute__((always_inline)) int slice_phase0(uint16_t *m) {
-    return 18 * m[0] - 15 * m[1] - 3 * m[2];
-}
-
-static inline __attribute__((always_inline)) int slice_phase1(uint16_t *m) {
-    return 14 * m[0] - 5 * m[1] - 9 * m[2];
-}
-
-// slightly DC unbalanced but better results
-static inline __attribute__((always_inline)) int slice_phase2(uint16_t *m) {
-    return 16 * m[0] + 5 * m[1] - 20 * m[2];
-}
-
-static inline __attribute__((always_inline)) int slice_phase3(uint16_t *m) {
-    return 7 * m[0] + 11 * m[1] - 18 * m[2];
-}
-
-static inline __attribute__((always_inline)) int slice_phase4(uint16_t *m) {
-    return 4 * m[0] + 15 * m[1] - 20 * m[2] + 1 * m[3];
-}
-
 static uint32_t valid_df_short_bitset;        // set of acceptable DF values for short messages
 static uint32_t valid_df_long_bitset;         // set of acceptable DF values for long messages
 
@@ -128,347 +64,664 @@ static void init_bitsets()
 }
 
 
-// extract one byte from the mag buffers using slice_phase functions
-// advance pPtr and phase
-static inline __attribute__((always_inline)) uint8_t slice_byte(uint16_t **pPtr, int *phase) {
-    uint8_t theByte = 0;
-
-    switch (*phase) {
-        case 0:
-            theByte =
-                (slice_phase0(*pPtr) > 0 ? 0x80 : 0) |
-                (slice_phase2(*pPtr+2) > 0 ? 0x40 : 0) |
-                (slice_phase4(*pPtr+4) > 0 ? 0x20 : 0) |
-                (slice_phase1(*pPtr+7) > 0 ? 0x10 : 0) |
-                (slice_phase3(*pPtr+9) > 0 ? 0x08 : 0) |
-                (slice_phase0(*pPtr+12) > 0 ? 0x04 : 0) |
-                (slice_phase2(*pPtr+14) > 0 ? 0x02 : 0) |
-                (slice_phase4(*pPtr+16) > 0 ? 0x01 : 0);
-
-            *phase = 1;
-            *pPtr += 19;
-            break;
+// one preamble candidate, the best message of the phases that passed the preamble threshold
+struct demodCandidate {
+    unsigned char msg[MODES_LONG_MSG_BYTES];
+    int score; // -42: no phase passed the threshold, no preamble
+    int phase;
+    uint32_t phasesTried; // bit n set: phase n + 4 was sliced (demod_preamblePhase stats)
+};
 
-        case 1:
-            theByte =
-                (slice_phase1(*pPtr) > 0 ? 0x80 : 0) |
-                (slice_phase3(*pPtr+2) > 0 ? 0x40 : 0) |
-                (slice_phase0(*pPtr+5) > 0 ? 0x20 : 0) |
-                (slice_phase2(*pPtr+7) > 0 ? 0x10 : 0) |
-                (slice_phase4(*pPtr+9) > 0 ? 0x08 : 0) |
-                (slice_phase1(*pPtr+12) > 0 ? 0x04 : 0) |
-                (slice_phase3(*pPtr+14) > 0 ? 0x02 : 0) |
-                (slice_phase0(*pPtr+17) > 0 ? 0x01 : 0);
-
-            *phase = 2;
-            *pPtr += 19;
-            break;
+static slice_fn sliceMessage;
 
-        case 2:
-            theByte =
-                (slice_phase2(*pPtr) > 0 ? 0x80 : 0) |
-                (slice_phase4(*pPtr+2) > 0 ? 0x40 : 0) |
-                (slice_phase1(*pPtr+5) > 0 ? 0x20 : 0) |
-                (slice_phase3(*pPtr+7) > 0 ? 0x10 : 0) |
-                (slice_phase0(*pPtr+10) > 0 ? 0x08 : 0) |
-                (slice_phase2(*pPtr+12) > 0 ? 0x04 : 0) |
-                (slice_phase4(*pPtr+14) > 0 ? 0x02 : 0) |
-                (slice_phase1(*pPtr+17) > 0 ? 0x01 : 0);
-
-            *phase = 3;
-            *pPtr += 19;
-            break;
+// slice and score the phases set in c->phasesTried, keep the best message
+// the phases are scored in order 4 to 8, ties go to the lower phase
+static void score_phases(uint16_t *pa, struct demodCandidate *c) {
+    uint8_t msg[SLICE_PHASES][MODES_LONG_MSG_BYTES];
+    int bytelen[SLICE_PHASES];
+    int maxlen = 0;
+    uint32_t valid = 0;
 
-        case 3:
-            theByte =
-                (slice_phase3(*pPtr) > 0 ? 0x80 : 0) |
-                (slice_phase0(*pPtr+3) > 0 ? 0x40 : 0) |
-                (slice_phase2(*pPtr+5) > 0 ? 0x20 : 0) |
-                (slice_phase4(*pPtr+7) > 0 ? 0x10 : 0) |
-                (slice_phase1(*pPtr+10) > 0 ? 0x08 : 0) |
-                (slice_phase3(*pPtr+12) > 0 ? 0x04 : 0) |
-                (slice_phase0(*pPtr+15) > 0 ? 0x02 : 0) |
-                (slice_phase2(*pPtr+17) > 0 ? 0x01 : 0);
-
-            *phase = 4;
-            *pPtr += 19;
-            break;
+    // the first byte of all phases in one go, then the rest only if a phase has a DF we are interested in
+    sliceMessage(pa, c->phasesTried, 0, 1, msg);
 
-        case 4:
-            theByte =
-                (slice_phase4(*pPtr) > 0 ? 0x80 : 0) |
-                (slice_phase1(*pPtr+3) > 0 ? 0x40 : 0) |
-                (slice_phase3(*pPtr+5) > 0 ? 0x20 : 0) |
-                (slice_phase0(*pPtr+8) > 0 ? 0x10 : 0) |
-                (slice_phase2(*pPtr+10) > 0 ? 0x08 : 0) |
-                (slice_phase4(*pPtr+12) > 0 ? 0x04 : 0) |
-                (slice_phase1(*pPtr+15) > 0 ? 0x02 : 0) |
-                (slice_phase3(*pPtr+17) > 0 ? 0x01 : 0);
-
-            *phase = 0;
-            *pPtr += 20;
-            break;
-    }
-    return theByte;
-}
+    for (int j = 0; j < SLICE_PHASES; j++) {
+        bytelen[j] = 0;
+        if (!(c->phasesTried & (1 << j)))
+            continue;
 
-static void score_phase(int try_phase, uint16_t *pa, unsigned char **bestmsg, int *bestscore, int *bestphase, unsigned char **msg, unsigned char *msg1, unsigned char *msg2) {
-    Modes.stats_current.demod_preamblePhase[try_phase - 4]++;
-    uint16_t *pPtr;
-    int phase, score, bytelen;
+        // inspect DF field early, only continue processing
+        // messages where the DF appears valid
+        uint32_t df = msg[j][0] >> 3;
+        if (valid_df_long_bitset & (1 << df)) {
+            bytelen[j] = MODES_LONG_MSG_BYTES;
+        } else if (valid_df_short_bitset & (1 << df)) {
+            bytelen[j] = MODES_SHORT_MSG_BYTES;
+        }
+        if (bytelen[j])
+            valid |= 1 << j;
+        maxlen = imax(maxlen, bytelen[j]);
+    }
 
-    pPtr = pa + 19 + (try_phase / 5);
-    phase = try_phase % 5;
+    if (valid)
+        sliceMessage(pa, valid, 1, maxlen, msg);
 
-    (*msg)[0] = slice_byte(&pPtr, &phase);
+    for (int j = 0; j < SLICE_PHASES; j++) {
+        if (!(c->phasesTried & (1 << j)))
+            continue;
 
-    // inspect DF field early, only continue processing
-    // messages where the DF appears valid
-    uint32_t df = ((uint8_t) (*msg)[0]) >> 3;
-    if (valid_df_long_bitset & (1 << df)) {
-        bytelen = MODES_LONG_MSG_BYTES;
-    } else if (valid_df_short_bitset & (1 << df)) {
-        bytelen = MODES_SHORT_MSG_BYTES;
-    } else {
-        score = -2;
-        if (score > *bestscore) {
+        int score;
+        if (!bytelen[j]) {
             // this is only for preamble stats
-            *bestscore = score;
+            score = -2;
+            if (score > c->score)
+                c->score = score;
+            continue;
         }
-        return;
-    }
 
-    for (int i = 1; i < bytelen; ++i) {
-        (*msg)[i] = slice_byte(&pPtr, &phase);
+        // Score the mode S message and see if it's any good.
+        score = scoreModesMessage(msg[j], bytelen[j] * 8);
+        if (score > c->score) {
+            // new high score!
+            memcpy(c->msg, msg[j], bytelen[j]);
+            memset(c->msg + bytelen[j], 0, MODES_LONG_MSG_BYTES - bytelen[j]);
+            c->score = score;
+            c->phase = j + 4;
+        }
     }
+}
+
+static preamble_mask_fn preambleMask;
+static modeac_mask_fn modeacMask;
+
+static void init_demod_functions() {
+    struct preambleMaskImpl impl[4];
+    preambleMaskImplementations(impl, 4);
+    preambleMask = impl[0].mask;
+
+    struct sliceImpl slicers[4];
+    sliceImplementations(slicers, 4);
+    sliceMessage = slicers[0].slice;
 
-    // Score the mode S message and see if it's any good.
-    score = scoreModesMessage(*msg, bytelen * 8);
-    if (score > *bestscore) {
-        // new high score!
-        *bestmsg = *msg;
-        *bestscore = score;
-        *bestphase = try_phase;
+    struct modeacMaskImpl acMasks[4];
+    modeacMaskImplementations(acMasks, 4);
+    modeacMask = acMasks[0].mask;
+}
 
-        // swap to using the other buffer so we don't clobber our demodulated data
-        // (if we find a better result then we'll swap back, but that's OK because
-        // we no longer need this copy if we found a better one)
-        *msg = (*msg == msg1) ? msg2 : msg1;
+// first sample at or after pa passing the preamble pre-check, or a sample >= stop
+// *maskStart / *mask cache the pre-check bits of PREAMBLE_MASK_WIDTH samples starting at *maskStart
+static inline __attribute__((always_inline)) uint16_t *next_preamble(uint16_t *pa, uint16_t *stop, uint16_t **maskStart, uint32_t *mask) {
+    while (pa < stop) {
+        uint32_t offset = pa - *maskStart;
+        if (offset >= PREAMBLE_MASK_WIDTH) {
+            *maskStart = pa;
+            *mask = preambleMask(pa);
+            offset = 0;
+        }
+        uint32_t bits = *mask >> offset;
+        if (bits) {
+            return pa + __builtin_ctz(bits);
+        }
+        pa = *maskStart + PREAMBLE_MASK_WIDTH;
     }
+    return pa;
 }
 
+// preamble threshold factor (in 1/32) for the current buffer
+static int32_t preamble_threshold() {
+    // reduce number of preamble detections if we recently dropped samples
+    if (Modes.stats_15min.samples_dropped)
+        return imax(PREAMBLE_THRESHOLD_PIZERO, Modes.preambleThreshold);
+    else
+        return Modes.preambleThreshold;
+}
+
+// Noise floor per region of the buffer
 //
-// Given 'mlen' magnitude samples in 'm', sampled at 2.4MHz,
-// try to demodulate some Mode S messages.
-//
-void demodulate2400(struct mag_buf *mag) {
-    unsigned char msg1[MODES_LONG_MSG_BYTES], msg2[MODES_LONG_MSG_BYTES], *msg;
+// The 5 noise samples of a preamble are few: in plain noise they are often low enough by chance
+// for a random bump to pass the preamble check, which then slices up to 5 phases.
+// Each region of NOISE_REGION samples is cut into chunks of NOISE_CHUNK samples and the lowest eighth
+// of the chunk sums is taken as the noise floor: chunks with messages in them are sorted out
+// as long as they don't fill 7/8 of the region.
+// The noise reference of a candidate is not allowed to fall below half of what the noise floor
+// of its region predicts for 5 samples, real preambles practically never have noise that quiet.
+#define NOISE_REGION_SHIFT (11)
+#define NOISE_REGION (1 << NOISE_REGION_SHIFT)
+#define NOISE_CHUNK (32)
+#define NOISE_CHUNKS (NOISE_REGION / NOISE_CHUNK)
+
+static int32_t *regionNoise; // minimum base_noise per region
+static uint32_t regionNoiseAlloc;
+
+// sum of each chunk, kept simple so the compiler vectorizes it
+static inline __attribute__((always_inline)) void chunk_sums(const uint16_t *m, uint32_t *sums, int chunks) {
+    for (int c = 0; c < chunks; c++) {
+        uint32_t sum = 0;
+        for (int k = 0; k < NOISE_CHUNK; k++)
+            sum += m[c * NOISE_CHUNK + k];
+        sums[c] = sum;
+    }
+}
 
-    unsigned char *bestmsg = NULL;
-    int bestscore;
-    int bestphase = 0;
+// value at the lowest eighth of n values, reorders sums
+static uint32_t lower_octile(uint32_t *sums, int n) {
+    int want = n / 8;
+    int lo = 0;
+    int hi = n - 1;
+    while (lo < hi) {
+        uint32_t pivot = sums[(lo + hi) / 2];
+        int i = lo;
+        int j = hi;
+        while (i <= j) {
+            while (sums[i] < pivot)
+                i++;
+            while (sums[j] > pivot)
+                j--;
+            if (i <= j) {
+                uint32_t tmp = sums[i];
+                sums[i] = sums[j];
+                sums[j] = tmp;
+                i++;
+                j--;
+            }
+        }
+        if (want <= j)
+            hi = j;
+        else if (want >= i)
+            lo = i;
+        else
+            break;
+    }
+    return sums[want];
+}
 
-    uint16_t *m = mag->data;
-    uint32_t mlen = mag->length;
+// fill regionNoise for the buffer and account the noise floor in the stats
+// without --demod-noise-floor the samples aren't looked at and candidates only use their own noise samples
+static void noise_floor(struct mag_buf *mag) {
+    uint32_t regions = (mag->length + NOISE_REGION - 1) >> NOISE_REGION_SHIFT;
+    if (regions > regionNoiseAlloc) {
+        sfree(regionNoise);
+        regionNoise = cmalloc(regions * sizeof(int32_t));
+        regionNoiseAlloc = regions;
+    }
 
-    uint64_t sum_scaled_signal_power = 0;
+    if (!Modes.demodNoiseFloor) {
+        memset(regionNoise, 0, regions * sizeof(int32_t));
+        return;
+    }
 
-    // initialize bitsets on first call
-    if (!valid_df_short_bitset)
-        init_bitsets();
+    uint32_t sums[NOISE_CHUNKS];
+    uint64_t floor_sum = 0;
+    int32_t last = 0;
+    for (uint32_t r = 0; r < regions; r++) {
+        uint32_t from = r << NOISE_REGION_SHIFT;
+        int chunks = imin(NOISE_CHUNKS, (mag->length - from) / NOISE_CHUNK);
+        if (chunks >= 4) {
+            chunk_sums(mag->data + from, sums, chunks);
+            uint32_t octile = lower_octile(sums, chunks);
+            floor_sum += octile;
+            // 5 samples at the mean of that chunk, halved
+            last = (int32_t) (octile * 5 / (2 * NOISE_CHUNK));
+        }
+        // a short tail uses the floor of the region before
+        regionNoise[r] = last;
+    }
 
-    msg = msg1;
+    if (regions) {
+        // mean magnitude to power, assuming Rayleigh distributed noise: P = 4 / pi * mean^2
+        double mean = (double) floor_sum / (regions * NOISE_CHUNK) / 65535.0;
+        Modes.stats_current.noise_floor_sum += 4.0 / M_PI * mean * mean;
+        Modes.stats_current.noise_floor_count++;
+    }
+}
 
-    // advance ifile artificial clock even if we don't receive anything
-    if (Modes.sdr_type == SDR_IFILE)
-        Modes.synthetic_now = mag->sysTimestamp;
+static inline __attribute__((always_inline)) int32_t region_noise(uint16_t *m, uint16_t *pa) {
+    return regionNoise[(pa - m) >> NOISE_REGION_SHIFT];
+}
 
-    uint16_t *pa = m;
-    uint16_t *stop = m + mlen;
+// Look for a message starting at pa with phase offset 3..7
+// noise_min is the lowest base_noise the candidate is measured against (see noise_floor)
+// returns 1 if the candidate passed the preamble check on its own noise samples but not on noise_min
+// only depends on the samples and the icao filter (scoreModesMessage), no other state is changed
+static inline __attribute__((always_inline)) int evaluate_candidate(uint16_t *pa, int32_t threshold, int32_t noise_min, struct demodCandidate *c) {
+    int32_t pa_mag, base_noise, ref_level, max_mag;
+
+    c->score = -42;
+    c->phase = 0;
+    c->phasesTried = 0;
+
+    // Ideal sample values for preambles with different phase
+    // Xn is the first data symbol with phase offset N
+    //
+    // sample#: 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0
+    // phase 3: 2/4\0/5\1 0 0 0 0/5\1/3 3\0 0 0 0 0 0 X4
+    // phase 4: 1/5\0/4\2 0 0 0 0/4\2 2/4\0 0 0 0 0 0 0 X0
+    // phase 5: 0/5\1/3 3\0 0 0 0/3 3\1/5\0 0 0 0 0 0 0 X1
+    // phase 6: 0/4\2 2/4\0 0 0 0 2/4\0/5\1 0 0 0 0 0 0 X2
+    // phase 7: 0/3 3\1/5\0 0 0 0 1/5\0/4\2 0 0 0 0 0 0 X3
+
+    // 5 noise samples
+    base_noise = pa[5] + pa[8] + pa[16] + pa[17] + pa[18];
+    int32_t own_noise = base_noise;
+    if (base_noise < noise_min)
+        base_noise = noise_min;
+    // pa_mag is the sum of the 4 preamble high bits
+    // minus 2 low bits between each of high bit pairs
+
+    ref_level = base_noise * threshold;
+
+    ref_level >>= 5; // divide by 32
+
+    int32_t diff_2_3 =  pa[2] - pa[3];
+    int32_t sum_1_4 = pa[1] + pa[4];
+    int32_t diff_10_11 = pa[10] - pa[11];
+    int32_t common3456 = sum_1_4 - diff_2_3 + pa[9] + pa[12];
+
+    // sample#: 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0
+    // phase 3: 2/4\0/5\1 0 0 0 0/5\1/3 3\0 0 0 0 0 0 X4
+    // phase 4: 1/5\0/4\2 0 0 0 0/4\2 2/4\0 0 0 0 0 0 0 X0
+    pa_mag = common3456 - diff_10_11;
+    max_mag = pa_mag;
+    if (pa_mag >= ref_level) {
+        // peaks at 1,3,9,11-12: phase 3
+        // peaks at 1,3,9,12: phase 4
+        c->phasesTried |= (1 << 0) | (1 << 1);
+    }
 
-    for (; pa < stop; pa++) {
-        int32_t pa_mag, base_noise, ref_level;
-        int msglen;
-
-        // Look for a message starting at around sample 0 with phase offset 3..7
-
-        // Ideal sample values for preambles with different phase
-        // Xn is the first data symbol with phase offset N
-        //
-        // sample#: 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0
-        // phase 3: 2/4\0/5\1 0 0 0 0/5\1/3 3\0 0 0 0 0 0 X4
-        // phase 4: 1/5\0/4\2 0 0 0 0/4\2 2/4\0 0 0 0 0 0 0 X0
-        // phase 5: 0/5\1/3 3\0 0 0 0/3 3\1/5\0 0 0 0 0 0 0 X1
-        // phase 6: 0/4\2 2/4\0 0 0 0 2/4\0/5\1 0 0 0 0 0 0 X2
-        // phase 7: 0/3 3\1/5\0 0 0 0 1/5\0/4\2 0 0 0 0 0 0 X3
-
-        // do a pre-check to reduce CPU usage
-        // some silly unrolling that cuts CPU cycles
-        // due to plenty room in the message buffer for decoding
-        // we can with pa go beyond stop without a buffer overrun ...
-
-        if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) { goto after_pre; }
-        pa++; if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) { goto after_pre; }
-        pa++; if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) { goto after_pre; }
-        pa++; if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) { goto after_pre; }
-        pa++; if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) { goto after_pre; }
-        pa++; if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) { goto after_pre; }
-        pa++; if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) { goto after_pre; }
-        pa++; if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) { goto after_pre; }
-        pa++; if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) { goto after_pre; }
-        pa++; if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) { goto after_pre; }
-
-        continue;
-
-after_pre:
-        // ... but we must NOT decode if have ran past stop
-        if (!(pa < stop))
-            continue;
+    // sample#: 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0
+    // phase 5: 0/5\1/3 3\0 0 0 0/3 3\1/5\0 0 0 0 0 0 0 X1
+    // phase 6: 0/4\2 2/4\0 0 0 0 2/4\0/5\1 0 0 0 0 0 0 X2
+    pa_mag = common3456 + diff_10_11;
+    max_mag = imax(max_mag, pa_mag);
+    if (pa_mag >= ref_level) {
+        // peaks at 1,3-4,9-10,12: phase 5
+        // peaks at 1,4,10,12: phase 6
+        c->phasesTried |= (1 << 2) | (1 << 3);
+    }
 
-        // 5 noise samples
-        base_noise = pa[5] + pa[8] + pa[16] + pa[17] + pa[18];
-        // pa_mag is the sum of the 4 preamble high bits
-        // minus 2 low bits between each of high bit pairs
+    // peaks at 1-2,4,10,12: phase 7
+    // sample#: 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0
+    // phase 7: 0/3 3\1/5\0 0 0 0 1/5\0/4\2 0 0 0 0 0 0 X3
+    pa_mag = sum_1_4 + 2 * diff_2_3 + diff_10_11 + pa[12];
+    max_mag = imax(max_mag, pa_mag);
+    if (pa_mag >= ref_level)
+        c->phasesTried |= (1 << 4);
 
-        // reduce number of preamble detections if we recently dropped samples
-        if (Modes.stats_15min.samples_dropped)
-            ref_level = base_noise * imax(PREAMBLE_THRESHOLD_PIZERO, Modes.preambleThreshold);
-        else
-            ref_level = base_noise * Modes.preambleThreshold;
+    if (c->phasesTried)
+        score_phases(pa, c);
 
-        ref_level >>= 5; // divide by 32
+    return !c->phasesTried && own_noise < noise_min && max_mag >= ((own_noise * threshold) >> 5);
+}
 
-        bestscore = -42;
+// Count a candidate with a preamble in the stats, decode it and pass the message on.
+// Returns how many samples the demodulator skips after pa.
+static int use_candidate(struct mag_buf *mag, uint16_t *pa, struct demodCandidate *c, uint64_t *sum_scaled_signal_power) {
+    int msglen;
 
-        int32_t diff_2_3 =  pa[2] - pa[3];
-        int32_t sum_1_4 = pa[1] + pa[4];
-        int32_t diff_10_11 = pa[10] - pa[11];
-        int32_t common3456 = sum_1_4 - diff_2_3 + pa[9] + pa[12];
+    for (int k = 0; k < 5; k++) {
+        if (c->phasesTried & (1 << k))
+            Modes.stats_current.demod_preamblePhase[k]++;
+    }
 
-        // sample#: 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0
-        // phase 3: 2/4\0/5\1 0 0 0 0/5\1/3 3\0 0 0 0 0 0 X4
-        // phase 4: 1/5\0/4\2 0 0 0 0/4\2 2/4\0 0 0 0 0 0 0 X0
-        pa_mag = common3456 - diff_10_11;
-        if (pa_mag >= ref_level) {
-            // peaks at 1,3,9,11-12: phase 3
-            score_phase(4, pa, &bestmsg, &bestscore, &bestphase, &msg, msg1, msg2);
+    // we had at least one phase greater than the preamble threshold
+    // and used scoremodesmessage on those bytes
+    Modes.stats_current.demod_preambles++;
 
-            // peaks at 1,3,9,12: phase 4
-            score_phase(5, pa, &bestmsg, &bestscore, &bestphase, &msg, msg1, msg2);
-        }
+    // Do we have a candidate?
+    if (c->score < 0) {
 
-        // sample#: 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0
-        // phase 5: 0/5\1/3 3\0 0 0 0/3 3\1/5\0 0 0 0 0 0 0 X1
-        // phase 6: 0/4\2 2/4\0 0 0 0 2/4\0/5\1 0 0 0 0 0 0 X2
-        pa_mag = common3456 + diff_10_11;
-        if (pa_mag >= ref_level) {
-            // peaks at 1,3-4,9-10,12: phase 5
-            score_phase(6, pa, &bestmsg, &bestscore, &bestphase, &msg, msg1, msg2);
+        if (c->score == -1)
+            Modes.stats_current.demod_rejected_unknown_icao++;
+        else
+            Modes.stats_current.demod_rejected_bad++;
+        return 0; // nope.
+    }
 
-            // peaks at 1,4,10,12: phase 6
-            score_phase(7, pa, &bestmsg, &bestscore, &bestphase, &msg, msg1, msg2);
-        }
+    msglen = modesMessageLenByType(getbits(c->msg, 1, 5));
 
-        // peaks at 1-2,4,10,12: phase 7
-        // sample#: 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0
-        // phase 7: 0/3 3\1/5\0 0 0 0 1/5\0/4\2 0 0 0 0 0 0 X3
-        pa_mag = sum_1_4 + 2 * diff_2_3 + diff_10_11 + pa[12];
-        if (pa_mag >= ref_level)
-            score_phase(8, pa, &bestmsg, &bestscore, &bestphase, &msg, msg1, msg2);
+    struct modesMessage *mm = netGetMM(&Modes.netMessageBuffer[0]);
 
+    // For consistency with how the Beast / Radarcape does it,
+    // we report the timestamp at the end of bit 56 (even if
+    // the frame is a 112-bit frame)
+    mm->timestamp = mag->sampleTimestamp + (pa - mag->data) * 5 + (8 + 56) * 12 + c->phase;
 
-        // no preamble detected
-        if (bestscore == -42)
-            continue;
+    // compute message receive time as block-start-time + difference in the 12MHz clock
+    mm->sysTimestamp = mag->sysTimestamp + receiveclock_ms_elapsed(mag->sampleTimestamp, mm->timestamp);
 
-        // we had at least one phase greater than the preamble threshold
-        // and used scoremodesmessage on those bytes
-        Modes.stats_current.demod_preambles++;
+    // advance ifile artifical clock for every message received
+    if (Modes.sdr_type == SDR_IFILE)
+        Modes.synthetic_now = mm->sysTimestamp;
 
-        // Do we have a candidate?
-        if (bestscore < 0) {
+    mm->score = c->score;
 
-            if (bestscore == -1)
+    // Decode the received message
+    {
+        memcpy(mm->msg, c->msg, MODES_LONG_MSG_BYTES);
+        int result = decodeModesMessage(mm);
+        if (result < 0) {
+            if (result == -1)
                 Modes.stats_current.demod_rejected_unknown_icao++;
             else
                 Modes.stats_current.demod_rejected_bad++;
-            continue; // nope.
+            return 0;
+        } else {
+            Modes.stats_current.demod_accepted[mm->correctedbits]++;
         }
+    }
 
-        msglen = modesMessageLenByType(getbits(bestmsg, 1, 5));
+    Modes.stats_current.demod_bestPhase[c->phase - 4]++;
 
-        struct modesMessage *mm = netGetMM(&Modes.netMessageBuffer[0]);
+    // measure signal power
+    {
+        double signal_power;
+        uint64_t scaled_signal_power = 0;
+        int signal_len = msglen * 12 / 5;
+        int k;
+
+        for (k = 0; k < signal_len; ++k) {
+            uint32_t mag = pa[19 + k];
+            scaled_signal_power += mag * mag;
+        }
 
-        // For consistency with how the Beast / Radarcape does it,
-        // we report the timestamp at the end of bit 56 (even if
-        // the frame is a 112-bit frame)
-        mm->timestamp = mag->sampleTimestamp + (pa -m) * 5 + (8 + 56) * 12 + bestphase;
+        signal_power = scaled_signal_power / 65535.0 / 65535.0;
+        mm->signalLevel = signal_power / signal_len;
+        Modes.stats_current.signal_power_sum += signal_power;
+        Modes.stats_current.signal_power_count += signal_len;
+        *sum_scaled_signal_power += scaled_signal_power;
 
-        // compute message receive time as block-start-time + difference in the 12MHz clock
-        mm->sysTimestamp = mag->sysTimestamp + receiveclock_ms_elapsed(mag->sampleTimestamp, mm->timestamp);
+        if (mm->signalLevel > Modes.stats_current.peak_signal_power)
+            Modes.stats_current.peak_signal_power = mm->signalLevel;
+        if (mm->signalLevel > 0.50119)
+            Modes.stats_current.strong_signal_count++; // signal power above -3dBFS
+    }
 
-        // advance ifile artifical clock for every message received
-        if (Modes.sdr_type == SDR_IFILE)
-            Modes.synthetic_now = mm->sysTimestamp;
-
-        mm->score = bestscore;
-
-        // Decode the received message
-        {
-            memcpy(mm->msg, bestmsg, MODES_LONG_MSG_BYTES);
-            int result = decodeModesMessage(mm);
-            if (result < 0) {
-                if (result == -1)
-                    Modes.stats_current.demod_rejected_unknown_icao++;
-                else
-                    Modes.stats_current.demod_rejected_bad++;
-                continue;
-            } else {
-                Modes.stats_current.demod_accepted[mm->correctedbits]++;
+    // Pass data to the next layer
+    netUseMessage(mm);
+
+    // Skip over the message:
+    // (we actually skip to 8 bits before the end of the message,
+    //  because we can often decode two messages that *almost* collide,
+    //  where the preamble of the second message clobbered the last
+    //  few bits of the first message, but the message bits didn't
+    //  overlap)
+    //return msglen * 12 / 5;
+    //
+    // let's test something, only jump part of the message and let the preamble detection handle the rest.
+    return msglen * 8 / 4;
+}
+
+// Mode A/C
+//
+// With --modeac the framing pulses are looked for in the same pass over the buffer as the Mode S preambles:
+// the sequential loop scans for Mode A/C up to each Mode S candidate before evaluating it, so the samples
+// are still in cache. With --demod-threads > 1 the Mode A/C scan is one more task next to the Mode S segments.
+// The frames found are passed on after the Mode S messages of the buffer, as before.
+
+struct modeacFrame {
+    uint32_t f2_clock; // 60MHz clock of F2 since the start of the buffer
+    uint32_t modeac;
+};
+
+struct modeacScan {
+    struct mag_buf *mag;
+    uint16_t *next; // next F1 sample to look at
+    uint16_t *maskStart;
+    uint32_t mask;
+    uint16_t level; // pre-check level, see modeacMaskImplementations
+    unsigned noise_level;
+    struct modeacFrame *frames;
+    int len;
+    int alloc;
+};
+
+static struct modeacScan modeacScan;
+
+static void modeacScanTo(struct modeacScan *scan, uint16_t *stop);
+static void modeacTask(void *arg, threadpool_threadbuffers_t *buffer_group);
+static void modeacSubmit(struct modeacScan *scan);
+
+static void modeacStart(struct modeacScan *scan, struct mag_buf *mag) {
+    double noise_stddev = sqrt(mag->mean_power - mag->mean_level * mag->mean_level); // Var(X) = E[(X-E[X])^2] = E[X^2] - (E[X])^2
+    scan->noise_level = (unsigned) ((mag->mean_power + noise_stddev) * 65535 + 0.5);
+    scan->level = (uint16_t) imin(65535, 4 * (int64_t) scan->noise_level);
+    scan->mag = mag;
+    scan->next = mag->data + 1;
+    scan->maskStart = scan->next;
+    scan->mask = modeacMask(scan->maskStart, scan->level);
+    scan->len = 0;
+}
+
+// first sample at or after f1 passing the framing pulse pre-check, or a sample >= stop
+static inline __attribute__((always_inline)) uint16_t *next_framing_pulse(uint16_t *f1, uint16_t *stop, struct modeacScan *scan) {
+    while (f1 < stop) {
+        uint32_t offset = f1 - scan->maskStart;
+        if (offset >= PREAMBLE_MASK_WIDTH) {
+            scan->maskStart = f1;
+            scan->mask = modeacMask(f1, scan->level);
+            offset = 0;
+        }
+        uint32_t bits = scan->mask >> offset;
+        if (bits) {
+            return f1 + __builtin_ctz(bits);
+        }
+        f1 = scan->maskStart + PREAMBLE_MASK_WIDTH;
+    }
+    return f1;
+}
+
+// --demod-threads > 1
+//
+// Each buffer is cut into one segment per thread. The threads look at every sample of their segment
+// passing the pre-check and record each candidate with a preamble: the best message and its score.
+// They don't decode, don't skip over messages and don't touch any stats. Candidates rejected only by the
+// region noise floor are recorded as well, the merge counts those the sequential loop would have looked at.
+// Reading beyond the end of a segment is fine, it's the same data the sequential loop reads there.
+//
+// The decode thread then walks the candidates of all segments in sample order and does exactly what
+// the sequential loop does: candidates it would have skipped over are dropped, the others are
+// counted and decoded. Scoring depends on the icao filter and decoding a message can add an address.
+// When that happens the remaining candidates of the buffer are scored again, the result is the same
+// as for a single thread.
+
+struct demodEvent {
+    uint32_t pos; // sample index of pa
+    int floorRejected; // no preamble because of the noise floor, c is not used
+    struct demodCandidate c;
+};
+
+struct demodSegment {
+    struct mag_buf *mag;
+    uint32_t from; // candidates start in [from, to)
+    uint32_t to;
+    int32_t threshold;
+    struct demodEvent *events;
+    int len;
+    int alloc;
+};
+
+static struct demodSegment *demodSegments;
+
+static void demodTask(void *arg, threadpool_threadbuffers_t *buffer_group) {
+    MODES_NOTUSED(buffer_group);
+    struct demodSegment *seg = arg;
+    uint16_t *m = seg->mag->data;
+    uint16_t *pa = m + seg->from;
+    uint16_t *stop = m + seg->to;
+
+    uint16_t *maskStart = pa;
+    uint32_t mask = preambleMask(pa);
+
+    seg->len = 0;
+    for (; pa < stop; pa++) {
+        pa = next_preamble(pa, stop, &maskStart, &mask);
+        if (!(pa < stop))
+            break;
+
+        if (seg->len == seg->alloc) {
+            seg->alloc = seg->alloc ? 2 * seg->alloc : 1024;
+            seg->events = realloc(seg->events, seg->alloc * sizeof(struct demodEvent));
+            if (!seg->events) {
+                fprintf(stderr, "demodTask: out of memory\n");
+                exit(1);
             }
         }
+        struct demodEvent *ev = &seg->events[seg->len];
+        ev->floorRejected = evaluate_candidate(pa, seg->threshold, region_noise(m, pa), &ev->c);
+        if (ev->c.score == -42 && !ev->floorRejected)
+            continue;
+        ev->pos = pa - m;
+        seg->len++;
+    }
+}
 
-        Modes.stats_current.demod_bestPhase[bestphase - 4]++;
+static void demodulate2400Threaded(struct mag_buf *mag, int32_t threshold, uint64_t *sum_scaled_signal_power) {
+    int parts = Modes.demodThreads;
+    uint16_t *m = mag->data;
+
+    if (!Modes.demodPool) {
+        Modes.demodPool = threadpool_create(parts, 0);
+        Modes.demodTasks = allocate_task_group(parts + 1);
+        demodSegments = cmalloc(parts * sizeof(struct demodSegment));
+        memset(demodSegments, 0x0, parts * sizeof(struct demodSegment));
+    }
+
+    threadpool_task_t *tasks = Modes.demodTasks->tasks;
+    for (int k = 0; k < parts; k++) {
+        struct demodSegment *seg = &demodSegments[k];
+        seg->mag = mag;
+        seg->from = (uint64_t) mag->length * k / parts;
+        seg->to = (uint64_t) mag->length * (k + 1) / parts;
+        seg->threshold = threshold;
+        tasks[k].function = demodTask;
+        tasks[k].argument = seg;
+    }
+    int taskCount = parts;
+    if (Modes.mode_ac) {
+        tasks[taskCount].function = modeacTask;
+        tasks[taskCount].argument = &modeacScan;
+        taskCount++;
+    }
+
+    uint32_t filterGeneration = icaoFilterGeneration();
 
-        // measure signal power
-        {
-            double signal_power;
-            uint64_t scaled_signal_power = 0;
-            int signal_len = msglen * 12 / 5;
-            int k;
+    struct timespec before = threadpool_get_cumulative_thread_time(Modes.demodPool);
+    threadpool_run(Modes.demodPool, tasks, taskCount);
+    struct timespec after = threadpool_get_cumulative_thread_time(Modes.demodPool);
+    timespec_add_elapsed(&before, &after, &Modes.stats_current.demod_cpu);
 
-            for (k = 0; k < signal_len; ++k) {
-                uint32_t mag = pa[19 + k];
-                scaled_signal_power += mag * mag;
+    // first sample the sequential loop would look at next
+    uint32_t next = 0;
+    for (int k = 0; k < parts; k++) {
+        struct demodSegment *seg = &demodSegments[k];
+        for (int i = 0; i < seg->len; i++) {
+            struct demodEvent *ev = &seg->events[i];
+            if (ev->pos < next)
+                continue;
+            if (ev->floorRejected) {
+                Modes.stats_current.demod_floor_rejected++;
+                continue;
             }
 
-            signal_power = scaled_signal_power / 65535.0 / 65535.0;
-            mm->signalLevel = signal_power / signal_len;
-            Modes.stats_current.signal_power_sum += signal_power;
-            Modes.stats_current.signal_power_count += signal_len;
-            sum_scaled_signal_power += scaled_signal_power;
+            struct demodCandidate *c = &ev->c;
+            struct demodCandidate rescored;
+            if (icaoFilterGeneration() != filterGeneration) {
+                evaluate_candidate(m + ev->pos, threshold, region_noise(m, m + ev->pos), &rescored);
+                c = &rescored;
+            }
+            next = ev->pos + use_candidate(mag, m + ev->pos, c, sum_scaled_signal_power) + 1;
+        }
+    }
+}
 
-            if (mm->signalLevel > Modes.stats_current.peak_signal_power)
-                Modes.stats_current.peak_signal_power = mm->signalLevel;
-            if (mm->signalLevel > 0.50119)
-                Modes.stats_current.strong_signal_count++; // signal power above -3dBFS
+void demodulate2400Cleanup() {
+    if (Modes.demodPool) {
+        threadpool_destroy(Modes.demodPool);
+        destroy_task_group(Modes.demodTasks);
+        Modes.demodPool = NULL;
+        Modes.demodTasks = NULL;
+        for (int k = 0; k < Modes.demodThreads; k++) {
+            sfree(demodSegments[k].events);
         }
+        sfree(demodSegments);
+    }
+    sfree(regionNoise);
+    regionNoiseAlloc = 0;
+    sfree(modeacScan.frames);
+    modeacScan.alloc = 0;
+}
 
-        // Skip over the message:
-        // (we actually skip to 8 bits before the end of the message,
-        //  because we can often decode two messages that *almost* collide,
-        //  where the preamble of the second message clobbered the last
-        //  few bits of the first message, but the message bits didn't
-        //  overlap)
-        //pa += msglen * 12 / 5;
-        //
-        // let's test something, only jump part of the message and let the preamble detection handle the rest.
-        pa += msglen * 8 / 4;
+//
+// Given 'mlen' magnitude samples in 'm', sampled at 2.4MHz,
+// try to demodulate some Mode S messages, with --modeac also Mode A/C messages.
+//
+void demodulate2400(struct mag_buf *mag) {
+    struct demodCandidate c;
 
-        // Pass data to the next layer
-        netUseMessage(mm);
+    uint16_t *m = mag->data;
+    uint32_t mlen = mag->length;
+
+    uint64_t sum_scaled_signal_power = 0;
+
+    // initialize bitsets on first call
+    if (!valid_df_short_bitset)
+        init_bitsets();
+    if (!preambleMask)
+        init_demod_functions();
+
+    // advance ifile artificial clock even if we don't receive anything
+    if (Modes.sdr_type == SDR_IFILE)
+        Modes.synthetic_now = mag->sysTimestamp;
+
+    int32_t threshold = preamble_threshold();
+    Modes.stats_current.preamble_threshold = threshold;
+
+    noise_floor(mag);
+
+    struct modeacScan *ac = NULL;
+    if (Modes.mode_ac) {
+        ac = &modeacScan;
+        modeacStart(ac, mag);
+    }
+
+    if (Modes.demodThreads > 1 && mlen >= DEMOD_MIN_SEGMENT * (uint32_t) Modes.demodThreads) {
+        demodulate2400Threaded(mag, threshold, &sum_scaled_signal_power);
+    } else {
+        uint16_t *pa = m;
+        uint16_t *stop = m + mlen;
+
+        uint16_t *maskStart = m;
+        uint32_t mask = preambleMask(m);
+
+        for (; pa < stop; pa++) {
+            // do a pre-check to reduce CPU usage
+            // it's evaluated for PREAMBLE_MASK_WIDTH samples at once using SIMD where available
+            // due to plenty room in the message buffer for decoding
+            // the pre-check can look beyond stop without a buffer overrun ...
+            pa = next_preamble(pa, stop, &maskStart, &mask);
+
+            // ... but we must NOT decode if have ran past stop
+            if (!(pa < stop))
+                break;
+
+            if (ac)
+                modeacScanTo(ac, pa);
+
+            Modes.stats_current.demod_floor_rejected += evaluate_candidate(pa, threshold, region_noise(m, pa), &c);
+
+            // no preamble detected
+            if (c.score == -42)
+                continue;
+
+            pa += use_candidate(mag, pa, &c, &sum_scaled_signal_power);
+        }
+        if (ac)
+            modeacScanTo(ac, stop);
     }
 
+    if (ac)
+        modeacSubmit(ac);
+
     /* update noise power */
     {
         double sum_signal_power = sum_scaled_signal_power / 65535.0 / 65535.0;
@@ -570,190 +823,226 @@ static void draw_modeac(uint16_t *m, unsigned modeac, unsigned f1_clock, unsigne
 //            1.00us = 60 cycles } one bit period = 1.45us = 87 cycles
 //
 // one 2.4MHz sample = 25 cycles
-void demodulate2400AC(struct mag_buf *mag) {
-    uint16_t *m = mag->data;
-    uint32_t mlen = mag->length;
-    unsigned f1_sample;
-
-    double noise_stddev = sqrt(mag->mean_power - mag->mean_level * mag->mean_level); // Var(X) = E[(X-E[X])^2] = E[X^2] - (E[X])^2
-    unsigned noise_level = (unsigned) ((mag->mean_power + noise_stddev) * 65535 + 0.5);
-
-    for (f1_sample = 1; f1_sample < mlen; ++f1_sample) {
-        // Mode A/C messages should match this bit sequence:
-
-        // bit #     value
-        //   -1       0    quiet zone
-        //    0       1    framing pulse (F1)
-        //    1      C1
-        //    2      A1
-        //    3      C2
-        //    4      A2
-        //    5      C4
-        //    6      A4
-        //    7       0    quiet zone (X1)
-        //    8      B1
-        //    9      D1
-        //   10      B2
-        //   11      D2
-        //   12      B4
-        //   13      D4
-        //   14       1    framing pulse (F2)
-        //   15       0    quiet zone (X2)
-        //   16       0    quiet zone (X3)
-        //   17     SPI
-        //   18       0    quiet zone (X4)
-        //   19       0    quiet zone (X5)
-
-        // Look for a F1 and F2 pair,
-        // with F1 starting at offset f1_sample.
-
-        // the first framing pulse covers 3.5 samples:
-        //
-        // |----|        |----|
-        // | F1 |________| C1 |_
-        //
-        // | 0 | 1 | 2 | 3 | 4 |
-        //
-        // and there is some unknown phase offset of the
-        // leading edge e.g.:
-        //
-        //   |----|        |----|
-        // __| F1 |________| C1 |_
-        //
-        // | 0 | 1 | 2 | 3 | 4 |
-        //
-        // in theory the "on" period can straddle 3 samples
-        // but it's not a big deal as at most 4% of the power
-        // is in the third sample.
-
-        if (!(m[f1_sample - 1] < m[f1_sample + 0]))
-            continue; // not a rising edge
-
-        if (m[f1_sample + 2] > m[f1_sample + 0] || m[f1_sample + 2] > m[f1_sample + 1])
-            continue; // quiet part of bit wasn't sufficiently quiet
-
-        unsigned f1_level = (m[f1_sample + 0] + m[f1_sample + 1]) / 2;
-
-        if (noise_level * 2 > f1_level) {
-            // require 6dB above noise
-            continue;
-        }
+//
+// Mode A/C candidate with F1 starting at f1_sample, only depends on the samples
+static int modeac_frame(uint16_t *m, uint32_t mlen, unsigned f1_sample, unsigned noise_level, struct modeacFrame *frame) {
+    // Mode A/C messages should match this bit sequence:
+
+    // bit #     value
+    //   -1       0    quiet zone
+    //    0       1    framing pulse (F1)
+    //    1      C1
+    //    2      A1
+    //    3      C2
+    //    4      A2
+    //    5      C4
+    //    6      A4
+    //    7       0    quiet zone (X1)
+    //    8      B1
+    //    9      D1
+    //   10      B2
+    //   11      D2
+    //   12      B4
+    //   13      D4
+    //   14       1    framing pulse (F2)
+    //   15       0    quiet zone (X2)
+    //   16       0    quiet zone (X3)
+    //   17     SPI
+    //   18       0    quiet zone (X4)
+    //   19       0    quiet zone (X5)
+
+    // Look for a F1 and F2 pair,
+    // with F1 starting at offset f1_sample.
+
+    // the first framing pulse covers 3.5 samples:
+    //
+    // |----|        |----|
+    // | F1 |________| C1 |_
+    //
+    // | 0 | 1 | 2 | 3 | 4 |
+    //
+    // and there is some unknown phase offset of the
+    // leading edge e.g.:
+    //
+    //   |----|        |----|
+    // __| F1 |________| C1 |_
+    //
+    // | 0 | 1 | 2 | 3 | 4 |
+    //
+    // in theory the "on" period can straddle 3 samples
+    // but it's not a big deal as at most 4% of the power
+    // is in the third sample.
+
+    if (!(m[f1_sample - 1] < m[f1_sample + 0]))
+        return 0; // not a rising edge
+
+    if (m[f1_sample + 2] > m[f1_sample + 0] || m[f1_sample + 2] > m[f1_sample + 1])
+        return 0; // quiet part of bit wasn't sufficiently quiet
+
+    unsigned f1_level = (m[f1_sample + 0] + m[f1_sample + 1]) / 2;
+
+    if (noise_level * 2 > f1_level) {
+        // require 6dB above noise
+        return 0;
+    }
 
-        // estimate initial clock phase based on the amount of power
-        // that ended up in the second sample
+    // estimate initial clock phase based on the amount of power
+    // that ended up in the second sample
 
-        float f1a_power = (float) m[f1_sample] * m[f1_sample];
-        float f1b_power = (float) m[f1_sample + 1] * m[f1_sample + 1];
-        float fraction = f1b_power / (f1a_power + f1b_power);
-        unsigned f1_clock = (unsigned) (25 * (f1_sample + fraction * fraction) + 0.5);
+    float f1a_power = (float) m[f1_sample] * m[f1_sample];
+    float f1b_power = (float) m[f1_sample + 1] * m[f1_sample + 1];
+    float fraction = f1b_power / (f1a_power + f1b_power);
+    unsigned f1_clock = (unsigned) (25 * (f1_sample + fraction * fraction) + 0.5);
 
-        // same again for F2
-        // F2 is 20.3us / 14 bit periods after F1
-        unsigned f2_clock = f1_clock + (87 * 14);
-        unsigned f2_sample = f2_clock / 25;
-        assert(f2_sample < mlen + Modes.trailing_samples);
+    // same again for F2
+    // F2 is 20.3us / 14 bit periods after F1
+    unsigned f2_clock = f1_clock + (87 * 14);
+    unsigned f2_sample = f2_clock / 25;
+    assert(f2_sample < mlen + Modes.trailing_samples);
 
-        if (!(m[f2_sample - 1] < m[f2_sample + 0]))
-            continue;
+    if (!(m[f2_sample - 1] < m[f2_sample + 0]))
+        return 0;
 
-        if (m[f2_sample + 2] > m[f2_sample + 0] || m[f2_sample + 2] > m[f2_sample + 1])
-            continue; // quiet part of bit wasn't sufficiently quiet
+    if (m[f2_sample + 2] > m[f2_sample + 0] || m[f2_sample + 2] > m[f2_sample + 1])
+        return 0; // quiet part of bit wasn't sufficiently quiet
 
-        unsigned f2_level = (m[f2_sample + 0] + m[f2_sample + 1]) / 2;
+    unsigned f2_level = (m[f2_sample + 0] + m[f2_sample + 1]) / 2;
 
-        if (noise_level * 2 > f2_level) {
-            // require 6dB above noise
-            continue;
-        }
-
-        unsigned f1f2_level = (f1_level > f2_level ? f1_level : f2_level);
+    if (noise_level * 2 > f2_level) {
+        // require 6dB above noise
+        return 0;
+    }
 
-        float midpoint = sqrtf(noise_level * f1f2_level); // geometric mean of the two levels
-        unsigned signal_threshold = (unsigned) (midpoint * M_SQRT2 + 0.5); // +3dB
-        unsigned noise_threshold = (unsigned) (midpoint / M_SQRT2 + 0.5); // -3dB
+    unsigned f1f2_level = (f1_level > f2_level ? f1_level : f2_level);
 
-        // Looks like a real signal. Demodulate all the bits.
-        unsigned uncertain_bits = 0;
-        unsigned noisy_bits = 0;
-        unsigned bits = 0;
-        unsigned bit;
-        unsigned clock;
-        for (bit = 0, clock = f1_clock; bit < 20; ++bit, clock += 87) {
-            unsigned sample = clock / 25;
+    float midpoint = sqrtf(noise_level * f1f2_level); // geometric mean of the two levels
+    unsigned signal_threshold = (unsigned) (midpoint * M_SQRT2 + 0.5); // +3dB
+    unsigned noise_threshold = (unsigned) (midpoint / M_SQRT2 + 0.5); // -3dB
 
-            bits <<= 1;
-            noisy_bits <<= 1;
-            uncertain_bits <<= 1;
+    // Looks like a real signal. Demodulate all the bits.
+    unsigned uncertain_bits = 0;
+    unsigned noisy_bits = 0;
+    unsigned bits = 0;
+    unsigned bit;
+    unsigned clock;
+    for (bit = 0, clock = f1_clock; bit < 20; ++bit, clock += 87) {
+        unsigned sample = clock / 25;
 
-            // check for excessive noise in the quiet period
-            if (m[sample + 2] >= signal_threshold) {
-                noisy_bits |= 1;
-            }
+        bits <<= 1;
+        noisy_bits <<= 1;
+        uncertain_bits <<= 1;
 
-            // decide if this bit is on or off
-            if (m[sample + 0] >= signal_threshold || m[sample + 1] >= signal_threshold) {
-                bits |= 1;
-            } else if (m[sample + 0] > noise_threshold && m[sample + 1] > noise_threshold) {
-                /* not certain about this bit */
-                uncertain_bits |= 1;
-            } else {
-                /* this bit is off */
-            }
+        // check for excessive noise in the quiet period
+        if (m[sample + 2] >= signal_threshold) {
+            noisy_bits |= 1;
         }
 
-        // framing bits must be on
-        if ((bits & 0x80020) != 0x80020) {
-            continue;
+        // decide if this bit is on or off
+        if (m[sample + 0] >= signal_threshold || m[sample + 1] >= signal_threshold) {
+            bits |= 1;
+        } else if (m[sample + 0] > noise_threshold && m[sample + 1] > noise_threshold) {
+            /* not certain about this bit */
+            uncertain_bits |= 1;
+        } else {
+            /* this bit is off */
         }
+    }
 
-        // quiet bits must be off
-        if ((bits & 0x0101B) != 0) {
-            continue;
-        }
+    // framing bits must be on
+    if ((bits & 0x80020) != 0x80020) {
+        return 0;
+    }
 
-        if (noisy_bits || uncertain_bits) {
-            continue;
-        }
+    // quiet bits must be off
+    if ((bits & 0x0101B) != 0) {
+        return 0;
+    }
+
+    if (noisy_bits || uncertain_bits) {
+        return 0;
+    }
 
-        // Convert to the form that we use elsewhere:
-        //  00 A4 A2 A1  00 B4 B2 B1  SPI C4 C2 C1  00 D4 D2 D1
-        unsigned modeac =
-                ((bits & 0x40000) ? 0x0010 : 0) | // C1
-                ((bits & 0x20000) ? 0x1000 : 0) | // A1
-                ((bits & 0x10000) ? 0x0020 : 0) | // C2
-                ((bits & 0x08000) ? 0x2000 : 0) | // A2
-                ((bits & 0x04000) ? 0x0040 : 0) | // C4
-                ((bits & 0x02000) ? 0x4000 : 0) | // A4
-                ((bits & 0x00800) ? 0x0100 : 0) | // B1
-                ((bits & 0x00400) ? 0x0001 : 0) | // D1
-                ((bits & 0x00200) ? 0x0200 : 0) | // B2
-                ((bits & 0x00100) ? 0x0002 : 0) | // D2
-                ((bits & 0x00080) ? 0x0400 : 0) | // B4
-                ((bits & 0x00040) ? 0x0004 : 0) | // D4
-                ((bits & 0x00004) ? 0x0080 : 0); // SPI
+    // Convert to the form that we use elsewhere:
+    //  00 A4 A2 A1  00 B4 B2 B1  SPI C4 C2 C1  00 D4 D2 D1
+    unsigned modeac =
+            ((bits & 0x40000) ? 0x0010 : 0) | // C1
+            ((bits & 0x20000) ? 0x1000 : 0) | // A1
+            ((bits & 0x10000) ? 0x0020 : 0) | // C2
+            ((bits & 0x08000) ? 0x2000 : 0) | // A2
+            ((bits & 0x04000) ? 0x0040 : 0) | // C4
+            ((bits & 0x02000) ? 0x4000 : 0) | // A4
+            ((bits & 0x00800) ? 0x0100 : 0) | // B1
+            ((bits & 0x00400) ? 0x0001 : 0) | // D1
+            ((bits & 0x00200) ? 0x0200 : 0) | // B2
+            ((bits & 0x00100) ? 0x0002 : 0) | // D2
+            ((bits & 0x00080) ? 0x0400 : 0) | // B4
+            ((bits & 0x00040) ? 0x0004 : 0) | // D4
+            ((bits & 0x00004) ? 0x0080 : 0); // SPI
 
 #ifdef MODEAC_DEBUG
-        draw_modeac(m, modeac, f1_clock, noise_threshold, signal_threshold, bits, noisy_bits, uncertain_bits);
+    draw_modeac(m, modeac, f1_clock, noise_threshold, signal_threshold, bits, noisy_bits, uncertain_bits);
 #endif
 
+    frame->f2_clock = f2_clock;
+    frame->modeac = modeac;
+    return 1;
+}
+
+// look for Mode A/C messages with F1 before stop, continuing where the last call left off
+static void modeacScanTo(struct modeacScan *scan, uint16_t *stop) {
+    uint16_t *m = scan->mag->data;
+    uint32_t mlen = scan->mag->length;
+    uint16_t *f1 = scan->next;
+
+    for (; f1 < stop; f1++) {
+        f1 = next_framing_pulse(f1, stop, scan);
+        if (!(f1 < stop))
+            break;
+
+        if (scan->len == scan->alloc) {
+            scan->alloc = scan->alloc ? 2 * scan->alloc : 64;
+            scan->frames = realloc(scan->frames, scan->alloc * sizeof(struct modeacFrame));
+            if (!scan->frames) {
+                fprintf(stderr, "modeacScanTo: out of memory\n");
+                exit(1);
+            }
+        }
+        if (modeac_frame(m, mlen, f1 - m, scan->noise_level, &scan->frames[scan->len])) {
+            scan->len++;
+            f1 += (20 * 87 / 25);
+        }
+    }
+    scan->next = f1;
+}
+
+static void modeacTask(void *arg, threadpool_threadbuffers_t *buffer_group) {
+    MODES_NOTUSED(buffer_group);
+    struct modeacScan *scan = arg;
+    modeacScanTo(scan, scan->mag->data + scan->mag->length);
+}
+
+// pass the messages found by modeacScanTo on
+static void modeacSubmit(struct modeacScan *scan) {
+    struct mag_buf *mag = scan->mag;
+    for (int i = 0; i < scan->len; i++) {
+        struct modeacFrame *frame = &scan->frames[i];
+
         // This message looks good, submit it
         struct modesMessage *mm = netGetMM(&Modes.netMessageBuffer[0]);
 
         // For consistency with how the Beast / Radarcape does it,
         // we report the timestamp at the second framing pulse (F2)
-        mm->timestamp = mag->sampleTimestamp + f2_clock / 5; // 60MHz -> 12MHz
+        mm->timestamp = mag->sampleTimestamp + frame->f2_clock / 5; // 60MHz -> 12MHz
 
         // compute message receive time as block-start-time + difference in the 12MHz clock
         mm->sysTimestamp = mag->sysTimestamp + receiveclock_ms_elapsed(mag->sampleTimestamp, mm->timestamp);
 
-        decodeModeAMessage(mm, modeac);
+        decodeModeAMessage(mm, frame->modeac);
 
         // Pass data to the next layer
         netUseMessage(mm);
 
-        f1_sample += (20 * 87 / 25);
         Modes.stats_current.demod_modeac++;
     }
-
-    netDrainMessageBuffers();
+    scan->len = 0;
 }
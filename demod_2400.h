@@ -35,7 +35,51 @@
 
 struct mag_buf;
 
+// smallest part of a magnitude buffer demodulated by one of the --demod-threads workers
+#define DEMOD_MIN_SEGMENT (16 * 1024)
+
+// start samples checked per call of a preamble mask function, reads m[0] to m[PREAMBLE_MASK_WIDTH + 15]
+#define PREAMBLE_MASK_WIDTH 32
+
+typedef uint32_t (*preamble_mask_fn)(const uint16_t *m);
+
+struct preambleMaskImpl {
+    const char *name;
+    preamble_mask_fn mask;
+};
+
+// implementations usable on this CPU, fastest first, see preamble.c
+int preambleMaskImplementations(struct preambleMaskImpl *out, int max);
+
+// possible Mode A/C framing pulses at the PREAMBLE_MASK_WIDTH start samples, reads m[-1] to m[PREAMBLE_MASK_WIDTH + 2]
+typedef uint32_t (*modeac_mask_fn)(const uint16_t *m, uint16_t level);
+
+struct modeacMaskImpl {
+    const char *name;
+    modeac_mask_fn mask;
+};
+
+// implementations usable on this CPU, fastest first, see preamble.c
+int modeacMaskImplementations(struct modeacMaskImpl *out, int max);
+
+// phase offsets tried for a preamble: try_phase 4 to 8, in 1/5 samples
+#define SLICE_PHASES 5
+// position of the first message bit for try_phase 4 in 1/5 samples after the preamble start
+#define SLICE_FIRST_BIT (19 * 5 + 4)
+
+// slice the bytes [from, to) of a message starting at pa for the phases set in the phases bitmask,
+// out[j] for try_phase j + 4; implementations may fill in the other phases as well
+typedef void (*slice_fn)(const uint16_t *pa, uint32_t phases, int from, int to, uint8_t out[SLICE_PHASES][MODES_LONG_MSG_BYTES]);
+
+struct sliceImpl {
+    const char *name;
+    slice_fn slice;
+};
+
+// implementations usable on this CPU, fastest first, see slicer.c
+int sliceImplementations(struct sliceImpl *out, int max);
+
 void demodulate2400 (struct mag_buf *mag);
-void demodulate2400AC (struct mag_buf *mag);
+void demodulate2400Cleanup ();
 
 #endif
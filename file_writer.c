@@ -0,0 +1,401 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// file_writer.c: background writer for the json, trace and globe output files
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "readsb.h"
+
+struct fileJob {
+    struct fileJob *next;
+    int64_t queued; // mono_micro_seconds()
+    int len; // -1: unlink path
+    char *content;
+    char path[];
+};
+
+struct fileQueue {
+    pthread_mutex_t mutex;
+    pthread_cond_t work; // jobs queued or exit
+    pthread_cond_t done; // a batch finished
+    struct fileJob *head;
+    struct fileJob *tail;
+    int jobs; // queued, not yet taken by the writer
+    int busy; // jobs of the batch being written
+    int64_t bytes; // queued and being written
+    int exit;
+    pthread_t thread;
+
+    // counters since the last fileWriterStats()
+    uint64_t writes;
+    uint64_t writeBytes;
+    uint32_t errors;
+    uint32_t stalls;
+    uint32_t depthMax;
+    uint64_t latencySum;
+    uint64_t latencyMax;
+};
+
+// content hash of the last write of a path, see fileWriterUnchanged()
+struct fileHash {
+    struct fileHash *next;
+    uint64_t path;
+    uint64_t content;
+    int64_t written; // mstime()
+};
+
+struct fileHashShard {
+    pthread_mutex_t mutex;
+    uint32_t skips; // since the last fileWriterStats()
+    struct fileHash *buckets[FILE_HASH_BUCKETS / FILE_HASH_SHARDS];
+};
+
+static struct {
+    int threads;
+    struct fileQueue *queues;
+    struct fileHashShard *shards;
+} writer;
+
+static inline uint64_t pathHash(const char *path) {
+    return fasthash64(path, strlen(path), 0x5bd1e995);
+}
+
+static struct fileHash **hashBucket(uint64_t path, struct fileHashShard **shard) {
+    *shard = &writer.shards[path % FILE_HASH_SHARDS];
+    return &(*shard)->buckets[(path / FILE_HASH_SHARDS) % (FILE_HASH_BUCKETS / FILE_HASH_SHARDS)];
+}
+
+void fileWriterForget(const char *path) {
+    if (!writer.shards)
+        return;
+    uint64_t key = pathHash(path);
+    struct fileHashShard *shard;
+    struct fileHash **bucket = hashBucket(key, &shard);
+    pthread_mutex_lock(&shard->mutex);
+    for (struct fileHash **e = bucket; *e; e = &(*e)->next) {
+        if ((*e)->path == key) {
+            struct fileHash *del = *e;
+            *e = del->next;
+            sfree(del);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&shard->mutex);
+}
+
+// returns 0 on success
+static int writeFileNow(const char *path, const char *content, int len) {
+    char tmppath[PATH_MAX];
+    snprintf(tmppath, PATH_MAX, "%s.readsb_tmp", path);
+
+    int firstOpenFail = 1;
+    int fd;
+open:
+    fd = open(tmppath, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        if (firstOpenFail) {
+            unlink(tmppath);
+            firstOpenFail = 0;
+            goto open;
+        }
+        fprintf(stderr, "writeJsonTo open(): ");
+        perror(tmppath);
+        return -1;
+    }
+
+    if (write(fd, content, len) != len) {
+        fprintf(stderr, "writeJsonTo write(): ");
+        perror(tmppath);
+        close(fd);
+        goto error;
+    }
+
+    if (close(fd) < 0)
+        goto error;
+
+    if (rename(tmppath, path) == -1) {
+        fprintf(stderr, "writeJsonTo rename(): %s -> %s", tmppath, path);
+        perror("");
+        goto error;
+    }
+    return 0;
+
+error:
+    unlink(tmppath);
+    return -1;
+}
+
+static void *fileWriterEntryPoint(void *arg) {
+    struct fileQueue *q = arg;
+    pthread_mutex_lock(&q->mutex);
+    while (1) {
+        while (!q->head && !q->exit)
+            pthread_cond_wait(&q->work, &q->mutex);
+        if (!q->head)
+            break;
+
+        // the whole queue is one batch
+        struct fileJob *batch = q->head;
+        q->head = q->tail = NULL;
+        q->busy = q->jobs;
+        q->jobs = 0;
+        pthread_mutex_unlock(&q->mutex);
+
+        uint64_t writes = 0, bytes = 0, latencySum = 0, latencyMax = 0;
+        int64_t freed = 0;
+        uint32_t errors = 0;
+        while (batch) {
+            struct fileJob *job = batch;
+            batch = job->next;
+            if (job->len < 0) {
+                unlink(job->path);
+                sfree(job);
+                continue;
+            }
+            if (writeFileNow(job->path, job->content, job->len) == 0) {
+                writes++;
+                bytes += job->len;
+            } else {
+                errors++;
+                // don't skip the next write of unchanged content
+                fileWriterForget(job->path);
+            }
+            uint64_t latency = mono_micro_seconds() - job->queued;
+            latencySum += latency;
+            latencyMax = imax(latencyMax, latency);
+            freed += job->len;
+            sfree(job);
+        }
+
+        pthread_mutex_lock(&q->mutex);
+        q->busy = 0;
+        q->bytes -= freed;
+        q->writes += writes;
+        q->writeBytes += bytes;
+        q->errors += errors;
+        q->latencySum += latencySum;
+        q->latencyMax = imax(q->latencyMax, latencyMax);
+        pthread_cond_broadcast(&q->done);
+    }
+    pthread_mutex_unlock(&q->mutex);
+    return NULL;
+}
+
+void fileWriterInit(int threads) {
+    writer.shards = cmalloc(FILE_HASH_SHARDS * sizeof(struct fileHashShard));
+    if (writer.shards) {
+        memset(writer.shards, 0, FILE_HASH_SHARDS * sizeof(struct fileHashShard));
+        for (int i = 0; i < FILE_HASH_SHARDS; i++)
+            pthread_mutex_init(&writer.shards[i].mutex, NULL);
+    }
+
+    if (threads <= 0)
+        return;
+    writer.queues = cmalloc(threads * sizeof(struct fileQueue));
+    memset(writer.queues, 0, threads * sizeof(struct fileQueue));
+    for (int i = 0; i < threads; i++) {
+        struct fileQueue *q = &writer.queues[i];
+        pthread_mutex_init(&q->mutex, NULL);
+        pthread_cond_init(&q->work, NULL);
+        pthread_cond_init(&q->done, NULL);
+        if (pthread_create(&q->thread, NULL, fileWriterEntryPoint, q)) {
+            fprintf(stderr, "fileWriterInit: pthread_create failed: %s, writing files synchronously\n", strerror(errno));
+            pthread_mutex_destroy(&q->mutex);
+            pthread_cond_destroy(&q->work);
+            pthread_cond_destroy(&q->done);
+            break;
+        }
+        writer.threads = i + 1;
+    }
+    if (!writer.threads)
+        sfree(writer.queues);
+}
+
+static void queueJob(const char *path, struct fileJob *job, int len) {
+    struct fileQueue *q = &writer.queues[pathHash(path) % writer.threads];
+    pthread_mutex_lock(&q->mutex);
+    if (q->bytes + len > FILE_WRITER_MAX_BYTES / writer.threads && (q->jobs || q->busy)) {
+        // the disk doesn't keep up, wait instead of queueing without limit
+        q->stalls++;
+        while (q->bytes + len > FILE_WRITER_MAX_BYTES / writer.threads && (q->jobs || q->busy))
+            pthread_cond_wait(&q->done, &q->mutex);
+    }
+    job->queued = mono_micro_seconds();
+    if (q->tail)
+        q->tail->next = job;
+    else
+        q->head = job;
+    q->tail = job;
+    q->jobs++;
+    q->bytes += len;
+    q->depthMax = imax(q->depthMax, q->jobs + q->busy);
+    pthread_cond_signal(&q->work);
+    pthread_mutex_unlock(&q->mutex);
+}
+
+int fileWriterUnchanged(const char *dir, const char *file, const char *content, int len, int64_t maxAge) {
+    if (!writer.shards || Modes.write_unchanged)
+        return 0;
+
+    char path[PATH_MAX];
+    snprintf(path, PATH_MAX, "%s/%s", dir, file);
+    uint64_t key = pathHash(path);
+    uint64_t hash = fasthash64(content, len, 0x2127599bf4325c37ULL);
+    int64_t now = mstime();
+
+    struct fileHashShard *shard;
+    struct fileHash **bucket = hashBucket(key, &shard);
+    pthread_mutex_lock(&shard->mutex);
+    struct fileHash *e = *bucket;
+    while (e && e->path != key)
+        e = e->next;
+    int unchanged = 0;
+    if (!e) {
+        e = cmalloc(sizeof(struct fileHash));
+        if (e) {
+            e->path = key;
+            e->next = *bucket;
+            *bucket = e;
+        }
+    } else if (e->content == hash && now - e->written < maxAge) {
+        unchanged = 1;
+        shard->skips++;
+    }
+    if (e && !unchanged) {
+        e->content = hash;
+        e->written = now;
+    }
+    pthread_mutex_unlock(&shard->mutex);
+    return unchanged;
+}
+
+void fileWriterQueue(const char *path, const char *content, int len) {
+    if (!writer.threads) {
+        if (writeFileNow(path, content, len) != 0)
+            fileWriterForget(path);
+        return;
+    }
+
+    size_t pathLen = strlen(path) + 1;
+    struct fileJob *job = cmalloc(sizeof(struct fileJob) + pathLen + len);
+    if (!job) {
+        if (writeFileNow(path, content, len) != 0)
+            fileWriterForget(path);
+        return;
+    }
+    memcpy(job->path, path, pathLen);
+    job->content = job->path + pathLen;
+    memcpy(job->content, content, len);
+    job->len = len;
+    job->next = NULL;
+    queueJob(path, job, len);
+}
+
+void fileWriterUnlink(const char *path) {
+    fileWriterForget(path);
+    if (!writer.threads) {
+        unlink(path);
+        return;
+    }
+
+    size_t pathLen = strlen(path) + 1;
+    struct fileJob *job = cmalloc(sizeof(struct fileJob) + pathLen);
+    if (!job) {
+        unlink(path);
+        return;
+    }
+    memcpy(job->path, path, pathLen);
+    job->content = NULL;
+    job->len = -1;
+    job->next = NULL;
+    queueJob(path, job, 0);
+}
+
+void fileWriterCleanup() {
+    int threads = writer.threads;
+    for (int i = 0; i < threads; i++) {
+        struct fileQueue *q = &writer.queues[i];
+        pthread_mutex_lock(&q->mutex);
+        q->exit = 1;
+        pthread_cond_signal(&q->work);
+        pthread_mutex_unlock(&q->mutex);
+    }
+    // the writers finish their queues before exiting
+    for (int i = 0; i < threads; i++) {
+        struct fileQueue *q = &writer.queues[i];
+        pthread_join(q->thread, NULL);
+    }
+    // counted in the final statistics
+    fileWriterStats(&Modes.stats_current);
+    for (int i = 0; i < threads; i++) {
+        struct fileQueue *q = &writer.queues[i];
+        pthread_mutex_destroy(&q->mutex);
+        pthread_cond_destroy(&q->work);
+        pthread_cond_destroy(&q->done);
+    }
+    writer.threads = 0;
+    sfree(writer.queues);
+
+    if (writer.shards) {
+        for (int i = 0; i < FILE_HASH_SHARDS; i++) {
+            struct fileHashShard *shard = &writer.shards[i];
+            for (int k = 0; k < FILE_HASH_BUCKETS / FILE_HASH_SHARDS; k++) {
+                struct fileHash *e = shard->buckets[k];
+                while (e) {
+                    struct fileHash *next = e->next;
+                    sfree(e);
+                    e = next;
+                }
+            }
+            pthread_mutex_destroy(&shard->mutex);
+        }
+        sfree(writer.shards);
+    }
+}
+
+void fileWriterStats(struct stats *st) {
+    for (int i = 0; i < writer.threads; i++) {
+        struct fileQueue *q = &writer.queues[i];
+        pthread_mutex_lock(&q->mutex);
+        st->file_writes += q->writes;
+        st->file_write_bytes += q->writeBytes;
+        st->file_write_errors += q->errors;
+        st->file_write_stalls += q->stalls;
+        st->file_write_latency_sum += q->latencySum;
+        st->file_write_latency_max = imax(st->file_write_latency_max, q->latencyMax);
+        st->file_write_queue_max = imax(st->file_write_queue_max, q->depthMax);
+        q->writes = q->writeBytes = q->latencySum = q->latencyMax = 0;
+        q->errors = q->stalls = 0;
+        q->depthMax = q->jobs + q->busy;
+        pthread_mutex_unlock(&q->mutex);
+    }
+    for (int i = 0; writer.shards && i < FILE_HASH_SHARDS; i++) {
+        struct fileHashShard *shard = &writer.shards[i];
+        pthread_mutex_lock(&shard->mutex);
+        st->file_write_skips += shard->skips;
+        shard->skips = 0;
+        pthread_mutex_unlock(&shard->mutex);
+    }
+}
+
+int fileWriterQueueDepth() {
+    int depth = 0;
+    for (int i = 0; i < writer.threads; i++) {
+        struct fileQueue *q = &writer.queues[i];
+        pthread_mutex_lock(&q->mutex);
+        depth += q->jobs + q->busy;
+        pthread_mutex_unlock(&q->mutex);
+    }
+    return depth;
+}
@@ -0,0 +1,48 @@
+#ifndef FILE_WRITER_H
+#define FILE_WRITER_H
+
+// Background writer for the json, trace and globe output files
+//
+// writeJsonTo() compresses the content on the calling thread and hands a copy to fileWriterQueue(),
+// one of --write-threads writer threads does the open / write / close / rename. Each writer takes
+// all jobs queued for it at once and works through them, the json and trace threads never wait for
+// the filesystem unless FILE_WRITER_MAX_BYTES are queued already (counted as stalls).
+// A path always goes to the same writer so writes and unlinks of the same file stay in order.
+// Without writer threads (--write-threads=0, before init, after cleanup) the file is written right away.
+
+#define FILE_WRITER_MAX_BYTES (64 * 1024 * 1024)
+
+// Unchanged files
+//
+// Traces of aircraft without new points and globe tiles without aircraft come out byte for byte the
+// same as the last time. fileWriterUnchanged() keeps a 64 bit hash of the last content of each path
+// and lets the caller skip compressing and writing it again. The globe files differ in their header
+// (time, aircraft and message counts) only, the callers pass the content after it and rewrite the file
+// every FILE_UNCHANGED_GLOBE_AGE to keep the header current. A failed write, compression or
+// fileWriterUnlink() drops the hash so the next write goes through.
+
+#define FILE_HASH_BUCKETS (1 << 16)
+#define FILE_HASH_SHARDS (256)
+#define FILE_UNCHANGED_GLOBE_AGE (60 * SECONDS)
+#define FILE_UNCHANGED_TRACE_AGE (10 * MINUTES)
+
+void fileWriterInit(int threads);
+// write everything queued and stop the writers, later writes are synchronous
+void fileWriterCleanup();
+
+// write len bytes of content to path through a temporary file and rename, content is copied
+void fileWriterQueue(const char *path, const char *content, int len);
+// unlink path after the writes of it queued before
+void fileWriterUnlink(const char *path);
+// returns 1 if dir/file was last written with the same content less than maxAge ms ago and
+// the write can be skipped, otherwise remembers content as written now and returns 0
+int fileWriterUnchanged(const char *dir, const char *file, const char *content, int len, int64_t maxAge);
+// the content remembered for path didn't make it to the file, don't skip the next write
+void fileWriterForget(const char *path);
+
+// add the counters since the last call to st
+void fileWriterStats(struct stats *st);
+// jobs waiting right now
+int fileWriterQueueDepth();
+
+#endif
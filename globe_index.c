@@ -1,10 +1,9 @@
 #include "readsb.h"
-#define STATE_SAVE_MAGIC (0x7ba09e63757314ceULL)
+// changed when struct aircraft was split into hot and cold parts, state from before is not loaded
+#define STATE_SAVE_MAGIC (0x5d3f2b8e9c4a17e2ULL)
 #define STATE_SAVE_MAGIC_END (STATE_SAVE_MAGIC + 1)
 #define LZO_MAGIC (0xf7413cc6eaf227dbULL)
 
-static const char zstd_magic[] = { 0x28, 0xb5, 0x2f, 0xfd };
-
 static void mark_legs(traceBuffer tb, struct aircraft *a, int start, int recent);
 static void traceCleanupNoUnlink(struct aircraft *a);
 static traceBuffer reassembleTrace(struct aircraft *a, int numPoints, int64_t after_timestamp, threadpool_buffer_t *buffer);
@@ -431,7 +430,7 @@ static void createDateDir(char *base_dir, struct tm *utc, char *dateDir) {
 }
 
 static void scheduleMemBothWrite(struct aircraft *a, int64_t schedTime) {
-    a->trace_next_mw = schedTime;
+    a->cold->trace_next_mw = schedTime;
     a->trace_writeCounter = 0xc0ffee;
 }
 
@@ -497,8 +496,8 @@ void traceWrite(struct aircraft *a, threadpool_threadbuffers_t *buffer_group) {
         if (Modes.trace_hist_only & 8) {
             hist_only_mask = WPERM;
             if (Modes.trace_hist_only == 10) {
-                if (a->trace_writeCounter > 0 && now > a->trace_next_mw) {
-                    a->trace_next_mw = now + 5 * MINUTES;
+                if (a->trace_writeCounter > 0 && now > a->cold->trace_next_mw) {
+                    a->cold->trace_next_mw = now + 5 * MINUTES;
                     trace_write |= WRECENT;
                     hist_only_mask |= WRECENT;
                     a->trace_writeCounter = 0;
@@ -509,7 +508,7 @@ void traceWrite(struct aircraft *a, threadpool_threadbuffers_t *buffer_group) {
                     a->trace_writeCounter = 0;
                 }
             }
-            if (now > a->trace_next_mw) {
+            if (now > a->cold->trace_next_mw) {
                 hist_only_mask |= WMEM;
             }
         }
@@ -539,7 +538,8 @@ void traceWrite(struct aircraft *a, threadpool_threadbuffers_t *buffer_group) {
     if ((trace_write & (WPERM | WMEM))) {
         tb = reassembleTrace(a, -1, -1, reassemble_buffer);
     } else {
-        tb = reassembleTrace(a, 2 * recent_points, -1, reassemble_buffer);
+        // mark_legs for the recent trace looks at the last 4 * recent_points
+        tb = reassembleTrace(a, 4 * recent_points, -1, reassemble_buffer);
     }
 
     int startFull = 0;
@@ -569,14 +569,15 @@ void traceWrite(struct aircraft *a, threadpool_threadbuffers_t *buffer_group) {
         if (recent.len > 0) {
             snprintf(filename, 256, "traces/%02x/trace_recent_%s%06x.json", a->addr % 256, (a->addr & MODES_NON_ICAO_ADDRESS) ? "~" : "", a->addr & 0xFFFFFF);
 
-            writeJsonToGzip(Modes.json_dir, filename, recent, 1);
+            if (!fileWriterUnchanged(Modes.json_dir, filename, recent.buffer, recent.len, FILE_UNCHANGED_TRACE_AGE))
+                writeJsonToGzip(Modes.json_dir, filename, recent, 1);
         }
     }
 
     if (trace_write && a->addr == TRACE_FOCUS)
         fprintf(stderr, "mw: %.0f, perm: %.0f, count: %d %x\n",
-                ((int64_t) a->trace_next_mw - (int64_t) now) / 1000.0,
-                ((int64_t) a->trace_next_perm - (int64_t) now) / 1000.0,
+                ((int64_t) a->cold->trace_next_mw - (int64_t) now) / 1000.0,
+                ((int64_t) a->cold->trace_next_perm - (int64_t) now) / 1000.0,
                 a->trace_writeCounter, a->trace_writeCounter);
 
     int memWritten = 0;
@@ -606,15 +607,16 @@ void traceWrite(struct aircraft *a, threadpool_threadbuffers_t *buffer_group) {
             if (full.len > 0) {
                 snprintf(filename, 256, "traces/%02x/trace_full_%s%06x.json", a->addr % 256, (a->addr & MODES_NON_ICAO_ADDRESS) ? "~" : "", a->addr & 0xFFFFFF);
 
-                writeJsonToGzip(Modes.json_dir, filename, full, 5);
+                if (!fileWriterUnchanged(Modes.json_dir, filename, full.buffer, full.len, FILE_UNCHANGED_TRACE_AGE))
+                    writeJsonToGzip(Modes.json_dir, filename, full, 5);
             }
         }
 
         if (a->trace_writeCounter >= 0xc0ffee) {
-            a->trace_next_mw = now + random() % (GLOBE_MEM_IVAL * 9 / 8);
+            a->cold->trace_next_mw = now + random() % (GLOBE_MEM_IVAL * 9 / 8);
             a->trace_writeCounter = random() % memThreshold;
         } else {
-            a->trace_next_mw = now + GLOBE_MEM_IVAL + random() % (GLOBE_MEM_IVAL / 8);
+            a->cold->trace_next_mw = now + GLOBE_MEM_IVAL + random() % (GLOBE_MEM_IVAL / 8);
             a->trace_writeCounter = 0;
         }
     }
@@ -665,7 +667,7 @@ void traceWrite(struct aircraft *a, threadpool_threadbuffers_t *buffer_group) {
         endStamp = endState->timestamp;
 
         // only write permanent trace if we haven't already written up to the last timestamp
-        if (a->trace_perm_last_timestamp == endStamp) {
+        if (a->cold->trace_perm_last_timestamp == endStamp) {
             goto perm_done;
         }
         // don't write permanent trace for non icao traces that are on the ground
@@ -716,12 +718,12 @@ void traceWrite(struct aircraft *a, threadpool_threadbuffers_t *buffer_group) {
 
 perm_done:
         if (fiftyfive.tm_hour == 23) {
-            a->trace_next_perm = now + GLOBE_PERM_IVAL / 8 + random() % (GLOBE_PERM_IVAL / 1);
+            a->cold->trace_next_perm = now + GLOBE_PERM_IVAL / 8 + random() % (GLOBE_PERM_IVAL / 1);
         } else {
-            a->trace_next_perm = now + GLOBE_PERM_IVAL / 1 + random() % (GLOBE_PERM_IVAL / 8);
+            a->cold->trace_next_perm = now + GLOBE_PERM_IVAL / 1 + random() % (GLOBE_PERM_IVAL / 8);
         }
         // note what we have written to disk
-        a->trace_perm_last_timestamp = endStamp;
+        a->cold->trace_perm_last_timestamp = endStamp;
     }
 
     if (Modes.debug_traceCount) {
@@ -763,8 +765,8 @@ perm_done:
             if (print) {
                 fprintf(stderr, " hex: %06x mw: %6.0f, perm: %6.0f, count: %4d / %4d (%4x) \n",
                         a->addr,
-                        ((int64_t) a->trace_next_mw - (int64_t) now) / 1000.0,
-                        ((int64_t) a->trace_next_perm - (int64_t) now) / 1000.0,
+                        ((int64_t) a->cold->trace_next_mw - (int64_t) now) / 1000.0,
+                        ((int64_t) a->cold->trace_next_perm - (int64_t) now) / 1000.0,
                         a->trace_writeCounter,
                         recent_points,
                         a->trace_writeCounter);
@@ -775,8 +777,8 @@ perm_done:
 
     if (0 && a->addr == TRACE_FOCUS)
         fprintf(stderr, "mw: %.0f, perm: %.0f, count: %d\n",
-                ((int64_t) a->trace_next_mw - (int64_t) now) / 1000.0,
-                ((int64_t) a->trace_next_perm - (int64_t) now) / 1000.0,
+                ((int64_t) a->cold->trace_next_mw - (int64_t) now) / 1000.0,
+                ((int64_t) a->cold->trace_next_perm - (int64_t) now) / 1000.0,
                 a->trace_writeCounter);
 }
 
@@ -788,6 +790,7 @@ static void free_aircraft_range(int start, int end) {
             na = a->next;
             if (a) {
                 traceCleanupNoUnlink(a);
+                free(a->cold);
                 free(a);
             }
             a = na;
@@ -823,6 +826,7 @@ static int load_aircraft(char **p, char *end, int64_t now, threadpool_buffer_t *
     static int size_changed;
 
     ssize_t newSize = sizeof(struct aircraft);
+    ssize_t newColdSize = sizeof(struct aircraftCold);
 
     if (end - *p < (int) sizeof(uint64_t)) {
         return -1;
@@ -832,7 +836,13 @@ static int load_aircraft(char **p, char *end, int64_t now, threadpool_buffer_t *
     *p += memcpySize(&tmp_u64, *p, sizeof(tmp_u64));
     ssize_t oldSize = tmp_u64;
 
-    if (end - *p < oldSize) {
+    // struct aircraft, size of struct aircraftCold, struct aircraftCold
+    if (oldSize < 0 || end - *p < oldSize + (ssize_t) sizeof(uint64_t)) {
+        return -1;
+    }
+    memcpy(&tmp_u64, *p + oldSize, sizeof(tmp_u64));
+    ssize_t oldColdSize = tmp_u64;
+    if (oldColdSize < 0 || end - *p < oldSize + (ssize_t) sizeof(uint64_t) + oldColdSize) {
         return -1;
     }
 
@@ -846,7 +856,6 @@ static int load_aircraft(char **p, char *end, int64_t now, threadpool_buffer_t *
         }
         //fprintf(stderr, "%06x aircraft already exists, overwriting old data\n", source->addr);
         //freeAircraft(a);
-        quickRemove(a);
 
         // remove from active list if on it
         if (a->onActiveList) {
@@ -861,22 +870,28 @@ static int load_aircraft(char **p, char *end, int64_t now, threadpool_buffer_t *
     }
 
     struct aircraft *preserveNext = a->next;
+    struct aircraftCold *preserveCold = a->cold;
 
     memcpy(a, *p, imin(oldSize, newSize));
     *p += oldSize;
 
     a->next = preserveNext;
+    a->cold = preserveCold;
 
-    if (!size_changed && oldSize != newSize) {
+    *p += sizeof(uint64_t);
+    memcpy(a->cold, *p, imin(oldColdSize, newColdSize));
+    *p += oldColdSize;
+
+    if (!size_changed && (oldSize != newSize || oldColdSize != newColdSize)) {
         size_changed = 1;
-        fprintf(stderr, "sizeof(struct aircraft) has changed from %ld to %ld bytes, this means the code changed and if the coder didn't think properly might result in bad aircraft data. If your map doesn't have weird stuff ... probably all good and just an upgrade.\n",
-                (long) oldSize, (long) newSize);
+        fprintf(stderr, "sizeof(struct aircraft) has changed from %ld / %ld to %ld / %ld bytes, this means the code changed and if the coder didn't think properly might result in bad aircraft data. If your map doesn't have weird stuff ... probably all good and just an upgrade.\n",
+                (long) oldSize, (long) oldColdSize, (long) newSize, (long) newColdSize);
         Modes.writeInternalState = 1; // immediately write in the new format
     }
 
     // if we are loading this data via the replace_state mechanism, make sure we write the permanent trace again
     if (Modes.replace_state_blob) {
-        a->trace_perm_last_timestamp = 0;
+        a->cold->trace_perm_last_timestamp = 0;
     }
 
     aircraftZeroTail(a);
@@ -893,10 +908,10 @@ static int load_aircraft(char **p, char *end, int64_t now, threadpool_buffer_t *
     if (a->addrtype_updated > now)
         a->addrtype_updated = now;
 
-    if (a->trace_next_perm < now) {
-        a->trace_next_perm = now + 1 * MINUTES + random() % (5 * MINUTES);
-    } else if (a->trace_next_perm - now > GLOBE_PERM_IVAL) {
-        a->trace_next_perm = now + 5 * MINUTES + random() % GLOBE_PERM_IVAL;
+    if (a->cold->trace_next_perm < now) {
+        a->cold->trace_next_perm = now + 1 * MINUTES + random() % (5 * MINUTES);
+    } else if (a->cold->trace_next_perm - now > GLOBE_PERM_IVAL) {
+        a->cold->trace_next_perm = now + 5 * MINUTES + random() % GLOBE_PERM_IVAL;
     }
 
     int new_index = a->globe_index;
@@ -917,10 +932,10 @@ static int load_aircraft(char **p, char *end, int64_t now, threadpool_buffer_t *
     // set trace pointers to zero before loading the trace
     a->trace_current_max = 0;
     a->trace_current = NULL;
-    a->trace_chunks = NULL;
+    a->cold->trace_chunks = NULL;
 
     // recalculate overall trace chunk size
-    a->trace_chunk_overall_bytes = 0;
+    a->cold->trace_chunk_overall_bytes = 0;
 
     int discard_trace = 0;
 
@@ -943,19 +958,19 @@ static int load_aircraft(char **p, char *end, int64_t now, threadpool_buffer_t *
         int checkNo = 0;
 #define checkSize(size) if (++checkNo && ((end - *p < (ssize_t) size) || size < 0)) { fprintf(stderr, "loadAircraft: checkSize failed for hex %06x checkNo %d size %lld\n", a->addr, checkNo, (long long) size); traceCleanupNoUnlink(a); return -1; }
 
-        if (a->trace_chunk_len > 0) {
-            a->trace_chunks = cmalloc(a->trace_chunk_len * sizeof(stateChunk));
+        if (a->cold->trace_chunk_len > 0) {
+            a->cold->trace_chunks = cmalloc(a->cold->trace_chunk_len * sizeof(stateChunk));
         } else {
-            a->trace_chunk_len = 0;
+            a->cold->trace_chunk_len = 0;
         }
-        for (int k = 0; k < a->trace_chunk_len; k++) {
-            stateChunk *chunk = &a->trace_chunks[k];
+        for (int k = 0; k < a->cold->trace_chunk_len; k++) {
+            stateChunk *chunk = &a->cold->trace_chunks[k];
             checkSize(sizeof(stateChunk));
             *p += memcpySize(chunk, *p, sizeof(stateChunk));
 
             checkSize(chunk->compressed_size);
             chunk->compressed = cmalloc(chunk->compressed_size);
-            a->trace_chunk_overall_bytes += chunk->compressed_size;
+            a->cold->trace_chunk_overall_bytes += chunk->compressed_size;
             *p += memcpySize(chunk->compressed, *p, chunk->compressed_size);
 
             ssize_t padBytes = roundUp8(chunk->compressed_size) - chunk->compressed_size;
@@ -981,7 +996,7 @@ static int load_aircraft(char **p, char *end, int64_t now, threadpool_buffer_t *
         traceMaintenance(a, now, passbuffer);
 
         if (a->addr == Modes.leg_focus) {
-            a->trace_next_perm = now;
+            a->cold->trace_next_perm = now;
             scheduleMemBothWrite(a, now);
             fprintf(stderr, "leg_focus: %06x trace len: %d\n", a->addr, a->trace_len);
             a->trace_write |= WRECENT;
@@ -1593,12 +1608,6 @@ void set_globe_index (struct aircraft *a, int new_index) {
                 a->addr, old_index, new_index, GLOBE_MAX_INDEX);
         return;
     }
-    if (old_index >= 0) {
-        ca_remove(&Modes.globeLists[old_index], a);
-    }
-    if (new_index >= 0) {
-        ca_add(&Modes.globeLists[new_index], a);
-    }
 }
 
 static void traceUnlink(struct aircraft *a) {
@@ -1608,29 +1617,29 @@ static void traceUnlink(struct aircraft *a) {
         return;
 
     snprintf(filename, 1024, "%s/traces/%02x/trace_recent_%s%06x.json", Modes.json_dir, a->addr % 256, (a->addr & MODES_NON_ICAO_ADDRESS) ? "~" : "", a->addr & 0xFFFFFF);
-    unlink(filename);
+    fileWriterUnlink(filename);
 
     snprintf(filename, 1024, "%s/traces/%02x/trace_full_%s%06x.json", Modes.json_dir, a->addr % 256, (a->addr & MODES_NON_ICAO_ADDRESS) ? "~" : "", a->addr & 0xFFFFFF);
-    unlink(filename);
+    fileWriterUnlink(filename);
 
     //fprintf(stderr, "unlink %06x: %s\n", a->addr, filename);
 }
 
 static stateChunk *resizeTraceChunks(struct aircraft *a, int newLen) {
-    int oldLen = a->trace_chunk_len;
+    int oldLen = a->cold->trace_chunk_len;
 
     if (oldLen < 0 || newLen < 0) {
         fprintf(stderr, "resizeTraceChunks: oldLen < 0 || newLen < 0 ... this is a fatal error, exiting.\n");
         exit(1);
     }
-    if (oldLen > 0 && !a->trace_chunks) {
-        fprintf(stderr, "resizeTraceChunks: oldLen > 0 && !a->trace_chunks ... this is a fatal error, exiting.\n");
+    if (oldLen > 0 && !a->cold->trace_chunks) {
+        fprintf(stderr, "resizeTraceChunks: oldLen > 0 && !a->cold->trace_chunks ... this is a fatal error, exiting.\n");
         exit(1);
     }
 
-    a->trace_chunk_len = newLen;
+    a->cold->trace_chunk_len = newLen;
     if (newLen == 0) {
-        sfree(a->trace_chunks);
+        sfree(a->cold->trace_chunks);
         return NULL;
     }
     if (oldLen == newLen) {
@@ -1658,7 +1667,7 @@ static stateChunk *resizeTraceChunks(struct aircraft *a, int newLen) {
             exit(1);
         }
 
-        memcpy(new, a->trace_chunks + shrinkByLen, newBytes);
+        memcpy(new, a->cold->trace_chunks + shrinkByLen, newBytes);
     } else {
         int growByBytes = newBytes - oldBytes;
         if (growByBytes < 0) {
@@ -1666,16 +1675,16 @@ static stateChunk *resizeTraceChunks(struct aircraft *a, int newLen) {
             exit(1);
         }
 
-        memcpy(new, a->trace_chunks, oldBytes);
+        memcpy(new, a->cold->trace_chunks, oldBytes);
         memset(new + oldLen, 0x0, growByBytes);
     }
 
-    sfree(a->trace_chunks);
+    sfree(a->cold->trace_chunks);
 
-    a->trace_chunks = new;
+    a->cold->trace_chunks = new;
 
     if (newLen > oldLen) {
-        return &a->trace_chunks[a->trace_chunk_len - 1];
+        return &a->cold->trace_chunks[a->cold->trace_chunk_len - 1];
     } else {
         return NULL;
     }
@@ -1696,15 +1705,15 @@ static void tracePrune(struct aircraft *a, int64_t now) {
 
     int deletedChunks = 0;
 
-    for (int k = 0; k < a->trace_chunk_len; k++) {
-        stateChunk *chunk = &a->trace_chunks[k];
+    for (int k = 0; k < a->cold->trace_chunk_len; k++) {
+        stateChunk *chunk = &a->cold->trace_chunks[k];
         if (chunk->lastTimestamp >= keep_after) {
             break;
         }
 
         deletedChunks++;
         a->trace_len -= chunk->numStates;
-        a->trace_chunk_overall_bytes -= chunk->compressed_size;
+        a->cold->trace_chunk_overall_bytes -= chunk->compressed_size;
 
         sfree(chunk->compressed);
     }
@@ -1713,7 +1722,7 @@ static void tracePrune(struct aircraft *a, int64_t now) {
         if (0 && Modes.verbose) {
             fprintf(stderr, "%06x deleting %d chunks\n", a->addr, deletedChunks);
         }
-        resizeTraceChunks(a, a->trace_chunk_len - deletedChunks);
+        resizeTraceChunks(a, a->cold->trace_chunk_len - deletedChunks);
     }
 
     int deleteFs = 0;
@@ -1761,14 +1770,14 @@ static void destroyTraceCache(struct traceCache *cache) {
 
 
 static void traceCleanupNoUnlink(struct aircraft *a) {
-    if (a->trace_chunks) {
-        for (int k = 0; k < a->trace_chunk_len; k++) {
-            sfree(a->trace_chunks[k].compressed);
+    if (a->cold->trace_chunks) {
+        for (int k = 0; k < a->cold->trace_chunk_len; k++) {
+            sfree(a->cold->trace_chunks[k].compressed);
         }
     }
-    sfree(a->trace_chunks);
-    a->trace_chunk_len = 0;
-    a->trace_chunk_overall_bytes = 0;
+    sfree(a->cold->trace_chunks);
+    a->cold->trace_chunk_len = 0;
+    a->cold->trace_chunk_overall_bytes = 0;
 
     sfree(a->trace_current);
     a->trace_current_max = 0;
@@ -1777,7 +1786,7 @@ static void traceCleanupNoUnlink(struct aircraft *a) {
     a->tracePosBuffered = 0;
     a->trace_len = 0;
 
-    destroyTraceCache(&a->traceCache);
+    destroyTraceCache(&a->cold->traceCache);
 }
 
 void traceCleanup(struct aircraft *a) {
@@ -1795,26 +1804,45 @@ static traceBuffer reassembleTrace(struct aircraft *a, int numPoints, int64_t af
     int currentLen = a->trace_current_len;
     int allocLen = currentLen;
 
+    // leading points of firstChunk that don't need to be decompressed and where decompression starts
+    int skipPoints = 0;
+    int skipOffset = 0;
+
     if (numPoints >= 0) {
-        firstChunk = a->trace_chunk_len;
-        for (int k = a->trace_chunk_len - 1; k >= 0 && allocLen < numPoints; k--) {
-            stateChunk *chunk = &a->trace_chunks[k];
+        firstChunk = a->cold->trace_chunk_len;
+        for (int k = a->cold->trace_chunk_len - 1; k >= 0 && allocLen < numPoints; k--) {
+            stateChunk *chunk = &a->cold->trace_chunks[k];
             allocLen += chunk->numStates;
             firstChunk = k;
         }
+        if (firstChunk < a->cold->trace_chunk_len && allocLen > numPoints) {
+            stateChunk *chunk = &a->cold->trace_chunks[firstChunk];
+            int keep = numPoints - (allocLen - chunk->numStates);
+            if (chunkIsZstd(chunk)) {
+                skipPoints = chunkSeek(chunk, keep, -1, &skipOffset);
+                allocLen -= skipPoints;
+            }
+        }
     } else if (after_timestamp > 0) {
-        firstChunk = a->trace_chunk_len;
-        for (int k = a->trace_chunk_len - 1; k >= 0; k--) {
-            stateChunk *chunk = &a->trace_chunks[k];
+        firstChunk = a->cold->trace_chunk_len;
+        for (int k = a->cold->trace_chunk_len - 1; k >= 0; k--) {
+            stateChunk *chunk = &a->cold->trace_chunks[k];
             if (after_timestamp > chunk->lastTimestamp) {
                 break;
             }
             allocLen += chunk->numStates;
             firstChunk = k;
         }
+        if (firstChunk < a->cold->trace_chunk_len) {
+            stateChunk *chunk = &a->cold->trace_chunks[firstChunk];
+            if (chunkIsZstd(chunk)) {
+                skipPoints = chunkSeek(chunk, -1, after_timestamp, &skipOffset);
+                allocLen -= skipPoints;
+            }
+        }
     } else {
-        for (int k = 0; k < a->trace_chunk_len; k++) {
-            stateChunk *chunk = &a->trace_chunks[k];
+        for (int k = 0; k < a->cold->trace_chunk_len; k++) {
+            stateChunk *chunk = &a->cold->trace_chunks[k];
             allocLen += chunk->numStates;
         }
     }
@@ -1828,38 +1856,39 @@ static traceBuffer reassembleTrace(struct aircraft *a, int numPoints, int64_t af
 
 
     int actual_len = 0;
-    for (int k = firstChunk; k < a->trace_chunk_len; k++) {
-        stateChunk *chunk = &a->trace_chunks[k];
-        actual_len += chunk->numStates;
+    for (int k = firstChunk; k < a->cold->trace_chunk_len; k++) {
+        stateChunk *chunk = &a->cold->trace_chunks[k];
+        int skipped = (k == firstChunk) ? skipPoints : 0;
+        int offset = (k == firstChunk) ? skipOffset : 0;
+        actual_len += chunk->numStates - skipped;
         if (actual_len > allocLen) { fprintf(stderr, "remakeTrace buffer overflow, bailing eex5ioBu\n"); exit(1); }
 
         lzo_uint uncompressed_len = stateBytes(chunk->numStates);
 
-        if (memcmp(zstd_magic, chunk->compressed, sizeof(zstd_magic)) == 0) {
+        if (chunkIsZstd(chunk)) {
             if (!buffer->dctx) {
                 buffer->dctx = ZSTD_createDCtx();
             }
-            size_t res = ZSTD_decompressDCtx(buffer->dctx, tp, uncompressed_len, chunk->compressed, chunk->compressed_size);
-            if (ZSTD_isError(res)) {
-                fprintf(stderr, "reassembleTrace() zstd error: %s\n", ZSTD_getErrorName(res));
+            if (chunkDecompress(buffer->dctx, chunk, offset, skipped, tp) != 0) {
+                fprintf(stderr, "reassembleTrace(%06x): corrupt trace chunk %d\n", a->addr, k);
                 tb.len = 0;
                 traceCleanup(a);
                 return tb;
             }
         } else {
             //fprintf(stderr, "reassembleTrace(%06x %d %ld): chunk %d trace_chunk_len %d compressed_size %d uncompressed_size %d outAlloc %d allocLen %d numStates %d trace_current_len %d\n",
-            //        a->addr, numPoints, (long) after_timestamp, k, a->trace_chunk_len,
+            //        a->addr, numPoints, (long) after_timestamp, k, a->cold->trace_chunk_len,
             //        chunk->compressed_size, (int) uncompressed_len, (int) stateBytes(allocLen), allocLen, (int) chunk->numStates, currentLen);
 
             int res = lzo1x_decompress_safe(chunk->compressed, chunk->compressed_size, (unsigned char*) tp, &uncompressed_len, NULL);
 
             //fprintf(stderr, "reassembleTrace(%06x %d %ld): chunk %d trace_chunk_len %d compressed_size %d uncompressed_size %d outAlloc %d allocLen %d numStates %d trace_current_len %d\n",
-            //        a->addr, numPoints, (long) after_timestamp, k, a->trace_chunk_len,
+            //        a->addr, numPoints, (long) after_timestamp, k, a->cold->trace_chunk_len,
             //        chunk->compressed_size, (int) uncompressed_len, (int) stateBytes(allocLen), allocLen, (int) chunk->numStates, currentLen);
 
             if (res != LZO_E_OK) {
                 fprintf(stderr, "reassembleTrace(%06x %d %ld): decompress failure chunk %d trace_chunk_len %d compressed_size %d uncompressed_size %d\n",
-                        a->addr, numPoints, (long) after_timestamp, k, a->trace_chunk_len,
+                        a->addr, numPoints, (long) after_timestamp, k, a->cold->trace_chunk_len,
                         chunk->compressed_size, (int) uncompressed_len);
                 tb.len = 0;
                 traceCleanup(a);
@@ -1867,7 +1896,7 @@ static traceBuffer reassembleTrace(struct aircraft *a, int numPoints, int64_t af
             }
         }
 
-        tp += getFourStates(chunk->numStates);
+        tp += getFourStates(chunk->numStates - skipped);
     }
 
     actual_len += currentLen;
@@ -1887,28 +1916,27 @@ static float recompressStateChunk(struct stateChunk *chunk, threadpool_buffer_t
         passbuffer->dctx = ZSTD_createDCtx();
     }
     int uncompressed_len = stateBytes(chunk->numStates);
-    int maxSize = ZSTD_compressBound(uncompressed_len);
+    int maxSize = chunkFrameBound(chunk->numStates);
     int totalBuffer = uncompressed_len + maxSize;
     char *uncompressed = check_grow_threadpool_buffer_t(passbuffer, totalBuffer);
     char *compressed = uncompressed + uncompressed_len;
 
-    size_t res = ZSTD_decompressDCtx(passbuffer->dctx, uncompressed, uncompressed_len, chunk->compressed, chunk->compressed_size);
-    if (ZSTD_isError(res)) {
-        fprintf(stderr, "recompress(): Corrupt trace chunk: zstd error: %s\n", ZSTD_getErrorName(res));
+    if (chunkDecompress(passbuffer->dctx, chunk, 0, 0, (fourState *) uncompressed) != 0) {
+        fprintf(stderr, "recompress(): Corrupt trace chunk\n");
         return 0.0f;
     }
 
     if (!passbuffer->cctx) {
         passbuffer->cctx = ZSTD_createCCtx();
     }
-    size_t compressedSize = ZSTD_compressCCtx(
-            passbuffer->cctx,
-            compressed, maxSize,
-            uncompressed, uncompressed_len,
-            2);
+    ssize_t compressedSize;
+    if (Modes.trace_columnar) {
+        compressedSize = chunkCompressColumnar(passbuffer->cctx, compressed, maxSize, (fourState *) uncompressed, chunk->numStates, 2);
+    } else {
+        compressedSize = chunkCompressFrame(passbuffer->cctx, compressed, maxSize, (fourState *) uncompressed, chunk->numStates, 2);
+    }
 
-    if (ZSTD_isError(compressedSize)) {
-        fprintf(stderr, "recompress() zstd error: %s\n", ZSTD_getErrorName(compressedSize));
+    if (compressedSize < 0) {
         return 0.0f;
     }
 
@@ -1963,8 +1991,8 @@ static int compressChunk(fourState *source, int pointCount, threadpool_buffer_t
 
     int extending = 0;
 
-    if (a->trace_chunk_len > 0) {
-        lastChunk = &a->trace_chunks[a->trace_chunk_len - 1];
+    if (a->cold->trace_chunk_len > 0) {
+        lastChunk = &a->cold->trace_chunks[a->cold->trace_chunk_len - 1];
 
         int k = 0;
         while(k < pointCount / SFOUR) {
@@ -1984,7 +2012,7 @@ static int compressChunk(fourState *source, int pointCount, threadpool_buffer_t
             extending = 0;
         }
 
-        if (extending && memcmp(zstd_magic, lastChunk->compressed, sizeof(zstd_magic)) != 0) {
+        if (extending && !chunkIsZstd(lastChunk)) {
             extending = 0;
         }
         if (extending < Modes.traceChunkPoints / 4) {
@@ -1998,7 +2026,7 @@ static int compressChunk(fourState *source, int pointCount, threadpool_buffer_t
         // add to existing chunk
 
         // do some bookkeeping, we add the compressed size of the newly compressed chunk back to it
-        a->trace_chunk_overall_bytes -= lastChunk->compressed_size;
+        a->cold->trace_chunk_overall_bytes -= lastChunk->compressed_size;
 
         // tell rest of the code to write new details into existing stateChunk struct
         target = lastChunk;
@@ -2011,13 +2039,13 @@ static int compressChunk(fourState *source, int pointCount, threadpool_buffer_t
         newBytes = stateBytes(pointCount);
     } else {
         // disable, not worth it
-        if (0 && lastChunk && memcmp(zstd_magic, lastChunk->compressed, sizeof(zstd_magic)) == 0) {
+        if (0 && lastChunk && chunkIsZstd(lastChunk)) {
             // recompress finished buffer
             recompressStateChunk(lastChunk, passbuffer);
         }
 
         // make new chunk
-        target = resizeTraceChunks(a, a->trace_chunk_len + 1);
+        target = resizeTraceChunks(a, a->cold->trace_chunk_len + 1);
 
         if (!target) {
             fprintf(stderr, "%06x compressChunk error, resizeTraceChunks returned NULL, treat this as fatal and exit.\n", a->addr);
@@ -2050,14 +2078,8 @@ static int compressChunk(fourState *source, int pointCount, threadpool_buffer_t
             }
         }
 
-        /*
-         * size_t ZSTD_compressCCtx(ZSTD_CCtx* cctx,
-         void* dst, size_t dstCapacity,
-         const void* src, size_t srcSize,
-         int compressionLevel);
-         */
-
-        int maxSize = ZSTD_compressBound(newBytes);
+        // every call appends an indexed frame, see trace_chunk.h
+        int maxSize = chunkFrameBound(pointCount);
         int totalBuffer = maxSize;
         if (extending) {
             totalBuffer += target->compressed_size;
@@ -2070,16 +2092,18 @@ static int compressChunk(fourState *source, int pointCount, threadpool_buffer_t
             compressed += target->compressed_size;
         }
 
-        compressedSize = ZSTD_compressCCtx(
-                passbuffer->cctx,
-                compressed, maxSize,
-                source, newBytes,
-                2);
+        ssize_t frameSize;
+        if (Modes.trace_columnar) {
+            frameSize = chunkCompressColumnar(passbuffer->cctx, compressed, maxSize, source, pointCount, 2);
+        } else {
+            frameSize = chunkCompressFrame(passbuffer->cctx, compressed, maxSize, source, pointCount, 2);
+        }
 
-        if (ZSTD_isError(compressedSize)) {
-            fprintf(stderr, "compressChunk() zstd error: %s\n", ZSTD_getErrorName(compressedSize));
+        if (frameSize < 0) {
+            fprintf(stderr, "compressChunk() failed\n");
             exit(1);
         }
+        compressedSize = frameSize;
 
     } else {
         int temp_alloc = newBytes + newBytes / 16 + 64 + 3; // from mini lzo example: upper bound of compressed size
@@ -2104,14 +2128,14 @@ static int compressChunk(fourState *source, int pointCount, threadpool_buffer_t
     target->compressed = cmalloc(target->compressed_size);
     memcpy(target->compressed, passbuffer->buf, target->compressed_size);
 
-    a->trace_chunk_overall_bytes += target->compressed_size;
+    a->cold->trace_chunk_overall_bytes += target->compressed_size;
 
 
     if (Modes.verbose) {
         int64_t after = nsThreadTime();
         fprintf(stderr, "%s%06x compressChunk: cpu: %7.3f ms compressed: %8d chunks %3d ratio %5.2f lp %5.1fh chunkTime %5.1fh %5d %5d\n",
                 ((a->addr & MODES_NON_ICAO_ADDRESS) ? "." : ". "),
-                a->addr, (after - before) * 1e-6, target->compressed_size, a->trace_chunk_len, stateBytes(target->numStates) / (double) target->compressed_size,
+                a->addr, (after - before) * 1e-6, target->compressed_size, a->cold->trace_chunk_len, stateBytes(target->numStates) / (double) target->compressed_size,
                 (now - (getState(a->trace_current, a->trace_current_len - 1))->timestamp) / (double) HOURS,
                 (target->lastTimestamp - target->firstTimestamp) / (double) HOURS,
                 target->numStates, extending);
@@ -2227,9 +2251,9 @@ static void compressCurrent(struct aircraft *a, threadpool_buffer_t *passbuffer)
 
 void traceMaintenance(struct aircraft *a, int64_t now, threadpool_buffer_t *passbuffer) {
     // free trace cache for inactive aircraft
-    if (a->traceCache.entries && now - a->seenPosReliable > TRACE_CACHE_LIFETIME) {
+    if (a->cold->traceCache.entries && now - a->seenPosReliable > TRACE_CACHE_LIFETIME) {
         //fprintf(stderr, "%06x free traceCache\n", a->addr);
-        destroyTraceCache(&a->traceCache);
+        destroyTraceCache(&a->cold->traceCache);
     }
 
     //fprintf(stderr, "%06x\n", a->addr);
@@ -2245,20 +2269,20 @@ void traceMaintenance(struct aircraft *a, int64_t now, threadpool_buffer_t *pass
     }
 
     if (Modes.json_globe_index) {
-        if (now > a->trace_next_perm)
+        if (now > a->cold->trace_next_perm)
             a->trace_write |= WPERM;
-        if (now > a->trace_next_mw)
+        if (now > a->cold->trace_next_mw)
             a->trace_write |= WMEM;
     }
 
     // on day change write out the traces for yesterday
     // for which day and which time span is written is determined by traceday
-    if (a->traceWrittenForYesterday != Modes.triggerPermWriteDay) {
-        a->traceWrittenForYesterday = Modes.triggerPermWriteDay;
+    if (a->cold->traceWrittenForYesterday != Modes.triggerPermWriteDay) {
+        a->cold->traceWrittenForYesterday = Modes.triggerPermWriteDay;
         if (a->addr == TRACE_FOCUS)
             fprintf(stderr, "schedule_perm\n");
 
-        a->trace_next_perm = now + random() % (5 * MINUTES);
+        a->cold->trace_next_perm = now + random() % (5 * MINUTES);
     }
 
     if (a->trace_current_len > 0) {
@@ -2602,7 +2626,7 @@ no_save_state:
     if (!a->trace_current) {
         resizeTraceCurrent(a, now);
         scheduleMemBothWrite(a, now); // rewrite full history file
-        a->trace_next_perm = now + GLOBE_PERM_IVAL / 2; // schedule perm write
+        a->cold->trace_next_perm = now + GLOBE_PERM_IVAL / 2; // schedule perm write
 
         //fprintf(stderr, "%06x: new trace\n", a->addr);
     }
@@ -2737,6 +2761,7 @@ void save_blob(int blob, threadpool_buffer_t *pbuffer1, threadpool_buffer_t *pbu
 
     struct aircraft copyback;
     struct aircraft *copy = &copyback;
+    struct aircraftCold coldback;
     for (int j = start; j < end; j++) {
         for (struct aircraft *a = Modes.aircraft[j]; a || (j == end - 1); a = a->next) {
             int size_state = 0;
@@ -2745,22 +2770,25 @@ void save_blob(int blob, threadpool_buffer_t *pbuffer1, threadpool_buffer_t *pbu
             } else {
                 // work on local copy of aircraft for traceUsePosBuffered
                 memcpy(copy, a, sizeof(struct aircraft));
+                memcpy(&coldback, a->cold, sizeof(struct aircraftCold));
+                copy->cold = &coldback;
 
                 traceUsePosBuffered(copy);
 
                 size_state += sizeof(struct aircraft);
-                if (copy->trace_chunk_len > 0 && copy->trace_chunks == NULL) {
-                    fprintf(stderr, "<3> %06x trace corrupted, copy->trace_chunks is NULL but copy->trace_chunk_len > 0\n", copy->addr);
+                size_state += sizeof(struct aircraftCold);
+                if (copy->cold->trace_chunk_len > 0 && copy->cold->trace_chunks == NULL) {
+                    fprintf(stderr, "<3> %06x trace corrupted, copy->cold->trace_chunks is NULL but copy->cold->trace_chunk_len > 0\n", copy->addr);
                 }
-                for (int k = 0; k < copy->trace_chunk_len; k++) {
-                    stateChunk *chunk = &copy->trace_chunks[k];
+                for (int k = 0; k < copy->cold->trace_chunk_len; k++) {
+                    stateChunk *chunk = &copy->cold->trace_chunks[k];
                     size_state += sizeof(stateChunk);
                     size_state += roundUp8(chunk->compressed_size);
                 }
                 size_state += stateBytes(copy->trace_current_len);
 
-                // add space for 2 magic constants / 2 struct sizes
-                size_state += 4 * sizeof(uint64_t);
+                // add space for 2 magic constants / 3 struct sizes
+                size_state += 5 * sizeof(uint64_t);
             }
 
             if (!copy || (p + size_state > buf + alloc)) {
@@ -2869,13 +2897,17 @@ void save_blob(int blob, threadpool_buffer_t *pbuffer1, threadpool_buffer_t *pbu
 
             aircraftZeroTail(copy);
             p += memcpySize(p, copy, sizeof(struct aircraft));
+
+            uint64_t size_cold = sizeof(struct aircraftCold);
+            p += memcpySize(p, &size_cold, sizeof(size_cold));
+            p += memcpySize(p, copy->cold, sizeof(struct aircraftCold));
             if (copy->trace_len > 0) {
 
                 uint64_t fourState_size = sizeof(fourState);
                 p += memcpySize(p, &fourState_size, sizeof(fourState_size));
 
-                for (int k = 0; k < copy->trace_chunk_len; k++) {
-                    stateChunk *chunk = &copy->trace_chunks[k];
+                for (int k = 0; k < copy->cold->trace_chunk_len; k++) {
+                    stateChunk *chunk = &copy->cold->trace_chunks[k];
                     p += memcpySize(p, chunk, sizeof(stateChunk));
 
                     p += memcpySize(p, chunk->compressed, chunk->compressed_size);
@@ -3639,7 +3671,7 @@ void unlinkPerm(struct aircraft *a) {
 
     int64_t now = mstime();
 
-    a->trace_perm_last_timestamp = 0;
+    a->cold->trace_perm_last_timestamp = 0;
 
     // fiftyfive_ago changes day 55 min after midnight: stop writing the previous days traces
     // fiftysix_ago changes day 56 min after midnight: allow webserver to read the previous days traces (see checkNewDay function)
@@ -3662,7 +3694,7 @@ void unlinkPerm(struct aircraft *a) {
     snprintf(filename, PATH_MAX, "%s/%s/traces/%02x/trace_full_%s%06x.json", Modes.globe_history_dir, tstring, a->addr % 256, (a->addr & MODES_NON_ICAO_ADDRESS) ? "~" : "", a->addr & 0xFFFFFF);
     filename[PATH_MAX - 101] = 0;
 
-    unlink(filename);
+    fileWriterUnlink(filename);
 
 }
 
@@ -3734,7 +3766,7 @@ void traceDelete() {
         setTrace(a, trace, trace_len, &passbuffer);
 
         int64_t now = mstime();
-        a->trace_next_perm = now;
+        a->cold->trace_next_perm = now;
         scheduleMemBothWrite(a, now);
         traceMaintenance(a, now, &passbuffer);
 
@@ -73,6 +73,7 @@ static struct argp_option optionsReadsb[] = {
     {"interactive", OptInteractive, 0, 0, "Interactive mode refreshing data on screen. Implies --throttle", 1},
     {"raw", OptRaw, 0, 0, "Show only messages hex values", 1},
     {"preamble-threshold", OptPreambleThreshold, "<"stringize(PREAMBLE_THRESHOLD_MIN)"-"stringize(PREAMBLE_THRESHOLD_MAX)">", 0, "lower threshold --> more CPU usage (default: "stringize(PREAMBLE_THRESHOLD_DEFAULT)", pi zero / pi 1: "stringize(PREAMBLE_THRESHOLD_PIZERO)", hot CPU "stringize(PREAMBLE_THRESHOLD_HOT)")", 1},
+    {"demod-noise-floor", OptDemodNoiseFloor, 0, 0, "Also check possible preambles against the noise floor of the surrounding samples, skipping some of the weakest ones (default: off)", 1},
     {"forward-mlat", OptForwardMlat, 0, 0, "Forward received beast mlat results to beast output ports", 1},
     {"forward-mlat-sbs", OptForwardMlatSbs, 0, 0, "Forward received mlat results to sbs output ports", 1},
     {"mlat", OptMlat, 0, 0, "Display raw messages in Beast ASCII mode", 1},
@@ -107,6 +108,9 @@ static struct argp_option optionsReadsb[] = {
     {"write-receiver-id-json", OptNetReceiverIdJson, 0, 0, "Write receivers.json", 1},
     {"json-trace-interval", OptJsonTraceInt, "<seconds>", 0, "Interval after which a new position will guaranteed to be written to the trace and the json position output (default: 30)", 1},
     {"json-trace-hist-only", OptJsonTraceHistOnly, "1,2,3,8", 0, "Don't write recent(1), full(2), either(3) traces to /run, only archive via write-globe-history (8: irregularly write limited traces to run, subject to change)", 1},
+    {"trace-columnar", OptTraceColumnar, 0, 0, "Compress trace chunks in the columnar format: smaller, but --write-state files can't be read by older versions", 1},
+    {"write-threads", OptWriteThreads, "<n>", 0, "Threads writing the json, trace and globe files in the background (default: 2, 0: write them on the generating thread)", 1},
+    {"write-unchanged", OptWriteUnchanged, 0, 0, "Rewrite trace and globe files every time, by default they are skipped while their content doesn't change", 1},
     {"write-json-gzip", OptJsonGzip, 0, 0, "Write aircraft.json also as aircraft.json.gz", 1},
     {"write-json-binCraft-only", OptJsonOnlyBin, "<n>", 0, "Use only binary binCraft format for globe files (1), for aircraft.json as well (2)", 1},
     {"write-binCraft-old", OptEnableBinGz, 0, 0, "write old gzipped binCraft files\n", 1},
@@ -147,7 +151,7 @@ static struct argp_option optionsReadsb[] = {
     {"net-receiver-id", OptNetReceiverId, 0, 0, "forward receiver ID", 2},
     {"net-ingest", OptNetIngest, 0, 0, "primary ingest node", 2},
     {"net-garbage", OptGarbage, "<ports>", 0, "timeout receivers, output messages from timed out receivers as beast on <ports>", 2},
-    {"decode-threads", OptDecodeThreads, "<n>", 0, "Number of decode threads, either 1 or 2 (default: 1). Only use 2 when you have beast traffic > 200 MBit/s, expect 1.4x speedup for 2x CPU", 2},
+    {"decode-threads", OptDecodeThreads, "<n>", 0, "Number of decode threads (default: 1). Aircraft tracking is partitioned by ICAO address across the threads. Only use more than 1 when you have beast traffic > 200 MBit/s", 2},
     {"uuid-file", OptUuidFile, "<path>", 0, "path to UUID file", 2},
     {"net-ro-size", OptNetRoSize, "<size>", 0, "TCP output flush size (maximum amount of internally buffered data before writing to network) (default: 1200)", 2},
     {"net-ro-interval", OptNetRoInterval, "<seconds>", 0, "TCP output flush interval in seconds (maximum delay between placing data in the output buffer and sending)(default: 0.05, valid values 0.0 - 1.0)", 2},
@@ -155,7 +159,9 @@ static struct argp_option optionsReadsb[] = {
     {"net-connector-delay", OptNetConnectorDelay, "<seconds>", 0, "Outbound re-connection delay (default: 30)", 2},
     {"net-heartbeat", OptNetHeartbeat, "<rate>", 0, "TCP heartbeat rate in seconds (default: 60 sec; 0 to disable)", 2},
     {"net-buffer", OptNetBuffer, "<n>", 0, "TCP buffer size 64Kb * (2^n) (default: n=2, 256Kb)", 2},
+    {"net-io-uring", OptNetIoUring, 0, 0, "Send network output to all clients with one io_uring submission (falls back to writev if unsupported)", 2},
     {"net-verbatim", OptNetVerbatim, 0, 0, "Forward messages unchanged", 2},
+    {"demod-threads", OptDemodThreads, "<n>", 0, "Number of threads demodulating each SDR buffer (default: 1, one per CPU with --ifile-fast, max: 16). Use more than 1 when the demodulator can't keep up and samples are dropped", 2},
     {"sdr-buffer-size", OptSdrBufSize, "<KiB>", 0, "SDR buffer / USB transfer size in kibibytes (default: 256 which is equivalent to around 54 ms using rtl-sdr, option might be ignored in future versions)", 2},
 #ifdef ENABLE_RTLSDR
     {0,0,0,0, "RTL-SDR options:", 3},
@@ -197,6 +203,10 @@ static struct argp_option optionsReadsb[] = {
     {"ifile", OptIfileName, "<path>", 0, "Read samples from given file ('-' for stdin)", 7},
     {"iformat", OptIfileFormat, "<type>", 0, "Set sample format (UC8, SC16, SC16Q11)", 7},
     {"throttle", OptIfileThrottle, 0, 0, "Process samples at the original capture speed (must be specified after --device-type ifile)", 7},
+    {"ifile-fast", OptIfileFast, 0, 0, "Reprocess a capture as fast as possible: memory map the file, demodulate with one thread per CPU unless --demod-threads is given and report the sample rate achieved at the end. Larger --sdr-buffer-size values allow more demodulation threads", 7},
+
+    {0,0,0,0, "shm-specific options, use with --shm:", 10},
+    {"shm", OptShmName, "<name>", 0, "Read samples from the POSIX shared memory IQ ring with this name (see sdr_shm.h for the layout). Several decoders can attach to the same ring", 10},
 #ifdef ENABLE_PLUTOSDR
     {0,0,0,0, "ADALM-Pluto SDR options:", 8},
     {0,0,0, OPTION_DOC, "use with --device-type plutosdr", 8},
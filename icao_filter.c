@@ -35,6 +35,7 @@ static uint32_t *icao_filter_b;
 static uint32_t *icao_filter_active;
 
 static uint32_t occupied;
+static uint32_t generation;
 
 static inline uint32_t filterHash(uint32_t addr) {
     return addrHash(addr, filterBits);
@@ -68,6 +69,7 @@ static void icaoFilterResize(uint32_t bits) {
     uint32_t *oldA = icao_filter_a;
     uint32_t *oldB = icao_filter_b;
 
+    generation++;
     filterBits = bits;
     filterBuckets = 1ULL << filterBits;
     filterSize = filterBuckets * sizeof(uint32_t);
@@ -97,6 +99,7 @@ void icaoFilterExpire() {
     if (occupied < filterBuckets / 9 && filterBits > MINBITS) {
         icaoFilterResize(filterBits - 1);
     }
+    generation++;
     // reset occupied count
     occupied = 0;
     if (icao_filter_active == icao_filter_a) {
@@ -109,6 +112,18 @@ void icaoFilterExpire() {
     }
 }
 
+static int filterContains(uint32_t *table, uint32_t addr) {
+    uint32_t h, h0;
+
+    h0 = h = filterHash(addr);
+    while (table[h] != EMPTY && table[h] != addr) {
+        h = (h + 1) & (filterBuckets - 1);
+        if (h == h0)
+            break;
+    }
+    return table[h] == addr;
+}
+
 void icaoFilterAdd(uint32_t addr) {
     uint32_t h, h0;
     h0 = h = filterHash(addr);
@@ -122,6 +137,10 @@ void icaoFilterAdd(uint32_t addr) {
     if (icao_filter_active[h] == EMPTY) {
         occupied++;
         icao_filter_active[h] = addr;
+        // most of the time the address is just moving over from the other table
+        if (!filterContains(icao_filter_active == icao_filter_a ? icao_filter_b : icao_filter_a, addr)) {
+            generation++;
+        }
     }
 
     if (occupied > filterBuckets / 3 && filterBits < 20) {
@@ -130,25 +149,9 @@ void icaoFilterAdd(uint32_t addr) {
 }
 
 int icaoFilterTest(uint32_t addr) {
-    uint32_t h, h0;
-
-    h0 = h = filterHash(addr);
-    while (icao_filter_a[h] != EMPTY && icao_filter_a[h] != addr) {
-        h = (h + 1) & (filterBuckets - 1);
-        if (h == h0)
-            break;
-    }
-    if (icao_filter_a[h] == addr)
-        return 1;
-
-    h = h0;
-    while (icao_filter_b[h] != EMPTY && icao_filter_b[h] != addr) {
-        h = (h + 1) & (filterBuckets - 1);
-        if (h == h0)
-            break;
-    }
-    if (icao_filter_b[h] == addr)
-        return 1;
+    return filterContains(icao_filter_a, addr) || filterContains(icao_filter_b, addr);
+}
 
-    return 0;
+uint32_t icaoFilterGeneration() {
+    return generation;
 }
@@ -43,4 +43,8 @@ uint32_t icaoFilterTestFuzzy (uint32_t partial);
 // old entries.
 void icaoFilterExpire ();
 
+// Changes whenever icaoFilterTest might answer differently for some address
+// (new address, expiry, resize).
+uint32_t icaoFilterGeneration ();
+
 #endif
@@ -628,12 +628,24 @@ char *sprintACASInfoShort(char *p, char *end, uint32_t addr, unsigned char *byte
     return p;
 }
 
-char *sprintAircraftObject(char *p, char *end, struct aircraft *a, int64_t now, int printMode, struct modesMessage *mm) {
+static inline double jsonAge(int64_t now, int64_t timestamp) {
+    return (now < timestamp) ? 0 : ((now - timestamp) / 1000.0);
+}
+
+// with ages != NULL the positions of the seen_pos / seen values are noted for reprintAircraftObject
+static char *sprintAircraftObjectImpl(char *p, char *end, struct aircraft *a, int64_t now, int printMode, struct modesMessage *mm, struct jsonAges *ages) {
 
     // printMode == 0: aircraft.json / globe.json / apiBuffer
     // printMode == 1: trace.json
     // printMode == 2: jsonPositionOutput
 
+    // conditions depending on now need to be reflected in aircraftReuseUntil
+
+    char *start = p;
+    if (ages) {
+        ages->seenPos = -1;
+        ages->seen = -1;
+    }
     p = safe_snprintf(p, end, "{");
     if (printMode == 2)
         p = safe_snprintf(p, end, "\"now\" : %.3f,", now / 1000.0);
@@ -647,12 +659,12 @@ char *sprintAircraftObject(char *p, char *end, struct aircraft *a, int64_t now,
     if (printMode != 1) {
 
         if (Modes.db) {
-            if (a->registration[0])
-                p = safe_snprintf(p, end, ",\"r\":\"%.*s\"", (int) sizeof(a->registration), a->registration);
-            if (a->typeCode[0])
-                p = safe_snprintf(p, end, ",\"t\":\"%.*s\"", (int) sizeof(a->typeCode), a->typeCode);
-            if (a->dbFlags) {
-                uint32_t dbFlags = a->dbFlags;
+            if (a->cold->registration[0])
+                p = safe_snprintf(p, end, ",\"r\":\"%.*s\"", (int) sizeof(a->cold->registration), a->cold->registration);
+            if (a->cold->typeCode[0])
+                p = safe_snprintf(p, end, ",\"t\":\"%.*s\"", (int) sizeof(a->cold->typeCode), a->cold->typeCode);
+            if (a->cold->dbFlags) {
+                uint32_t dbFlags = a->cold->dbFlags;
                 dbFlags &= ~(1 << 7);
                 p = safe_snprintf(p, end, ",\"dbFlags\":%u", dbFlags);
             }
@@ -740,9 +752,15 @@ char *sprintAircraftObject(char *p, char *end, struct aircraft *a, int64_t now,
     }
     if (printMode != 1) {
         if (trackDataValid(&a->pos_reliable_valid)) {
-            p = safe_snprintf(p, end, ",\"lat\":%f,\"lon\":%f,\"nic\":%u,\"rc\":%u,\"seen_pos\":%.3f",
-                    a->latReliable, a->lonReliable, a->pos_nic_reliable, a->pos_rc_reliable,
-                (now < a->pos_reliable_valid.updated) ? 0 : ((now - a->pos_reliable_valid.updated) / 1000.0));
+            p = safe_snprintf(p, end, ",\"lat\":%f,\"lon\":%f,\"nic\":%u,\"rc\":%u,\"seen_pos\":",
+                    a->latReliable, a->lonReliable, a->pos_nic_reliable, a->pos_rc_reliable);
+            char *age = p;
+            p = safe_snprintf(p, end, "%.3f", jsonAge(now, a->pos_reliable_valid.updated));
+            if (ages) {
+                ages->seenPos = age - start;
+                ages->seenPosLen = p - age;
+                ages->seenPosTs = a->pos_reliable_valid.updated;
+            }
 #if defined(TRACKS_UUID)
             {
                 char uuid[32]; // needs 18 chars and null byte
@@ -757,7 +775,7 @@ char *sprintAircraftObject(char *p, char *end, struct aircraft *a, int64_t now,
                 int64_t printNewer = now - 3 * SECONDS;
                 int first = 1;
                 for (int i = 0; i < RECENT_RECEIVER_IDS; i++) {
-                    idTime *entry = &a->recentReceiverIds[i];
+                    idTime *entry = &a->cold->recentReceiverIds[i];
                     if (entry->id != 0 && entry->time > printNewer) {
                         if (first) {
                             first = 0;
@@ -775,13 +793,20 @@ char *sprintAircraftObject(char *p, char *end, struct aircraft *a, int64_t now,
                 p = safe_snprintf(p, end, ",\"r_dst\":%.3f,\"r_dir\":%.1f", a->receiver_distance / 1852.0, a->receiver_direction);
             }
         } else {
-            if (now < a->rr_seen + 2 * MINUTES) {
-                p = safe_snprintf(p, end, ",\"rr_lat\":%.1f,\"rr_lon\":%.1f", a->rr_lat, a->rr_lon);
+            if (now < a->cold->rr_seen + 2 * MINUTES) {
+                p = safe_snprintf(p, end, ",\"rr_lat\":%.1f,\"rr_lon\":%.1f", a->cold->rr_lat, a->cold->rr_lon);
             }
             if (now < a->seenPosReliable + 14 * 24 * HOURS) {
-                p = safe_snprintf(p, end, ",\"lastPosition\":{\"lat\":%f,\"lon\":%f,\"nic\":%u,\"rc\":%u,\"seen_pos\":%.3f}",
-                        a->latReliable, a->lonReliable, a->pos_nic_reliable, a->pos_rc_reliable,
-                        (now < a->seenPosReliable) ? 0 : ((now - a->seenPosReliable) / 1000.0));
+                p = safe_snprintf(p, end, ",\"lastPosition\":{\"lat\":%f,\"lon\":%f,\"nic\":%u,\"rc\":%u,\"seen_pos\":",
+                        a->latReliable, a->lonReliable, a->pos_nic_reliable, a->pos_rc_reliable);
+                char *age = p;
+                p = safe_snprintf(p, end, "%.3f", jsonAge(now, a->seenPosReliable));
+                if (ages) {
+                    ages->seenPos = age - start;
+                    ages->seenPosLen = p - age;
+                    ages->seenPosTs = a->seenPosReliable;
+                }
+                p = safe_snprintf(p, end, "}");
             }
         }
         if (nogps(now, a)) {
@@ -830,9 +855,15 @@ char *sprintAircraftObject(char *p, char *end, struct aircraft *a, int64_t now,
         p = safe_snprintf(p, end, ",\"tisb\":");
         p = append_flags(p, end, a, SOURCE_TISB);
 
-        p = safe_snprintf(p, end, ",\"messages\":%u,\"seen\":%.1f,\"rssi\":%.1f",
-                a->messages, (now < a->seen) ? 0 : ((now - a->seen) / 1000.0),
-                getSignal(a));
+        p = safe_snprintf(p, end, ",\"messages\":%u,\"seen\":", a->messages);
+        char *age = p;
+        p = safe_snprintf(p, end, "%.1f", jsonAge(now, a->seen));
+        if (ages) {
+            ages->seen = age - start;
+            ages->seenLen = p - age;
+            ages->seenTs = a->seen;
+        }
+        p = safe_snprintf(p, end, ",\"rssi\":%.1f", getSignal(a));
 
     }
 
@@ -848,6 +879,68 @@ char *sprintAircraftObject(char *p, char *end, struct aircraft *a, int64_t now,
     return p;
 }
 
+char *sprintAircraftObject(char *p, char *end, struct aircraft *a, int64_t now, int printMode, struct modesMessage *mm) {
+    return sprintAircraftObjectImpl(p, end, a, now, printMode, mm, NULL);
+}
+
+char *sprintAircraftObjectAges(char *p, char *end, struct aircraft *a, int64_t now, struct jsonAges *ages) {
+    return sprintAircraftObjectImpl(p, end, a, now, 0, NULL, ages);
+}
+
+char *reprintAircraftObject(char *p, char *end, const char *obj, int len, const struct jsonAges *old, struct jsonAges *ages, int64_t now) {
+    *ages = *old;
+    char *start = p;
+    const char *src = obj;
+    if (old->seenPos >= 0) {
+        memcpy(p, src, old->seenPos - (src - obj));
+        p += old->seenPos - (src - obj);
+        char *age = p;
+        p = safe_snprintf(p, end, "%.3f", jsonAge(now, old->seenPosTs));
+        ages->seenPos = age - start;
+        ages->seenPosLen = p - age;
+        src = obj + old->seenPos + old->seenPosLen;
+    }
+    if (old->seen >= 0) {
+        memcpy(p, src, old->seen - (src - obj));
+        p += old->seen - (src - obj);
+        char *age = p;
+        p = safe_snprintf(p, end, "%.1f", jsonAge(now, old->seenTs));
+        ages->seen = age - start;
+        ages->seenLen = p - age;
+        src = obj + old->seen + old->seenLen;
+    }
+    memcpy(p, src, len - (src - obj));
+    p += len - (src - obj);
+    return p;
+}
+
+// first time the output of toBinCraft / sprintAircraftObject can change without the aircraft being updated
+// apart from the ages of the last message and position
+// all conditions are of the form now < timestamp + x and don't flip back once now reaches that time
+int64_t aircraftReuseUntil(struct aircraft *a, int64_t now) {
+#if defined(PRINT_UUIDS)
+    // recentReceiverIds depend on now
+    return now;
+#endif
+    int64_t until = INT64_MAX;
+    int64_t thresholds[] = {
+        a->wind_updated + TRACK_EXPIRE,
+        a->oat_updated + TRACK_EXPIRE,
+        a->cold->rr_seen + 2 * MINUTES,
+        a->seenPosReliable + 14 * 24 * HOURS,
+        a->seenAdsbReliable + 15 * SECONDS, // nogps
+        a->seenAdsbReliable + NOGPS_DWELL, // nogps
+        a->acas_ra_valid.updated + 15 * SECONDS,
+        a->category_updated + Modes.trackExpireJaero, // toBinCraft
+    };
+    for (unsigned i = 0; i < sizeof(thresholds) / sizeof(thresholds[0]); i++) {
+        if (thresholds[i] >= now && thresholds[i] < until) {
+            until = thresholds[i];
+        }
+    }
+    return until;
+}
+
 char *sprintAircraftRecent(char *p, char *end, struct aircraft *a, int64_t now, int printMode, struct modesMessage *mm, int64_t recent) {
     if (printMode == 1) {
     }
@@ -1018,14 +1111,23 @@ int includeAircraftJson(int64_t now, struct aircraft *a) {
     return 0;
 }
 
+// binCraft row i of the snapshot with the position as toBinCraft wrote it
+static inline char *writeBinRow(char *p, struct apiBuffer *buffer, int i) {
+    struct binCraft *bin = (struct binCraft *) p;
+    memcpy(bin, &buffer->list[i].bin, sizeof(struct binCraft));
+    bin->lat = buffer->cols.lat[i];
+    bin->lon = buffer->cols.lon[i];
+    return p + sizeof(struct binCraft);
+}
+
 struct char_buffer generateAircraftBin(threadpool_buffer_t *pbuffer) {
     struct char_buffer cb;
-    int64_t now = mstime();
-    struct aircraft *a;
 
-    struct craftArray *ca = &Modes.aircraftActive;
-    ca_lock_read(ca);
-    size_t alloc = 4096 + (ca->len + 64) * sizeof(struct binCraft);
+    // written from the snapshot of the last apiUpdate
+    struct apiBuffer *buffer = apiSnapshotAcquire();
+    int64_t now = buffer->timestamp;
+
+    size_t alloc = 4096 + (buffer->len + 64) * sizeof(struct binCraft);
 
     char *buf = check_grow_threadpool_buffer_t(pbuffer, alloc);
     char *p = buf;
@@ -1080,25 +1182,17 @@ struct char_buffer generateAircraftBin(threadpool_buffer_t *pbuffer) {
 
     p = buf + elementSize;
 
-    for (int i = 0; i < ca->len; i++) {
-        a = ca->list[i];
-        if (a == NULL) continue;
-
-        if (!includeAircraftJson(now, a)) {
-            continue;
-        }
+    for (int i = 0; i < buffer->len; i++) {
         // check if we have enough space
         if ((p + 2 * sizeof(struct binCraft)) >= end) {
             fprintf(stderr, "increase buffer size: iXok9ieD\n");
             break;
         }
 
-        toBinCraft(a, (struct binCraft *) p, now);
-        p += sizeof(struct binCraft);
-
+        p = writeBinRow(p, buffer, i);
     }
 
-    ca_unlock_read(ca);
+    apiSnapshotRelease(buffer);
 
     cb.len = p - buf;
     cb.buffer = buf;
@@ -1109,26 +1203,36 @@ struct char_buffer generateAircraftBin(threadpool_buffer_t *pbuffer) {
 
 struct char_buffer generateGlobeBin(int globe_index, int mil, threadpool_buffer_t *pbuffer) {
     struct char_buffer cb = { 0 };
-    int64_t now = mstime();
-    struct aircraft *a;
     ssize_t alloc = 4096 + 4 * sizeof(struct binCraft);
 
-    struct craftArray *ca = NULL;
-
-    if (globe_index == -1) {
-        ca = &Modes.aircraftActive;
-    } else if (globe_index <= GLOBE_MAX_INDEX) {
-        ca = &Modes.globeLists[globe_index];
-    }
-
-    if (!ca) {
+    if (globe_index < -1 || globe_index > GLOBE_MAX_INDEX) {
         fprintf(stderr, "generateGlobeBin: bad globe_index: %d\n", globe_index);
         return cb;
     }
 
-    ca_lock_read(ca);
+    // written from the snapshot of the last apiUpdate
+    struct apiBuffer *buffer = apiSnapshotAcquire();
+    struct apiColumns *cols = &buffer->cols;
+    int64_t now = buffer->timestamp;
 
-    alloc += ca->len * sizeof(struct binCraft);
+    int32_t *selected;
+    int count;
+    int32_t *scratch = NULL;
+    if (globe_index == -1) {
+        // whole list, only used for the military aircraft
+        struct apiColumnFilter filter;
+        apiColumnFilterInit(&filter);
+        if (mil) {
+            filter.flags |= API_COL_MIL;
+        }
+        scratch = cmalloc((buffer->len + 1) * sizeof(int32_t));
+        count = apiColumnsSelect(cols, &filter, 0, buffer->len, scratch);
+        selected = scratch;
+    } else {
+        selected = apiColumnsTile(cols, globe_index, &count);
+    }
+
+    alloc += count * sizeof(struct binCraft);
 
     char *buf = check_grow_threadpool_buffer_t(pbuffer, alloc);
     char *p = buf;
@@ -1190,14 +1294,9 @@ struct char_buffer generateGlobeBin(int globe_index, int mil, threadpool_buffer_
 
     p = buf + elementSize;
 
-    for (int i = 0; i < ca->len; i++) {
-        a = ca->list[i];
-        if (a == NULL) continue;
-
-        if (!includeAircraftJson(now, a))
-            continue;
-
-        if (mil && !(a->dbFlags & 1))
+    for (int j = 0; j < count; j++) {
+        int i = selected[j];
+        if (mil && !(cols->flags[i] & API_COL_MIL))
             continue;
         // check if we have enough space
         if ((p + 2 * sizeof(struct binCraft)) >= end) {
@@ -1205,12 +1304,11 @@ struct char_buffer generateGlobeBin(int globe_index, int mil, threadpool_buffer_
             break;
         }
 
-        toBinCraft(a, (struct binCraft *) p, now);
-        p += sizeof(struct binCraft);
-
+        p = writeBinRow(p, buffer, i);
     }
 
-    ca_unlock_read(ca);
+    apiSnapshotRelease(buffer);
+    sfree(scratch);
 
     cb.len = p - buf;
     cb.buffer = buf;
@@ -1219,109 +1317,6 @@ struct char_buffer generateGlobeBin(int globe_index, int mil, threadpool_buffer_
 #undef memWrite
 }
 
-struct char_buffer generateGlobeJson(int globe_index, threadpool_buffer_t *pbuffer) {
-    struct char_buffer cb = { 0 };
-    int64_t now = mstime();
-    struct aircraft *a;
-    ssize_t alloc = 4096; // The initial buffer is resized as needed
-
-    struct craftArray *ca = NULL;
-    if (globe_index <= GLOBE_MAX_INDEX) {
-        ca = &Modes.globeLists[globe_index];
-    }
-    if (!ca) {
-        fprintf(stderr, "generateAircraftJson: bad globe_index: %d\n", globe_index);
-        return cb;
-    }
-    ca_lock_read(ca);
-
-    alloc += ca->len * 2048; // 2048 bytes per potential aircraft object
-
-    char *buf = check_grow_threadpool_buffer_t(pbuffer, alloc);
-
-    char *p = buf;
-    char *end = buf + alloc;
-
-    p = safe_snprintf(p, end,
-            "{ \"now\" : %.3f,\n"
-            "  \"messages\" : %u,\n",
-            now / 1000.0,
-            Modes.stats_current.messages_total + Modes.stats_alltime.messages_total);
-
-    p = safe_snprintf(p, end,
-            "  \"global_ac_count_withpos\" : %d,\n",
-            Modes.globalStatsCount.readsb_aircraft_with_position
-            );
-
-    p = safe_snprintf(p, end, "  \"globeIndex\" : %d, ", globe_index);
-    if (globe_index >= GLOBE_MIN_INDEX) {
-        int grid = GLOBE_INDEX_GRID;
-        int lat = ((globe_index - GLOBE_MIN_INDEX) / GLOBE_LAT_MULT) * grid - 90;
-        int lon = ((globe_index - GLOBE_MIN_INDEX) % GLOBE_LAT_MULT) * grid - 180;
-        p = safe_snprintf(p, end,
-                "\"south\" : %d, "
-                "\"west\" : %d, "
-                "\"north\" : %d, "
-                "\"east\" : %d,\n",
-                lat,
-                lon,
-                lat + grid,
-                lon + grid);
-    } else {
-        struct tile *tiles = Modes.json_globe_special_tiles;
-        struct tile tile = tiles[globe_index];
-        p = safe_snprintf(p, end,
-                "\"south\" : %d, "
-                "\"west\" : %d, "
-                "\"north\" : %d, "
-                "\"east\" : %d,\n",
-                tile.south,
-                tile.west,
-                tile.north,
-                tile.east);
-    }
-
-    p = safe_snprintf(p, end, "  \"aircraft\" : [");
-
-    for (int i = 0; i < ca->len; i++) {
-        a = ca->list[i];
-        if (a == NULL) continue;
-
-        if (!includeAircraftJson(now, a))
-            continue;
-
-        // check if we have enough space
-        // disable this due to passbuffer .... this would be a memleak
-        if (0 && (p + 2000) >= end) {
-            int used = p - buf;
-            alloc *= 2;
-            buf = (char *) realloc(buf, alloc);
-            p = buf + used;
-            end = buf + alloc;
-        }
-
-        p = safe_snprintf(p, end, "\n");
-        p = sprintAircraftObject(p, end, a, now, 0, NULL);
-        p = safe_snprintf(p, end, ",");
-
-        if (p >= end) {
-            fprintf(stderr, "buffer overrun aircraft json\n");
-            break;
-        }
-    }
-
-    if (*(p-1) == ',')
-        p--;
-
-    p = safe_snprintf(p, end, "\n  ]\n}\n");
-
-    ca_unlock_read(ca);
-
-    cb.len = p - buf;
-    cb.buffer = buf;
-    return cb;
-}
-
 struct char_buffer generateAircraftJson(int64_t onlyRecent){
     struct char_buffer cb;
     int64_t now = mstime();
@@ -1459,7 +1454,10 @@ static char *sprintTracePoint(char *p, char *end, struct state *state, struct st
     if (state_all) {
         int64_t now = state->timestamp;
         struct aircraft b;
+        struct aircraftCold bCold;
         memset(&b, 0, sizeof(struct aircraft));
+        memset(&bCold, 0, sizeof(struct aircraftCold));
+        b.cold = &bCold;
         struct aircraft *ac = &b;
         from_state_all(state_all, state, ac, now);
 
@@ -1503,7 +1501,7 @@ static char *sprintTracePoint(char *p, char *end, struct state *state, struct st
 }
 
 static void checkTraceCache(struct aircraft *a, traceBuffer tb, int64_t now) {
-    struct traceCache *cache = &a->traceCache;
+    struct traceCache *cache = &a->cold->traceCache;
     if (!cache->entries || !cache->json || !cache->json_max) {
         if (Modes.trace_hist_only & 8) {
             return; // no cache in this special case
@@ -1760,14 +1758,14 @@ struct char_buffer generateTraceJson(struct aircraft *a, traceBuffer tb, int sta
 
     if (Modes.db) {
         char *regInfo = p;
-        if (a->registration[0]) {
-            p = safe_snprintf(p, end, ",\n\"r\":\"%.*s\"", (int) sizeof(a->registration), a->registration);
+        if (a->cold->registration[0]) {
+            p = safe_snprintf(p, end, ",\n\"r\":\"%.*s\"", (int) sizeof(a->cold->registration), a->cold->registration);
         }
-        if (a->typeCode[0]) {
-            p = safe_snprintf(p, end, ",\n\"t\":\"%.*s\"", (int) sizeof(a->typeCode), a->typeCode);
+        if (a->cold->typeCode[0]) {
+            p = safe_snprintf(p, end, ",\n\"t\":\"%.*s\"", (int) sizeof(a->cold->typeCode), a->cold->typeCode);
         }
-        if (a->typeCode[0] || a->registration[0] || a->dbFlags) {
-            uint32_t dbFlags = a->dbFlags;
+        if (a->cold->typeCode[0] || a->cold->registration[0] || a->cold->dbFlags) {
+            uint32_t dbFlags = a->cold->dbFlags;
             dbFlags &= ~(1 << 7);
             p = safe_snprintf(p, end, ",\n\"dbFlags\":%u", dbFlags);
         }
@@ -1799,7 +1797,7 @@ struct char_buffer generateTraceJson(struct aircraft *a, traceBuffer tb, int sta
     // due to timestamping, only use trace cache for recent trace jsons
     if (recent && firstStamp != 0) {
         checkTraceCache(a, tb, now);
-        tCache = &a->traceCache;
+        tCache = &a->cold->traceCache;
         if (tCache->entries && tCache->entriesLen > 0) {
             entries = tCache->entries;
             referenceTs = tCache->referenceTs;
@@ -1968,11 +1966,10 @@ struct char_buffer generateOutlineJson() {
 }
 
 // Write JSON to file
+// gzip compression happens here on the calling thread, the file itself is written by fileWriterQueue()
 static inline __attribute__((always_inline)) struct char_buffer writeJsonTo (const char* dir, const char *file, struct char_buffer cb, int gzip, int gzip_level) {
 
     char pathbuf[PATH_MAX];
-    char tmppath[PATH_MAX];
-    int fd;
     int len = cb.len;
     char *content = cb.buffer;
 
@@ -1981,75 +1978,51 @@ static inline __attribute__((always_inline)) struct char_buffer writeJsonTo (con
     } else {
         snprintf(pathbuf, PATH_MAX, "%s", file);
     }
-    snprintf(tmppath, PATH_MAX, "%s.readsb_tmp", pathbuf);
 
-    int firstOpenFail = 1;
-open:
-    fd = open(tmppath, O_WRONLY | O_CREAT | O_EXCL, 0644);
-    if (fd < 0) {
-        if (firstOpenFail) {
-            unlink(tmppath);
-            firstOpenFail = 0;
-            goto open;
-        }
-        fprintf(stderr, "writeJsonTo open(): ");
-        perror(tmppath);
-        goto error_2;
+    if (!content) {
+        // generating the content failed (see generateZstd), an empty file is written as before
+        // but the next write mustn't be skipped as unchanged
+        fileWriterForget(pathbuf);
     }
 
+    if (!gzip) {
+        fileWriterQueue(pathbuf, content, len);
+        return cb;
+    }
 
-    if (gzip) {
-        gzFile gzfp = gzdopen(fd, "wb");
-        if (!gzfp) {
-            goto error_1;
-        }
-
-        int gBufSize = 128 * 1024;
-        if (len < 16 * 1024) {
-            gBufSize = 16 * 1024;
-        }
-        gzbuffer(gzfp, gBufSize);
-
-        int name_len = strlen(file);
-        if (name_len > 8 && strcmp("binCraft", file + (name_len - 8)) == 0) {
-            gzsetparams(gzfp, gzip_level, Z_FILTERED);
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    int strategy = Z_DEFAULT_STRATEGY;
+    int name_len = strlen(file);
+    if (name_len > 8 && strcmp("binCraft", file + (name_len - 8)) == 0) {
+        strategy = Z_FILTERED;
+    }
+    // windowBits 15 + 16: gzip header and trailer, same as gzdopen()
+    if (deflateInit2(&strm, gzip_level, Z_DEFLATED, 15 + 16, 8, strategy) != Z_OK) {
+        fprintf(stderr, "%s: deflateInit2 failed\n", pathbuf);
+        fileWriterForget(pathbuf);
+        return cb;
+    }
+    uLong bound = deflateBound(&strm, len);
+    char *gz = cmalloc(bound);
+    if (gz) {
+        strm.next_in = (Bytef *) content;
+        strm.avail_in = len;
+        strm.next_out = (Bytef *) gz;
+        strm.avail_out = bound;
+        int res = deflate(&strm, Z_FINISH);
+        if (res == Z_STREAM_END) {
+            fileWriterQueue(pathbuf, gz, strm.total_out);
         } else {
-            gzsetparams(gzfp, gzip_level, Z_DEFAULT_STRATEGY);
+            fprintf(stderr, "%s: gzip compression of length %d failed: %d\n", pathbuf, len, res);
+            fileWriterForget(pathbuf);
         }
-
-        int res = gzwrite(gzfp, content, len);
-        if (res != len) {
-            int error;
-            fprintf(stderr, "%s: gzwrite of length %d failed: %s (res == %d)\n", pathbuf, len, gzerror(gzfp, &error), res);
-        }
-
-        if (gzclose(gzfp) < 0)
-            goto error_2;
+        sfree(gz);
     } else {
-        if (write(fd, content, len) != len) {
-            fprintf(stderr, "writeJsonTo write(): ");
-            perror(tmppath);
-            goto error_1;
-        }
-
-        if (close(fd) < 0)
-            goto error_2;
+        fileWriterForget(pathbuf);
     }
+    deflateEnd(&strm);
 
-    if (rename(tmppath, pathbuf) == -1) {
-        fprintf(stderr, "writeJsonTo rename(): %s -> %s", tmppath, pathbuf);
-        perror("");
-        goto error_2;
-    }
-
-    goto out;
-
-error_1:
-    close(fd);
-error_2:
-    unlink(tmppath);
-
-out:
     return cb;
 }
 
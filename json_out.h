@@ -34,12 +34,30 @@ void logACASInfoShort(uint32_t addr, unsigned char *MV, struct aircraft *a, stru
 
 char *sprintACASInfoShort(char *p, char *end, uint32_t addr, unsigned char *MV, struct aircraft *a, struct modesMessage *mm, int64_t now);
 char *sprintAircraftObject(char *p, char *end, struct aircraft *a, int64_t now, int printMode, struct modesMessage *mm);
+
+// where an aircraft object printed by sprintAircraftObjectAges has its seen_pos / seen values
+// offsets relative to the start of the object, -1 if not present
+struct jsonAges {
+    int16_t seenPos;
+    int16_t seenPosLen;
+    int16_t seen;
+    int16_t seenLen;
+    int64_t seenPosTs; // the values are the ages of these timestamps
+    int64_t seenTs;
+};
+
+// same as sprintAircraftObject with printMode 0
+char *sprintAircraftObjectAges(char *p, char *end, struct aircraft *a, int64_t now, struct jsonAges *ages);
+// copy an object printed by sprintAircraftObjectAges, only updating the ages for now
+// only valid while the aircraft is unchanged and now is before aircraftReuseUntil
+// the caller needs to make sure there is room for len + 32 bytes
+char *reprintAircraftObject(char *p, char *end, const char *obj, int len, const struct jsonAges *old, struct jsonAges *ages, int64_t now);
+int64_t aircraftReuseUntil(struct aircraft *a, int64_t now);
 char *sprintAircraftRecent(char *p, char *end, struct aircraft *a, int64_t now, int printMode, struct modesMessage *mm, int64_t recent);
 struct char_buffer generateAircraftJson(int64_t onlyRecent);
 struct char_buffer generateAircraftBin(threadpool_buffer_t *pbuffer);
 struct char_buffer generateTraceJson(struct aircraft *a, traceBuffer tb, int start, int last, threadpool_buffer_t *buffer, int64_t startStamp);
 struct char_buffer generateGlobeBin(int globe_index, int mil, threadpool_buffer_t *buffer);
-struct char_buffer generateGlobeJson(int globe_index, threadpool_buffer_t *buffer);
 struct char_buffer generateReceiverJson ();
 struct char_buffer generateHistoryJson ();
 struct char_buffer generateClientsJson();
@@ -60,6 +60,7 @@
 #include <netdb.h>
 #include <poll.h>
 #include <sys/sendfile.h>
+#include <sys/uio.h>
 
 #include "uat2esnt/uat2esnt.h"
 
@@ -800,7 +801,9 @@ void serviceListen(struct net_service *service, char *bind_addr, char *bind_port
 static void initMessageBuffers() {
     if (Modes.decodeThreads > 1) {
         pthread_mutex_init(&Modes.decodeLock, NULL);
-        pthread_mutex_init(&Modes.trackLock, NULL);
+        for (int s = 0; s < TRACK_SHARDS; s++) {
+            pthread_mutex_init(&Modes.trackShardLock[s], NULL);
+        }
         pthread_mutex_init(&Modes.outputLock, NULL);
 
         Modes.decodeTasks = allocate_task_group(Modes.decodeThreads);
@@ -818,6 +821,10 @@ static void initMessageBuffers() {
         int bytes = buf->alloc * sizeof(struct modesMessage);
         buf->msg = cmalloc(bytes);
         //fprintf(stderr, "netMessageBuffer alloc: %d size: %d\n", buf->alloc, bytes);
+        if (Modes.decodeThreads > 1) {
+            buf->shardOrder = cmalloc(buf->alloc * sizeof(uint16_t));
+            reset_stats(&buf->trackStats);
+        }
     }
 }
 
@@ -871,6 +878,15 @@ void modesInitNet(void) {
 
     Modes.net_epfd = my_epoll_create(&Modes.exitNowEventfd);
 
+    if (Modes.net_io_uring) {
+        Modes.netUring = cmalloc(sizeof(struct uring));
+        int res = uringInit(Modes.netUring, URING_ENTRIES);
+        if (res < 0) {
+            fprintf(stderr, "io_uring not available: %s, using writev for network output\n", strerror(-res));
+            sfree(Modes.netUring);
+        }
+    }
+
     // set up listeners
     raw_out = serviceInit(&Modes.services_out, "Raw TCP output", &Modes.raw_out, raw_heartbeat, no_heartbeat, READ_MODE_IGNORE, NULL, NULL);
     serviceListen(raw_out, Modes.net_bind_address, Modes.net_output_raw_ports, Modes.net_epfd);
@@ -1408,40 +1424,76 @@ static int pongReceived(struct client *c, int64_t now) {
 }
 
 
-static inline int flushClient(struct client *c, int64_t now) {
-    if (!c->service) { fprintf(stderr, "report error: Ahlu8pie\n"); return -1; }
-    int toWrite = c->sendq_len;
-    char *psendq = c->sendq;
-
-    if (toWrite == 0) {
-        c->last_flush = now;
-        return 0;
+// move the unsent part of the SendQ to the front of the buffer
+static void sendqCompact(struct client *c) {
+    if (c->sendq_start == 0) {
+        return;
     }
+    c->sendq_len -= c->sendq_start;
+    memmove(c->sendq, c->sendq + c->sendq_start, c->sendq_len);
+    c->sendq_start = 0;
+}
 
-    int bytesWritten = send(c->fd, psendq, toWrite, 0);
-    int err = errno;
+// Fill iov with the unsent part of the SendQ followed by the shared writer block data / len.
+// Returns the number of iovecs used, 0 if there is nothing to send.
+static int clientSendIov(struct client *c, const char *data, int len, struct iovec *iov) {
+    int pending = c->sendq_len - c->sendq_start;
+    int iovcnt = 0;
+    if (pending > 0) {
+        iov[iovcnt].iov_base = c->sendq + c->sendq_start;
+        iov[iovcnt].iov_len = pending;
+        iovcnt++;
+    }
+    if (len > 0) {
+        iov[iovcnt].iov_base = (void *) data;
+        iov[iovcnt].iov_len = len;
+        iovcnt++;
+    }
+    return iovcnt;
+}
+
+// Account for a send of the iovecs from clientSendIov, bytesWritten / err as returned by writev.
+// The shared block is only copied into the SendQ for the part which the socket didn't accept.
+// The caller needs to make sure the SendQ has room for len bytes.
+static int clientSendComplete(struct client *c, int64_t now, const char *data, int len, int bytesWritten, int err) {
+    int pending = c->sendq_len - c->sendq_start;
 
     // If we get -1, it's only fatal if it's not EAGAIN/EWOULDBLOCK
     if (bytesWritten < 0 && err != EAGAIN && err != EWOULDBLOCK) {
         fprintf(stderr, "%s: Send Error: %s: %s port %s (fd %d, SendQ %d, RecvQ %d)\n",
                 c->service->descr, strerror(err), c->host, c->port,
-                c->fd, c->sendq_len, c->buflen);
+                c->fd, pending, c->buflen);
         modesCloseClient(c);
         return -1;
     }
-    if (bytesWritten > 0) {
-        Modes.stats_current.network_bytes_out += bytesWritten;
-        // Advance buffer
-        psendq += bytesWritten;
-        toWrite -= bytesWritten;
-
+    int written = imax(0, bytesWritten);
+    if (written > 0) {
+        Modes.stats_current.network_bytes_out += written;
         c->last_send = now;	// If we wrote anything, update this.
-        if (bytesWritten == c->sendq_len) {
-            c->sendq_len = 0;
-            c->last_flush = now;
+    }
+    if (written >= pending) {
+        // SendQ is empty, queue what's left of the shared block
+        int dataWritten = written - pending;
+        c->sendq_start = 0;
+        c->sendq_len = len - dataWritten;
+        if (c->sendq_len > 0) {
+            memcpy(c->sendq, data + dataWritten, c->sendq_len);
         } else {
-            c->sendq_len -= bytesWritten;
-            memmove((void*)c->sendq, c->sendq + bytesWritten, toWrite);
+            c->last_flush = now;
+        }
+    } else {
+        // advance the read position instead of shifting the buffer after every partial send
+        c->sendq_start += written;
+        if (len > 0 && c->sendq_len + len > c->sendq_max) {
+            sendqCompact(c);
+        }
+        if (len > 0) {
+            memcpy(c->sendq + c->sendq_len, data, len);
+            c->sendq_len += len;
+        }
+        // keep room for data which is appended directly to the SendQ (pings, heartbeats)
+        if (c->sendq_start > c->sendq_max / 2) {
+            sendqCompact(c);
         }
     }
     if (c->last_flush != now && !(c->epollEvent.events & EPOLLOUT)) {
@@ -1461,13 +1513,126 @@ static inline int flushClient(struct client *c, int64_t now) {
     // give the connection 10 seconds to ramp up --> automatic TCP window scaling in Linux ...
     int64_t flushTimeout = imax(1 * SECONDS, 8 * Modes.net_output_flush_interval);
     if (now - c->last_flush > flushTimeout && now - c->connectedSince > 10 * SECONDS) {
-        fprintf(stderr, "%s: Couldn't flush data for %.2fs (Insufficient bandwidth?): disconnecting: %s port %s (fd %d, SendQ %d)\n", c->service->descr, flushTimeout / 1000.0, c->host, c->port, c->fd, c->sendq_len);
+        fprintf(stderr, "%s: Couldn't flush data for %.2fs (Insufficient bandwidth?): disconnecting: %s port %s (fd %d, SendQ %d)\n", c->service->descr, flushTimeout / 1000.0, c->host, c->port, c->fd, c->sendq_len - c->sendq_start);
         modesCloseClient(c);
         return -1;
     }
     return bytesWritten;
 }
 
+// Send the SendQ of a client followed by the shared writer block data / len with a single writev()
+static int flushClientData(struct client *c, int64_t now, const char *data, int len) {
+    if (!c->service) { fprintf(stderr, "report error: Ahlu8pie\n"); return -1; }
+
+    struct iovec iov[2];
+    int iovcnt = clientSendIov(c, data, len, iov);
+    if (iovcnt == 0) {
+        c->last_flush = now;
+        return 0;
+    }
+
+    int bytesWritten = writev(c->fd, iov, iovcnt);
+    Modes.stats_current.network_sends++;
+    Modes.stats_current.network_send_syscalls++;
+    return clientSendComplete(c, now, data, len, bytesWritten, errno);
+}
+
+static inline int flushClient(struct client *c, int64_t now) {
+    return flushClientData(c, now, NULL, 0);
+}
+
+// scratch space to send a writer block to all clients with one io_uring submission
+// only used by the thread doing the output (under Modes.outputLock with multiple decode threads)
+static struct {
+    int alloc;
+    int len;
+    struct client **clients;
+    int *fds;
+    struct msghdr *msgs;
+    struct iovec *iovs;
+    int *results;
+} sendBatch;
+
+static void sendBatchReserve(int count) {
+    if (count <= sendBatch.alloc) {
+        return;
+    }
+    int alloc = imax(count, 2 * sendBatch.alloc);
+    sendBatch.clients = realloc(sendBatch.clients, alloc * sizeof(struct client *));
+    sendBatch.fds = realloc(sendBatch.fds, alloc * sizeof(int));
+    sendBatch.msgs = realloc(sendBatch.msgs, alloc * sizeof(struct msghdr));
+    sendBatch.iovs = realloc(sendBatch.iovs, 2 * alloc * sizeof(struct iovec));
+    sendBatch.results = realloc(sendBatch.results, alloc * sizeof(int));
+    if (!sendBatch.clients || !sendBatch.fds || !sendBatch.msgs || !sendBatch.iovs || !sendBatch.results) {
+        fprintf(stderr, "FATAL: sendBatchReserve: out of memory!\n");
+        exit(1);
+    }
+    sendBatch.alloc = alloc;
+}
+
+static void sendBatchFree() {
+    sfree(sendBatch.clients);
+    sfree(sendBatch.fds);
+    sfree(sendBatch.msgs);
+    sfree(sendBatch.iovs);
+    sfree(sendBatch.results);
+    sendBatch.alloc = 0;
+    sendBatch.len = 0;
+}
+
+static void sendBatchAdd(struct client *c, const char *data, int len) {
+    int k = sendBatch.len;
+    struct iovec *iov = &sendBatch.iovs[2 * k];
+    int iovcnt = clientSendIov(c, data, len, iov);
+    if (iovcnt == 0) {
+        return;
+    }
+    struct msghdr *msg = &sendBatch.msgs[k];
+    memset(msg, 0, sizeof(struct msghdr));
+    msg->msg_iovlen = iovcnt; // msg_iov is set in sendBatchRun, the arrays can still move
+    sendBatch.clients[k] = c;
+    sendBatch.fds[k] = c->fd;
+    sendBatch.len++;
+}
+
+// submit the sends of all batched clients at once and do the per client bookkeeping
+static void sendBatchRun(const char *data, int len, int64_t now) {
+    if (!sendBatch.len) {
+        return;
+    }
+    for (int k = 0; k < sendBatch.len; k++) {
+        sendBatch.msgs[k].msg_iov = &sendBatch.iovs[2 * k];
+        sendBatch.results[k] = -ECANCELED;
+    }
+    int enterCalls = uringSendmsgBatch(Modes.netUring, sendBatch.fds, sendBatch.msgs, sendBatch.results, sendBatch.len);
+    if (enterCalls < 0) {
+        // only on hard errors (EAGAIN / EBUSY are retried), nothing is in flight anymore
+        // sends the kernel never took are -ECANCELED and go out with writev below,
+        // clients with a send of unknown outcome (-EIO) are closed as their stream can't be continued
+        fprintf(stderr, "io_uring send failed: %s, falling back to writev\n", strerror(-enterCalls));
+        uringDestroy(Modes.netUring);
+        sfree(Modes.netUring);
+    } else {
+        Modes.stats_current.network_send_syscalls += enterCalls;
+    }
+    for (int k = 0; k < sendBatch.len; k++) {
+        struct client *c = sendBatch.clients[k];
+        int res = sendBatch.results[k];
+        if (res == -ECANCELED || res == -ENOTSOCK || res == -EINVAL || res == -EOPNOTSUPP) {
+            // not sent by the ring, not a socket or sendmsg not supported by io_uring on this kernel
+            flushClientData(c, now, data, len);
+            continue;
+        }
+        Modes.stats_current.network_sends++;
+        if (res < 0) {
+            clientSendComplete(c, now, data, len, -1, -res);
+        } else {
+            clientSendComplete(c, now, data, len, res, 0);
+        }
+    }
+    sendBatch.len = 0;
+}
+
 //
 //=========================================================================
 //
@@ -1484,27 +1649,31 @@ static void flushWrites(struct net_writer *writer) {
                 pong(c, now);
             }
             // give the connection 10 seconds to ramp up --> automatic TCP window scaling in Linux ...
-            if ((c->sendq_len + writer->dataUsed) >= c->sendq_max) {
+            int pending = c->sendq_len - c->sendq_start;
+            if ((pending + writer->dataUsed) >= c->sendq_max) {
                 if (now - c->connectedSince < 10 * SECONDS) {
                     fprintf(stderr, "%s: Discarding full SendQ: %s port %s (fd %d, SendQ %d, RecvQ %d)\n",
                             c->service->descr, c->host, c->port,
-                            c->fd, c->sendq_len, c->buflen);
+                            c->fd, pending, c->buflen);
                     c->sendq_len = 0;
+                    c->sendq_start = 0;
                     flushClient(c, now);
                     continue;
                 }
                 // Too much data in client SendQ.  Drop client - SendQ exceeded.
                 fprintf(stderr, "%s: Dropped due to full SendQ: %s port %s (fd %d, SendQ %d, RecvQ %d)\n",
                         c->service->descr, c->host, c->port,
-                        c->fd, c->sendq_len, c->buflen);
+                        c->fd, pending, c->buflen);
                 modesCloseClient(c);
                 continue;	// Go to the next client
             }
-            // Append the data to the end of the queue, increment len
-            memcpy(c->sendq + c->sendq_len, writer->data, writer->dataUsed);
-            c->sendq_len += writer->dataUsed;
-            // Try flushing...
-            if (flushClient(c, now) < 0) {
+            // Send the shared buffer directly, only the part the client can't take right now is copied to its SendQ
+            if (Modes.netUring) {
+                sendBatchReserve(sendBatch.len + 1);
+                sendBatchAdd(c, writer->data, writer->dataUsed);
+                continue;
+            }
+            if (flushClientData(c, now, writer->data, writer->dataUsed) < 0) {
                 continue;
             }
             if (!c->service) {
@@ -1512,6 +1681,9 @@ static void flushWrites(struct net_writer *writer) {
             }
         }
     }
+    if (Modes.netUring) {
+        sendBatchRun(writer->data, writer->dataUsed, now);
+    }
     writer->dataUsed = 0;
     writer->lastWrite = now;
     return;
@@ -4250,6 +4422,7 @@ static int decodeUatMessage(struct client *c, char *msg, int remote, int64_t now
             if (now > a->seen + 300 * SECONDS) {
                 //fprintf(stderr, "IGNORING first UAT message from: %06x\n", a->addr);
                 a->seen = now;
+                aircraftChanged(a);
                 return 0;
             }
             netUseMessage(mm);
@@ -5512,6 +5685,7 @@ static void cleanupService(struct net_service *s) {
 
         anetCloseSocket(c->fd);
         c->sendq_len = 0;
+        c->sendq_start = 0;
         sfree(c->sendq);
         sfree(c->buf);
         sfree(c);
@@ -5551,7 +5725,9 @@ static void cleanupMessageBuffers() {
 
     if (Modes.decodeThreads > 1) {
         pthread_mutex_destroy(&Modes.decodeLock);
-        pthread_mutex_destroy(&Modes.trackLock);
+        for (int s = 0; s < TRACK_SHARDS; s++) {
+            pthread_mutex_destroy(&Modes.trackShardLock[s]);
+        }
         pthread_mutex_destroy(&Modes.outputLock);
 
         threadpool_destroy(Modes.decodePool);
@@ -5561,6 +5737,7 @@ static void cleanupMessageBuffers() {
     for (int k = 0; k < Modes.decodeThreads; k++) {
         struct messageBuffer *buf = &Modes.netMessageBuffer[k];
         sfree(buf->msg);
+        sfree(buf->shardOrder);
         buf->len = 0;
         buf->alloc = 0;
     }
@@ -5570,6 +5747,12 @@ static void cleanupMessageBuffers() {
 void cleanupNetwork(void) {
     cleanupMessageBuffers();
 
+    if (Modes.netUring) {
+        uringDestroy(Modes.netUring);
+        sfree(Modes.netUring);
+    }
+    sendBatchFree();
+
     if (Modes.dump_fw) {
         zstdFwFinishFile(Modes.dump_fw);
         destroyZstdFw(Modes.dump_fw);
@@ -5769,6 +5952,83 @@ static void outputMessage(struct modesMessage *mm) {
 
 }
 
+static inline int trackShard(struct modesMessage *mm) {
+    // Mode A/C counters are global, keep them all on shard 0
+    if (mm->msgtype == DFTYPE_MODEAC) {
+        return 0;
+    }
+    return addrHash(mm->addr, AIRCRAFT_HASH_BITS) & (TRACK_SHARDS - 1);
+}
+
+static void trackUpdateShard(struct messageBuffer *buf, int from, int to) {
+    for (int j = from; j < to; j++) {
+        struct modesMessage *mm = &buf->msg[buf->shardOrder[j]];
+        if (Modes.debug_yeet && mm->addr % 0x100 != 0xd) {
+            continue;
+        }
+        trackUpdateFromMessage(mm);
+    }
+}
+
+// track update for --decode-threads > 1
+// each aircraft hash bucket belongs to exactly one shard, holding the shard lock
+// gives exclusive access to the aircraft of that shard.
+// the messages of this buffer are grouped by shard (keeping their order) and
+// the shards are processed in whatever order their locks become available.
+static void trackUpdateSharded(struct messageBuffer *buf) {
+    int count[TRACK_SHARDS] = { 0 };
+    int start[TRACK_SHARDS + 1];
+
+    for (int k = 0; k < buf->len; k++) {
+        count[trackShard(&buf->msg[k])]++;
+    }
+    start[0] = 0;
+    for (int s = 0; s < TRACK_SHARDS; s++) {
+        start[s + 1] = start[s] + count[s];
+        count[s] = start[s];
+    }
+    for (int k = 0; k < buf->len; k++) {
+        buf->shardOrder[count[trackShard(&buf->msg[k])]++] = k;
+    }
+
+    uint64_t pending = 0;
+    for (int s = 0; s < TRACK_SHARDS; s++) {
+        if (start[s + 1] > start[s]) {
+            pending |= (1ULL << s);
+        }
+    }
+
+    // different decode threads start with different shards to reduce contention
+    int offset = buf->id * (TRACK_SHARDS / Modes.decodeThreads);
+    while (pending) {
+        int progress = 0;
+        int first = -1;
+        for (int i = 0; i < TRACK_SHARDS; i++) {
+            int s = (i + offset) & (TRACK_SHARDS - 1);
+            if (!(pending & (1ULL << s))) {
+                continue;
+            }
+            if (pthread_mutex_trylock(&Modes.trackShardLock[s])) {
+                if (first < 0) {
+                    first = s;
+                }
+                continue;
+            }
+            trackUpdateShard(buf, start[s], start[s + 1]);
+            pthread_mutex_unlock(&Modes.trackShardLock[s]);
+            pending &= ~(1ULL << s);
+            progress = 1;
+        }
+        if (!progress) {
+            // all remaining shards are busy, wait for one of them
+            pthread_mutex_lock(&Modes.trackShardLock[first]);
+            trackUpdateShard(buf, start[first], start[first + 1]);
+            pthread_mutex_unlock(&Modes.trackShardLock[first]);
+            pending &= ~(1ULL << first);
+        }
+    }
+}
+
 static void drainMessageBuffer(struct messageBuffer *buf) {
     if (Modes.decodeThreads < 2) {
         for (int k = 0; k < buf->len; k++) {
@@ -5790,19 +6050,9 @@ static void drainMessageBuffer(struct messageBuffer *buf) {
 
         pthread_mutex_unlock(&Modes.decodeLock);
 
-
-        sched_yield();
         //fprintf(stderr, "thread %d draining\n", buf->id);
 
-        pthread_mutex_lock(&Modes.trackLock);
-        for (int k = 0; k < buf->len; k++) {
-            struct modesMessage *mm = &buf->msg[k];
-            if (Modes.debug_yeet && mm->addr % 0x100 != 0xd) {
-                continue;
-            }
-            trackUpdateFromMessage(mm);
-        }
-        pthread_mutex_unlock(&Modes.trackLock);
+        trackUpdateSharded(buf);
 
         pthread_mutex_lock(&Modes.outputLock);
         for (int k = 0; k < buf->len; k++) {
@@ -5817,6 +6067,8 @@ static void drainMessageBuffer(struct messageBuffer *buf) {
         buf->len = 0;
 
         pthread_mutex_lock(&Modes.decodeLock);
+        // decodeLock protects Modes.stats_current
+        trackMergeStats(buf);
         //fprintf(stderr, "thread %d drain done, back to decoding\n", buf->id);
     }
 }
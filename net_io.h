@@ -110,7 +110,8 @@ struct client
     int8_t receiverIdLocked; // receiverId has been transmitted by other side.
     int8_t unreasonable_messagerate;
     char *sendq;  // Write buffer - allocated later
-    int sendq_len; // Amount of data in SendQ
+    int sendq_len; // End of the data in SendQ
+    int sendq_start; // Start of the unsent data in SendQ, data before it has already been sent
     int sendq_max; // Max size of SendQ
     uint32_t ping; // only 24 bit are ever sent
     uint32_t pong; // only 24 bit are ever sent
@@ -0,0 +1,167 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// aircraft_benchmark.c: lookup cost of the aircraft index vs the hash bucket chains
+//
+// usage: aircraft_benchmark
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "../readsb.h"
+
+struct _Modes Modes;
+
+void setExit(int arg) {
+    exit(arg);
+}
+
+#define LOOKUPS (4 * 1000 * 1000)
+
+// the decoder uses each lookup result before the next message is looked up
+// chaining the lookups through zero measures that latency instead of overlapped throughput
+static volatile uintptr_t volatileZero;
+
+static int64_t nanotime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// lookup as done by aircraftGet before the index
+static struct aircraft *chainGet(uint32_t addr) {
+    struct aircraft *a = Modes.aircraft[addrHash(addr, AIRCRAFT_HASH_BITS)];
+    while (a && a->addr != addr) {
+        a = a->next;
+    }
+    return a;
+}
+
+// entries below removed must be gone, the others must be found
+static void verify(struct aircraftIndex *idx, uint32_t *addrs, struct aircraft **list, int removed, int count) {
+    for (int i = 0; i < count; i++) {
+        struct aircraft *expected = (i < removed) ? NULL : list[i];
+        if (aircraftIndexGet(idx, addrs[i]) != expected) {
+            fprintf(stderr, "index lookup of %06x wrong!\n", addrs[i]);
+            exit(1);
+        }
+    }
+}
+
+static void bench(int count) {
+    struct aircraftIndex idx;
+    aircraftIndexInit(&idx);
+    memset(Modes.aircraft, 0x0, sizeof(Modes.aircraft));
+
+    struct aircraft **list = cmalloc(count * sizeof(struct aircraft *));
+    uint32_t *addrs = cmalloc(count * sizeof(uint32_t));
+    for (int i = 0; i < count; i++) {
+        uint32_t addr;
+        do {
+            addr = random() & 0xffffff;
+        } while (chainGet(addr));
+
+        struct aircraft *a = cmalloc(sizeof(struct aircraft));
+        memset(a, 0x0, sizeof(struct aircraft));
+        a->addr = addr;
+        uint32_t hash = addrHash(addr, AIRCRAFT_HASH_BITS);
+        a->next = Modes.aircraft[hash];
+        Modes.aircraft[hash] = a;
+        aircraftIndexAdd(&idx, addr, a);
+
+        list[i] = a;
+        addrs[i] = addr;
+    }
+    // possibly still resizing
+    verify(&idx, addrs, list, 0, count);
+    aircraftIndexMaintenance(&idx);
+
+    // lookup order like the message stream: random aircraft
+    uint32_t *order = cmalloc(LOOKUPS * sizeof(uint32_t));
+    for (int i = 0; i < LOOKUPS; i++) {
+        order[i] = addrs[random() % count];
+    }
+    // same number of lookups for addresses not in the table (bad CRC / new aircraft)
+    uint32_t *misses = cmalloc(LOOKUPS * sizeof(uint32_t));
+    for (int i = 0; i < LOOKUPS; i++) {
+        misses[i] = (random() & 0xffffff) | 0x1000000;
+    }
+
+    uintptr_t zero = volatileZero;
+    uintptr_t check = 0;
+    uintptr_t prev = 0;
+    int64_t t0 = nanotime();
+    for (int i = 0; i < LOOKUPS; i++) {
+        prev = (uintptr_t) chainGet(order[i] + (prev & zero));
+        check += prev;
+    }
+    int64_t t1 = nanotime();
+    for (int i = 0; i < LOOKUPS; i++) {
+        prev = (uintptr_t) aircraftIndexGet(&idx, order[i] + (prev & zero));
+        check -= prev;
+    }
+    int64_t t2 = nanotime();
+    for (int i = 0; i < LOOKUPS; i++) {
+        prev = (uintptr_t) chainGet(misses[i] + (prev & zero));
+        check += prev;
+    }
+    int64_t t3 = nanotime();
+    for (int i = 0; i < LOOKUPS; i++) {
+        prev = (uintptr_t) aircraftIndexGet(&idx, misses[i] + (prev & zero));
+        check += prev;
+    }
+    int64_t t4 = nanotime();
+
+    if (check != 0) {
+        fprintf(stderr, "lookup mismatch!\n");
+        exit(1);
+    }
+
+    fprintf(stderr, "%6d aircraft | hit: chain %5.1f ns index %5.1f ns | miss: chain %5.1f ns index %5.1f ns | index slots %u\n",
+            count,
+            (t1 - t0) / (double) LOOKUPS, (t2 - t1) / (double) LOOKUPS,
+            (t3 - t2) / (double) LOOKUPS, (t4 - t3) / (double) LOOKUPS,
+            idx.cur->mask + 1);
+
+    // remove everything again, exercises deletion and shrinking
+    for (int i = 0; i < count; i++) {
+        aircraftIndexRemove(&idx, addrs[i]);
+        if (i == count / 2 || i == count * 7 / 8) {
+            verify(&idx, addrs, list, i + 1, count);
+            aircraftIndexMaintenance(&idx);
+            verify(&idx, addrs, list, i + 1, count);
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        sfree(list[i]);
+    }
+    if (aircraftIndexCount(&idx) != 0) {
+        fprintf(stderr, "index not empty after removing all aircraft!\n");
+        exit(1);
+    }
+    aircraftIndexDestroy(&idx);
+    sfree(misses);
+    sfree(order);
+    sfree(addrs);
+    sfree(list);
+}
+
+int main(int argc, char **argv) {
+    MODES_NOTUSED(argc);
+    MODES_NOTUSED(argv);
+    srandom(42);
+
+    bench(5000);
+    bench(20000);
+    bench(100000);
+    return 0;
+}
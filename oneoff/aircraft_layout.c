@@ -0,0 +1,120 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// aircraft_layout.c: pahole style layout report of struct aircraft and struct aircraftCold
+//
+// usage: aircraft_layout
+//
+// Lists the members starting in each 64 byte cache line, bitfields are not listed.
+// Members used for every message should stay in the first lines of struct aircraft,
+// members the decoder doesn't use belong in struct aircraftCold.
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "../readsb.h"
+
+struct _Modes Modes;
+
+void setExit(int arg) {
+    exit(arg);
+}
+
+struct member {
+    const char *name;
+    size_t offset;
+    size_t size;
+};
+
+#define M(s, m) { #m, offsetof(struct s, m), sizeof(((struct s *) 0)->m) }
+
+static struct member hot[] = {
+    M(aircraft, next), M(aircraft, cold), M(aircraft, addr), M(aircraft, addrtype),
+    M(aircraft, seen), M(aircraft, seen_pos), M(aircraft, messages), M(aircraft, onActiveList),
+    M(aircraft, receiverCount), M(aircraft, category), M(aircraft, category_updated), M(aircraft, lastSignalTimestamp),
+    M(aircraft, trace_current), M(aircraft, trace_current_max), M(aircraft, trace_current_len), M(aircraft, trace_len),
+    M(aircraft, trace_write), M(aircraft, trace_writeCounter), M(aircraft, baro_alt), M(aircraft, alt_reliable),
+    M(aircraft, geom_alt), M(aircraft, geom_delta), M(aircraft, signalNext), M(aircraft, signalLevel),
+    M(aircraft, seenAdsbReliable), M(aircraft, addrtype_updated), M(aircraft, tat), M(aircraft, nogpsCounter),
+    M(aircraft, receiverIdsNext), M(aircraft, seenPosReliable), M(aircraft, lastPosReceiverId), M(aircraft, pos_nic),
+    M(aircraft, pos_rc), M(aircraft, lat), M(aircraft, lon), M(aircraft, pos_reliable_odd),
+    M(aircraft, pos_reliable_even), M(aircraft, mlatEPU), M(aircraft, gs_last_pos), M(aircraft, wind_speed),
+    M(aircraft, wind_direction), M(aircraft, wind_altitude), M(aircraft, oat), M(aircraft, wind_updated),
+    M(aircraft, oat_updated), M(aircraft, tat_updated), M(aircraft, baro_rate), M(aircraft, geom_rate),
+    M(aircraft, ias), M(aircraft, tas), M(aircraft, squawk), M(aircraft, squawkTentative),
+    M(aircraft, nav_altitude_mcp), M(aircraft, nav_altitude_fms), M(aircraft, cpr_odd_lat), M(aircraft, cpr_odd_lon),
+    M(aircraft, cpr_odd_nic), M(aircraft, cpr_odd_rc), M(aircraft, cpr_even_lat), M(aircraft, cpr_even_lon),
+    M(aircraft, cpr_even_nic), M(aircraft, cpr_even_rc), M(aircraft, nav_qnh), M(aircraft, nav_heading),
+    M(aircraft, gs), M(aircraft, mach), M(aircraft, track), M(aircraft, track_rate),
+    M(aircraft, roll), M(aircraft, mag_heading), M(aircraft, true_heading), M(aircraft, calc_track),
+    M(aircraft, next_reduce_forward_DF11), M(aircraft, callsign), M(aircraft, emergency), M(aircraft, airground),
+    M(aircraft, nav_modes), M(aircraft, cpr_odd_type), M(aircraft, cpr_even_type), M(aircraft, nav_altitude_src),
+    M(aircraft, modeA_hit), M(aircraft, modeC_hit), M(aircraft, adsb_version), M(aircraft, adsr_version),
+    M(aircraft, tisb_version), M(aircraft, adsb_hrd), M(aircraft, adsb_tah), M(aircraft, globe_index),
+    M(aircraft, sil_type), M(aircraft, callsign_valid), M(aircraft, baro_alt_valid), M(aircraft, geom_alt_valid),
+    M(aircraft, geom_delta_valid), M(aircraft, gs_valid), M(aircraft, ias_valid), M(aircraft, tas_valid),
+    M(aircraft, mach_valid), M(aircraft, track_valid), M(aircraft, track_rate_valid), M(aircraft, roll_valid),
+    M(aircraft, mag_heading_valid), M(aircraft, true_heading_valid), M(aircraft, baro_rate_valid), M(aircraft, geom_rate_valid),
+    M(aircraft, nic_a_valid), M(aircraft, nic_c_valid), M(aircraft, nic_baro_valid), M(aircraft, nac_p_valid),
+    M(aircraft, nac_v_valid), M(aircraft, sil_valid), M(aircraft, gva_valid), M(aircraft, sda_valid),
+    M(aircraft, squawk_valid), M(aircraft, emergency_valid), M(aircraft, airground_valid), M(aircraft, nav_qnh_valid),
+    M(aircraft, nav_altitude_mcp_valid), M(aircraft, nav_altitude_fms_valid), M(aircraft, nav_altitude_src_valid), M(aircraft, nav_heading_valid),
+    M(aircraft, nav_modes_valid), M(aircraft, cpr_odd_valid), M(aircraft, cpr_even_valid), M(aircraft, position_valid),
+    M(aircraft, alert_valid), M(aircraft, spi_valid), M(aircraft, seenPosGlobal), M(aircraft, latReliable),
+    M(aircraft, lonReliable), M(aircraft, receiverIds), M(aircraft, next_reduce_forward_status), M(aircraft, acas_ra),
+    M(aircraft, acas_flags), M(aircraft, acas_ra_valid), M(aircraft, gs_reliable), M(aircraft, track_reliable),
+    M(aircraft, canary1), M(aircraft, squawkTentativeChanged), M(aircraft, magneticDeclination), M(aircraft, updatedDeclination),
+    M(aircraft, pos_nic_reliable), M(aircraft, pos_rc_reliable), M(aircraft, trackUnreliable), M(aircraft, receiverId),
+    M(aircraft, prev_lat), M(aircraft, prev_lon), M(aircraft, prev_pos_time), M(aircraft, speedUnreliable),
+    M(aircraft, lastStatusDiscarded), M(aircraft, nextJsonPortOutput), M(aircraft, receiver_distance), M(aircraft, receiver_direction),
+    M(aircraft, mlat_pos_valid), M(aircraft, mlat_lat), M(aircraft, mlat_lon), M(aircraft, pos_reliable_valid),
+    M(aircraft, seenAdsbLat), M(aircraft, seenAdsbLon), M(aircraft, lastStatusTs), M(aircraft, lastOverrideTs),
+    M(aircraft, zeroStart), M(aircraft, messageRate), M(aircraft, messageRateAcc), M(aircraft, nextMessageRateCalc),
+    M(aircraft, disc_cache_index), M(aircraft, cpr_cache_index), M(aircraft, disc_cache), M(aircraft, cpr_cache),
+    M(aircraft, zeroEnd),
+};
+
+static struct member cold[] = {
+    M(aircraftCold, trace_next_mw), M(aircraftCold, trace_next_perm), M(aircraftCold, trace_perm_last_timestamp), M(aircraftCold, trace_chunks),
+    M(aircraftCold, trace_chunk_len), M(aircraftCold, traceWrittenForYesterday), M(aircraftCold, dbFlags), M(aircraftCold, typeCode),
+    M(aircraftCold, registration), M(aircraftCold, typeLong), M(aircraftCold, rr_lat), M(aircraftCold, rr_lon),
+    M(aircraftCold, rr_seen), M(aircraftCold, zeroStart), M(aircraftCold, traceCache), M(aircraftCold, trace_chunk_overall_bytes),
+    M(aircraftCold, initialTraceWriteDone), M(aircraftCold, zeroEnd),
+};
+
+static void report(const char *name, size_t size, struct member *members, int count) {
+    fprintf(stderr, "struct %s {\n", name);
+    size_t line = SIZE_MAX;
+    size_t end = 0;
+    for (int i = 0; i < count; i++) {
+        struct member *m = &members[i];
+        if (m->offset > end) {
+            fprintf(stderr, "    /* XXX %zu bytes hole or bitfields */\n", m->offset - end);
+        }
+        if (m->offset / 64 != line) {
+            line = m->offset / 64;
+            fprintf(stderr, "    /* --- cacheline %zu boundary (%zu bytes) --- */\n", line, line * 64);
+        }
+        fprintf(stderr, "    %-28s /* %5zu %5zu */\n", m->name, m->offset, m->size);
+        end = m->offset + m->size;
+    }
+    fprintf(stderr, "    /* size: %zu, cachelines: %zu */\n};\n\n", size, (size + 63) / 64);
+}
+
+int main(int argc, char **argv) {
+    MODES_NOTUSED(argc);
+    MODES_NOTUSED(argv);
+
+    report("aircraft", sizeof(struct aircraft), hot, sizeof(hot) / sizeof(hot[0]));
+    report("aircraftCold", sizeof(struct aircraftCold), cold, sizeof(cold) / sizeof(cold[0]));
+    return 0;
+}
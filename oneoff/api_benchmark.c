@@ -0,0 +1,244 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// api_benchmark.c: latency of the API box / circle lookups, longitude band scan vs apiGrid
+//
+// usage: api_benchmark [aircraft.binCraft]
+//
+// Without an argument a synthetic fleet is used, otherwise the fleet snapshot is read from
+// an aircraft.binCraft as written to the json directory (gzip compressed or plain).
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "../readsb.h"
+
+struct _Modes Modes;
+
+void setExit(int arg) {
+    exit(arg);
+}
+
+#define QUERIES (4000)
+
+static struct apiEntry *list;
+static int len;
+
+static int64_t nanotime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int compareLon(const void *p1, const void *p2) {
+    const struct apiEntry *a1 = p1;
+    const struct apiEntry *a2 = p2;
+    return (a1->bin.lon > a2->bin.lon) - (a1->bin.lon < a2->bin.lon);
+}
+
+static int compareInt64(const void *p1, const void *p2) {
+    int64_t i1 = *(const int64_t *) p1;
+    int64_t i2 = *(const int64_t *) p2;
+    return (i1 > i2) - (i1 < i2);
+}
+
+static double gauss() {
+    double u1 = (random() + 1.0) / (RAND_MAX + 2.0);
+    double u2 = (random() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+static void synthetic(int count) {
+    // most traffic around a few hubs, the rest spread out
+    double hubs[][2] = {
+        { 50.0, 8.5 }, { 51.5, -0.4 }, { 40.6, -73.8 }, { 33.9, -118.4 }, { 41.9, -87.9 },
+        { 25.3, 55.4 }, { 35.5, 139.8 }, { 1.4, 104.0 }, { -33.9, 151.2 }, { 48.4, 2.5 },
+        { 39.9, 116.6 }, { 22.3, 114.0 }, { 52.3, 4.8 }, { 43.7, -79.6 }, { 19.4, -99.1 },
+    };
+    int hubCount = sizeof(hubs) / sizeof(hubs[0]);
+
+    list = cmalloc(count * sizeof(struct apiEntry));
+    memset(list, 0, count * sizeof(struct apiEntry));
+    for (int i = 0; i < count; i++) {
+        double lat, lon;
+        if (i % 10 < 7) {
+            double *hub = hubs[random() % hubCount];
+            lat = hub[0] + 3 * gauss();
+            lon = hub[1] + 4 * gauss();
+        } else {
+            lat = -60 + 130.0 * random() / RAND_MAX;
+            lon = -180 + 360.0 * random() / RAND_MAX;
+        }
+        lat = fmax(-89, fmin(89, lat));
+        lon = fmax(-180, fmin(180, lon));
+        list[i].bin.hex = i;
+        list[i].bin.lat = (int32_t) (lat * 1E6);
+        list[i].bin.lon = (int32_t) (lon * 1E6);
+        list[i].bin.position_valid = 1;
+    }
+    len = count;
+}
+
+static int load(char *path) {
+    gzFile gz = gzopen(path, "r");
+    if (!gz) {
+        perror(path);
+        return -1;
+    }
+    size_t alloc = 1024 * 1024;
+    size_t used = 0;
+    char *buf = cmalloc(alloc);
+    int res;
+    while ((res = gzread(gz, buf + used, alloc - used)) > 0) {
+        used += res;
+        if (used == alloc) {
+            alloc *= 2;
+            buf = realloc(buf, alloc);
+        }
+    }
+    gzclose(gz);
+
+    uint32_t elementSize;
+    if (used < 12) {
+        fprintf(stderr, "%s: too short\n", path);
+        return -1;
+    }
+    memcpy(&elementSize, buf + 8, sizeof(elementSize));
+    if (elementSize < 16 || elementSize > 4096) {
+        fprintf(stderr, "%s: bad elementSize %u\n", path, elementSize);
+        return -1;
+    }
+    int count = used / elementSize - 1;
+    list = cmalloc(imax(1, count) * sizeof(struct apiEntry));
+    memset(list, 0, imax(1, count) * sizeof(struct apiEntry));
+    for (int i = 0; i < count; i++) {
+        memcpy(&list[i].bin, buf + (i + 1) * elementSize, imin(elementSize, sizeof(struct binCraft)));
+        if (!list[i].bin.position_valid) {
+            // same as apiAdd, sorts to the end of the list
+            list[i].bin.lat = INT32_MAX;
+            list[i].bin.lon = INT32_MAX;
+        }
+    }
+    len = count;
+    sfree(buf);
+    return 0;
+}
+
+// same lookup as findInBox / findInCircle in api.c, returns the number of matches
+static int query(struct apiGrid *grid, int32_t *candidates, double lat, double lon, double latdiff, double londiff, double radius) {
+    struct range r[2];
+    memset(r, 0, sizeof(r));
+    int32_t lat1 = (int32_t) ((lat - latdiff) * 1E6);
+    int32_t lat2 = (int32_t) ((lat + latdiff) * 1E6);
+    double o1 = lon - londiff;
+    double o2 = lon + londiff;
+    o1 = o1 < -180 ? o1 + 360: o1;
+    o2 = o2 > 180 ? o2 - 360 : o2;
+    int32_t lon1 = (int32_t) (o1 * 1E6);
+    int32_t lon2 = (int32_t) (o2 * 1E6);
+    if (lon1 <= lon2) {
+        r[0] = findLonRange(lon1, lon2, list, len);
+    } else {
+        r[0] = findLonRange(lon1, 180E6, list, len);
+        r[1] = findLonRange(-180E6, lon2, list, len);
+    }
+    int count = 0;
+    for (int k = 0; k < 2; k++) {
+        int n = apiGridFind(grid, list, r[k], lat1, lat2, candidates);
+        if (radius <= 0) {
+            count += n;
+            continue;
+        }
+        for (int i = 0; i < n; i++) {
+            struct apiEntry *e = &list[candidates[i]];
+            if (greatcircle(lat, lon, e->bin.lat / 1E6, e->bin.lon / 1E6, 0) < radius)
+                count++;
+        }
+    }
+    return count;
+}
+
+static void bench(const char *name, struct apiGrid *grid, struct apiGrid *scan, double latdiff, double londiff, double radius) {
+    int64_t *tScan = cmalloc(QUERIES * sizeof(int64_t));
+    int64_t *tGrid = cmalloc(QUERIES * sizeof(int64_t));
+    int32_t *candidates = cmalloc((len + 1) * sizeof(int32_t));
+    int64_t matches = 0;
+
+    srandom(42);
+    for (int q = 0; q < QUERIES; q++) {
+        // center the queries on aircraft so they hit traffic like real queries do
+        struct apiEntry *e = &list[random() % len];
+        if (e->bin.lat == INT32_MAX) {
+            q--;
+            continue;
+        }
+        double lat = e->bin.lat / 1E6;
+        double lon = e->bin.lon / 1E6;
+        double ld = radius > 0 ? radius / 111e3 : latdiff;
+        double od = radius > 0 ? radius / (cos(lat * M_PI / 180.0) * 111e3 + 1) : londiff;
+
+        int64_t start = nanotime();
+        int a = query(scan, candidates, lat, lon, ld, od, radius);
+        int64_t mid = nanotime();
+        int b = query(grid, candidates, lat, lon, ld, od, radius);
+        int64_t end = nanotime();
+        if (a != b) {
+            fprintf(stderr, "%s: result mismatch scan %d grid %d\n", name, a, b);
+            exit(1);
+        }
+        matches += b;
+        tScan[q] = mid - start;
+        tGrid[q] = end - mid;
+    }
+    qsort(tScan, QUERIES, sizeof(int64_t), compareInt64);
+    qsort(tGrid, QUERIES, sizeof(int64_t), compareInt64);
+    fprintf(stderr, "%-24s avg matches %6.1f | scan p50 %7.1f us p99 %7.1f us | grid p50 %7.1f us p99 %7.1f us\n",
+            name, matches / (double) QUERIES,
+            tScan[QUERIES / 2] / 1E3, tScan[QUERIES * 99 / 100] / 1E3,
+            tGrid[QUERIES / 2] / 1E3, tGrid[QUERIES * 99 / 100] / 1E3);
+    sfree(tScan);
+    sfree(tGrid);
+    sfree(candidates);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        if (load(argv[1]) < 0)
+            return 1;
+    } else {
+        synthetic(15000);
+    }
+    if (len < 1) {
+        fprintf(stderr, "no aircraft\n");
+        return 1;
+    }
+    qsort(list, len, sizeof(struct apiEntry), compareLon);
+
+    struct apiGrid grid = { 0 };
+    int64_t start = nanotime();
+    apiGridBuild(&grid, list, len);
+    fprintf(stderr, "%d aircraft, grid column size %d, build %.2f ms\n", len, grid.columnSize, (nanotime() - start) / 1E6);
+
+    // without entries apiGridFind scans the longitude band like before the grid
+    struct apiGrid scan = { 0 };
+
+    bench("box 2x2 deg", &grid, &scan, 1, 1, 0);
+    bench("corridor N-S 30x1 deg", &grid, &scan, 15, 0.5, 0);
+    bench("corridor E-W 1x60 deg", &grid, &scan, 0.5, 30, 0);
+    bench("box 10x10 deg", &grid, &scan, 5, 5, 0);
+    bench("circle 100 km", &grid, &scan, 0, 0, 100e3);
+    bench("circle 500 km", &grid, &scan, 0, 0, 500e3);
+
+    apiGridFree(&grid);
+    sfree(list);
+    return 0;
+}
@@ -2,6 +2,9 @@
 //
 // convert_benchmark.c: benchmarks for IQ sample converters
 //
+// Every converter usable on this CPU is checked bit for bit against the plain C
+// version (magnitudes and means) and then timed.
+//
 // Copyright (c) 2019 Michael Wolf <michael@mictronics.de>
 //
 // This code is based on a detached fork of dump1090-fa.
@@ -24,10 +27,20 @@
 
 #include "../readsb.h"
 
+struct _Modes Modes;
+
+void setExit(int arg) {
+    exit(arg);
+}
+
+#define BUF_SAMPLES (128 * 1024)
+#define BUFFERS (10)
+
 static void **testdata_uc8;
 static void **testdata_sc16;
 static void **testdata_sc16q11;
 static uint16_t *outdata;
+static uint16_t *refdata;
 
 // SC16Q11_TABLE_BITS notes:
 
@@ -60,24 +73,25 @@ static uint16_t *outdata;
 // SC16Q11_TABLE_BITS=8:          5.77M samples/second
 // SC16Q11_TABLE_BITS=7:         10.23M samples/second
 
-void prepare()
+static void prepare()
 {
     srand(1);
 
-    testdata_uc8 = calloc(10, sizeof(void*));
-    testdata_sc16 = calloc(10, sizeof(void*));
-    testdata_sc16q11 = calloc(10, sizeof(void*));
-    outdata = calloc(MODES_MAG_BUF_SAMPLES, sizeof(uint16_t));
+    testdata_uc8 = calloc(BUFFERS, sizeof(void*));
+    testdata_sc16 = calloc(BUFFERS, sizeof(void*));
+    testdata_sc16q11 = calloc(BUFFERS, sizeof(void*));
+    outdata = calloc(BUF_SAMPLES, sizeof(uint16_t));
+    refdata = calloc(BUFFERS * BUF_SAMPLES, sizeof(uint16_t));
 
-    for (int buf = 0; buf < 10; ++buf) {
-        uint8_t *uc8 = calloc(MODES_MAG_BUF_SAMPLES, 2);
-        testdata_uc8[buf] = uc8;;
-        uint16_t *sc16 = calloc(MODES_MAG_BUF_SAMPLES, 4);
+    for (int buf = 0; buf < BUFFERS; ++buf) {
+        uint8_t *uc8 = calloc(BUF_SAMPLES, 2);
+        testdata_uc8[buf] = uc8;
+        uint16_t *sc16 = calloc(BUF_SAMPLES, 4);
         testdata_sc16[buf] = sc16;
-        uint16_t *sc16q11 = calloc(MODES_MAG_BUF_SAMPLES, 4);
+        uint16_t *sc16q11 = calloc(BUF_SAMPLES, 4);
         testdata_sc16q11[buf] = sc16q11;
 
-        for (unsigned i = 0; i < MODES_MAG_BUF_SAMPLES; ++i) {
+        for (unsigned i = 0; i < BUF_SAMPLES; ++i) {
             double I = 2.0 * rand() / (RAND_MAX + 1.0) - 1.0;
             double Q = 2.0 * rand() / (RAND_MAX + 1.0) - 1.0;
 
@@ -89,49 +103,102 @@ void prepare()
 
             sc16q11[i*2] = htole16( (int16_t) (I * 2048.0) );
             sc16q11[i*2+1] = htole16( (int16_t) (Q * 2048.0) );
+
+            // some samples out of range for 12 bits
+            if (i % 16 == 0) {
+                sc16q11[i*2] = htole16( (int16_t) (I * 32768.0) );
+            }
+        }
+    }
+}
+
+// shorter buffers now and then to exercise the scalar handling of the last samples
+static unsigned buffer_samples(int buf) {
+    return BUF_SAMPLES - buf % 8;
+}
+
+// output of the converter for all buffers in a row must match the plain C version exactly,
+// with a DC block the state carries over from buffer to buffer
+static bool check(iq_convert_fn converter, struct converter_state *state, void **data, double *ref_level, double *ref_power, bool reference) {
+    for (int buf = 0; buf < BUFFERS; ++buf) {
+        unsigned samples = buffer_samples(buf);
+        uint16_t *ref = refdata + buf * BUF_SAMPLES;
+        double level, power;
+        converter(data[buf], reference ? ref : outdata, samples, state, &level, &power);
+        if (reference) {
+            ref_level[buf] = level;
+            ref_power[buf] = power;
+            continue;
+        }
+        for (unsigned i = 0; i < samples; ++i) {
+            if (outdata[i] != ref[i]) {
+                fprintf(stderr, "  magnitude mismatch in buffer %d sample %u: %u != %u\n", buf, i, outdata[i], ref[i]);
+                return false;
+            }
+        }
+        if (level != ref_level[buf] || power != ref_power[buf]) {
+            fprintf(stderr, "  mean level / power mismatch in buffer %d\n", buf);
+            return false;
         }
     }
+    return true;
 }
 
-void test(const char *what, input_format_t format, void **data, double sample_rate, bool filter_dc) {
-    fprintf(stderr, "Benchmarking: %s ", what);
+static void test(const char *what, input_format_t format, void **data, double sample_rate, bool filter_dc) {
+    fprintf(stderr, "Benchmarking: %s\n", what);
 
     struct converter_state *state;
-    iq_convert_fn converter = init_converter(format, sample_rate, filter_dc, &state);
-    if (!converter) {
+    const char *description;
+    double ref_level[BUFFERS];
+    double ref_power[BUFFERS];
+
+    // the plain C version is the last one
+    int variants = 0;
+    while (init_converter_variant(format, sample_rate, filter_dc, variants, &description, &state)) {
+        cleanup_converter(&state);
+        variants++;
+    }
+    if (!variants) {
         fprintf(stderr, "Can't initialize converter\n");
         return;
     }
 
-    struct timespec total = { 0, 0 };
-    int iterations = 0;
+    iq_convert_fn reference = init_converter_variant(format, sample_rate, filter_dc, variants - 1, &description, &state);
+    check(reference, state, data, ref_level, ref_power, true);
+    cleanup_converter(&state);
+
+    for (int variant = 0; variant < variants; ++variant) {
+        iq_convert_fn converter = init_converter_variant(format, sample_rate, filter_dc, variant, &description, &state);
+        if (!converter) {
+            fprintf(stderr, "Can't initialize converter\n");
+            exit(1);
+        }
+        if (!check(converter, state, data, ref_level, ref_power, false)) {
+            fprintf(stderr, "  %s: output differs from %s!\n", description, "the plain C version");
+            exit(1);
+        }
 
-    // Run it once to force init.
-    converter(data[0], outdata, MODES_MAG_BUF_SAMPLES, state, NULL, NULL);
+        struct timespec total = { 0, 0 };
+        int iterations = 0;
 
-    while (total.tv_sec < 5) {
-        fprintf(stderr, ".");
+        while (total.tv_sec < 1) {
+            struct timespec start;
+            start_cpu_timing(&start);
 
-        struct timespec start;
-        start_cpu_timing(&start);
+            for (int i = 0; i < BUFFERS; ++i) {
+                converter(data[i], outdata, BUF_SAMPLES, state, NULL, NULL);
+            }
 
-        for (int i = 0; i < 10; ++i) {
-            converter(data[i], outdata, MODES_MAG_BUF_SAMPLES, state, NULL, NULL);
+            end_cpu_timing(&start, &total);
+            iterations++;
         }
 
-        end_cpu_timing(&start, &total);
-        iterations++;
-    }
-
-    fprintf(stderr, "\n");
-    cleanup_converter(&state);
+        cleanup_converter(&state);
 
-    double samples = 10.0 * iterations * MODES_MAG_BUF_SAMPLES;
-    double nanos = total.tv_sec * 1e9 + total.tv_nsec;
-    fprintf(stderr, "  %.2fM samples in %.6f seconds\n",
-            samples / 1e6, nanos / 1e9);
-    fprintf(stderr, "  %.2fM samples/second\n",
-            samples / nanos * 1e3);
+        double samples = (double) BUFFERS * iterations * BUF_SAMPLES;
+        double nanos = total.tv_sec * 1e9 + total.tv_nsec;
+        fprintf(stderr, "  %-32s %8.2fM samples/second\n", description, samples / nanos * 1e3);
+    }
 }
 
 int main(int argc, char **argv)
@@ -149,4 +216,6 @@ int main(int argc, char **argv)
 
     test("SC16, DC", INPUT_SC16, testdata_sc16, 2400000, true);
     test("SC16, no DC", INPUT_SC16, testdata_sc16, 2400000, false);
+
+    return 0;
 }
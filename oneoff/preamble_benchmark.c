@@ -0,0 +1,224 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// preamble_benchmark.c: checks the preamble and Mode A/C mask implementations against each other and times them
+//
+// usage: preamble_benchmark [file.iq]
+//
+// Without an argument random magnitudes are used, otherwise the magnitudes of an
+// unsigned 8 bit IQ file (as recorded by rtl_sdr) at 2.4 MS/s.
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "../readsb.h"
+
+struct _Modes Modes;
+
+void setExit(int arg) {
+    exit(arg);
+}
+
+#define SAMPLES (16 * 1024 * 1024)
+#define PADDING (64)
+#define ROUNDS (5)
+
+static int64_t nanotime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// the pre-check as demodulate2400 did it before the masks, one sample at a time
+static uint64_t scanSequential(uint16_t *m, uint32_t len) {
+    uint64_t candidates = 0;
+    for (uint16_t *pa = m; pa < m + len; pa++) {
+        if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]) {
+            candidates += pa - m;
+        }
+    }
+    return candidates;
+}
+
+// the Mode A/C framing pulse checks as demodulate2400AC did them, one sample at a time
+static uint64_t scanModeacSequential(uint16_t *m, uint32_t len, unsigned noise_level) {
+    uint64_t candidates = 0;
+    for (uint32_t f1 = 1; f1 < len; f1++) {
+        uint16_t *p = m + f1;
+        if (!(p[-1] < p[0]))
+            continue;
+        if (p[2] > p[0] || p[2] > p[1])
+            continue;
+        if (noise_level * 2 > (unsigned) (p[0] + p[1]) / 2)
+            continue;
+        candidates += f1;
+    }
+    return candidates;
+}
+
+static uint64_t scanModeacMask(modeac_mask_fn mask, uint16_t *m, uint32_t len, uint16_t level) {
+    uint64_t candidates = 0;
+    for (uint32_t i = 1; i < len; i += PREAMBLE_MASK_WIDTH) {
+        uint32_t bits = mask(m + i, level);
+        while (bits) {
+            uint32_t k = i + __builtin_ctz(bits);
+            if (k < len) {
+                candidates += k;
+            }
+            bits &= bits - 1;
+        }
+    }
+    return candidates;
+}
+
+// same walk over the candidates as demodulate2400
+static uint64_t scanMask(preamble_mask_fn mask, uint16_t *m, uint32_t len) {
+    uint64_t candidates = 0;
+    for (uint32_t i = 0; i < len; i += PREAMBLE_MASK_WIDTH) {
+        uint32_t bits = mask(m + i);
+        while (bits) {
+            uint32_t k = i + __builtin_ctz(bits);
+            if (k < len) {
+                candidates += k;
+            }
+            bits &= bits - 1;
+        }
+    }
+    return candidates;
+}
+
+static uint32_t loadIQ(char *path, uint16_t *m) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    uint8_t iq[2 * 4096];
+    uint32_t len = 0;
+    size_t n;
+    while (len < SAMPLES && (n = fread(iq, 2, 4096, f)) > 0) {
+        for (size_t k = 0; k < n && len < SAMPLES; k++) {
+            float i = iq[2 * k] - 127.5f;
+            float q = iq[2 * k + 1] - 127.5f;
+            m[len++] = (uint16_t) fminf(65535, sqrtf(i * i + q * q) * 360);
+        }
+    }
+    fclose(f);
+    return len;
+}
+
+int main(int argc, char **argv) {
+    uint16_t *m = cmalloc((SAMPLES + PADDING) * sizeof(uint16_t));
+    memset(m, 0, (SAMPLES + PADDING) * sizeof(uint16_t));
+    uint32_t len;
+    if (argc > 1) {
+        len = loadIQ(argv[1], m);
+    } else {
+        srandom(42);
+        for (uint32_t i = 0; i < SAMPLES; i++) {
+            // include equal values and the full unsigned range
+            m[i] = (i & 1) ? random() & 0xffff : random() & 0x7;
+        }
+        len = SAMPLES;
+    }
+
+    struct preambleMaskImpl impl[8];
+    int count = preambleMaskImplementations(impl, 8);
+    preamble_mask_fn scalar = impl[count - 1].mask;
+
+    // every implementation must produce the same bits at every alignment
+    for (int k = 0; k < count; k++) {
+        for (uint32_t i = 0; i + PREAMBLE_MASK_WIDTH < len; i += 7) {
+            if (impl[k].mask(m + i) != scalar(m + i)) {
+                fprintf(stderr, "%s: mask mismatch at sample %u\n", impl[k].name, i);
+                return 1;
+            }
+        }
+    }
+
+    uint64_t reference = scanSequential(m, len);
+    int64_t best = INT64_MAX;
+    for (int r = 0; r < ROUNDS; r++) {
+        int64_t start = nanotime();
+        if (scanSequential(m, len) != reference) {
+            return 1;
+        }
+        int64_t elapsed = nanotime() - start;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+    fprintf(stderr, "%u samples\n%-12s %6.3f ns/sample\n", len, "sequential", best / (double) len);
+
+    for (int k = 0; k < count; k++) {
+        best = INT64_MAX;
+        for (int r = 0; r < ROUNDS; r++) {
+            int64_t start = nanotime();
+            if (scanMask(impl[k].mask, m, len) != reference) {
+                fprintf(stderr, "%s: candidates differ from the sequential check\n", impl[k].name);
+                return 1;
+            }
+            int64_t elapsed = nanotime() - start;
+            if (elapsed < best) {
+                best = elapsed;
+            }
+        }
+        fprintf(stderr, "%-12s %6.3f ns/sample\n", impl[k].name, best / (double) len);
+    }
+
+    // the level of a quiet receiver, 4 * noise_level must not exceed 65535 for exact masks
+    unsigned noise_level = 2000;
+    uint16_t level = 4 * noise_level;
+    struct modeacMaskImpl acImpl[8];
+    int acCount = modeacMaskImplementations(acImpl, 8);
+    modeac_mask_fn acScalar = acImpl[acCount - 1].mask;
+    for (int k = 0; k < acCount; k++) {
+        for (uint32_t i = 1; i + PREAMBLE_MASK_WIDTH < len; i += 7) {
+            if (acImpl[k].mask(m + i, level) != acScalar(m + i, level)) {
+                fprintf(stderr, "modeac %s: mask mismatch at sample %u\n", acImpl[k].name, i);
+                return 1;
+            }
+        }
+    }
+
+    reference = scanModeacSequential(m, len, noise_level);
+    best = INT64_MAX;
+    for (int r = 0; r < ROUNDS; r++) {
+        int64_t start = nanotime();
+        if (scanModeacSequential(m, len, noise_level) != reference) {
+            return 1;
+        }
+        int64_t elapsed = nanotime() - start;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+    fprintf(stderr, "Mode A/C\n%-12s %6.3f ns/sample\n", "sequential", best / (double) len);
+
+    for (int k = 0; k < acCount; k++) {
+        best = INT64_MAX;
+        for (int r = 0; r < ROUNDS; r++) {
+            int64_t start = nanotime();
+            if (scanModeacMask(acImpl[k].mask, m, len, level) != reference) {
+                fprintf(stderr, "modeac %s: candidates differ from the sequential check\n", acImpl[k].name);
+                return 1;
+            }
+            int64_t elapsed = nanotime() - start;
+            if (elapsed < best) {
+                best = elapsed;
+            }
+        }
+        fprintf(stderr, "%-12s %6.3f ns/sample\n", acImpl[k].name, best / (double) len);
+    }
+    sfree(m);
+    return 0;
+}
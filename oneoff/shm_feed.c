@@ -0,0 +1,109 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// shm_feed.c: plays an IQ file into a shared memory ring for readsb --device-type shm
+//
+// usage: shm_feed <name> <file.iq> [speed]
+//
+// The file holds unsigned 8 bit IQ samples at 2.4 MS/s (as recorded by rtl_sdr), speed is a
+// multiple of real time (default 1). The ring is created, left empty for a second so readers
+// can attach, fed in 10 ms steps, marked finished and unlinked.
+// Also serves as an example writer for the ring layout described in sdr_shm.h.
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "../readsb.h"
+#include "../sdr_shm.h"
+
+struct _Modes Modes;
+
+void setExit(int arg) {
+    exit(arg);
+}
+
+#define SAMPLE_RATE (2400000)
+#define RING_SIZE (16 * 1024 * 1024)
+#define STEP_SAMPLES (SAMPLE_RATE / 100)
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <name> <file.iq> [speed]\n", argv[0]);
+        return 1;
+    }
+    double speed = argc > 3 ? atof(argv[3]) : 1.0;
+    if (speed <= 0) {
+        speed = 1.0;
+    }
+
+    FILE *in = fopen(argv[2], "r");
+    if (!in) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    size_t dataOffset = sysconf(_SC_PAGESIZE);
+    int fd = shm_open(argv[1], O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0 || ftruncate(fd, dataOffset + RING_SIZE) != 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    uint8_t *map = mmap(NULL, dataOffset + RING_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        shm_unlink(argv[1]);
+        return 1;
+    }
+
+    struct shmRingHeader *h = (struct shmRingHeader *) map;
+    uint8_t *ring = map + dataOffset;
+    h->version = SHM_RING_VERSION;
+    h->data_offset = dataOffset;
+    h->data_size = RING_SIZE;
+    h->sample_rate = SAMPLE_RATE;
+    h->frequency = 1090000000;
+    strcpy(h->datatype, "cu8");
+    // readers check the magic first, write it last
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(h->magic, SHM_RING_MAGIC, sizeof(h->magic));
+
+    sleep(1);
+    h->datetime_ns = (int64_t) mstime() * 1000000;
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    uint64_t written = 0;
+    uint8_t buf[2 * STEP_SAMPLES];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        // the step may wrap around the end of the ring
+        size_t at = written % RING_SIZE;
+        size_t first = imin(n, RING_SIZE - at);
+        memcpy(ring + at, buf, first);
+        memcpy(ring, buf + first, n - first);
+        written += n;
+        __atomic_store_n(&h->write_offset, written, __ATOMIC_RELEASE);
+
+        next.tv_nsec += n / 2 * (1e9 / SAMPLE_RATE) / speed;
+        normalize_timespec(&next);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR)
+            ;
+    }
+    fclose(in);
+
+    __atomic_store_n(&h->state, SHM_RING_FINISHED, __ATOMIC_RELEASE);
+    fprintf(stderr, "%llu samples written\n", (unsigned long long) (written / 2));
+    munmap(map, dataOffset + RING_SIZE);
+    shm_unlink(argv[1]);
+    return 0;
+}
@@ -0,0 +1,178 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// slicer_benchmark.c: checks the bit slicer implementations against each other and times them
+//
+// usage: slicer_benchmark [file.iq]
+//
+// Without an argument random magnitudes are used, otherwise the magnitudes of an
+// unsigned 8 bit IQ file (as recorded by rtl_sdr) at 2.4 MS/s.
+// The timed work is what the demodulator does for each preamble candidate: slice the first byte
+// of the phases passing the preamble threshold, then the whole message for those with a known DF.
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "../readsb.h"
+
+struct _Modes Modes;
+
+void setExit(int arg) {
+    exit(arg);
+}
+
+#define SAMPLES (16 * 1024 * 1024)
+#define PADDING (512)
+#define ROUNDS (5)
+#define THRESHOLD (PREAMBLE_THRESHOLD_DEFAULT)
+
+// DF 0, 4, 5, 11, 16, 17, 18, 20, 21
+#define KNOWN_DF ((1 << 0) | (1 << 4) | (1 << 5) | (1 << 11) | (1 << 16) | (1 << 17) | (1 << 18) | (1 << 20) | (1 << 21))
+
+struct candidate {
+    uint32_t pos;
+    uint32_t phases;
+};
+
+static int64_t nanotime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static uint32_t loadIQ(char *path, uint16_t *m) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    uint8_t iq[2 * 4096];
+    uint32_t len = 0;
+    size_t n;
+    while (len < SAMPLES && (n = fread(iq, 2, 4096, f)) > 0) {
+        for (size_t k = 0; k < n && len < SAMPLES; k++) {
+            float i = iq[2 * k] - 127.5f;
+            float q = iq[2 * k + 1] - 127.5f;
+            m[len++] = (uint16_t) fminf(65535, sqrtf(i * i + q * q) * 360);
+        }
+    }
+    fclose(f);
+    return len;
+}
+
+// the pre-check and preamble threshold of demodulate2400, phases as in struct demodCandidate
+static uint32_t candidatePhases(uint16_t *pa) {
+    if (!(pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]))
+        return 0;
+
+    int32_t ref_level = (pa[5] + pa[8] + pa[16] + pa[17] + pa[18]) * THRESHOLD >> 5;
+    int32_t diff_2_3 = pa[2] - pa[3];
+    int32_t sum_1_4 = pa[1] + pa[4];
+    int32_t diff_10_11 = pa[10] - pa[11];
+    int32_t common3456 = sum_1_4 - diff_2_3 + pa[9] + pa[12];
+
+    uint32_t phases = 0;
+    if (common3456 - diff_10_11 >= ref_level)
+        phases |= (1 << 0) | (1 << 1);
+    if (common3456 + diff_10_11 >= ref_level)
+        phases |= (1 << 2) | (1 << 3);
+    if (sum_1_4 + 2 * diff_2_3 + diff_10_11 + pa[12] >= ref_level)
+        phases |= (1 << 4);
+    return phases;
+}
+
+static uint64_t run(slice_fn slice, uint16_t *m, struct candidate *cand, int count) {
+    uint8_t msg[SLICE_PHASES][MODES_LONG_MSG_BYTES];
+    uint64_t check = 0;
+    for (int i = 0; i < count; i++) {
+        uint16_t *pa = m + cand[i].pos;
+        slice(pa, cand[i].phases, 0, 1, msg);
+        uint32_t valid = 0;
+        for (int j = 0; j < SLICE_PHASES; j++) {
+            if ((cand[i].phases & (1 << j)) && (KNOWN_DF & (1 << (msg[j][0] >> 3))))
+                valid |= 1 << j;
+        }
+        if (valid)
+            slice(pa, valid, 1, MODES_LONG_MSG_BYTES, msg);
+        for (int j = 0; j < SLICE_PHASES; j++) {
+            if (valid & (1 << j))
+                check = check * 31 + msg[j][MODES_LONG_MSG_BYTES - 1];
+        }
+    }
+    return check;
+}
+
+int main(int argc, char **argv) {
+    uint16_t *m = cmalloc((SAMPLES + PADDING) * sizeof(uint16_t));
+    memset(m, 0, (SAMPLES + PADDING) * sizeof(uint16_t));
+    uint32_t len;
+    if (argc > 1) {
+        len = loadIQ(argv[1], m);
+    } else {
+        srandom(42);
+        for (uint32_t i = 0; i < SAMPLES; i++) {
+            m[i] = random() & 0xffff;
+        }
+        len = SAMPLES;
+    }
+
+    struct candidate *cand = cmalloc(len * sizeof(struct candidate));
+    int count = 0;
+    uint32_t tried = 0;
+    for (uint32_t i = 0; i < len; i++) {
+        uint32_t phases = candidatePhases(m + i);
+        if (phases) {
+            cand[count++] = (struct candidate) { i, phases };
+            tried += __builtin_popcount(phases);
+        }
+    }
+
+    struct sliceImpl impl[8];
+    int impls = sliceImplementations(impl, 8);
+    slice_fn scalar = impl[impls - 1].slice;
+
+    // every implementation must produce the same bytes for all phases of every candidate
+    for (int k = 0; k < impls; k++) {
+        for (int i = 0; i < count; i++) {
+            uint8_t want[SLICE_PHASES][MODES_LONG_MSG_BYTES];
+            uint8_t got[SLICE_PHASES][MODES_LONG_MSG_BYTES];
+            scalar(m + cand[i].pos, 0x1f, 0, MODES_LONG_MSG_BYTES, want);
+            impl[k].slice(m + cand[i].pos, 0x1f, 0, MODES_LONG_MSG_BYTES, got);
+            if (memcmp(want, got, sizeof(want))) {
+                fprintf(stderr, "%s: bytes differ for the candidate at sample %u\n", impl[k].name, cand[i].pos);
+                return 1;
+            }
+        }
+    }
+
+    fprintf(stderr, "%u samples, %d candidates, %.2f phases per candidate\n", len, count, count ? tried / (double) count : 0.0);
+
+    uint64_t reference = run(scalar, m, cand, count);
+    for (int k = 0; k < impls; k++) {
+        int64_t best = INT64_MAX;
+        for (int r = 0; r < ROUNDS; r++) {
+            int64_t start = nanotime();
+            if (run(impl[k].slice, m, cand, count) != reference) {
+                fprintf(stderr, "%s: messages differ from the scalar slicer\n", impl[k].name);
+                return 1;
+            }
+            int64_t elapsed = nanotime() - start;
+            if (elapsed < best) {
+                best = elapsed;
+            }
+        }
+        fprintf(stderr, "%-12s %7.1f ns/candidate\n", impl[k].name, count ? best / (double) count : 0.0);
+    }
+    sfree(cand);
+    sfree(m);
+    return 0;
+}
@@ -0,0 +1,331 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// trace_benchmark.c: cost of reassembling traces from compressed chunks versus trace length
+//
+// usage: trace_benchmark [sample_dir]
+//
+// Synthetic traces of increasing length are chunked the way compressChunk() does it: a frame per
+// traceChunkPoints points appended to the last chunk until it spans two hours or exceeds 16 KiB.
+// Timed are the reads traceWrite() and the heatmap do: the whole trace (trace_full), the last
+// 4 * TRACE_RECENT_POINTS points (trace_recent) and the points of the last 30 minutes, each
+// once decompressing whole chunks and once seeking to the first frame needed.
+//
+// Then the chunk formats: chunk samples are compressed on their own as compressChunk() does it,
+// with plain zstd and in the columnar format.
+// The samples are synthetic unless sample_dir holds fourState arrays as written by the disabled
+// tracechunk_samples dump in compressChunk(), a day of those makes for a realistic comparison.
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "../readsb.h"
+
+struct _Modes Modes;
+
+void setExit(int arg) {
+    exit(arg);
+}
+
+#define CHUNK_POINTS (4 * 64)
+#define CHUNK_MAX_BYTES (16 * 1024)
+#define CHUNK_DURATION (120 * MINUTES)
+#define ROUNDS (20)
+
+struct trace {
+    stateChunk *chunks;
+    int chunkCount;
+    int len;
+};
+
+static int64_t nanotime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct sample {
+    fourState *fs;
+    int points;
+};
+
+// an aircraft reporting every 2 to 12 seconds, mostly cruising, sometimes turning, climbing or descending
+static fourState *makePoints(int len) {
+    fourState *fs = cmalloc(stateBytes(len));
+    memset(fs, 0, stateBytes(len));
+    int64_t ts = 1700000000000LL + random() % (24 * HOURS);
+    double lat = 30 + random() % 30, lon = -10 + random() % 40, track = random() % 360, alt = 1000 * (random() % 40);
+    double turn = 0, rate = 0, gs = 250 + random() % 250;
+    for (int i = 0; i < len; i++) {
+        struct state *st = getState(fs, i);
+        int64_t elapsed = 2000 + random() % 10000;
+        ts += elapsed;
+        if (random() % 32 == 0) {
+            turn = (random() % 3 - 1) * 1.5;
+            rate = (random() % 3 - 1) * (random() % 3000);
+        }
+        track = fmod(track + turn * elapsed / 1000 + 360, 360);
+        alt = fmax(0, alt + rate * elapsed / 60000);
+        lat += cos(track * M_PI / 180) * gs * elapsed / 3600e3 / 60;
+        lon += sin(track * M_PI / 180) * gs * elapsed / 3600e3 / 60 / cos(lat * M_PI / 180);
+        st->timestamp = ts;
+        st->lat = lat * 1E6;
+        st->lon = lon * 1E6;
+        st->gs = gs * _gs_factor;
+        st->track = track * _track_factor;
+        st->baro_alt = (int) (alt / 25) * 25 * _alt_factor;
+        st->baro_rate = (int) (rate / 64) * 64 * _rate_factor;
+        st->gs_valid = st->track_valid = st->baro_alt_valid = st->baro_rate_valid = 1;
+        struct state_all *all = getStateAll(fs, i);
+        if (all) {
+            memcpy(all->callsign, "DLH123  ", 8);
+            all->squawk = 0x1000;
+        }
+    }
+    return fs;
+}
+
+static void buildTrace(struct trace *t, fourState *fs, int len, ZSTD_CCtx *cctx) {
+    t->chunks = cmalloc((len / CHUNK_POINTS + 1) * sizeof(stateChunk));
+    t->chunkCount = 0;
+    t->len = len;
+    size_t cap = chunkFrameBound(CHUNK_POINTS);
+    unsigned char *frame = cmalloc(cap);
+    for (int i = 0; i + CHUNK_POINTS <= len; i += CHUNK_POINTS) {
+        fourState *src = fs + i / SFOUR;
+        ssize_t size = chunkCompressFrame(cctx, frame, cap, src, CHUNK_POINTS, 2);
+        if (size < 0)
+            exit(1);
+        stateChunk *last = t->chunkCount ? &t->chunks[t->chunkCount - 1] : NULL;
+        int64_t lastTs = getState(src, CHUNK_POINTS - 1)->timestamp;
+        if (last && last->compressed_size <= CHUNK_MAX_BYTES && lastTs - last->firstTimestamp <= CHUNK_DURATION) {
+            unsigned char *grown = cmalloc(last->compressed_size + size);
+            memcpy(grown, last->compressed, last->compressed_size);
+            memcpy(grown + last->compressed_size, frame, size);
+            sfree(last->compressed);
+            last->compressed = grown;
+            last->compressed_size += size;
+            last->numStates += CHUNK_POINTS;
+            last->lastTimestamp = lastTs;
+        } else {
+            stateChunk *c = &t->chunks[t->chunkCount++];
+            c->compressed = cmalloc(size);
+            memcpy(c->compressed, frame, size);
+            c->compressed_size = size;
+            c->numStates = CHUNK_POINTS;
+            c->firstTimestamp = getState(src, 0)->timestamp;
+            c->lastTimestamp = lastTs;
+        }
+    }
+    sfree(frame);
+}
+
+// reassembleTrace() without trace_current, returns the number of points decompressed
+static int reassemble(struct trace *t, int numPoints, int64_t after, int seek, ZSTD_DCtx *dctx, fourState *out) {
+    int first = 0;
+    int len = 0;
+    if (numPoints >= 0) {
+        first = t->chunkCount;
+        for (int k = t->chunkCount - 1; k >= 0 && len < numPoints; k--) {
+            len += t->chunks[k].numStates;
+            first = k;
+        }
+    } else if (after > 0) {
+        first = t->chunkCount;
+        for (int k = t->chunkCount - 1; k >= 0 && after <= t->chunks[k].lastTimestamp; k--) {
+            first = k;
+        }
+    }
+    int skipped = 0;
+    int offset = 0;
+    if (seek && first < t->chunkCount) {
+        int keep = numPoints >= 0 ? numPoints - (len - t->chunks[first].numStates) : -1;
+        skipped = chunkSeek(&t->chunks[first], keep, after, &offset);
+    }
+    fourState *tp = out;
+    int total = 0;
+    for (int k = first; k < t->chunkCount; k++) {
+        int s = (k == first) ? skipped : 0;
+        if (chunkDecompress(dctx, &t->chunks[k], (k == first) ? offset : 0, s, tp) != 0)
+            exit(1);
+        tp += getFourStates(t->chunks[k].numStates - s);
+        total += t->chunks[k].numStates - s;
+    }
+    return total;
+}
+
+static double timeRead(struct trace *t, int numPoints, int64_t after, int seek, ZSTD_DCtx *dctx, fourState *out, int *points) {
+    int64_t best = INT64_MAX;
+    for (int r = 0; r < ROUNDS; r++) {
+        int64_t start = nanotime();
+        *points = reassemble(t, numPoints, after, seek, dctx, out);
+        int64_t elapsed = nanotime() - start;
+        if (elapsed < best)
+            best = elapsed;
+    }
+    return best * 1e-3;
+}
+
+static int loadSamples(char *dir, struct sample *samples, int max) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        perror(dir);
+        exit(1);
+    }
+    int count = 0;
+    struct dirent *ep;
+    while ((ep = readdir(d)) && count < max) {
+        char path[PATH_MAX];
+        snprintf(path, PATH_MAX, "%s/%s", dir, ep->d_name);
+        int fd = open(path, O_RDONLY);
+        if (fd < 0)
+            continue;
+        struct char_buffer cb = readWholeFile(fd, path);
+        close(fd);
+        int points = cb.len / sizeof(fourState) * SFOUR;
+        if (points >= SFOUR) {
+            samples[count++] = (struct sample) { (fourState *) cb.buffer, points };
+        } else {
+            sfree(cb.buffer);
+        }
+    }
+    closedir(d);
+    return count;
+}
+
+// frames of 64 to 256 points like compressChunk() produces them
+static int makeSamples(struct sample *samples, int max) {
+    for (int i = 0; i < max; i++) {
+        int points = alignSFOUR(CHUNK_POINTS / 4 + random() % (CHUNK_POINTS * 3 / 4));
+        samples[i] = (struct sample) { makePoints(points), points };
+    }
+    return max;
+}
+
+// compress / decompress each sample on its own, returns the compressed bytes
+static size_t compressSamples(struct sample *samples, int count, int columnar, ZSTD_CCtx *cctx, ZSTD_DCtx *dctx,
+        double *compressUs, double *decompressUs) {
+    size_t cap = chunkFrameBound(CHUNK_POINTS * 64);
+    unsigned char *frame = cmalloc(cap);
+    fourState *out = cmalloc(stateBytes(CHUNK_POINTS * 64));
+    int64_t bestC = INT64_MAX, bestD = INT64_MAX;
+    size_t bytes = 0;
+    for (int r = 0; r < ROUNDS / 4; r++) {
+        int64_t c = 0, d = 0;
+        bytes = 0;
+        for (int i = 0; i < count; i++) {
+            int points = imin(samples[i].points, CHUNK_POINTS * 64);
+            int64_t start = nanotime();
+            ssize_t size;
+            if (columnar)
+                size = chunkCompressColumnar(cctx, frame, cap, samples[i].fs, points, 2);
+            else
+                size = chunkCompressFrame(cctx, frame, cap, samples[i].fs, points, 2);
+            int64_t mid = nanotime();
+            if (size < 0)
+                exit(1);
+            stateChunk chunk = { frame, size, points, 0, 0 };
+            if (chunkDecompress(dctx, &chunk, 0, 0, out) != 0 || memcmp(out, samples[i].fs, stateBytes(points))) {
+                fprintf(stderr, "sample %d differs after decompression\n", i);
+                exit(1);
+            }
+            d += nanotime() - mid;
+            c += mid - start;
+            bytes += size;
+        }
+        bestC = imin(bestC, c);
+        bestD = imin(bestD, d);
+    }
+    *compressUs = bestC * 1e-3 / count;
+    *decompressUs = bestD * 1e-3 / count;
+    sfree(frame);
+    sfree(out);
+    return bytes;
+}
+
+static void formatComparison(char *dir, ZSTD_CCtx *cctx, ZSTD_DCtx *dctx) {
+    int max = 4000;
+    struct sample *samples = cmalloc(max * sizeof(struct sample));
+    int count = dir ? loadSamples(dir, samples, max) : makeSamples(samples, max);
+    if (count < 20) {
+        fprintf(stderr, "not enough samples\n");
+        exit(1);
+    }
+
+    size_t raw = 0;
+    for (int i = 0; i < count; i++)
+        raw += stateBytes(samples[i].points);
+    double plainC, plainD, colC, colD;
+    size_t plain = compressSamples(samples, count, 0, cctx, dctx, &plainC, &plainD);
+    size_t columnar = compressSamples(samples, count, 1, cctx, dctx, &colC, &colD);
+    fprintf(stderr, "\n%d samples, %zu bytes uncompressed\n", count, raw);
+    fprintf(stderr, "%-10s %9s %6s %14s %16s\n", "", "bytes", "ratio", "compress", "decompress");
+    fprintf(stderr, "%-10s %9zu %6.2f %8.1f us/chunk %8.1f us/chunk\n", "plain", plain, raw / (double) plain, plainC, plainD);
+    fprintf(stderr, "%-10s %9zu %6.2f %8.1f us/chunk %8.1f us/chunk\n", "columnar", columnar, raw / (double) columnar, colC, colD);
+
+    for (int i = 0; i < count; i++)
+        sfree(samples[i].fs);
+    sfree(samples);
+}
+
+int main(int argc, char **argv) {
+    srandom(42);
+    ZSTD_CCtx *cctx = ZSTD_createCCtx();
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    int recent = 4 * TRACE_RECENT_POINTS;
+
+    fprintf(stderr, "%8s %6s %8s | %10s | %-21s | %-21s\n", "points", "chunks", "bytes", "full", "recent whole/seek", "30 min whole/seek");
+    for (int len = 4 * CHUNK_POINTS; len <= 128 * CHUNK_POINTS; len *= 2) {
+        fourState *fs = makePoints(len);
+        struct trace t;
+        buildTrace(&t, fs, len, cctx);
+        size_t bytes = 0;
+        for (int k = 0; k < t.chunkCount; k++)
+            bytes += t.chunks[k].compressed_size;
+
+        fourState *out = cmalloc(stateBytes(len));
+        int points;
+        double full = timeRead(&t, -1, -1, 0, dctx, out, &points);
+        if (points != len || memcmp(out, fs, stateBytes(len))) {
+            fprintf(stderr, "full read differs from the input\n");
+            return 1;
+        }
+        int64_t after = getState(fs, len - 1)->timestamp - 30 * MINUTES;
+        int wholePoints, seekPoints;
+        double recentWhole = timeRead(&t, recent, -1, 0, dctx, out, &wholePoints);
+        double recentSeek = timeRead(&t, recent, -1, 1, dctx, out, &seekPoints);
+        if (seekPoints < recent || memcmp(out, fs + (len - seekPoints) / SFOUR, stateBytes(seekPoints))) {
+            fprintf(stderr, "recent read differs from the input\n");
+            return 1;
+        }
+        double windowWhole = timeRead(&t, -1, after, 0, dctx, out, &wholePoints);
+        double windowSeek = timeRead(&t, -1, after, 1, dctx, out, &seekPoints);
+        if (seekPoints < len && getState(fs, len - seekPoints - 1)->timestamp >= after) {
+            fprintf(stderr, "30 minute read is missing points\n");
+            return 1;
+        }
+        fprintf(stderr, "%8d %6d %8zu | %7.1f us | %7.1f / %7.1f us | %7.1f / %7.1f us\n",
+                len, t.chunkCount, bytes, full, recentWhole, recentSeek, windowWhole, windowSeek);
+
+        for (int k = 0; k < t.chunkCount; k++)
+            sfree(t.chunks[k].compressed);
+        sfree(t.chunks);
+        sfree(out);
+        sfree(fs);
+    }
+
+    formatComparison(argc > 1 ? argv[1] : NULL, cctx, dctx);
+
+    ZSTD_freeCCtx(cctx);
+    ZSTD_freeDCtx(dctx);
+    return 0;
+}
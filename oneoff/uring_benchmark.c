@@ -0,0 +1,172 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// uring_benchmark.c: compares the two ways flushWrites() sends a writer block to its clients
+//
+// usage: uring_benchmark [block bytes]
+//
+// Each round sends one block (default 1200 bytes, about one --net-ro-size flush) to every client
+// of a set of loopback TCP connections: once with one writev() per client as without --net-io-uring,
+// once with uringSendmsgBatch() as with it. The receiving ends are drained between rounds and not timed.
+// Reported per sent message: system calls and CPU time of the sending thread.
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "../readsb.h"
+
+struct _Modes Modes;
+
+void setExit(int arg) {
+    exit(arg);
+}
+
+#define ROUNDS (2000)
+#define MAX_CLIENTS (256)
+
+static int64_t cputime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// connected loopback pairs, send[i] is the sending end as a client fd of readsb, recv[i] the receiving end
+static void connectPairs(int count, int *send, int *recv) {
+    int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(addr);
+    if (listenFd < 0 || bind(listenFd, (struct sockaddr *) &addr, addrLen) || listen(listenFd, MAX_CLIENTS)
+            || getsockname(listenFd, (struct sockaddr *) &addr, &addrLen)) {
+        perror("listen");
+        exit(1);
+    }
+    for (int i = 0; i < count; i++) {
+        recv[i] = socket(AF_INET, SOCK_STREAM, 0);
+        if (recv[i] < 0 || connect(recv[i], (struct sockaddr *) &addr, addrLen)) {
+            perror("connect");
+            exit(1);
+        }
+        send[i] = accept(listenFd, NULL, NULL);
+        if (send[i] < 0) {
+            perror("accept");
+            exit(1);
+        }
+        fcntl(recv[i], F_SETFL, O_NONBLOCK);
+    }
+    close(listenFd);
+}
+
+static void drain(int count, int *recv) {
+    char buf[64 * 1024];
+    for (int i = 0; i < count; i++) {
+        while (read(recv[i], buf, sizeof(buf)) > 0)
+            ;
+    }
+}
+
+static void run(struct uring *u, int count, int len) {
+    int send[MAX_CLIENTS];
+    int recv[MAX_CLIENTS];
+    connectPairs(count, send, recv);
+
+    char *data = cmalloc(len);
+    for (int k = 0; k < len; k++)
+        data[k] = (char) k;
+
+    struct iovec iov[MAX_CLIENTS];
+    struct msghdr msgs[MAX_CLIENTS];
+    int results[MAX_CLIENTS];
+    for (int i = 0; i < count; i++) {
+        iov[i].iov_base = data;
+        iov[i].iov_len = len;
+        memset(&msgs[i], 0, sizeof(struct msghdr));
+        msgs[i].msg_iov = &iov[i];
+        msgs[i].msg_iovlen = 1;
+    }
+
+    int64_t writevCpu = 0;
+    int64_t writevCalls = 0;
+    int64_t uringCpu = 0;
+    int64_t uringCalls = 0;
+    int64_t failed = 0;
+    for (int r = 0; r < ROUNDS; r++) {
+        int64_t start = cputime();
+        for (int i = 0; i < count; i++) {
+            if (writev(send[i], &iov[i], 1) != len)
+                failed++;
+            writevCalls++;
+        }
+        writevCpu += cputime() - start;
+        drain(count, recv);
+
+        if (u) {
+            start = cputime();
+            int res = uringSendmsgBatch(u, send, msgs, results, count);
+            uringCpu += cputime() - start;
+            if (res < 0) {
+                fprintf(stderr, "uringSendmsgBatch: %s\n", strerror(-res));
+                exit(1);
+            }
+            uringCalls += res;
+            for (int i = 0; i < count; i++) {
+                if (results[i] != len)
+                    failed++;
+            }
+            drain(count, recv);
+        }
+    }
+
+    int64_t messages = (int64_t) ROUNDS * count;
+    printf("%4d clients  writev: %5.2f syscalls %6.2f us per message", count,
+            writevCalls / (double) messages, writevCpu / 1e3 / messages);
+    if (u) {
+        printf("   io_uring: %5.3f syscalls %6.2f us per message", uringCalls / (double) messages, uringCpu / 1e3 / messages);
+    }
+    if (failed) {
+        printf("   %lld short sends", (long long) failed);
+    }
+    printf("\n");
+
+    for (int i = 0; i < count; i++) {
+        close(send[i]);
+        close(recv[i]);
+    }
+    sfree(data);
+}
+
+int main(int argc, char **argv) {
+    int len = argc > 1 ? atoi(argv[1]) : 1200;
+    if (len <= 0) {
+        fprintf(stderr, "usage: %s [block bytes]\n", argv[0]);
+        return 1;
+    }
+
+    struct uring ring;
+    struct uring *u = &ring;
+    int res = uringInit(u, URING_ENTRIES);
+    if (res < 0) {
+        fprintf(stderr, "io_uring not available: %s, only timing writev\n", strerror(-res));
+        u = NULL;
+    }
+
+    int counts[] = { 1, 4, 16, 64, 256 };
+    for (unsigned k = 0; k < sizeof(counts) / sizeof(counts[0]); k++) {
+        run(u, counts[k], len);
+    }
+
+    if (u)
+        uringDestroy(u);
+    return 0;
+}
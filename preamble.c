@@ -0,0 +1,225 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// preamble.c: vectorized preamble and Mode A/C framing pulse pre-checks for the 2.4MHz demodulator
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "readsb.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PREAMBLE_X86
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PREAMBLE_NEON
+#endif
+
+// demodulate2400 only scores a possible message start at m[0] if
+//   m[1] > m[7] && m[12] > m[14] && m[12] > m[15]
+// These functions evaluate that for PREAMBLE_MASK_WIDTH consecutive start samples
+// and return the result as a bitmask, bit i for a message starting at m[i].
+// Most samples fail the check, the demodulator only looks at the set bits.
+
+static uint32_t preambleMaskScalar(const uint16_t *m) {
+    uint32_t mask = 0;
+    for (int i = 0; i < PREAMBLE_MASK_WIDTH; i++) {
+        const uint16_t *p = m + i;
+        mask |= (uint32_t) ((p[1] > p[7]) & (p[12] > p[14]) & (p[12] > p[15])) << i;
+    }
+    return mask;
+}
+
+// The Mode A/C demodulator (modeac_frame) only looks at a framing pulse F1 starting at m[0] if
+//   m[-1] < m[0] && m[2] <= m[0] && m[2] <= m[1] && (m[0] + m[1]) / 2 >= 2 * noise_level
+// level is 4 * noise_level, at most 65535. m[0] + m[1] saturates at 65535 in the vector versions,
+// with a clamped level they can set extra bits. The demodulator checks each set bit again.
+static uint32_t modeacMaskScalar(const uint16_t *m, uint16_t level) {
+    uint32_t mask = 0;
+    for (int i = 0; i < PREAMBLE_MASK_WIDTH; i++) {
+        const uint16_t *p = m + i;
+        uint32_t sum = imin(65535, p[0] + p[1]);
+        mask |= (uint32_t) ((p[-1] < p[0]) & (p[2] <= p[0]) & (p[2] <= p[1]) & (sum >= level)) << i;
+    }
+    return mask;
+}
+
+#ifdef PREAMBLE_X86
+// SSE2 only has signed 16 bit compares, flipping the sign bit maps unsigned order to signed order
+// (SSE2 is always there on x86_64, the target attributes are for 32 bit builds)
+__attribute__((target("sse2")))
+static inline __m128i loadBiased(const uint16_t *p) {
+    return _mm_xor_si128(_mm_loadu_si128((const __m128i *) p), _mm_set1_epi16((short) 0x8000));
+}
+
+__attribute__((target("sse2")))
+static uint32_t preambleMaskSSE2(const uint16_t *m) {
+    uint32_t mask = 0;
+    for (int i = 0; i < PREAMBLE_MASK_WIDTH; i += 8) {
+        const uint16_t *p = m + i;
+        __m128i s12 = loadBiased(p + 12);
+        __m128i c = _mm_and_si128(_mm_cmpgt_epi16(loadBiased(p + 1), loadBiased(p + 7)),
+                _mm_and_si128(_mm_cmpgt_epi16(s12, loadBiased(p + 14)), _mm_cmpgt_epi16(s12, loadBiased(p + 15))));
+        // saturating pack to one byte per start sample, then one bit per byte
+        mask |= (uint32_t) _mm_movemask_epi8(_mm_packs_epi16(c, _mm_setzero_si128())) << i;
+    }
+    return mask;
+}
+
+__attribute__((target("sse2")))
+static uint32_t modeacMaskSSE2(const uint16_t *m, uint16_t level) {
+    __m128i bias = _mm_set1_epi16((short) 0x8000);
+    __m128i biasedLevel = _mm_set1_epi16((short) (level ^ 0x8000));
+    uint32_t mask = 0;
+    for (int i = 0; i < PREAMBLE_MASK_WIDTH; i += 8) {
+        const uint16_t *p = m + i;
+        __m128i s0 = loadBiased(p);
+        __m128i s1 = loadBiased(p + 1);
+        __m128i s2 = loadBiased(p + 2);
+        __m128i sum = _mm_xor_si128(_mm_adds_epu16(_mm_loadu_si128((const __m128i *) p), _mm_loadu_si128((const __m128i *) (p + 1))), bias);
+        __m128i reject = _mm_or_si128(_mm_or_si128(_mm_cmpgt_epi16(s2, s0), _mm_cmpgt_epi16(s2, s1)), _mm_cmpgt_epi16(biasedLevel, sum));
+        __m128i c = _mm_andnot_si128(reject, _mm_cmpgt_epi16(s0, loadBiased(p - 1)));
+        mask |= (uint32_t) _mm_movemask_epi8(_mm_packs_epi16(c, _mm_setzero_si128())) << i;
+    }
+    return mask;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i loadBiased256(const uint16_t *p) {
+    return _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) p), _mm256_set1_epi16((short) 0x8000));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i check256(const uint16_t *p) {
+    __m256i s12 = loadBiased256(p + 12);
+    return _mm256_and_si256(_mm256_cmpgt_epi16(loadBiased256(p + 1), loadBiased256(p + 7)),
+            _mm256_and_si256(_mm256_cmpgt_epi16(s12, loadBiased256(p + 14)), _mm256_cmpgt_epi16(s12, loadBiased256(p + 15))));
+}
+
+__attribute__((target("avx2")))
+static uint32_t preambleMaskAVX2(const uint16_t *m) {
+    __m256i lo = check256(m);
+    __m256i hi = check256(m + 16);
+    // the pack works per 128 bit lane, the permute puts the bytes back in sample order
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xd8);
+    return (uint32_t) _mm256_movemask_epi8(packed);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i modeacCheck256(const uint16_t *p, __m256i biasedLevel) {
+    __m256i s0 = loadBiased256(p);
+    __m256i s1 = loadBiased256(p + 1);
+    __m256i s2 = loadBiased256(p + 2);
+    __m256i sum = _mm256_xor_si256(_mm256_adds_epu16(_mm256_loadu_si256((const __m256i *) p), _mm256_loadu_si256((const __m256i *) (p + 1))),
+            _mm256_set1_epi16((short) 0x8000));
+    __m256i reject = _mm256_or_si256(_mm256_or_si256(_mm256_cmpgt_epi16(s2, s0), _mm256_cmpgt_epi16(s2, s1)), _mm256_cmpgt_epi16(biasedLevel, sum));
+    return _mm256_andnot_si256(reject, _mm256_cmpgt_epi16(s0, loadBiased256(p - 1)));
+}
+
+__attribute__((target("avx2")))
+static uint32_t modeacMaskAVX2(const uint16_t *m, uint16_t level) {
+    __m256i biasedLevel = _mm256_set1_epi16((short) (level ^ 0x8000));
+    __m256i lo = modeacCheck256(m, biasedLevel);
+    __m256i hi = modeacCheck256(m + 16, biasedLevel);
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xd8);
+    return (uint32_t) _mm256_movemask_epi8(packed);
+}
+#endif
+
+#ifdef PREAMBLE_NEON
+static uint32_t preambleMaskNEON(const uint16_t *m) {
+    static const uint8_t weights[8] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x8_t w = vld1_u8(weights);
+    uint32_t mask = 0;
+    for (int i = 0; i < PREAMBLE_MASK_WIDTH; i += 8) {
+        const uint16_t *p = m + i;
+        uint16x8_t s12 = vld1q_u16(p + 12);
+        uint16x8_t c = vandq_u16(vcgtq_u16(vld1q_u16(p + 1), vld1q_u16(p + 7)),
+                vandq_u16(vcgtq_u16(s12, vld1q_u16(p + 14)), vcgtq_u16(s12, vld1q_u16(p + 15))));
+        // no movemask on NEON: weight each byte with its bit and add them up pairwise (works on armv7 too)
+        uint8x8_t b = vand_u8(vmovn_u16(c), w);
+        b = vpadd_u8(b, b);
+        b = vpadd_u8(b, b);
+        b = vpadd_u8(b, b);
+        mask |= (uint32_t) vget_lane_u8(b, 0) << i;
+    }
+    return mask;
+}
+#endif
+
+#ifdef PREAMBLE_NEON
+static uint32_t modeacMaskNEON(const uint16_t *m, uint16_t level) {
+    static const uint8_t weights[8] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x8_t w = vld1_u8(weights);
+    uint16x8_t l = vdupq_n_u16(level);
+    uint32_t mask = 0;
+    for (int i = 0; i < PREAMBLE_MASK_WIDTH; i += 8) {
+        const uint16_t *p = m + i;
+        uint16x8_t s0 = vld1q_u16(p);
+        uint16x8_t s1 = vld1q_u16(p + 1);
+        uint16x8_t s2 = vld1q_u16(p + 2);
+        uint16x8_t c = vandq_u16(vandq_u16(vcltq_u16(vld1q_u16(p - 1), s0), vcgeq_u16(vqaddq_u16(s0, s1), l)),
+                vandq_u16(vcleq_u16(s2, s0), vcleq_u16(s2, s1)));
+        uint8x8_t b = vand_u8(vmovn_u16(c), w);
+        b = vpadd_u8(b, b);
+        b = vpadd_u8(b, b);
+        b = vpadd_u8(b, b);
+        mask |= (uint32_t) vget_lane_u8(b, 0) << i;
+    }
+    return mask;
+}
+#endif
+
+int preambleMaskImplementations(struct preambleMaskImpl *out, int max) {
+    int n = 0;
+#ifdef PREAMBLE_X86
+    __builtin_cpu_init();
+    if (n < max && __builtin_cpu_supports("avx2")) {
+        out[n++] = (struct preambleMaskImpl) { "avx2", preambleMaskAVX2 };
+    }
+    if (n < max && __builtin_cpu_supports("sse2")) {
+        out[n++] = (struct preambleMaskImpl) { "sse2", preambleMaskSSE2 };
+    }
+#endif
+#ifdef PREAMBLE_NEON
+    if (n < max) {
+        out[n++] = (struct preambleMaskImpl) { "neon", preambleMaskNEON };
+    }
+#endif
+    if (n < max) {
+        out[n++] = (struct preambleMaskImpl) { "scalar", preambleMaskScalar };
+    }
+    return n;
+}
+
+int modeacMaskImplementations(struct modeacMaskImpl *out, int max) {
+    int n = 0;
+#ifdef PREAMBLE_X86
+    __builtin_cpu_init();
+    if (n < max && __builtin_cpu_supports("avx2")) {
+        out[n++] = (struct modeacMaskImpl) { "avx2", modeacMaskAVX2 };
+    }
+    if (n < max && __builtin_cpu_supports("sse2")) {
+        out[n++] = (struct modeacMaskImpl) { "sse2", modeacMaskSSE2 };
+    }
+#endif
+#ifdef PREAMBLE_NEON
+    if (n < max) {
+        out[n++] = (struct modeacMaskImpl) { "neon", modeacMaskNEON };
+    }
+#endif
+    if (n < max) {
+        out[n++] = (struct modeacMaskImpl) { "scalar", modeacMaskScalar };
+    }
+    return n;
+}
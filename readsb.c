@@ -154,6 +154,7 @@ static void configSetDefaults(void) {
     Modes.netIngest = 0;
     Modes.uuidFile = strdup("/usr/local/share/adsbexchange/adsbx-uuid");
     Modes.json_trace_interval = 20 * 1000;
+    Modes.write_threads = 2;
     Modes.state_write_interval = 1 * HOURS;
     Modes.heatmap_current_interval = -15;
     Modes.heatmap_interval = 60 * SECONDS;
@@ -169,6 +170,7 @@ static void configSetDefaults(void) {
     Modes.state_chunk_size_read = Modes.state_chunk_size;
 
     Modes.decodeThreads = 1;
+    Modes.demodThreads = 0;
 
     Modes.filterDF = 0;
     Modes.filterDFbitset = 0;
@@ -246,6 +248,7 @@ static void modesInit(void) {
 
     pthread_mutex_init(&Modes.traceDebugMutex, NULL);
     pthread_mutex_init(&Modes.hungTimerMutex, NULL);
+    pthread_mutex_init(&Modes.trackSharedLock, NULL);
 
     threadInit(&Threads.reader, "reader");
     threadInit(&Threads.upkeep, "upkeep");
@@ -266,9 +269,6 @@ static void modesInit(void) {
     Modes.allTasks = allocate_task_group(2 * Modes.allPoolSize);
     Modes.allPool = threadpool_create(Modes.allPoolSize, 4);
 
-    for (int i = 0; i <= GLOBE_MAX_INDEX; i++) {
-        ca_init(&Modes.globeLists[i]);
-    }
     ca_init(&Modes.aircraftActive);
 
     geomag_init();
@@ -302,7 +302,7 @@ static void modesInit(void) {
 
     init_globe_index();
 
-    quickInit();
+    aircraftIndexInit(&Modes.aircraftIndex);
 }
 
 static void lockThreads() {
@@ -517,6 +517,14 @@ static void *readerEntryPoint(void *arg) {
     return NULL;
 }
 
+// the globe files begin with a header holding the time, aircraft and message counts,
+// only the aircraft after it decide whether the file changed
+static int globeUnchanged(const char *file, struct char_buffer cb, size_t headerLen) {
+    if (cb.len < headerLen)
+        return 0;
+    return fileWriterUnchanged(Modes.json_dir, file, cb.buffer + headerLen, cb.len - headerLen, FILE_UNCHANGED_GLOBE_AGE);
+}
+
 static void *jsonEntryPoint(void *arg) {
     MODES_NOTUSED(arg);
     srandom(get_seed());
@@ -585,10 +593,12 @@ static void *jsonEntryPoint(void *arg) {
 
         if (Modes.json_globe_index) {
             struct char_buffer cb2 = generateGlobeBin(-1, 1, &pass_buffer);
-            if (Modes.enableBinGz) {
+            if (Modes.enableBinGz && !globeUnchanged("globeMil_42777.binCraft", cb2, sizeof(struct binCraft))) {
                 writeJsonToGzip(Modes.json_dir, "globeMil_42777.binCraft", cb2, 1);
             }
-            writeJsonToFile(Modes.json_dir, "globeMil_42777.binCraft.zst", ident(generateZstd(cctx, &zstd_buffer, cb2, 1)));
+            if (!globeUnchanged("globeMil_42777.binCraft.zst", cb2, sizeof(struct binCraft))) {
+                writeJsonToFile(Modes.json_dir, "globeMil_42777.binCraft.zst", ident(generateZstd(cctx, &zstd_buffer, cb2, 1)));
+            }
         }
 
         end_cpu_timing(&start_time, &Modes.stats_current.aircraft_json_cpu);
@@ -629,6 +639,9 @@ static void *globeJsonEntryPoint(void *arg) {
             char filename[32];
             snprintf(filename, 31, "globe_%04d.json", index);
             struct char_buffer cb = apiGenerateGlobeJson(index, &pass_buffer);
+            char *aircraft = memmem(cb.buffer, cb.len, "\"aircraft\" : [", 14);
+            if (aircraft && globeUnchanged(filename, cb, aircraft - cb.buffer))
+                continue;
             writeJsonToGzip(Modes.json_dir, filename, cb, 1);
         }
 
@@ -676,23 +689,28 @@ static void *globeBinEntryPoint(void *arg) {
 
             struct char_buffer cb2 = generateGlobeBin(index, 0, &pass_buffer);
 
+            // each file has its own hash, a failed write of one doesn't hold back the other
             if (Modes.enableBinGz) {
                 snprintf(filename, 31, "globe_%04d.binCraft", index);
-                writeJsonToGzip(Modes.json_dir, filename, cb2, 1);
+                if (!globeUnchanged(filename, cb2, sizeof(struct binCraft)))
+                    writeJsonToGzip(Modes.json_dir, filename, cb2, 1);
             }
 
             snprintf(filename, 31, "globe_%04d.binCraft.zst", index);
-            writeJsonToFile(Modes.json_dir, filename, ident(generateZstd(cctx, &zstd_buffer, cb2, 1)));
+            if (!globeUnchanged(filename, cb2, sizeof(struct binCraft)))
+                writeJsonToFile(Modes.json_dir, filename, ident(generateZstd(cctx, &zstd_buffer, cb2, 1)));
 
             struct char_buffer cb3 = generateGlobeBin(index, 1, &pass_buffer);
 
             if (Modes.enableBinGz) {
                 snprintf(filename, 31, "globeMil_%04d.binCraft", index);
-                writeJsonToGzip(Modes.json_dir, filename, cb3, 1);
+                if (!globeUnchanged(filename, cb3, sizeof(struct binCraft)))
+                    writeJsonToGzip(Modes.json_dir, filename, cb3, 1);
             }
 
             snprintf(filename, 31, "globeMil_%04d.binCraft.zst", index);
-            writeJsonToFile(Modes.json_dir, filename, ident(generateZstd(cctx, &zstd_buffer, cb3, 1)));
+            if (!globeUnchanged(filename, cb3, sizeof(struct binCraft)))
+                writeJsonToFile(Modes.json_dir, filename, ident(generateZstd(cctx, &zstd_buffer, cb3, 1)));
         }
 
         part++;
@@ -809,43 +827,28 @@ static void *decodeEntryPoint(void *arg) {
         while (!Modes.exit) {
             struct timespec start_time;
 
-            lockReader();
-            // reader is locked, and possibly we have data.
             // copy out reader CPU time and reset it
-            add_timespecs(&Modes.reader_cpu_accumulator, &Modes.stats_current.reader_cpu, &Modes.stats_current.reader_cpu);
-            Modes.reader_cpu_accumulator.tv_sec = 0;
-            Modes.reader_cpu_accumulator.tv_nsec = 0;
-
-            struct mag_buf *buf = NULL;
-            if (Modes.first_free_buffer != Modes.first_filled_buffer) {
-                // FIFO is not empty, process one buffer.
-                buf = &Modes.mag_buffers[Modes.first_filled_buffer];
-            } else {
-                buf = NULL;
-            }
-            unlockReader();
+            fifoReaderCpu(&Modes.stats_current.reader_cpu);
+
+            // oldest unprocessed buffer, NULL if the FIFO is empty
+            struct mag_buf *buf = fifoPeek();
 
             if (buf) {
+                fifoDemodStart(buf);
                 start_cpu_timing(&start_time);
                 demodulate2400(buf);
-                if (Modes.mode_ac) {
-                    demodulate2400AC(buf);
-                }
 
                 Modes.stats_current.samples_processed += buf->length;
                 Modes.stats_current.samples_dropped += buf->dropped;
                 end_cpu_timing(&start_time, &Modes.stats_current.demod_cpu);
 
-                // Mark the buffer we just processed as completed.
-                lockReader();
-                Modes.first_filled_buffer = (Modes.first_filled_buffer + 1) % MODES_MAG_BUFFERS;
-                pthread_cond_signal(&Threads.reader.cond);
-                unlockReader();
-
                 Modes.stats_current.samples_lost += Modes.sdr_buf_samples - buf->length;
 
                 timingStatistics(buf);
 
+                // Mark the buffer we just processed as completed.
+                fifoRelease();
+
                 watchdogCounter = 100; // roughly 10 seconds
             } else {
                 // Nothing to process this time around.
@@ -860,16 +863,15 @@ static void *decodeEntryPoint(void *arg) {
             backgroundTasks(now);
             end_cpu_timing(&start_time, &Modes.stats_current.background_cpu);
 
-            lockReader();
-            int newData = (Modes.first_free_buffer != Modes.first_filled_buffer);
-            unlockReader();
-
-            if (!newData) {
+            if (!fifoPeek()) {
                 /* wait for more data.
                  * we should be getting data every 50-60ms. wait for max 80 before we give up and do some background work.
                  * this is fairly aggressive as all our network I/O runs out of the background work!
+                 * the reader wakes us as soon as it pushes a buffer.
                  */
-                threadTimedWait(&Threads.decode, &ts, 80);
+                pthread_mutex_unlock(&Threads.decode.mutex);
+                fifoWaitData(80);
+                pthread_mutex_lock(&Threads.decode.mutex);
             }
             mono = mono_milli_seconds();
             // if removeStale is late by REMOVE_STALE_INTERVAL, force it to run
@@ -898,7 +900,7 @@ static void traceWriteTask(void *arg, threadpool_threadbuffers_t *buffer_group)
     // increment info->from to mark this part of the task as finshed
     for (int j = info->from; j < info->to; j++, info->from++) {
         for (a = Modes.aircraft[j]; a; a = a->next) {
-            if (Modes.triggerPastDayTraceWrite && !a->initialTraceWriteDone) {
+            if (Modes.triggerPastDayTraceWrite && !a->cold->initialTraceWriteDone) {
                 a->trace_writeCounter = 0xc0ffee;
                 a->trace_write |= WRECENT;
                 a->trace_write |= WMEM;
@@ -909,7 +911,7 @@ static void traceWriteTask(void *arg, threadpool_threadbuffers_t *buffer_group)
                     return;
                 }
                 traceWrite(a, buffer_group);
-                a->initialTraceWriteDone = 1;
+                a->cold->initialTraceWriteDone = 1;
                 int64_t elapsed = mono_milli_seconds() - before;
                 if (elapsed > 4 * SECONDS) {
                     fprintf(stderr, "<3>traceWrite() for %06x took %.1f s!\n", a->addr, elapsed / 1000.0);
@@ -1252,17 +1254,15 @@ static void cleanup_and_exit(int code) {
     for (i = 0; i < MODES_MAG_BUFFERS; ++i) {
         sfree(Modes.mag_buffers[i].data);
     }
+    demodulate2400Cleanup();
     crcCleanupTables();
 
     receiverCleanup();
 
-    for (int i = 0; i <= GLOBE_MAX_INDEX; i++) {
-        ca_destroy(&Modes.globeLists[i]);
-    }
     ca_destroy(&Modes.aircraftActive);
 
     icaoFilterDestroy();
-    quickDestroy();
+    aircraftIndexDestroy(&Modes.aircraftIndex);
 
     exit(code);
 }
@@ -1423,6 +1423,9 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
         case OptPreambleThreshold:
             Modes.preambleThreshold = (uint32_t) (imax(imin(strtoll(arg, NULL, 10), PREAMBLE_THRESHOLD_MAX), PREAMBLE_THRESHOLD_MIN));
             break;
+        case OptDemodNoiseFloor:
+            Modes.demodNoiseFloor = 1;
+            break;
         case OptNet:
             Modes.net = 1;
             break;
@@ -1619,6 +1622,15 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
         case OptJsonTraceHistOnly:
             Modes.trace_hist_only = (int8_t) atoi(arg);
             break;
+        case OptWriteThreads:
+            Modes.write_threads = imax(0, atoi(arg));
+            break;
+        case OptWriteUnchanged:
+            Modes.write_unchanged = 1;
+            break;
+        case OptTraceColumnar:
+            Modes.trace_columnar = 1;
+            break;
         case OptJsonTraceInt:
             Modes.json_trace_interval = (int64_t)(1000 * atof(arg));
             break;
@@ -1737,6 +1749,9 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
         case OptNetBuffer:
             Modes.net_sndbuf_size = atoi(arg);
             break;
+        case OptNetIoUring:
+            Modes.net_io_uring = 1;
+            break;
         case OptNetVerbatim:
             Modes.net_verbatim = 1;
             break;
@@ -1756,6 +1771,9 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
         case OptDecodeThreads:
             Modes.decodeThreads = imax(1, atoi(arg));
             break;
+        case OptDemodThreads:
+            Modes.demodThreads = imax(1, imin(16, atoi(arg)));
+            break;
         case OptNetIngest:
             Modes.netIngest = 1;
             break;
@@ -1955,6 +1973,8 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
         case OptIfileName:
         case OptIfileFormat:
         case OptIfileThrottle:
+        case OptIfileFast:
+        case OptShmName:
 #ifdef ENABLE_BLADERF
         case OptBladeFpgaDir:
         case OptBladeDecim:
@@ -2546,6 +2566,7 @@ int main(int argc, char **argv) {
     if (argc >= 2 && !strcmp(argv[1], "--structs")) {
         fprintf(stderr, VERSION_STRING"\n");
         fprintf(stderr, "struct aircraft: %zu\n", sizeof(struct aircraft));
+        fprintf(stderr, "struct aircraftCold: %zu\n", sizeof(struct aircraftCold));
         fprintf(stderr, "struct validity: %zu\n", sizeof(data_validity));
         fprintf(stderr, "state: %zu\n", sizeof(struct state));
         fprintf(stderr, "state_all: %zu\n", sizeof(struct state_all));
@@ -2618,6 +2639,10 @@ int main(int argc, char **argv) {
         fprintf(stderr, "Unable to create globe history directory (%s): %s\n", Modes.globe_history_dir, strerror(errno));
     }
 
+    if (Modes.json_dir || Modes.globe_history_dir || Modes.prom_file) {
+        fileWriterInit(Modes.write_threads);
+    }
+
     checkNewDay(mstime());
     checkNewDayAcas(mstime());
 
@@ -2637,8 +2662,8 @@ int main(int argc, char **argv) {
 
     threadCreate(&Threads.misc, NULL, miscEntryPoint, NULL);
 
-    if (Modes.api || (Modes.json_dir && Modes.onlyBin < 2)) {
-        // provide a json buffer
+    if (Modes.api || Modes.json_dir) {
+        // provide a json buffer, also the snapshot the binCraft files are written from
         Modes.apiUpdate = 1;
         apiBufferInit();
         if (Modes.api) {
@@ -2737,13 +2762,6 @@ int main(int argc, char **argv) {
     close(mainEpfd);
     sfree(events);
 
-    if (Modes.json_dir) {
-        // mark this instance as deactivated, webinterface won't load
-        char pathbuf[PATH_MAX];
-        snprintf(pathbuf, PATH_MAX, "%s/receiver.json", Modes.json_dir);
-        unlink(pathbuf);
-    }
-
     threadSignalJoin(&Threads.misc);
 
     if (Modes.sdr_type != SDR_NONE) {
@@ -2783,8 +2801,20 @@ int main(int argc, char **argv) {
 
     threadDestroyAll();
 
+    // files queued by the threads above land before exiting
+    fileWriterCleanup();
+
+    if (Modes.json_dir) {
+        // mark this instance as deactivated, webinterface won't load
+        // after fileWriterCleanup(), a receiver.json write still queued would bring it back
+        char pathbuf[PATH_MAX];
+        snprintf(pathbuf, PATH_MAX, "%s/receiver.json", Modes.json_dir);
+        unlink(pathbuf);
+    }
+
     pthread_mutex_destroy(&Modes.traceDebugMutex);
     pthread_mutex_destroy(&Modes.hungTimerMutex);
+    pthread_mutex_destroy(&Modes.trackSharedLock);
 
     if (Modes.debug_bogus) {
         display_total_short_range_stats();
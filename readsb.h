@@ -102,6 +102,7 @@
 #include <stdatomic.h>
 #include <zstd.h>
 #include <sys/mman.h>
+#include <sys/uio.h>
 
 
 #include "compat/compat.h"
@@ -318,6 +319,7 @@ typedef enum {
 #define DB_BUCKETS (1 << DB_HASH_BITS) // this is critical for hashing purposes
 
 #define STATE_BLOBS 256 // change naming scheme if increasing this
+#define TRACK_SHARDS 32 // aircraft state partitions for --decode-threads > 1, needs to be a power of 2
 #define LOCK_THREADS_MAX 64
 #define PERIODIC_UPDATE (1 * SECONDS)
 #define REMOVE_STALE_INTERVAL (1 * SECONDS)
@@ -333,6 +335,9 @@ typedef enum {
 #define PING_BUCKETBASE (24) // milliseconds of first bucket
 #define PING_BUCKETMULT (1.2) // each bucket will grow by that factor
 
+#define FIFO_LATENCY_BUCKETS 16 // statistics on magnitude buffer queue latency
+#define FIFO_LATENCY_BASE_US (64LL) // upper bound of the first bucket in microseconds, doubles with each bucket
+
 #define PING_REDUCE (1500) // 1.5 seconds
 #define PING_REDUCE_DURATION (15 * SECONDS)
 
@@ -423,6 +428,7 @@ static inline void *malloc_or_exit(size_t alignment, size_t size, const char *fi
 #include "util.h"
 #include "fasthash.h"
 #include "anet.h"
+#include "uring.h"
 #include "net_io.h"
 #include "crc.h"
 #include "demod_2400.h"
@@ -442,7 +448,7 @@ static inline void *malloc_or_exit(size_t alignment, size_t size, const char *fi
 
 typedef enum
 {
-    SDR_NONE = 0, SDR_IFILE, SDR_RTLSDR, SDR_BLADERF, SDR_MICROBLADERF, SDR_HACKRF, SDR_MODESBEAST, SDR_PLUTOSDR, SDR_SOAPYSDR, SDR_GNS
+    SDR_NONE = 0, SDR_IFILE, SDR_RTLSDR, SDR_BLADERF, SDR_MICROBLADERF, SDR_HACKRF, SDR_MODESBEAST, SDR_PLUTOSDR, SDR_SOAPYSDR, SDR_GNS, SDR_SHM
 } sdr_type_t;
 
 // Structure representing one magnitude buffer
@@ -456,6 +462,7 @@ struct mag_buf
     unsigned length; // Number of valid samples _after_ overlap. Total buffer length is buf->length + Modes.trailing_samples.
     int64_t sysTimestamp; // Estimated system time at start of block
     int64_t sysMicroseconds; // sysTimestamp in microseconds
+    int64_t pushMicroseconds; // monotonic time the reader handed this block to the decode thread
     uint16_t *data; // Magnitude data. Starts with Modes.trailing_samples worth of overlap from the previous block
 #if defined(__arm__)
     /*padding 4 bytes*/
@@ -487,6 +494,9 @@ struct messageBuffer {
     int alloc;
     int id;
     struct client *activeClient;
+    uint16_t *shardOrder; // message indexes sorted by track shard
+    uint32_t messageRateAcc; // messages counted by the track shards, merged into Modes.messageRateAcc
+    struct stats trackStats; // counted by the track shards, merged into Modes.stats_current
 };
 
 struct _Modes
@@ -517,8 +527,8 @@ struct _Modes
     char *currentTask;
     int64_t joinTimeout;
 
-    unsigned first_free_buffer; // Entry in mag_buffers that will next be filled with input.
-    unsigned first_filled_buffer; // Entry in mag_buffers that has valid data and will be demodulated next. If equal to next_free_buffer, there is no unprocessed data.
+    atomic_uint first_free_buffer; // Entry in mag_buffers that will next be filled with input. Only written by the reader.
+    atomic_uint first_filled_buffer; // Entry in mag_buffers that has valid data and will be demodulated next. If equal to next_free_buffer, there is no unprocessed data. Only written by the decode thread.
     unsigned trailing_samples; // extra trailing samples in magnitude buffers
     int volatile exit; // Exit from the main loop when true
     int volatile exitSoon;
@@ -545,11 +555,15 @@ struct _Modes
     struct epoll_event *net_events;
 
     struct messageBuffer *netMessageBuffer;
+    int demodThreads; // --demod-threads, threads splitting up each magnitude buffer, 0: not set (1, or one per CPU with --ifile-fast)
+    threadpool_t *demodPool;
+    task_group_t *demodTasks;
     int decodeThreads;
     threadpool_t *decodePool;
     task_group_t *decodeTasks;
     pthread_mutex_t decodeLock;
-    pthread_mutex_t trackLock;
+    pthread_mutex_t trackShardLock[TRACK_SHARDS]; // aircraft are owned by the shard of their aircraft hash
+    pthread_mutex_t trackSharedLock; // receiver table, range outline, aircraft creation
     pthread_mutex_t outputLock;
 
     int max_fds;
@@ -566,8 +580,8 @@ struct _Modes
     ssize_t volatile state_chunk_size;
     ssize_t volatile state_chunk_size_read;
 
-    ALIGNED struct aircraft * aircraft[AIRCRAFT_BUCKETS];
-    ALIGNED struct craftArray globeLists[GLOBE_MAX_INDEX+1];
+    ALIGNED struct aircraft * aircraft[AIRCRAFT_BUCKETS]; // owns the aircraft, used for iteration
+    struct aircraftIndex aircraftIndex; // lookups by address
     int receiver_table_hash_bits;
     int receiver_table_size;
     struct receiver **receiverTable;
@@ -719,6 +733,7 @@ struct _Modes
     uint64_t receiver_focus;
 
     uint32_t preambleThreshold;
+    int8_t demodNoiseFloor; // --demod-noise-floor, see noise_floor() in demod_2400.c
     int net_output_flush_size; // Minimum Size of output data
     int32_t net_output_beast_reduce_interval; // Position update interval for data reduction
     int32_t ping_reduce;
@@ -811,9 +826,14 @@ struct _Modes
     struct client *serial_client;
 
     int net_sndbuf_size; // TCP output buffer size (64Kb * 2^n)
+    int8_t net_io_uring; // batch the output sends using io_uring
+    struct uring *netUring; // NULL if io_uring isn't used / available
     int json_aircraft_history_next;
     int json_aircraft_history_full;
     int trace_hist_only;
+    int8_t trace_columnar; // write trace chunk frames in the columnar format
+    int write_threads; // threads writing the json, trace and globe files, 0: the calling thread writes
+    int8_t write_unchanged; // don't skip trace and globe files whose content didn't change
     int sbsOverrideSquawk;
     float messageRateMult;
     uint32_t binCraftVersion; // never change the type for this variable
@@ -828,7 +848,7 @@ struct _Modes
     int8_t updateStats;
     int8_t staleStop;
 
-    struct timespec reader_cpu_accumulator; // CPU time used by the reader thread, copied out and reset by the main thread under the mutex
+    atomic_int_fast64_t reader_cpu_ns; // CPU time used by the reader thread, copied out and reset by the decode thread
     ALIGNED struct mag_buf mag_buffers[MODES_MAG_BUFFERS]; // Converted magnitude buffers from RTL or file input
 
     int64_t startup_time;
@@ -1129,6 +1149,7 @@ enum {
     OptInteractiveTTL,
     OptRaw,
     OptPreambleThreshold,
+    OptDemodNoiseFloor,
     OptModeAc,
     OptModeAcAuto,
     OptForwardMlat,
@@ -1180,6 +1201,9 @@ enum {
     OptJsonGlobeIndex,
     OptJsonTraceInt,
     OptJsonTraceHistOnly,
+    OptTraceColumnar,
+    OptWriteThreads,
+    OptWriteUnchanged,
     OptDcFilter,
     OptBiasTee,
     OptNet,
@@ -1216,6 +1240,7 @@ enum {
     OptNetConnectorDelay,
     OptNetHeartbeat,
     OptNetBuffer,
+    OptNetIoUring,
     OptNetVerbatim,
     OptNetReceiverId,
     OptNetReceiverIdJson,
@@ -1223,6 +1248,7 @@ enum {
     OptSdrBufSize,
     OptGarbage,
     OptDecodeThreads,
+    OptDemodThreads,
     OptUuidFile,
     OptRtlSdrEnableAgc,
     OptRtlSdrPpm,
@@ -1237,6 +1263,8 @@ enum {
     OptIfileName,
     OptIfileFormat,
     OptIfileThrottle,
+    OptIfileFast,
+    OptShmName,
     OptBladeFpgaDir,
     OptBladeDecim,
     OptBladeBw,
@@ -1253,6 +1281,8 @@ enum {
 
 // This one needs modesMessage:
 #include "track.h"
+#include "trace_chunk.h"
+#include "file_writer.h"
 #include "mode_s.h"
 #include "comm_b.h"
 
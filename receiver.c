@@ -111,7 +111,20 @@ void receiverCleanup() {
     }
     sfree(Modes.receiverTable);
 }
+static int receiverPositionReceivedLocked(struct aircraft *a, struct modesMessage *mm, double lat, double lon, int64_t now);
+
+// the receiver table is shared between the track shards when using multiple decode threads
 int receiverPositionReceived(struct aircraft *a, struct modesMessage *mm, double lat, double lon, int64_t now) {
+    if (Modes.decodeThreads > 1) {
+        pthread_mutex_lock(&Modes.trackSharedLock);
+        int res = receiverPositionReceivedLocked(a, mm, lat, lon, now);
+        pthread_mutex_unlock(&Modes.trackSharedLock);
+        return res;
+    }
+    return receiverPositionReceivedLocked(a, mm, lat, lon, now);
+}
+
+static int receiverPositionReceivedLocked(struct aircraft *a, struct modesMessage *mm, double lat, double lon, int64_t now) {
     uint64_t id = mm->receiverId;
     if (id == 0 || lat > 85.0 || lat < -85.0 || lon < -179.9 || lon > 179.9) {
         return RECEIVER_RANGE_UNCLEAR;
@@ -282,7 +295,19 @@ int receiverCheckBad(uint64_t id, int64_t now) {
         return 0;
 }
 
+static struct receiver *receiverBadLocked(uint64_t id, uint32_t addr, int64_t now);
+
 struct receiver *receiverBad(uint64_t id, uint32_t addr, int64_t now) {
+    if (Modes.decodeThreads > 1) {
+        pthread_mutex_lock(&Modes.trackSharedLock);
+        struct receiver *r = receiverBadLocked(id, addr, now);
+        pthread_mutex_unlock(&Modes.trackSharedLock);
+        return r;
+    }
+    return receiverBadLocked(id, addr, now);
+}
+
+static struct receiver *receiverBadLocked(uint64_t id, uint32_t addr, int64_t now) {
     if (!Modes.receiverTable) {
         return NULL;
     }
@@ -24,7 +24,11 @@
 
 #include "readsb.h"
 
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
 #include "sdr_ifile.h"
+#include "sdr_shm.h"
 #ifdef ENABLE_RTLSDR
 #include "sdr_rtlsdr.h"
 #endif
@@ -112,6 +116,7 @@ static sdr_handler sdr_handlers[] = {
     { beastInitConfig, beastHandleOption, beastOpen, noRun, noCancel, noClose, "modesbeast", SDR_MODESBEAST, 0},
     { beastInitConfig, beastHandleOption, beastOpen, noRun, noCancel, noClose, "gnshulc", SDR_GNS, 0},
     { ifileInitConfig, ifileHandleOption, ifileOpen, ifileRun, noCancel, ifileClose, "ifile", SDR_IFILE, 0},
+    { shmInitConfig, shmHandleOption, shmOpen, shmRun, noCancel, shmClose, "shm", SDR_SHM, 0},
     { noInitConfig, noHandleOption, noOpen, noRun, noCancel, noClose, "none", SDR_NONE, 0},
 
     { NULL, NULL, NULL, NULL, NULL, NULL, NULL, SDR_NONE, 0} /* must come last */
@@ -191,12 +196,136 @@ void sdrClose() {
     current_handler()->close();
 }
 
-void lockReader() {
-    pthread_mutex_lock(&Threads.reader.mutex);
+
+// Magnitude buffer FIFO
+//
+// Single producer (the SDR reader) and single consumer (the decode thread), no mutex.
+// Modes.first_free_buffer is only written by the reader, Modes.first_filled_buffer only by the
+// decode thread. Both are futex words: the decode thread sleeps on first_free_buffer while the
+// FIFO is empty, a reader that has to wait for a free buffer sleeps on first_filled_buffer.
+
+// real monotonic time, mono_micro_seconds() follows the sample clock when reading from a file
+static int64_t fifoMicroseconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static int latencyBucket(int64_t us) {
+    int bucket = 0;
+    while (bucket < FIFO_LATENCY_BUCKETS - 1 && us >= (FIFO_LATENCY_BASE_US << bucket)) {
+        bucket++;
+    }
+    return bucket;
 }
-void unlockReader() {
-    pthread_mutex_unlock(&Threads.reader.mutex);
+
+static void futexWait(atomic_uint *word, unsigned val, int64_t timeout_ms) {
+    struct timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000;
+    // returns early with EAGAIN if the word isn't val anymore, EINTR and ETIMEDOUT are expected as well
+    syscall(SYS_futex, (uint32_t *) word, FUTEX_WAIT_PRIVATE, val, &ts, NULL, 0);
 }
+
+static void futexWake(atomic_uint *word) {
+    syscall(SYS_futex, (uint32_t *) word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
 void wakeDecode() {
-    pthread_cond_signal(&Threads.decode.cond);
+    futexWake(&Modes.first_free_buffer);
+}
+
+// buffer the reader fills next, lastbuf is the one pushed before it (for the overlap)
+// free_bufs is the number of buffers that are free after this one
+struct mag_buf *fifoAcquire(struct mag_buf **lastbuf, unsigned *free_bufs) {
+    unsigned free = atomic_load_explicit(&Modes.first_free_buffer, memory_order_relaxed);
+    unsigned filled = atomic_load_explicit(&Modes.first_filled_buffer, memory_order_acquire);
+    unsigned next = (free + 1) % MODES_MAG_BUFFERS;
+    *lastbuf = &Modes.mag_buffers[(free + MODES_MAG_BUFFERS - 1) % MODES_MAG_BUFFERS];
+    *free_bufs = (filled - next + MODES_MAG_BUFFERS) % MODES_MAG_BUFFERS;
+    return &Modes.mag_buffers[free];
+}
+
+// hand the buffer returned by fifoAcquire to the decode thread
+// only call this if fifoAcquire reported a free buffer
+void fifoPush(struct timespec *thread_cpu) {
+    unsigned free = atomic_load_explicit(&Modes.first_free_buffer, memory_order_relaxed);
+    unsigned next = (free + 1) % MODES_MAG_BUFFERS;
+
+    // accumulate reader CPU and restart measurement
+    struct timespec cpu = { 0, 0 };
+    end_cpu_timing(thread_cpu, &cpu);
+    start_cpu_timing(thread_cpu);
+    atomic_fetch_add_explicit(&Modes.reader_cpu_ns, cpu.tv_sec * 1000000000LL + cpu.tv_nsec, memory_order_relaxed);
+
+    Modes.mag_buffers[free].pushMicroseconds = fifoMicroseconds();
+    Modes.mag_buffers[next].dropped = 0;
+    Modes.mag_buffers[next].length = 0; // just in case
+
+    atomic_store_explicit(&Modes.first_free_buffer, next, memory_order_release);
+    futexWake(&Modes.first_free_buffer);
+}
+
+// for readers that wait instead of dropping: sleep until the next buffer is free or timeout_ms passed
+// returns true if there is a free buffer
+bool fifoWaitFree(int64_t timeout_ms) {
+    unsigned free = atomic_load_explicit(&Modes.first_free_buffer, memory_order_relaxed);
+    unsigned next = (free + 1) % MODES_MAG_BUFFERS;
+    unsigned filled = atomic_load_explicit(&Modes.first_filled_buffer, memory_order_acquire);
+    if (next != filled) {
+        return true;
+    }
+    if (!Modes.exit) {
+        futexWait(&Modes.first_filled_buffer, filled, timeout_ms);
+    }
+    return (next != atomic_load_explicit(&Modes.first_filled_buffer, memory_order_acquire));
+}
+
+// wait for the decode thread to process all pushed buffers
+void fifoDrain() {
+    unsigned free = atomic_load_explicit(&Modes.first_free_buffer, memory_order_relaxed);
+    unsigned filled;
+    while (!Modes.exit && (filled = atomic_load_explicit(&Modes.first_filled_buffer, memory_order_acquire)) != free) {
+        futexWait(&Modes.first_filled_buffer, filled, 50);
+    }
+}
+
+// oldest pushed buffer or NULL if the FIFO is empty
+struct mag_buf *fifoPeek() {
+    unsigned filled = atomic_load_explicit(&Modes.first_filled_buffer, memory_order_relaxed);
+    if (atomic_load_explicit(&Modes.first_free_buffer, memory_order_acquire) == filled) {
+        return NULL;
+    }
+    return &Modes.mag_buffers[filled];
+}
+
+// call before processing the buffer returned by fifoPeek, for the fifo_wait histogram
+void fifoDemodStart(struct mag_buf *buf) {
+    Modes.stats_current.fifo_wait[latencyBucket(fifoMicroseconds() - buf->pushMicroseconds)]++;
+}
+
+// the buffer returned by fifoPeek has been processed, give it back to the reader
+void fifoRelease() {
+    unsigned filled = atomic_load_explicit(&Modes.first_filled_buffer, memory_order_relaxed);
+    int64_t latency = fifoMicroseconds() - Modes.mag_buffers[filled].pushMicroseconds;
+    Modes.stats_current.fifo_latency[latencyBucket(latency)]++;
+
+    atomic_store_explicit(&Modes.first_filled_buffer, (filled + 1) % MODES_MAG_BUFFERS, memory_order_release);
+    futexWake(&Modes.first_filled_buffer);
+}
+
+// sleep until a buffer is pushed or timeout_ms passed
+void fifoWaitData(int64_t timeout_ms) {
+    unsigned filled = atomic_load_explicit(&Modes.first_filled_buffer, memory_order_relaxed);
+    if (!Modes.exit) {
+        futexWait(&Modes.first_free_buffer, filled, timeout_ms);
+    }
+}
+
+// move the CPU time the reader accumulated since the last call to target
+void fifoReaderCpu(struct timespec *target) {
+    int64_t ns = atomic_exchange_explicit(&Modes.reader_cpu_ns, 0, memory_order_relaxed);
+    target->tv_sec += ns / 1000000000LL;
+    target->tv_nsec += ns % 1000000000LL;
+    normalize_timespec(target);
 }
@@ -35,8 +35,16 @@ bool sdrHasRun();
 void sdrCancel ();
 void sdrClose ();
 
-void lockReader();
-void unlockReader();
 void wakeDecode();
 
+struct mag_buf *fifoAcquire(struct mag_buf **lastbuf, unsigned *free_bufs);
+void fifoPush(struct timespec *thread_cpu);
+bool fifoWaitFree(int64_t timeout_ms);
+void fifoDrain();
+struct mag_buf *fifoPeek();
+void fifoDemodStart(struct mag_buf *buf);
+void fifoRelease();
+void fifoWaitData(int64_t timeout_ms);
+void fifoReaderCpu(struct timespec *target);
+
 #endif
@@ -60,9 +60,11 @@ static struct {
     int fd;
     unsigned bytes_per_sample;
     bool throttle;
-    uint8_t padding1;
+    bool fast;
     uint16_t padding2;
     void *readbuf;
+    uint8_t *map; // whole input file with --ifile-fast, NULL when reading
+    size_t map_size;
     iq_convert_fn converter;
     struct converter_state *converter_state;
     const char *filename;
@@ -72,6 +74,9 @@ void ifileInitConfig(void) {
     ifile.filename = NULL;
     ifile.input_format = INPUT_UC8;
     ifile.throttle = false;
+    ifile.fast = false;
+    ifile.map = NULL;
+    ifile.map_size = 0;
     ifile.fd = -1;
     ifile.bytes_per_sample = 0;
     ifile.readbuf = NULL;
@@ -102,6 +107,9 @@ bool ifileHandleOption(int key, char *arg) {
         case OptIfileThrottle:
             ifile.throttle = true;
             break;
+        case OptIfileFast:
+            ifile.fast = true;
+            break;
         default:
             return false;
     }
@@ -143,7 +151,29 @@ bool ifileOpen(void) {
             return false;
     }
 
-    if (!(ifile.readbuf = cmalloc(Modes.sdr_buf_samples * ifile.bytes_per_sample))) {
+    if (ifile.fast) {
+        struct stat st;
+        if (fstat(ifile.fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, ifile.fd, 0);
+            if (map != MAP_FAILED) {
+                madvise(map, st.st_size, MADV_SEQUENTIAL);
+                ifile.map = map;
+                ifile.map_size = st.st_size;
+            }
+        }
+        if (!ifile.map) {
+            // stdin or a pipe, read it with readahead
+            posix_fadvise(ifile.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        }
+        if (Modes.demodThreads == 0) {
+            // demodulate2400 needs DEMOD_MIN_SEGMENT samples per thread
+            int cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            int segments = Modes.sdr_buf_samples / DEMOD_MIN_SEGMENT;
+            Modes.demodThreads = imax(1, imin(16, imin(cpus, segments)));
+        }
+    }
+
+    if (!ifile.map && !(ifile.readbuf = cmalloc(Modes.sdr_buf_samples * ifile.bytes_per_sample))) {
         fprintf(stderr, "ifile: failed to allocate read buffer\n");
         ifileClose();
         return false;
@@ -173,30 +203,27 @@ void ifileRun() {
     start_cpu_timing(&thread_cpu);
 
     uint64_t sampleCounter = 0;
+    size_t mapOffset = 0;
+    size_t mapReleased = 0; // everything before this was already handed back to the kernel
+    size_t pageSize = sysconf(_SC_PAGESIZE);
 
     clock_gettime(CLOCK_MONOTONIC, &next_buffer_delivery);
+    struct timespec run_start = next_buffer_delivery;
 
-    struct timespec ts;
-    clock_gettime(CLOCK_REALTIME, &ts);
-
-    lockReader();
     while (!Modes.exit && !eof) {
         ssize_t nread, toread;
         void *r;
+        void *input = ifile.readbuf;
         struct mag_buf *outbuf, *lastbuf;
-        unsigned next_free_buffer;
+        unsigned free_bufs;
         unsigned slen;
 
-        next_free_buffer = (Modes.first_free_buffer + 1) % MODES_MAG_BUFFERS;
-        if (next_free_buffer == Modes.first_filled_buffer) {
+        if (!fifoWaitFree(50)) {
             // no space for output yet
-            threadTimedWait(&Threads.reader, &ts, 50);
             continue;
         }
 
-        outbuf = &Modes.mag_buffers[Modes.first_free_buffer];
-        lastbuf = &Modes.mag_buffers[(Modes.first_free_buffer + MODES_MAG_BUFFERS - 1) % MODES_MAG_BUFFERS];
-        unlockReader();
+        outbuf = fifoAcquire(&lastbuf, &free_bufs);
 
         // Compute the sample timestamp for the start of the block
         outbuf->sampleTimestamp = sampleCounter * 12e6 / Modes.sample_rate;
@@ -216,7 +243,27 @@ void ifileRun() {
 
         toread = Modes.sdr_buf_samples * ifile.bytes_per_sample;
         r = ifile.readbuf;
-        while (toread) {
+        if (ifile.map) {
+            // convert straight from the mapping
+            size_t bytes = imin(toread, ifile.map_size - mapOffset);
+            bytes -= bytes % ifile.bytes_per_sample;
+            input = ifile.map + mapOffset;
+            // pages behind this block aren't needed again, the next block will be
+            // MADV_DONTNEED only drops them from the mapping, POSIX_FADV_DONTNEED then evicts them from the page cache
+            size_t done = mapOffset / pageSize * pageSize;
+            if (done > mapReleased) {
+                madvise(ifile.map + mapReleased, done - mapReleased, MADV_DONTNEED);
+                posix_fadvise(ifile.fd, mapReleased, done - mapReleased, POSIX_FADV_DONTNEED);
+                mapReleased = done;
+            }
+            if (mapOffset + bytes < ifile.map_size)
+                madvise(ifile.map + (mapOffset + bytes) / pageSize * pageSize, imin(toread, ifile.map_size - mapOffset - bytes), MADV_WILLNEED);
+            mapOffset += bytes;
+            toread -= bytes;
+            if (toread)
+                eof = 1;
+        }
+        while (toread && !ifile.map) {
             nread = read(ifile.fd, r, toread);
             if (nread <= 0) {
                 if (nread < 0) {
@@ -234,9 +281,9 @@ void ifileRun() {
         sampleCounter += slen;
 
         // Convert the new data
-        ifile.converter(ifile.readbuf, &outbuf->data[Modes.trailing_samples], slen, ifile.converter_state, &outbuf->mean_level, &outbuf->mean_power);
+        ifile.converter(input, &outbuf->data[Modes.trailing_samples], slen, ifile.converter_state, &outbuf->mean_level, &outbuf->mean_power);
 
-        if (ifile.throttle || Modes.interactive) {
+        if ((ifile.throttle || Modes.interactive) && !ifile.fast) {
             // Wait until we are allowed to release this buffer to the main thread
             while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_buffer_delivery, NULL) == EINTR)
                 ;
@@ -247,22 +294,22 @@ void ifileRun() {
         }
 
         // Push the new data to the main thread
-        lockReader();
-        Modes.first_free_buffer = next_free_buffer;
-        // accumulate CPU while holding the mutex, and restart measurement
-        end_cpu_timing(&thread_cpu, &Modes.reader_cpu_accumulator);
-        start_cpu_timing(&thread_cpu);
-        wakeDecode();
+        fifoPush(&thread_cpu);
     }
 
-    // Wait for the main thread to consume all data (reader still locked here)
-    while (!Modes.exit && Modes.first_filled_buffer != Modes.first_free_buffer) {
-        wakeDecode();
-        threadTimedWait(&Threads.reader, &ts, 50);
+    // Wait for the main thread to consume all data
+    fifoDrain();
+
+    if (ifile.fast) {
+        struct timespec run_end;
+        clock_gettime(CLOCK_MONOTONIC, &run_end);
+        double elapsed = (run_end.tv_sec - run_start.tv_sec) + (run_end.tv_nsec - run_start.tv_nsec) * 1e-9;
+        fprintf(stderr, "ifile: %llu samples in %.2f s: %.2f Msamples/s, %.1fx real time (%d demod threads)\n",
+                (unsigned long long) sampleCounter, elapsed, sampleCounter / elapsed * 1e-6,
+                sampleCounter / (double) Modes.sample_rate / elapsed, (int) imax(1, Modes.demodThreads));
     }
 
     Modes.exit = 1;
-    unlockReader();
 }
 
 void ifileClose() {
@@ -276,6 +323,11 @@ void ifileClose() {
         ifile.readbuf = NULL;
     }
 
+    if (ifile.map) {
+        munmap(ifile.map, ifile.map_size);
+        ifile.map = NULL;
+    }
+
     if (ifile.fd >= 0 && ifile.fd != STDIN_FILENO) {
         close(ifile.fd);
         ifile.fd = -1;
@@ -171,7 +171,6 @@ static void plutosdrCallback(int16_t *buf, uint32_t len) {
     struct mag_buf *outbuf;
     struct mag_buf *lastbuf;
     uint32_t slen;
-    unsigned next_free_buffer;
     unsigned free_bufs;
     int64_t block_duration;
 
@@ -179,12 +178,7 @@ static void plutosdrCallback(int16_t *buf, uint32_t len) {
     static int dropping = 0;
     static uint64_t sampleCounter = 0;
 
-    lockReader();
-
-    next_free_buffer = (Modes.first_free_buffer + 1) % MODES_MAG_BUFFERS;
-    outbuf = &Modes.mag_buffers[Modes.first_free_buffer];
-    lastbuf = &Modes.mag_buffers[(Modes.first_free_buffer + MODES_MAG_BUFFERS - 1) % MODES_MAG_BUFFERS];
-    free_bufs = (Modes.first_filled_buffer - next_free_buffer + MODES_MAG_BUFFERS) % MODES_MAG_BUFFERS;
+    outbuf = fifoAcquire(&lastbuf, &free_bufs);
 
     if (len != Modes.sdr_buf_size) {
         fprintf(stderr, "weirdness: plutosdr gave us a block with an unusual size (got %u bytes, expected %u bytes)\n",
@@ -211,12 +205,10 @@ static void plutosdrCallback(int16_t *buf, uint32_t len) {
         dropping = 1;
         outbuf->dropped += slen;
         sampleCounter += slen;
-        unlockReader();
         return;
     }
 
     dropping = 0;
-    unlockReader();
 
     outbuf->sampleTimestamp = sampleCounter * 12e6 / Modes.sample_rate;
     sampleCounter += slen;
@@ -238,17 +230,7 @@ static void plutosdrCallback(int16_t *buf, uint32_t len) {
     outbuf->length = slen;
     PLUTOSDR.converter(buf, &outbuf->data[Modes.trailing_samples], slen, PLUTOSDR.converter_state, &outbuf->mean_level, &outbuf->mean_power);
 
-    lockReader();
-
-    Modes.mag_buffers[next_free_buffer].dropped = 0;
-    Modes.mag_buffers[next_free_buffer].length = 0;
-    Modes.first_free_buffer = next_free_buffer;
-
-    end_cpu_timing(&thread_cpu, &Modes.reader_cpu_accumulator);
-    start_cpu_timing(&thread_cpu);
-
-    wakeDecode();
-    unlockReader();
+    fifoPush(&thread_cpu);
 }
 
 void plutosdrRun() {
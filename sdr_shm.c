@@ -0,0 +1,289 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// sdr_shm.c: shared memory IQ ring SDR support
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "readsb.h"
+#include "sdr_shm.h"
+
+static struct {
+    input_format_t input_format;
+    unsigned bytes_per_sample;
+    const char *name;
+    struct shmRingHeader *header;
+    size_t header_size;
+    uint8_t *ring; // the data area mapped twice back to back
+    uint64_t data_size;
+    iq_convert_fn converter;
+    struct converter_state *converter_state;
+} shm;
+
+void shmInitConfig(void) {
+    shm.name = NULL;
+    shm.input_format = INPUT_UC8;
+    shm.bytes_per_sample = 0;
+    shm.header = NULL;
+    shm.header_size = 0;
+    shm.ring = NULL;
+    shm.data_size = 0;
+    shm.converter = NULL;
+    shm.converter_state = NULL;
+}
+
+bool shmHandleOption(int key, char *arg) {
+    switch (key) {
+        case OptShmName:
+            shm.name = strdup(arg);
+            Modes.sdr_type = SDR_SHM;
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+static bool parseDatatype(const char *datatype) {
+    if (!strcmp(datatype, "cu8")) {
+        shm.input_format = INPUT_UC8;
+        shm.bytes_per_sample = 2;
+    } else if (!strcmp(datatype, "ci16_le") || !strcmp(datatype, "ci16")) {
+        shm.input_format = INPUT_SC16;
+        shm.bytes_per_sample = 4;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool shmOpen(void) {
+    if (!shm.name) {
+        fprintf(stderr, "SDR type 'shm' requires a --shm argument\n");
+        return false;
+    }
+
+    char name[PATH_MAX];
+    snprintf(name, sizeof(name), "%s%s", shm.name[0] == '/' ? "" : "/", shm.name);
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        fprintf(stderr, "shm: could not open %s: %s\n", name, strerror(errno));
+        return false;
+    }
+
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(struct shmRingHeader)) {
+        fprintf(stderr, "shm: %s is too small for a ring header\n", name);
+        close(fd);
+        return false;
+    }
+
+    shm.header_size = sizeof(struct shmRingHeader);
+    void *header = mmap(NULL, shm.header_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (header == MAP_FAILED) {
+        fprintf(stderr, "shm: could not map %s: %s\n", name, strerror(errno));
+        close(fd);
+        return false;
+    }
+    shm.header = header;
+
+    struct shmRingHeader *h = shm.header;
+    char datatype[sizeof(h->datatype) + 1];
+    memcpy(datatype, h->datatype, sizeof(h->datatype));
+    datatype[sizeof(h->datatype)] = '\0';
+
+    const char *error = NULL;
+    if (memcmp(h->magic, SHM_RING_MAGIC, sizeof(h->magic))) {
+        error = "not a readsb IQ ring";
+    } else if (h->version != SHM_RING_VERSION) {
+        error = "unsupported ring version";
+    } else if (h->data_offset < sizeof(struct shmRingHeader) || h->data_offset % pageSize
+            || !h->data_size || h->data_size % pageSize
+            || (uint64_t) st.st_size < h->data_offset + h->data_size) {
+        error = "bad ring geometry";
+    } else if (!parseDatatype(datatype)) {
+        error = "unsupported datatype (supported: cu8, ci16_le)";
+    } else if (h->sample_rate != (uint64_t) Modes.sample_rate) {
+        error = "sample rate doesn't match the demodulator";
+    } else if (2 * (uint64_t) Modes.sdr_buf_samples * shm.bytes_per_sample > h->data_size) {
+        error = "ring too small for --sdr-buffer-size, it must hold at least two buffers";
+    }
+    if (error) {
+        fprintf(stderr, "shm: %s: %s\n", name, error);
+        close(fd);
+        shmClose();
+        return false;
+    }
+
+    // map the data twice back to back, a block wrapping around the end of the ring
+    // continues in the second mapping and can be converted in place
+    shm.data_size = h->data_size;
+    void *ring = mmap(NULL, 2 * shm.data_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (ring == MAP_FAILED
+            || mmap(ring, shm.data_size, PROT_READ, MAP_SHARED | MAP_FIXED, fd, h->data_offset) == MAP_FAILED
+            || mmap((uint8_t *) ring + shm.data_size, shm.data_size, PROT_READ, MAP_SHARED | MAP_FIXED, fd, h->data_offset) == MAP_FAILED) {
+        fprintf(stderr, "shm: could not map the ring of %s: %s\n", name, strerror(errno));
+        if (ring != MAP_FAILED)
+            munmap(ring, 2 * shm.data_size);
+        close(fd);
+        shmClose();
+        return false;
+    }
+    shm.ring = ring;
+    close(fd);
+
+    shm.converter = init_converter(shm.input_format,
+            Modes.sample_rate,
+            Modes.dc_filter,
+            &shm.converter_state);
+    if (!shm.converter) {
+        fprintf(stderr, "shm: can't initialize sample converter\n");
+        shmClose();
+        return false;
+    }
+
+    fprintf(stderr, "shm: attached to %s: %s at %.2f MS/s, %.3f MHz, %.1f MB ring\n",
+            name, datatype, h->sample_rate * 1e-6, h->frequency * 1e-6, shm.data_size / (1024.0 * 1024.0));
+
+    return true;
+}
+
+void shmRun() {
+    if (!shm.ring)
+        return;
+
+    struct shmRingHeader *h = shm.header;
+    uint64_t bps = shm.bytes_per_sample;
+    uint64_t blockBytes = Modes.sdr_buf_samples * bps;
+
+    struct timespec thread_cpu;
+    start_cpu_timing(&thread_cpu);
+
+    // start with the newest samples, older ones are of no use to a live decoder
+    uint64_t pos = __atomic_load_n(&h->write_offset, __ATOMIC_ACQUIRE);
+    pos -= pos % bps;
+    bool restarted = false;
+    bool finished = false;
+
+    while (!Modes.exit && !finished) {
+        struct mag_buf *outbuf, *lastbuf;
+        unsigned free_bufs;
+
+        if (!fifoWaitFree(50)) {
+            // no space for output yet, the position check below notices if the writer laps us
+            continue;
+        }
+
+        outbuf = fifoAcquire(&lastbuf, &free_bufs);
+
+        // wait for a whole block
+        uint64_t written;
+        while (1) {
+            bool done = (__atomic_load_n(&h->state, __ATOMIC_ACQUIRE) == SHM_RING_FINISHED);
+            written = __atomic_load_n(&h->write_offset, __ATOMIC_ACQUIRE);
+            if (written < pos) {
+                // the writer started over
+                pos = written - written % bps;
+                restarted = true;
+                continue;
+            }
+            if (written - pos > shm.data_size - blockBytes) {
+                // the writer would overwrite the block while we convert it, skip to the newest data
+                uint64_t skip = written - written % bps;
+                outbuf->dropped += (skip - pos) / bps;
+                pos = skip;
+                continue;
+            }
+            if (written - pos >= blockBytes || (done && written > pos))
+                break;
+            if (done) {
+                finished = true;
+                break;
+            }
+            if (Modes.exit)
+                break;
+
+            // sleep about as long as the writer needs for the rest of the block
+            int64_t ns = (blockBytes - (written - pos)) / bps * 1000000000LL / h->sample_rate;
+            struct timespec ts = { 0, imax(1000000, imin(ns, 50000000)) };
+            nanosleep(&ts, NULL);
+        }
+        if (finished || Modes.exit)
+            break;
+
+        uint64_t bytes = imin(blockBytes, written - pos);
+        bytes -= bytes % bps;
+        unsigned slen = bytes / bps;
+
+        // Copy trailing data from last block (or reset if not valid)
+        if (outbuf->dropped == 0 && !restarted && lastbuf->length >= Modes.trailing_samples) {
+            memcpy(outbuf->data, lastbuf->data + lastbuf->length, Modes.trailing_samples * sizeof (uint16_t));
+        } else {
+            memset(outbuf->data, 0, Modes.trailing_samples * sizeof (uint16_t));
+        }
+        restarted = false;
+
+        // The sample clock counts stream samples, so every decoder on the ring shares it
+        uint64_t sample = pos / bps;
+        outbuf->sampleTimestamp = sample * 12e6 / Modes.sample_rate;
+
+        // the block started this long ago if the writer keeps up with real time
+        int64_t age_us = (written - pos) / bps * 1000000 / h->sample_rate;
+        if (h->datetime_ns) {
+            outbuf->sysTimestamp = h->datetime_ns / 1000000 + (int64_t) (sample * 1e3 / Modes.sample_rate);
+        } else {
+            outbuf->sysTimestamp = mstime() - age_us / 1000;
+        }
+        outbuf->sysMicroseconds = mono_micro_seconds() - age_us;
+
+        // Convert the new data straight from the ring
+        outbuf->length = slen;
+        shm.converter(shm.ring + pos % shm.data_size, &outbuf->data[Modes.trailing_samples], slen, shm.converter_state, &outbuf->mean_level, &outbuf->mean_power);
+
+        uint64_t after = __atomic_load_n(&h->write_offset, __ATOMIC_ACQUIRE);
+        pos += bytes;
+        if (after > written && after - (pos - bytes) > shm.data_size) {
+            // the writer lapped us during the conversion, part of the block is newer data
+            outbuf->dropped += slen;
+            outbuf->length = 0;
+            continue;
+        }
+
+        // Push the new data to the main thread
+        fifoPush(&thread_cpu);
+    }
+
+    // Wait for the main thread to consume all data
+    fifoDrain();
+
+    Modes.exit = 1;
+}
+
+void shmClose() {
+    if (shm.converter) {
+        cleanup_converter(&shm.converter_state);
+        shm.converter = NULL;
+    }
+
+    if (shm.ring) {
+        munmap(shm.ring, 2 * shm.data_size);
+        shm.ring = NULL;
+    }
+
+    if (shm.header) {
+        munmap(shm.header, shm.header_size);
+        shm.header = NULL;
+    }
+}
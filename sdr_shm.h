@@ -0,0 +1,65 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// sdr_shm.h: shared memory IQ ring SDR support (header)
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SDR_SHM_H
+#define SDR_SHM_H
+
+// Pseudo-SDR that reads IQ samples another process writes to a POSIX shared memory ring
+//
+// Layout of the shared memory object (shm_open name given with --shm):
+//
+//   offset 0            struct shmRingHeader
+//   data_offset         data_size bytes of interleaved IQ samples, a ring over the stream
+//
+// Stream byte n is stored at data_offset + n % data_size. data_offset and data_size must be
+// multiples of the page size, the reader maps the ring twice back to back so every block it
+// converts is contiguous. The writer copies samples into the ring, then stores the new total
+// of bytes written in write_offset (release order); readers never write to the object, so any
+// number of decoders can attach to the same ring. Readers that fall more than a ring behind
+// skip ahead and count the skipped samples as dropped.
+//
+// sample_rate, frequency, datetime_ns and datatype carry the SigMF core:sample_rate,
+// core:frequency, core:datetime (of stream byte 0) and core:datatype of the stream.
+// Supported datatypes are "cu8" and "ci16_le".
+
+#define SHM_RING_MAGIC "readsbIQ"
+#define SHM_RING_VERSION 1
+
+#define SHM_RING_RUNNING 0
+#define SHM_RING_FINISHED 1 // the writer is done, readers exit once they reach write_offset
+
+struct shmRingHeader {
+    char magic[8]; // SHM_RING_MAGIC, not NUL terminated
+    uint32_t version; // SHM_RING_VERSION
+    uint32_t data_offset; // start of the sample data
+    uint64_t data_size; // size of the sample ring in bytes
+    uint64_t sample_rate; // samples per second
+    uint64_t frequency; // center frequency in Hz, 0: unknown
+    int64_t datetime_ns; // wall clock time of stream byte 0 in ns since the epoch, 0: unknown
+    char datatype[16]; // NUL terminated
+    uint64_t write_offset; // stream bytes written so far, only ever increases
+    uint32_t state; // SHM_RING_RUNNING or SHM_RING_FINISHED
+    uint32_t padding;
+};
+
+void shmInitConfig ();
+bool shmHandleOption (int argc, char *argv);
+bool shmOpen ();
+void shmRun ();
+void shmClose ();
+
+#endif
@@ -345,26 +345,21 @@ static void *handle_bladerf_samples(struct bladerf *dev,
     MODES_NOTUSED(user_data);
     MODES_NOTUSED(num_samples);
 
-    lockReader();
     if (Modes.exit) {
-        unlockReader();
         return BLADERF_STREAM_SHUTDOWN;
     }
 
-    unsigned next_free_buffer = (Modes.first_free_buffer + 1) % MODES_MAG_BUFFERS;
-    struct mag_buf *outbuf = &Modes.mag_buffers[Modes.first_free_buffer];
-    struct mag_buf *lastbuf = &Modes.mag_buffers[(Modes.first_free_buffer + MODES_MAG_BUFFERS - 1) % MODES_MAG_BUFFERS];
-    unsigned free_bufs = (Modes.first_filled_buffer - next_free_buffer + MODES_MAG_BUFFERS) % MODES_MAG_BUFFERS;
+    struct mag_buf *lastbuf;
+    unsigned free_bufs;
+    struct mag_buf *outbuf = fifoAcquire(&lastbuf, &free_bufs);
 
     if (free_bufs == 0 || (dropping && free_bufs < MODES_MAG_BUFFERS / 2)) {
         // FIFO is full. Drop this block.
         dropping = true;
-        unlockReader();
         return samples;
     }
 
     dropping = false;
-    unlockReader();
 
     outbuf->sysTimestamp = mstime();
     outbuf->sysMicroseconds = mono_micro_seconds();
@@ -455,18 +450,7 @@ static void *handle_bladerf_samples(struct bladerf *dev,
         outbuf->mean_power /= blocks_processed;
 
         // Push the new data to the demodulation thread
-        lockReader();
-
-        // accumulate CPU while holding the mutex, and restart measurement
-        end_cpu_timing(&thread_cpu, &Modes.reader_cpu_accumulator);
-        start_cpu_timing(&thread_cpu);
-
-        Modes.mag_buffers[next_free_buffer].dropped = 0;
-        Modes.mag_buffers[next_free_buffer].length = 0; // just in case
-        Modes.first_free_buffer = next_free_buffer;
-
-        wakeDecode();
-        unlockReader();
+        fifoPush(&thread_cpu);
     }
 
     return samples;
@@ -0,0 +1,342 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// slicer.c: bit slicing of Mode S messages for the 2.4MHz demodulator
+//
+// Copyright (c) 2019 Michael Wolf <michael@mictronics.de>
+//
+// This code is based on a detached fork of dump1090-fa.
+//
+// Copyright (c) 2014,2015 Oliver Jowett <oliver@mutability.co.uk>
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "readsb.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SLICE_X86
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SLICE_NEON
+#endif
+
+// 2.4MHz sampling rate version
+//
+// When sampling at 2.4MHz we have exactly 6 samples per 5 symbols.
+// Each symbol is 500ns wide, each sample is 416.7ns wide
+//
+// We maintain a phase offset that is expressed in units of 1/5 of a sample i.e. 1/6 of a symbol, 83.333ns
+// Each symbol we process advances the phase offset by 6 i.e. 6/5 of a sample, 500ns
+//
+// The correlation functions below correlate a 1-0 pair of symbols (i.e. manchester encoded 1 bit)
+// starting at the given sample, and assuming that the symbol starts at a fixed 0-5 phase offset within
+// m[0]. They return a correlation value, generally interpreted as >0 = 1 bit, <0 = 0 bit
+
+// TODO check if there are better (or more balanced) correlation functions to use here
+
+// nb: the correlation functions sum to zero, so we do not need to adjust for the DC offset in the input signal
+// (adding any constant value to all of m[0..3] does not change the result)
+
+
+// Changes 2020 by wiedehopf:
+// 20 units per sample, 24 units per symbol that are distributed according to phase
+// 1 bit has 2 symbols, in a bit representing a one the first symbol is high and the second is low
+
+// The previous assumption was that symbols beyond our control are zero.
+// Let's make the assumption that the symbols beyond our control are a statistical mean of 0 and 1.
+// Such a mean is represented by 12 units per symbol.
+// As an example for the above let's discuss the first slice function:
+// Samples 0 and 1 are completely occupied by the bit we are trying to judge thus no outside symbols.
+// The 3rd sample is 8 units of our bit and 12 units of the following symbol.
+// Our bit contributes part of a low symbol represented by -8 units
+// but we also get 12 units of 0.5 resulting in +6 units from the following symbol.
+//
+// The above comment is how these changes started out, i'll leave them here as food for thought.
+// Using --ifile the coefficients from the above thought process were iteratively tweaked by hand.
+// Note one of the correlation functions is no longer DC balanced (but just slightly)
+// Further testing on your own samples using --ifile --quiet --stats is welcome
+// Note you might need to use --throttle unless your using wiedehopf's readsb fork,
+// otherwise position stats won't work as they rely on realtime differences between
+// reception of CPRs.
+// Creating a 5 minute sample with a gain of 43.9:
+// timeout 300 rtl_sdr -f 1090000000 -s 2400000 -g 43.9 sample.dat
+// Checking a set of correlation functions using the above sample:
+// make && ./readsb --device-type ifile --ifile sample.dat --quiet --stats
+
+static inline __attribute__((always_inline)) int slice_phase0(const uint16_t *m) {
+    return 18 * m[0] - 15 * m[1] - 3 * m[2];
+}
+
+static inline __attribute__((always_inline)) int slice_phase1(const uint16_t *m) {
+    return 14 * m[0] - 5 * m[1] - 9 * m[2];
+}
+
+// slightly DC unbalanced but better results
+static inline __attribute__((always_inline)) int slice_phase2(const uint16_t *m) {
+    return 16 * m[0] + 5 * m[1] - 20 * m[2];
+}
+
+static inline __attribute__((always_inline)) int slice_phase3(const uint16_t *m) {
+    return 7 * m[0] + 11 * m[1] - 18 * m[2];
+}
+
+static inline __attribute__((always_inline)) int slice_phase4(const uint16_t *m) {
+    return 4 * m[0] + 15 * m[1] - 20 * m[2] + 1 * m[3];
+}
+
+// extract one byte from the mag buffers using slice_phase functions
+// advance pPtr and phase
+static inline __attribute__((always_inline)) uint8_t slice_byte(const uint16_t **pPtr, int *phase) {
+    uint8_t theByte = 0;
+
+    switch (*phase) {
+        case 0:
+            theByte =
+                (slice_phase0(*pPtr) > 0 ? 0x80 : 0) |
+                (slice_phase2(*pPtr+2) > 0 ? 0x40 : 0) |
+                (slice_phase4(*pPtr+4) > 0 ? 0x20 : 0) |
+                (slice_phase1(*pPtr+7) > 0 ? 0x10 : 0) |
+                (slice_phase3(*pPtr+9) > 0 ? 0x08 : 0) |
+                (slice_phase0(*pPtr+12) > 0 ? 0x04 : 0) |
+                (slice_phase2(*pPtr+14) > 0 ? 0x02 : 0) |
+                (slice_phase4(*pPtr+16) > 0 ? 0x01 : 0);
+
+            *phase = 1;
+            *pPtr += 19;
+            break;
+
+        case 1:
+            theByte =
+                (slice_phase1(*pPtr) > 0 ? 0x80 : 0) |
+                (slice_phase3(*pPtr+2) > 0 ? 0x40 : 0) |
+                (slice_phase0(*pPtr+5) > 0 ? 0x20 : 0) |
+                (slice_phase2(*pPtr+7) > 0 ? 0x10 : 0) |
+                (slice_phase4(*pPtr+9) > 0 ? 0x08 : 0) |
+                (slice_phase1(*pPtr+12) > 0 ? 0x04 : 0) |
+                (slice_phase3(*pPtr+14) > 0 ? 0x02 : 0) |
+                (slice_phase0(*pPtr+17) > 0 ? 0x01 : 0);
+
+            *phase = 2;
+            *pPtr += 19;
+            break;
+
+        case 2:
+            theByte =
+                (slice_phase2(*pPtr) > 0 ? 0x80 : 0) |
+                (slice_phase4(*pPtr+2) > 0 ? 0x40 : 0) |
+                (slice_phase1(*pPtr+5) > 0 ? 0x20 : 0) |
+                (slice_phase3(*pPtr+7) > 0 ? 0x10 : 0) |
+                (slice_phase0(*pPtr+10) > 0 ? 0x08 : 0) |
+                (slice_phase2(*pPtr+12) > 0 ? 0x04 : 0) |
+                (slice_phase4(*pPtr+14) > 0 ? 0x02 : 0) |
+                (slice_phase1(*pPtr+17) > 0 ? 0x01 : 0);
+
+            *phase = 3;
+            *pPtr += 19;
+            break;
+
+        case 3:
+            theByte =
+                (slice_phase3(*pPtr) > 0 ? 0x80 : 0) |
+                (slice_phase0(*pPtr+3) > 0 ? 0x40 : 0) |
+                (slice_phase2(*pPtr+5) > 0 ? 0x20 : 0) |
+                (slice_phase4(*pPtr+7) > 0 ? 0x10 : 0) |
+                (slice_phase1(*pPtr+10) > 0 ? 0x08 : 0) |
+                (slice_phase3(*pPtr+12) > 0 ? 0x04 : 0) |
+                (slice_phase0(*pPtr+15) > 0 ? 0x02 : 0) |
+                (slice_phase2(*pPtr+17) > 0 ? 0x01 : 0);
+
+            *phase = 4;
+            *pPtr += 19;
+            break;
+
+        case 4:
+            theByte =
+                (slice_phase4(*pPtr) > 0 ? 0x80 : 0) |
+                (slice_phase1(*pPtr+3) > 0 ? 0x40 : 0) |
+                (slice_phase3(*pPtr+5) > 0 ? 0x20 : 0) |
+                (slice_phase0(*pPtr+8) > 0 ? 0x10 : 0) |
+                (slice_phase2(*pPtr+10) > 0 ? 0x08 : 0) |
+                (slice_phase4(*pPtr+12) > 0 ? 0x04 : 0) |
+                (slice_phase1(*pPtr+15) > 0 ? 0x02 : 0) |
+                (slice_phase3(*pPtr+17) > 0 ? 0x01 : 0);
+
+            *phase = 0;
+            *pPtr += 20;
+            break;
+    }
+    return theByte;
+}
+
+// all phases for which the phases bit is set, one after the other
+static void sliceScalar(const uint16_t *pa, uint32_t phases, int from, int to, uint8_t out[SLICE_PHASES][MODES_LONG_MSG_BYTES]) {
+    for (int j = 0; j < SLICE_PHASES; j++) {
+        if (!(phases & (1 << j)))
+            continue;
+        // position of the first bit in 1/5 samples
+        int pos = SLICE_FIRST_BIT + j + 96 * from;
+        const uint16_t *pPtr = pa + pos / 5;
+        int phase = pos % 5;
+        for (int i = from; i < to; i++)
+            out[j][i] = slice_byte(&pPtr, &phase);
+    }
+}
+
+// All phases at once
+//
+// Bit k of try_phase j + 4 is judged at position SLICE_FIRST_BIT + j + 12 * k in 1/5 samples.
+// The five phases of one bit are five consecutive positions, they start within 2 samples of each other.
+// Each lane of a vector is one phase: the correlation is a dot product of the 5 samples starting
+// at the sample of the first position with coefficients depending on the lane.
+// The pattern of slice functions and sample offsets repeats every 5 bits (12 samples).
+
+#define SLICE_TAPS 5
+#define SLICE_LANES 8
+
+static int32_t sliceCoef[5][SLICE_TAPS][SLICE_LANES] __attribute__((aligned(32)));
+static uint16_t sliceSample[MODES_LONG_MSG_BITS]; // first sample of bit k relative to pa
+#ifdef SLICE_X86
+// pairs of 16 bit coefficients for _mm256_madd_epi16, taps 0-1, 2-3, 4-5 and the bias correction:
+// the samples are biased to signed 16 bit by subtracting 32768, adding 32768 * sum(coefficients) undoes that
+static int16_t sliceCoefPairs[5][4][2 * SLICE_LANES] __attribute__((aligned(32)));
+#endif
+
+static void initSliceTables() {
+    static const int32_t phaseCoef[5][4] = {
+        { 18, -15,  -3, 0 }, // slice_phase0
+        { 14,  -5,  -9, 0 }, // slice_phase1
+        { 16,   5, -20, 0 }, // slice_phase2
+        {  7,  11, -18, 0 }, // slice_phase3
+        {  4,  15, -20, 1 }, // slice_phase4
+    };
+    memset(sliceCoef, 0, sizeof(sliceCoef));
+    for (int r = 0; r < 5; r++) {
+        int first = SLICE_FIRST_BIT + 12 * r;
+        for (int j = 0; j < SLICE_PHASES; j++) {
+            int pos = first + j;
+            int offset = pos / 5 - first / 5;
+            for (int t = 0; t < 4; t++)
+                sliceCoef[r][offset + t][j] = phaseCoef[pos % 5][t];
+        }
+    }
+    for (int k = 0; k < MODES_LONG_MSG_BITS; k++)
+        sliceSample[k] = (SLICE_FIRST_BIT + 12 * k) / 5;
+#ifdef SLICE_X86
+    memset(sliceCoefPairs, 0, sizeof(sliceCoefPairs));
+    for (int r = 0; r < 5; r++) {
+        for (int j = 0; j < SLICE_LANES; j++) {
+            int32_t sum = 0;
+            for (int t = 0; t < SLICE_TAPS; t++) {
+                sliceCoefPairs[r][t / 2][2 * j + t % 2] = (int16_t) sliceCoef[r][t][j];
+                sum += sliceCoef[r][t][j];
+            }
+            int32_t bias = 32768 * sum;
+            memcpy(&sliceCoefPairs[r][3][2 * j], &bias, sizeof(bias));
+        }
+    }
+#endif
+}
+
+#ifdef SLICE_X86
+__attribute__((target("avx2")))
+static inline __m256i broadcastPair(const uint16_t *m) {
+    int32_t pair;
+    memcpy(&pair, m, sizeof(pair));
+    // bias the samples to signed 16 bit
+    return _mm256_xor_si256(_mm256_set1_epi32(pair), _mm256_set1_epi16((short) 0x8000));
+}
+
+__attribute__((target("avx2")))
+static void sliceAVX2(const uint16_t *pa, uint32_t phases, int from, int to, uint8_t out[SLICE_PHASES][MODES_LONG_MSG_BYTES]) {
+    // with only one or two phases the vector lanes are mostly wasted
+    if (__builtin_popcount(phases) < 3) {
+        sliceScalar(pa, phases, from, to, out);
+        return;
+    }
+    __m256i zero = _mm256_setzero_si256();
+    int r = (8 * from) % 5;
+    for (int i = from; i < to; i++) {
+        // one byte per phase lane, the first bit ends up in the highest position
+        __m256i bits = zero;
+        for (int b = 0; b < 8; b++) {
+            const uint16_t *m = pa + sliceSample[8 * i + b];
+            const __m256i *c = (const __m256i *) sliceCoefPairs[r];
+            __m256i v = _mm256_add_epi32(_mm256_load_si256(c + 3), _mm256_madd_epi16(broadcastPair(m), _mm256_load_si256(c)));
+            v = _mm256_add_epi32(v, _mm256_madd_epi16(broadcastPair(m + 2), _mm256_load_si256(c + 1)));
+            v = _mm256_add_epi32(v, _mm256_madd_epi16(broadcastPair(m + 4), _mm256_load_si256(c + 2)));
+            // the compare is -1 for a positive correlation: bits * 2 + 1
+            bits = _mm256_sub_epi32(_mm256_slli_epi32(bits, 1), _mm256_cmpgt_epi32(v, zero));
+            r = (r == 4) ? 0 : r + 1;
+        }
+        int32_t lanes[8];
+        _mm256_storeu_si256((__m256i *) lanes, bits);
+        for (int j = 0; j < SLICE_PHASES; j++)
+            out[j][i] = (uint8_t) lanes[j];
+    }
+}
+#endif
+
+#ifdef SLICE_NEON
+static void sliceNEON(const uint16_t *pa, uint32_t phases, int from, int to, uint8_t out[SLICE_PHASES][MODES_LONG_MSG_BYTES]) {
+    if (__builtin_popcount(phases) < 3) {
+        sliceScalar(pa, phases, from, to, out);
+        return;
+    }
+    int32x4_t zero = vdupq_n_s32(0);
+    for (int i = from; i < to; i++) {
+        uint32x4_t lo = vdupq_n_u32(0);
+        uint32x4_t hi = vdupq_n_u32(0);
+        for (int b = 0; b < 8; b++) {
+            int k = 8 * i + b;
+            const uint16_t *m = pa + sliceSample[k];
+            int32_t (*c)[SLICE_LANES] = sliceCoef[k % 5];
+            int32x4_t vlo = zero;
+            int32x4_t vhi = zero;
+            for (int t = 0; t < SLICE_TAPS; t++) {
+                // only lane 4 of the upper half is used
+                vlo = vmlaq_n_s32(vlo, vld1q_s32(c[t]), m[t]);
+                vhi = vmlaq_n_s32(vhi, vld1q_s32(c[t] + 4), m[t]);
+            }
+            // the compare is all ones for a positive correlation, shift in its lowest bit
+            lo = vsraq_n_u32(vshlq_n_u32(lo, 1), vcgtq_s32(vlo, zero), 31);
+            hi = vsraq_n_u32(vshlq_n_u32(hi, 1), vcgtq_s32(vhi, zero), 31);
+        }
+        out[0][i] = (uint8_t) vgetq_lane_u32(lo, 0);
+        out[1][i] = (uint8_t) vgetq_lane_u32(lo, 1);
+        out[2][i] = (uint8_t) vgetq_lane_u32(lo, 2);
+        out[3][i] = (uint8_t) vgetq_lane_u32(lo, 3);
+        out[4][i] = (uint8_t) vgetq_lane_u32(hi, 0);
+    }
+}
+#endif
+
+int sliceImplementations(struct sliceImpl *out, int max) {
+    int n = 0;
+    initSliceTables();
+#ifdef SLICE_X86
+    __builtin_cpu_init();
+    if (n < max && __builtin_cpu_supports("avx2")) {
+        out[n++] = (struct sliceImpl) { "avx2", sliceAVX2 };
+    }
+#endif
+#ifdef SLICE_NEON
+    if (n < max) {
+        out[n++] = (struct sliceImpl) { "neon", sliceNEON };
+    }
+#endif
+    if (n < max) {
+        out[n++] = (struct sliceImpl) { "scalar", sliceScalar };
+    }
+    return n;
+}
@@ -62,6 +62,11 @@ void add_timespecs(const struct timespec *x, const struct timespec *y, struct ti
 
 static void display_range_histogram(struct stats *st);
 
+static uint64_t fileWriteLatencyAvg(struct stats *st) {
+    uint64_t jobs = st->file_writes + st->file_write_errors;
+    return jobs ? st->file_write_latency_sum / jobs : 0;
+}
+
 void display_stats(struct stats *st) {
     int j;
     time_t tt_start, tt_end;
@@ -97,6 +102,10 @@ void display_stats(struct stats *st) {
             printf("  %.1f dBFS noise power\n",
                     10 * log10(st->noise_power_sum / st->noise_power_count));
         }
+        if (st->noise_floor_sum > 0 && st->noise_floor_count > 0) {
+            printf("  %.1f dBFS noise floor, %u preambles below it\n",
+                    10 * log10(st->noise_floor_sum / st->noise_floor_count), st->demod_floor_rejected);
+        }
 
         if (st->signal_power_sum > 0 && st->signal_power_count > 0) {
             printf("  %.1f dBFS mean signal power\n",
@@ -294,6 +303,11 @@ void add_stats(const struct stats *st1, const struct stats *st2, struct stats *t
         target->demod_bestPhase[i] = st1->demod_bestPhase[i] + st2->demod_bestPhase[i];
     }
 
+    for (int i = 0; i < FIFO_LATENCY_BUCKETS; i++) {
+        target->fifo_wait[i] = st1->fifo_wait[i] + st2->fifo_wait[i];
+        target->fifo_latency[i] = st1->fifo_latency[i] + st2->fifo_latency[i];
+    }
+
     target->samples_processed = st1->samples_processed + st2->samples_processed;
     target->samples_dropped = st1->samples_dropped + st2->samples_dropped;
     target->samples_lost = st1->samples_lost + st2->samples_lost;
@@ -323,9 +337,22 @@ void add_stats(const struct stats *st1, const struct stats *st2, struct stats *t
     target->fullTraceWrites = st1->fullTraceWrites + st2->fullTraceWrites;
     target->permTraceWrites = st1->permTraceWrites + st2->permTraceWrites;
 
+    target->file_writes = st1->file_writes + st2->file_writes;
+    target->file_write_bytes = st1->file_write_bytes + st2->file_write_bytes;
+    target->file_write_errors = st1->file_write_errors + st2->file_write_errors;
+    target->file_write_stalls = st1->file_write_stalls + st2->file_write_stalls;
+    target->file_write_skips = st1->file_write_skips + st2->file_write_skips;
+    target->file_write_queue_max = imax(st1->file_write_queue_max, st2->file_write_queue_max);
+    target->file_write_latency_sum = st1->file_write_latency_sum + st2->file_write_latency_sum;
+    target->file_write_latency_max = imax(st1->file_write_latency_max, st2->file_write_latency_max);
+
     // noise power:
     target->noise_power_sum = st1->noise_power_sum + st2->noise_power_sum;
     target->noise_power_count = st1->noise_power_count + st2->noise_power_count;
+    target->noise_floor_sum = st1->noise_floor_sum + st2->noise_floor_sum;
+    target->noise_floor_count = st1->noise_floor_count + st2->noise_floor_count;
+    target->demod_floor_rejected = st1->demod_floor_rejected + st2->demod_floor_rejected;
+    target->preamble_threshold = st2->preamble_threshold ? st2->preamble_threshold : st1->preamble_threshold;
 
     // mean signal power:
     target->signal_power_sum = st1->signal_power_sum + st2->signal_power_sum;
@@ -357,6 +384,8 @@ void add_stats(const struct stats *st1, const struct stats *st2, struct stats *t
 
     target->network_bytes_in = st1->network_bytes_in + st2->network_bytes_in;
     target->network_bytes_out = st1->network_bytes_out + st2->network_bytes_out;
+    target->network_sends = st1->network_sends + st2->network_sends;
+    target->network_send_syscalls = st1->network_send_syscalls + st2->network_send_syscalls;
 
     target->remote_rejected_unknown_icao = st1->remote_rejected_unknown_icao + st2->remote_rejected_unknown_icao;
     for (i = 0; i < MODES_MAX_BITERRORS + 1; ++i)
@@ -414,6 +443,8 @@ static void lockCurrent() {
     Modes.stats_current.recentTraceWrites += atomic_exchange(&Modes.recentTraceWrites, 0);
     Modes.stats_current.fullTraceWrites += atomic_exchange(&Modes.fullTraceWrites, 0);
     Modes.stats_current.permTraceWrites += atomic_exchange(&Modes.permTraceWrites, 0);
+
+    fileWriterStats(&Modes.stats_current);
 }
 static void unlockCurrent() {
 }
@@ -533,6 +564,11 @@ static char * appendStatsJson(char *p, char *end, struct stats *st, const char *
             p = safe_snprintf(p, end, ",\"signal\":%.1f", 10 * log10(st->signal_power_sum / st->signal_power_count));
         if (st->noise_power_sum > 0 && st->noise_power_count > 0)
             p = safe_snprintf(p, end, ",\"noise\":%.1f", 10 * log10(st->noise_power_sum / st->noise_power_count));
+        if (st->noise_floor_sum > 0 && st->noise_floor_count > 0)
+            p = safe_snprintf(p, end, ",\"noise_floor\":%.1f", 10 * log10(st->noise_floor_sum / st->noise_floor_count));
+        if (st->preamble_threshold)
+            p = safe_snprintf(p, end, ",\"preamble_threshold\":%d", st->preamble_threshold);
+        p = safe_snprintf(p, end, ",\"floor_rejected\":%u", st->demod_floor_rejected);
         if (st->peak_signal_power > 0)
             p = safe_snprintf(p, end, ",\"peak_signal\":%.1f", 10 * log10(st->peak_signal_power));
 
@@ -544,6 +580,14 @@ static char * appendStatsJson(char *p, char *end, struct stats *st, const char *
         for (int i = 0; i < 5; i++) p = safe_snprintf(p, end, "%9u,", st->demod_bestPhase[i]);
         p--; p = safe_snprintf(p, end, "]");
 
+        p = safe_snprintf(p, end, ",\n\"fifo_bucket_us\":[");
+        for (int i = 0; i < FIFO_LATENCY_BUCKETS - 1; i++) p = safe_snprintf(p, end, "%lld,", (long long) FIFO_LATENCY_BASE_US << i);
+        p--; p = safe_snprintf(p, end, "],\"fifo_wait\":[");
+        for (int i = 0; i < FIFO_LATENCY_BUCKETS; i++) p = safe_snprintf(p, end, "%u,", st->fifo_wait[i]);
+        p--; p = safe_snprintf(p, end, "],\"fifo_latency\":[");
+        for (int i = 0; i < FIFO_LATENCY_BUCKETS; i++) p = safe_snprintf(p, end, "%u,", st->fifo_latency[i]);
+        p--; p = safe_snprintf(p, end, "]");
+
         p = safe_snprintf(p, end, "}");
     }
 
@@ -578,6 +622,8 @@ static char * appendStatsJson(char *p, char *end, struct stats *st, const char *
 
         p = safe_snprintf(p, end, ",\"bytes_in\": %lu", (long) st->network_bytes_in);
         p = safe_snprintf(p, end, ",\"bytes_out\": %lu", (long) st->network_bytes_out);
+        p = safe_snprintf(p, end, ",\"sends\": %llu", (unsigned long long) st->network_sends);
+        p = safe_snprintf(p, end, ",\"send_syscalls\": %llu", (unsigned long long) st->network_send_syscalls);
 
         p = safe_snprintf(p, end, "}");
     }
@@ -613,6 +659,14 @@ static char * appendStatsJson(char *p, char *end, struct stats *st, const char *
                 ",\"remove_stale\":%lld}"
                 ",\"tracks\":{\"all\":%u"
                 ",\"single_message\":%u}"
+                ",\"file_writer\":{\"files\":%llu"
+                ",\"bytes\":%llu"
+                ",\"errors\":%u"
+                ",\"stalls\":%u"
+                ",\"skipped\":%u"
+                ",\"queue_max\":%u"
+                ",\"latency_avg_us\":%llu"
+                ",\"latency_max_us\":%llu}"
                 ",\"messages\":%u"
                 ",\"max_distance\":%ld"
                 "}",
@@ -646,6 +700,14 @@ static char * appendStatsJson(char *p, char *end, struct stats *st, const char *
 #undef CPU_MILLIS
             st->unique_aircraft,
             st->single_message_aircraft,
+            (unsigned long long) st->file_writes,
+            (unsigned long long) st->file_write_bytes,
+            st->file_write_errors,
+            st->file_write_stalls,
+            st->file_write_skips,
+            st->file_write_queue_max,
+            (unsigned long long) fileWriteLatencyAvg(st),
+            (unsigned long long) st->file_write_latency_max,
             st->messages_total,
             (long) st->distance_max);
     }
@@ -809,6 +871,16 @@ struct char_buffer generatePromFile(int64_t now) {
     p = safe_snprintf(p, end, "readsb_tracewrites_perm %u\n", st->permTraceWrites);
     p = safe_snprintf(p, end, "readsb_tracewrites_cycle_duration %lld\n", (long long) Modes.writeTracesActualDuration);
 
+    p = safe_snprintf(p, end, "readsb_file_writer_files %llu\n", (unsigned long long) st->file_writes);
+    p = safe_snprintf(p, end, "readsb_file_writer_bytes %llu\n", (unsigned long long) st->file_write_bytes);
+    p = safe_snprintf(p, end, "readsb_file_writer_errors %u\n", st->file_write_errors);
+    p = safe_snprintf(p, end, "readsb_file_writer_stalls %u\n", st->file_write_stalls);
+    p = safe_snprintf(p, end, "readsb_file_writer_skipped %u\n", st->file_write_skips);
+    p = safe_snprintf(p, end, "readsb_file_writer_queue %d\n", fileWriterQueueDepth());
+    p = safe_snprintf(p, end, "readsb_file_writer_queue_max %u\n", st->file_write_queue_max);
+    p = safe_snprintf(p, end, "readsb_file_writer_latency_avg_us %llu\n", (unsigned long long) fileWriteLatencyAvg(st));
+    p = safe_snprintf(p, end, "readsb_file_writer_latency_max_us %llu\n", (unsigned long long) st->file_write_latency_max);
+
 
     p = safe_snprintf(p, end, "readsb_distance_max %u\n", (uint32_t) st->distance_max);
     if (st->distance_min < 1E42)
@@ -835,6 +907,8 @@ struct char_buffer generatePromFile(int64_t now) {
 
     p = safe_snprintf(p, end, "readsb_network_bytes_in %lu\n", (long) st->network_bytes_in);
     p = safe_snprintf(p, end, "readsb_network_bytes_out %lu\n", (long) st->network_bytes_out);
+    p = safe_snprintf(p, end, "readsb_network_sends %llu\n", (unsigned long long) st->network_sends);
+    p = safe_snprintf(p, end, "readsb_network_send_syscalls %llu\n", (unsigned long long) st->network_send_syscalls);
     p = safe_snprintf(p, end, "readsb_network_malformed_beast_bytes %u\n", st->remote_malformed_beast);
 
     if (Modes.ping) {
@@ -882,6 +956,11 @@ struct char_buffer generatePromFile(int64_t now) {
             p = safe_snprintf(p, end, "readsb_signal_noise %.1f\n", 10 * log10(st->noise_power_sum / st->noise_power_count));
         else
             p = safe_snprintf(p, end, "readsb_signal_noise -50.0\n");
+        if (st->noise_floor_sum > 0 && st->noise_floor_count > 0)
+            p = safe_snprintf(p, end, "readsb_signal_noise_floor %.1f\n", 10 * log10(st->noise_floor_sum / st->noise_floor_count));
+        if (st->preamble_threshold)
+            p = safe_snprintf(p, end, "readsb_demod_preamble_threshold %d\n", st->preamble_threshold);
+        p = safe_snprintf(p, end, "readsb_demod_floor_rejected %u\n", st->demod_floor_rejected);
         if (st->peak_signal_power > 0)
             p = safe_snprintf(p, end, "readsb_signal_peak %.1f\n", 10 * log10(st->peak_signal_power));
         else
@@ -896,6 +975,15 @@ struct char_buffer generatePromFile(int64_t now) {
             p = safe_snprintf(p, end, "readsb_demod_estimated_ppm %.1f\n", Modes.estimated_ppm);
 
             p = safe_snprintf(p, end, "readsb_demod_preambles %"PRIu32"\n", st->demod_preambles);
+
+            for (int i = 0; i < FIFO_LATENCY_BUCKETS - 1; i++) {
+                p = safe_snprintf(p, end, "readsb_demod_fifo_wait_%lld %u\n", (long long) FIFO_LATENCY_BASE_US << i, st->fifo_wait[i]);
+            }
+            p = safe_snprintf(p, end, "readsb_demod_fifo_wait_inf %u\n", st->fifo_wait[FIFO_LATENCY_BUCKETS - 1]);
+            for (int i = 0; i < FIFO_LATENCY_BUCKETS - 1; i++) {
+                p = safe_snprintf(p, end, "readsb_demod_fifo_latency_%lld %u\n", (long long) FIFO_LATENCY_BASE_US << i, st->fifo_latency[i]);
+            }
+            p = safe_snprintf(p, end, "readsb_demod_fifo_latency_inf %u\n", st->fifo_latency[FIFO_LATENCY_BUCKETS - 1]);
         }
     }
     if (Modes.json_globe_index) {
@@ -949,8 +1037,8 @@ void statsCountAircraft(int64_t now) {
 
             if (Modes.json_globe_index) {
                 trace_current_size += stateBytes(a->trace_current_max);
-                trace_chunk_size += a->trace_chunk_overall_bytes;
-                struct traceCache *tCache = &a->traceCache;
+                trace_chunk_size += a->cold->trace_chunk_overall_bytes;
+                struct traceCache *tCache = &a->cold->traceCache;
                 if (tCache->entries) {
                     trace_cache_size += tCache->totalAlloc;
                 }
@@ -68,6 +68,9 @@ struct stats
   uint64_t samples_processed;
   uint64_t samples_dropped;
   uint64_t samples_lost;
+  // magnitude buffer queue latency histograms, see FIFO_LATENCY_BUCKETS
+  uint32_t fifo_wait[FIFO_LATENCY_BUCKETS];
+  uint32_t fifo_latency[FIFO_LATENCY_BUCKETS];
   // Mode A/C demodulator counts:
   uint32_t demod_modeac;
   // number of signals with power > -3dBFS
@@ -75,6 +78,13 @@ struct stats
   // noise floor:
   double noise_power_sum;
   uint64_t noise_power_count;
+  // noise floor of the demodulator (see noise_floor in demod_2400.c):
+  double noise_floor_sum;
+  uint64_t noise_floor_count;
+  // preambles passing on their own noise samples but below the noise floor
+  uint32_t demod_floor_rejected;
+  // preamble threshold in use (1/32 units), last value wins
+  int32_t preamble_threshold;
   // mean signal power:
   double signal_power_sum;
   uint64_t signal_power_count;
@@ -106,6 +116,8 @@ struct stats
   uint32_t remote_ping_rtt[PING_BUCKETS];
   uint64_t network_bytes_in;
   uint64_t network_bytes_out;
+  uint64_t network_sends; // client sends of output data, writev() or io_uring sendmsg
+  uint64_t network_send_syscalls; // writev() + io_uring_enter() calls for them
   // total messages:
   uint32_t messages_total;
   // CPR decoding:
@@ -133,6 +145,16 @@ struct stats
   uint32_t fullTraceWrites;
   uint32_t permTraceWrites;
 
+  // background file writer (file_writer.c):
+  uint64_t file_writes;
+  uint64_t file_write_bytes;
+  uint32_t file_write_errors;
+  uint32_t file_write_stalls; // queue full, the json / trace thread had to wait
+  uint32_t file_write_skips; // content unchanged, not written again
+  uint32_t file_write_queue_max; // most files queued at once
+  uint64_t file_write_latency_sum; // microseconds from queueing to rename, summed over file_writes + errors
+  uint64_t file_write_latency_max;
+
   // number of altitude messages ignored because
   // we had a recent DF17/18 altitude
   uint32_t suppressed_altitude_messages;
@@ -0,0 +1,337 @@
+#include "readsb.h"
+
+static const char zstd_magic[] = { 0x28, 0xb5, 0x2f, 0xfd };
+
+// index entry at p, returns its magic, 0 if there is none
+static uint32_t readIndex(const unsigned char *p, const unsigned char *end, struct chunkFrameIndex *idx) {
+    uint32_t header[2];
+    if (end - p < (ssize_t) CHUNK_INDEX_BYTES)
+        return 0;
+    memcpy(header, p, sizeof(header));
+    if ((header[0] != CHUNK_INDEX_MAGIC && header[0] != CHUNK_COLUMNAR_MAGIC) || header[1] != sizeof(struct chunkFrameIndex))
+        return 0;
+    memcpy(idx, p + sizeof(header), sizeof(struct chunkFrameIndex));
+    if ((ssize_t) idx->compressedSize > end - p - (ssize_t) CHUNK_INDEX_BYTES)
+        return 0;
+    return header[0];
+}
+
+int chunkIsZstd(const stateChunk *chunk) {
+    uint32_t magic;
+    if (!chunk->compressed || chunk->compressed_size < (int) sizeof(magic))
+        return 0;
+    memcpy(&magic, chunk->compressed, sizeof(magic));
+    return magic == CHUNK_INDEX_MAGIC || magic == CHUNK_COLUMNAR_MAGIC
+        || memcmp(zstd_magic, chunk->compressed, sizeof(zstd_magic)) == 0;
+}
+
+// index entry under magic followed by the zstd frame of data, the timestamps are taken from src
+static ssize_t compressFrame(ZSTD_CCtx *cctx, void *dst, size_t dstCapacity,
+        const void *data, size_t size, const fourState *src, int points, int level, uint32_t magic) {
+    if (dstCapacity < CHUNK_INDEX_BYTES) {
+        fprintf(stderr, "chunkCompressFrame(): dstCapacity too small\n");
+        return -1;
+    }
+    unsigned char *p = dst;
+    size_t compressedSize = ZSTD_compressCCtx(cctx,
+            p + CHUNK_INDEX_BYTES, dstCapacity - CHUNK_INDEX_BYTES,
+            data, size,
+            level);
+
+    if (ZSTD_isError(compressedSize)) {
+        fprintf(stderr, "chunkCompressFrame() zstd error: %s\n", ZSTD_getErrorName(compressedSize));
+        return -1;
+    }
+
+    uint32_t header[2] = { magic, sizeof(struct chunkFrameIndex) };
+    struct chunkFrameIndex idx = {
+        .numStates = points,
+        .compressedSize = compressedSize,
+        .firstTimestamp = getState((fourState *) src, 0)->timestamp,
+        .lastTimestamp = getState((fourState *) src, points - 1)->timestamp,
+    };
+    memcpy(p, header, sizeof(header));
+    memcpy(p + sizeof(header), &idx, sizeof(idx));
+
+    return CHUNK_INDEX_BYTES + compressedSize;
+}
+
+ssize_t chunkCompressFrame(ZSTD_CCtx *cctx, void *dst, size_t dstCapacity, const fourState *src, int points, int level) {
+    return compressFrame(cctx, dst, dstCapacity, src, stateBytes(points), src, points, level, CHUNK_INDEX_MAGIC);
+}
+
+// Columnar format
+//
+// uint32_t slots: state slots encoded, getFourStates(points) * SFOUR
+// uint8_t width[COLUMNS]: bits per packed value
+// uint64_t first[COLUMNS]: column value of the first slot
+// the packed values of slots 1 to slots - 1, column by column, each column padded to a full byte
+// sizeof(struct state_all) byte planes of getFourStates(points) bytes each
+
+enum { COLUMN_DELTA, COLUMN_XOR };
+
+// byte ranges of struct state, together they cover it
+static const struct column {
+    uint8_t offset;
+    uint8_t bytes; // at most 6, packed values have to fit the bit reader
+    uint8_t mode;
+} columns[] = {
+    { 0, 6, COLUMN_DELTA }, // timestamp
+    { 6, 2, COLUMN_XOR }, // flags
+    { 8, 4, COLUMN_DELTA }, // lat
+    { 12, 4, COLUMN_DELTA }, // lon
+    { 16, 2, COLUMN_DELTA }, // gs
+    { 18, 2, COLUMN_DELTA }, // track
+    { 20, 2, COLUMN_DELTA }, // baro_alt
+    { 22, 2, COLUMN_DELTA }, // baro_rate
+    { 24, 2, COLUMN_DELTA }, // geom_alt
+    { 26, 2, COLUMN_DELTA }, // geom_rate
+    { 28, 4, COLUMN_XOR }, // ias, roll, addrtype
+#if defined(TRACKS_UUID)
+    { 32, 4, COLUMN_XOR }, // receiverId
+#endif
+};
+
+#define COLUMNS ((int) (sizeof(columns) / sizeof(columns[0])))
+#define COLUMNAR_HEADER (sizeof(uint32_t) + COLUMNS * (1 + sizeof(uint64_t)))
+
+// a different layout is still encoded losslessly, just not as compactly
+_Static_assert(offsetof(struct state, lat) == 8 && offsetof(struct state, gs) == 16 && offsetof(struct state, geom_rate) == 26,
+        "columns don't match struct state");
+_Static_assert(COLUMNAR_HEADER + COLUMNS <= CHUNK_COLUMNAR_OVERHEAD, "CHUNK_COLUMNAR_OVERHEAD too small");
+
+static inline uint64_t columnMask(int bits) {
+    return (bits == 64) ? ~0ULL : (1ULL << bits) - 1;
+}
+
+static inline uint64_t columnValue(const fourState *src, int slot, const struct column *col) {
+    uint64_t value = 0;
+    memcpy(&value, (const unsigned char *) getState((fourState *) src, slot) + col->offset, col->bytes);
+    return value;
+}
+
+static inline uint64_t columnEncode(uint64_t value, uint64_t prev, const struct column *col) {
+    if (col->mode == COLUMN_XOR)
+        return value ^ prev;
+    // the difference as a signed number of the column width, zigzag keeps small ones small
+    int shift = 64 - 8 * col->bytes;
+    int64_t delta = (int64_t) ((value - prev) << shift) >> shift;
+    return ((uint64_t) delta << 1) ^ (uint64_t) (delta >> 63);
+}
+
+static inline uint64_t columnDecode(uint64_t packed, uint64_t prev, const struct column *col) {
+    if (col->mode == COLUMN_XOR)
+        return packed ^ prev;
+    uint64_t delta = (packed >> 1) ^ -(packed & 1);
+    return (prev + delta) & columnMask(8 * col->bytes);
+}
+
+size_t columnarEncode(const fourState *src, int points, unsigned char *dst) {
+    int fours = getFourStates(points);
+    uint32_t slots = fours * SFOUR;
+    unsigned char *widths = dst + sizeof(slots);
+    unsigned char *first = widths + COLUMNS;
+    unsigned char *p = dst + COLUMNAR_HEADER;
+    memcpy(dst, &slots, sizeof(slots));
+
+    for (int c = 0; c < COLUMNS; c++) {
+        const struct column *col = &columns[c];
+        uint64_t prev = columnValue(src, 0, col);
+        memcpy(first + c * sizeof(uint64_t), &prev, sizeof(uint64_t));
+
+        uint64_t any = 0;
+        for (uint32_t i = 1; i < slots; i++) {
+            uint64_t value = columnValue(src, i, col);
+            any |= columnEncode(value, prev, col);
+            prev = value;
+        }
+        int width = any ? 64 - __builtin_clzll(any) : 0;
+        widths[c] = width;
+        if (!width)
+            continue;
+
+        prev = columnValue(src, 0, col);
+        uint64_t acc = 0;
+        int bits = 0;
+        for (uint32_t i = 1; i < slots; i++) {
+            uint64_t value = columnValue(src, i, col);
+            acc |= columnEncode(value, prev, col) << bits;
+            prev = value;
+            bits += width;
+            for (; bits >= 8; bits -= 8) {
+                *p++ = acc;
+                acc >>= 8;
+            }
+        }
+        if (bits)
+            *p++ = acc;
+    }
+
+    for (size_t k = 0; k < sizeof(struct state_all); k++) {
+        unsigned char prev = 0;
+        for (int i = 0; i < fours; i++) {
+            unsigned char byte = ((const unsigned char *) &src[i].zeroAll)[k];
+            *p++ = byte ^ prev;
+            prev = byte;
+        }
+    }
+
+    return p - dst;
+}
+
+int columnarDecode(const unsigned char *src, size_t size, fourState *dst, int points) {
+    int fours = getFourStates(points);
+    uint32_t slots;
+    if (size < COLUMNAR_HEADER)
+        return -1;
+    memcpy(&slots, src, sizeof(slots));
+    if (slots != (uint32_t) fours * SFOUR)
+        return -1;
+    const unsigned char *widths = src + sizeof(slots);
+    const unsigned char *first = widths + COLUMNS;
+    const unsigned char *p = src + COLUMNAR_HEADER;
+    const unsigned char *end = src + size;
+
+    for (int c = 0; c < COLUMNS; c++) {
+        const struct column *col = &columns[c];
+        int width = widths[c];
+        if (width > 8 * col->bytes || (size_t) (end - p) < ((size_t) width * (slots - 1) + 7) / 8)
+            return -1;
+
+        uint64_t prev;
+        memcpy(&prev, first + c * sizeof(uint64_t), sizeof(uint64_t));
+        if (prev & ~columnMask(8 * col->bytes))
+            return -1;
+        uint64_t mask = columnMask(width);
+        uint64_t acc = 0;
+        int bits = 0;
+        for (uint32_t i = 0; i < slots; i++) {
+            if (i > 0) {
+                while (bits < width) {
+                    acc |= (uint64_t) *p++ << bits;
+                    bits += 8;
+                }
+                prev = columnDecode(acc & mask, prev, col);
+                acc >>= width;
+                bits -= width;
+            }
+            memcpy((unsigned char *) getState(dst, i) + col->offset, &prev, col->bytes);
+        }
+    }
+
+    if ((size_t) (end - p) != sizeof(struct state_all) * fours)
+        return -1;
+    for (size_t k = 0; k < sizeof(struct state_all); k++) {
+        unsigned char prev = 0;
+        for (int i = 0; i < fours; i++) {
+            prev ^= *p++;
+            ((unsigned char *) &dst[i].zeroAll)[k] = prev;
+        }
+    }
+    return 0;
+}
+
+ssize_t chunkCompressColumnar(ZSTD_CCtx *cctx, void *dst, size_t dstCapacity, const fourState *src, int points, int level) {
+    unsigned char *encoded = cmalloc(stateBytes(points) + CHUNK_COLUMNAR_OVERHEAD);
+    if (!encoded)
+        return -1;
+    size_t size = columnarEncode(src, points, encoded);
+    ssize_t res = compressFrame(cctx, dst, dstCapacity, encoded, size, src, points, level, CHUNK_COLUMNAR_MAGIC);
+    sfree(encoded);
+    return res;
+}
+
+int chunkSeek(const stateChunk *chunk, int keepPoints, int64_t after_timestamp, int *offset) {
+    *offset = 0;
+    if (keepPoints < 0 && after_timestamp <= 0)
+        return 0;
+
+    const unsigned char *start = chunk->compressed;
+    const unsigned char *end = start + chunk->compressed_size;
+    const unsigned char *p = start;
+    int skipped = 0;
+    struct chunkFrameIndex idx;
+
+    // the last frame is always kept
+    while (readIndex(p, end, &idx)) {
+        const unsigned char *next = p + CHUNK_INDEX_BYTES + idx.compressedSize;
+        if (next >= end)
+            break;
+        int after = chunk->numStates - skipped - (int) idx.numStates;
+        int skip;
+        if (keepPoints >= 0)
+            skip = (after >= keepPoints);
+        else
+            skip = (idx.lastTimestamp < after_timestamp);
+        if (!skip || idx.numStates % SFOUR != 0)
+            break;
+        skipped += idx.numStates;
+        p = next;
+    }
+
+    *offset = p - start;
+    return skipped;
+}
+
+int chunkDecompress(ZSTD_DCtx *dctx, const stateChunk *chunk, int offset, int skipped, fourState *dst) {
+    const unsigned char *p = chunk->compressed + offset;
+    const unsigned char *end = chunk->compressed + chunk->compressed_size;
+    unsigned char *out = (unsigned char *) dst;
+    size_t capacity = stateBytes(chunk->numStates - skipped);
+    unsigned char *encoded = NULL; // columnar frames are decompressed here first
+    int err = -1;
+
+    // frame by frame, frames of the same chunk can differ in format
+    while (p < end) {
+        struct chunkFrameIndex idx;
+        size_t frameSize;
+        uint32_t magic = readIndex(p, end, &idx);
+        if (magic) {
+            p += CHUNK_INDEX_BYTES;
+            frameSize = idx.compressedSize;
+        } else {
+            // frame written before chunks were indexed
+            frameSize = ZSTD_findFrameCompressedSize(p, end - p);
+            if (ZSTD_isError(frameSize)) {
+                fprintf(stderr, "chunkDecompress() zstd error: %s\n", ZSTD_getErrorName(frameSize));
+                goto out;
+            }
+        }
+
+        if (magic == CHUNK_COLUMNAR_MAGIC) {
+            size_t frameBytes = stateBytes(idx.numStates);
+            if (frameBytes > capacity) {
+                fprintf(stderr, "chunkDecompress(): columnar frame larger than the chunk\n");
+                goto out;
+            }
+            if (!encoded && !(encoded = cmalloc(capacity + CHUNK_COLUMNAR_OVERHEAD)))
+                goto out;
+            size_t res = ZSTD_decompressDCtx(dctx, encoded, frameBytes + CHUNK_COLUMNAR_OVERHEAD, p, frameSize);
+            if (ZSTD_isError(res)) {
+                fprintf(stderr, "chunkDecompress() zstd error: %s\n", ZSTD_getErrorName(res));
+                goto out;
+            }
+            if (columnarDecode(encoded, res, (fourState *) out, idx.numStates) != 0) {
+                fprintf(stderr, "chunkDecompress(): corrupt columnar frame\n");
+                goto out;
+            }
+            out += frameBytes;
+            capacity -= frameBytes;
+            p += frameSize;
+            continue;
+        }
+
+        size_t res = ZSTD_decompressDCtx(dctx, out, capacity, p, frameSize);
+        if (ZSTD_isError(res)) {
+            fprintf(stderr, "chunkDecompress() zstd error: %s\n", ZSTD_getErrorName(res));
+            goto out;
+        }
+        out += res;
+        capacity -= res;
+        p += frameSize;
+    }
+    err = 0;
+out:
+    sfree(encoded);
+    return err;
+}
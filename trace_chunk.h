@@ -0,0 +1,62 @@
+#ifndef TRACE_CHUNK_H
+#define TRACE_CHUNK_H
+
+// Compressed trace chunks (stateChunk.compressed)
+//
+// A chunk is a sequence of zstd frames, compressChunk() appends one every time it extends the chunk.
+// Each frame is preceded by a zstd skippable frame holding its index entry, so a reader can find the
+// frames covering the points it needs without decompressing the others. zstd itself skips the index
+// frames, chunkDecompress() still goes frame by frame as frames can differ in format.
+// Chunks from older versions have no index entries and are always decompressed in full.
+//
+// With --trace-columnar the frames are written in the columnar format: the index entry is the same but
+// under CHUNK_COLUMNAR_MAGIC, and the zstd frame doesn't hold the fourState array but the points
+// transposed into columns. Timestamp, position, speed, track, altitudes and rates are delta and zigzag
+// encoded, flags and the remaining bit fields XORed with the previous point, each column bit packed to
+// the widest value it holds. The state_all of each fourState is XORed with the previous one and stored
+// byte plane by byte plane. Decoding restores the fourState array byte for byte.
+
+#define CHUNK_INDEX_MAGIC (ZSTD_MAGIC_SKIPPABLE_START + 0xa)
+#define CHUNK_COLUMNAR_MAGIC (ZSTD_MAGIC_SKIPPABLE_START + 0xb)
+// columnar header and the byte padding of the columns, the packed columns never exceed stateBytes()
+#define CHUNK_COLUMNAR_OVERHEAD (256)
+
+struct chunkFrameIndex {
+    uint32_t numStates; // points in the following zstd frame, a multiple of SFOUR
+    uint32_t compressedSize; // size of the following zstd frame
+    int64_t firstTimestamp;
+    int64_t lastTimestamp;
+};
+
+// skippable frame header + index entry
+#define CHUNK_INDEX_BYTES (2 * sizeof(uint32_t) + sizeof(struct chunkFrameIndex))
+
+static inline size_t chunkFrameBound(int points) {
+    return CHUNK_INDEX_BYTES + ZSTD_compressBound(stateBytes(points) + CHUNK_COLUMNAR_OVERHEAD);
+}
+
+// zstd compressed, with or without index, in either format
+int chunkIsZstd(const stateChunk *chunk);
+
+// write the index entry and the zstd frame for points from src to dst
+// returns the number of bytes written, -1 on error
+ssize_t chunkCompressFrame(ZSTD_CCtx *cctx, void *dst, size_t dstCapacity, const fourState *src, int points, int level);
+// same in the columnar format
+ssize_t chunkCompressColumnar(ZSTD_CCtx *cctx, void *dst, size_t dstCapacity, const fourState *src, int points, int level);
+
+// the columnar transform on its own, dst must hold stateBytes(points) + CHUNK_COLUMNAR_OVERHEAD
+// returns the number of bytes written
+size_t columnarEncode(const fourState *src, int points, unsigned char *dst);
+// dst must hold stateBytes(points), returns 0 on success, -1 if src isn't a valid encoding of points
+int columnarDecode(const unsigned char *src, size_t size, fourState *dst, int points);
+
+// find where decompression has to start for a read that needs the last keepPoints points of the chunk
+// (keepPoints >= 0) or the points at or after after_timestamp (after_timestamp > 0), otherwise the whole chunk
+// returns the number of leading points skipped, *offset is set to the first byte to decompress
+int chunkSeek(const stateChunk *chunk, int keepPoints, int64_t after_timestamp, int *offset);
+
+// decompress the chunk from offset (as returned by chunkSeek together with skipped) into dst
+// dst must hold stateBytes(chunk->numStates - skipped), returns 0 on success
+int chunkDecompress(ZSTD_DCtx *dctx, const stateChunk *chunk, int offset, int skipped, fourState *dst);
+
+#endif
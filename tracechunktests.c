@@ -0,0 +1,269 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// tracechunktests.c: round trip tests for the trace chunk formats
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "readsb.h"
+
+struct _Modes Modes;
+
+void setExit(int arg) {
+    exit(arg);
+}
+
+// Points as to_state() / to_state_all() write them for an aircraft on a flight: the same scaling,
+// validity flags and bit fields, with the aircraft values made up instead of decoded.
+static fourState *flightPoints(int len, int64_t start) {
+    fourState *fs = cmalloc(stateBytes(len));
+    memset(fs, 0, stateBytes(len));
+    double lat = 50.03, lon = 8.57, track = 250, alt = 0, rate = 0, gs = 0, roll = 0;
+    int64_t now = start;
+    for (int i = 0; i < len; i++) {
+        struct state *new = getState(fs, i);
+        int64_t elapsed = 1000 + random() % 12000;
+        now += elapsed;
+        int on_ground = (i < len / 8);
+        if (on_ground) {
+            gs = fmin(gs + 3, 30);
+        } else {
+            gs = fmin(gs + 20, 460);
+            rate = (alt < 36000) ? 2400 - random() % 600 : (random() % 3 - 1) * 64;
+            alt = fmin(alt + rate * elapsed / 60000, 36000);
+            roll = (random() % 8 == 0) ? -(random() % 25) : 0;
+            track = fmod(track + roll / 10 + 360, 360);
+        }
+        lat += cos(track * M_PI / 180) * gs * elapsed / 3600e3 / 60;
+        lon += sin(track * M_PI / 180) * gs * elapsed / 3600e3 / 60 / cos(lat * M_PI / 180);
+
+        new->timestamp = now;
+        new->lat = (int32_t) nearbyint(lat * 1E6);
+        new->lon = (int32_t) nearbyint(lon * 1E6);
+        new->stale = (random() % 50 == 0);
+        new->on_ground = on_ground;
+        new->leg_marker = (i == len / 2);
+        new->gs_valid = 1;
+        new->gs = (uint16_t) nearbyint(gs * _gs_factor);
+        new->track = (uint16_t) nearbyint(track * _track_factor);
+        new->track_valid = 1;
+        if (!on_ground) {
+            new->baro_alt_valid = 1;
+            new->baro_alt = (int16_t) nearbyint(alt * _alt_factor);
+            new->baro_rate_valid = 1;
+            new->baro_rate = (int16_t) nearbyint(rate * _rate_factor);
+            new->geom_alt_valid = 1;
+            new->geom_alt = (int16_t) nearbyint((alt + 475) * _alt_factor);
+            new->geom_rate_valid = (random() % 4 != 0);
+            new->geom_rate = new->geom_rate_valid ? (int16_t) nearbyint(rate * _rate_factor) : 0;
+            new->ias_valid = 1;
+            new->ias = gs * 0.6;
+            new->roll_valid = 1;
+            new->roll = (int16_t) nearbyint(roll * _roll_factor);
+        }
+        new->addrtype = ADDR_ADSB_ICAO;
+#if defined(TRACKS_UUID)
+        new->receiverId = random();
+#endif
+
+        struct state_all *all = getStateAll(fs, i);
+        if (all) {
+            memcpy(all->callsign, "DLH4AB  ", 8);
+            all->callsign_valid = 1;
+            all->squawk = 0x2341;
+            all->squawk_valid = 1;
+            all->category = 0xA3;
+            all->nav_altitude_mcp = (int16_t) nearbyint(36000 / 4.0f);
+            all->nav_qnh = (int16_t) nearbyint(1013.2 * 10.0f);
+            all->nav_heading = (uint16_t) nearbyint(track * _track_factor);
+            all->mach = (int16_t) nearbyint(0.78 * 1000.0f);
+            all->wind_direction = -170 + random() % 20;
+            all->wind_speed = 40;
+            all->oat = -52;
+            all->adsb_version = 2;
+            all->adsr_version = 15;
+            all->tisb_version = 15;
+            all->pos_nic = 8;
+            all->pos_rc = 186;
+        }
+    }
+    return fs;
+}
+
+// anything the bit fields can hold, padding included
+static fourState *randomPoints(int len) {
+    fourState *fs = cmalloc(stateBytes(len));
+    unsigned char *p = (unsigned char *) fs;
+    for (ssize_t k = 0; k < stateBytes(len); k++)
+        p[k] = random();
+    return fs;
+}
+
+static int compareStates(const char *test, fourState *expected, fourState *actual, int len) {
+    for (int i = 0; i < len; i++) {
+        if (memcmp(getState(expected, i), getState(actual, i), sizeof(struct state))) {
+            fprintf(stderr, "%s: FAIL: point %d differs, timestamp %lld lat %d lon %d, decoded %lld %d %d\n",
+                    test, i,
+                    (long long) getState(expected, i)->timestamp, getState(expected, i)->lat, getState(expected, i)->lon,
+                    (long long) getState(actual, i)->timestamp, getState(actual, i)->lat, getState(actual, i)->lon);
+            return 0;
+        }
+        struct state_all *all = getStateAll(expected, i);
+        if (all && memcmp(all, getStateAll(actual, i), sizeof(struct state_all))) {
+            fprintf(stderr, "%s: FAIL: state_all of point %d differs\n", test, i);
+            return 0;
+        }
+    }
+    // the unused slots of the last fourState come back as well
+    if (memcmp(expected, actual, stateBytes(len))) {
+        fprintf(stderr, "%s: FAIL: padding slots differ\n", test);
+        return 0;
+    }
+    return 1;
+}
+
+static int testEncode(const char *test, fourState *fs, int len) {
+    unsigned char *encoded = cmalloc(stateBytes(len) + CHUNK_COLUMNAR_OVERHEAD);
+    fourState *decoded = cmalloc(stateBytes(len));
+    memset(decoded, 0xaa, stateBytes(len));
+    size_t size = columnarEncode(fs, len, encoded);
+    int ok = 1;
+    if (size > (size_t) stateBytes(len) + CHUNK_COLUMNAR_OVERHEAD) {
+        fprintf(stderr, "%s: FAIL: %zu bytes encoded, more than the bound\n", test, size);
+        ok = 0;
+    } else if (columnarDecode(encoded, size, decoded, len) != 0) {
+        fprintf(stderr, "%s: FAIL: columnarDecode() failed\n", test);
+        ok = 0;
+    } else {
+        ok = compareStates(test, fs, decoded, len);
+    }
+    // truncated or padded input is rejected
+    if (ok && (columnarDecode(encoded, size - 1, decoded, len) == 0 || columnarDecode(encoded, size, decoded, len + SFOUR) == 0)) {
+        fprintf(stderr, "%s: FAIL: corrupt input decoded\n", test);
+        ok = 0;
+    }
+    if (ok)
+        fprintf(stderr, "%s: PASS (%d points, %zu -> %zu bytes)\n", test, len, (size_t) stateBytes(len), size);
+    sfree(encoded);
+    sfree(decoded);
+    return ok;
+}
+
+static int testColumnarEncode() {
+    int ok = 1;
+    char name[64];
+    // full and partial fourStates
+    for (int len = 1; len <= 9; len++) {
+        fourState *fs = flightPoints(len, 1700000000000LL);
+        snprintf(name, sizeof(name), "testColumnarEncode[flight %d]", len);
+        ok &= testEncode(name, fs, len);
+        sfree(fs);
+    }
+    fourState *fs = flightPoints(Modes.traceChunkPoints, 1700000000000LL);
+    ok &= testEncode("testColumnarEncode[flight chunk]", fs, Modes.traceChunkPoints);
+    sfree(fs);
+
+    fs = randomPoints(Modes.traceChunkPoints);
+    ok &= testEncode("testColumnarEncode[random bytes]", fs, Modes.traceChunkPoints);
+    sfree(fs);
+
+    // the largest deltas each column can hold
+    fs = flightPoints(16, 1700000000000LL);
+    for (int i = 0; i < 16; i += 2) {
+        struct state *st = getState(fs, i);
+        st->timestamp = (i % 4) ? -(1LL << 47) : (1LL << 47) - 1;
+        st->lat = (i % 4) ? INT32_MIN : INT32_MAX;
+        st->lon = (i % 4) ? INT32_MAX : INT32_MIN;
+        st->gs = (i % 4) ? 0 : UINT16_MAX;
+        st->baro_alt = (i % 4) ? INT16_MIN : INT16_MAX;
+        st->roll = (i % 4) ? -2048 : 2047;
+    }
+    ok &= testEncode("testColumnarEncode[extremes]", fs, 16);
+    sfree(fs);
+    return ok;
+}
+
+// chunks as compressChunk() builds them: frames appended to the last chunk, old and new formats mixed
+static int testChunkRoundTrip() {
+    int ok = 1;
+    int frames = 6;
+    int framePoints = Modes.traceChunkPoints;
+    int len = frames * framePoints - 3;
+    fourState *fs = flightPoints(len, 1700000000000LL);
+    ZSTD_CCtx *cctx = ZSTD_createCCtx();
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+
+    for (int mixed = 0; mixed <= 1; mixed++) {
+        const char *test = mixed ? "testChunkRoundTrip[mixed]" : "testChunkRoundTrip[columnar]";
+        unsigned char *compressed = cmalloc(frames * chunkFrameBound(framePoints));
+        int size = 0;
+        for (int f = 0; f < frames; f++) {
+            int points = imin(framePoints, len - f * framePoints);
+            fourState *src = fs + f * framePoints / SFOUR;
+            ssize_t res;
+            if (mixed && f % 2 == 0)
+                res = chunkCompressFrame(cctx, compressed + size, chunkFrameBound(points), src, points, 2);
+            else
+                res = chunkCompressColumnar(cctx, compressed + size, chunkFrameBound(points), src, points, 2);
+            if (res < 0) {
+                fprintf(stderr, "%s: FAIL: compression failed\n", test);
+                ok = 0;
+                break;
+            }
+            size += res;
+        }
+        stateChunk chunk = { compressed, size, len, getState(fs, 0)->timestamp, getState(fs, len - 1)->timestamp };
+        fourState *out = cmalloc(stateBytes(len));
+
+        if (!chunkIsZstd(&chunk) || chunkDecompress(dctx, &chunk, 0, 0, out) != 0) {
+            fprintf(stderr, "%s: FAIL: chunkDecompress() failed\n", test);
+            ok = 0;
+        } else if (compareStates(test, fs, out, len)) {
+            fprintf(stderr, "%s: PASS (%d points, %zu -> %d bytes)\n", test, len, (size_t) stateBytes(len), size);
+        } else {
+            ok = 0;
+        }
+
+        // reads of the recent points only decompress the frames they need
+        int offset;
+        int keep = framePoints + 10;
+        int skipped = chunkSeek(&chunk, keep, -1, &offset);
+        if (skipped != (frames - 2) * framePoints
+                || chunkDecompress(dctx, &chunk, offset, skipped, out) != 0
+                || memcmp(out, fs + skipped / SFOUR, stateBytes(len - skipped))) {
+            fprintf(stderr, "%s: FAIL: seek skipped %d points\n", test, skipped);
+            ok = 0;
+        } else {
+            fprintf(stderr, "%s: PASS (seek, %d points skipped)\n", test, skipped);
+        }
+
+        sfree(out);
+        sfree(compressed);
+    }
+
+    ZSTD_freeCCtx(cctx);
+    ZSTD_freeDCtx(dctx);
+    sfree(fs);
+    return ok;
+}
+
+int main(int __attribute__ ((unused)) argc, char __attribute__ ((unused)) **argv) {
+    int ok = 1;
+    srandom(42);
+    Modes.traceChunkPoints = alignSFOUR(4 * 64);
+
+    ok &= testColumnarEncode();
+    ok &= testChunkRoundTrip();
+
+    return ok ? 0 : 1;
+}
@@ -81,6 +81,15 @@ static uint16_t simpleHash(uint64_t receiverId) {
 
 static float knots_to_meterpersecond = (1852.0 / 3600.0);
 
+// with --decode-threads > 1 several track shards run concurrently,
+// they count into the stats of their message buffer which is merged by trackMergeStats
+static inline struct stats *trackStats(struct modesMessage *mm) {
+    if (Modes.decodeThreads > 1 && mm->messageBuffer) {
+        return &mm->messageBuffer->trackStats;
+    }
+    return &Modes.stats_current;
+}
+
 static void calculateMessageRateGlobal(int64_t now) {
     float sum = 0.0f;
     float mult = REMOVE_STALE_INTERVAL / 1000.0f;
@@ -249,7 +258,20 @@ static int compare_validity(const data_validity *lhs, const data_validity *rhs)
         return 0;
 }
 
-static void update_range_histogram(struct aircraft *a, int64_t now) {
+static void update_range_histogram_locked(struct aircraft *a, struct modesMessage *mm, int64_t now);
+
+static void update_range_histogram(struct aircraft *a, struct modesMessage *mm, int64_t now) {
+    // the range outline is global, track shards need to take turns
+    if (Modes.decodeThreads > 1) {
+        pthread_mutex_lock(&Modes.trackSharedLock);
+        update_range_histogram_locked(a, mm, now);
+        pthread_mutex_unlock(&Modes.trackSharedLock);
+    } else {
+        update_range_histogram_locked(a, mm, now);
+    }
+}
+
+static void update_range_histogram_locked(struct aircraft *a, struct modesMessage *mm, int64_t now) {
 
     double lat = a->lat;
     double lon = a->lon;
@@ -294,10 +316,10 @@ static void update_range_histogram(struct aircraft *a, int64_t now) {
         }
     }
 
-    if (range > Modes.stats_current.distance_max)
-        Modes.stats_current.distance_max = range;
-    if (range < Modes.stats_current.distance_min)
-        Modes.stats_current.distance_min = range;
+    if (range > trackStats(mm)->distance_max)
+        trackStats(mm)->distance_max = range;
+    if (range < trackStats(mm)->distance_min)
+        trackStats(mm)->distance_min = range;
 
     int bucket = round(range / Modes.maxRange * RANGE_BUCKET_COUNT);
 
@@ -306,7 +328,7 @@ static void update_range_histogram(struct aircraft *a, int64_t now) {
     else if (bucket >= RANGE_BUCKET_COUNT)
         bucket = RANGE_BUCKET_COUNT - 1;
 
-    ++Modes.stats_current.range_histogram[bucket];
+    ++trackStats(mm)->range_histogram[bucket];
 }
 
 static int cpr_duplicate_check(int64_t now, struct aircraft *a, struct modesMessage *mm) {
@@ -818,7 +840,7 @@ static int doGlobalCPR(struct aircraft *a, struct modesMessage *mm, double *lat,
             }
 
             if (mm->source != SOURCE_MLAT) {
-                Modes.stats_current.cpr_global_range_checks++;
+                trackStats(mm)->cpr_global_range_checks++;
                 if (Modes.debug_maxRange) {
                     showPositionDebug(a, mm, mm->sysTimestamp, *lat, *lon);
                 }
@@ -830,7 +852,7 @@ static int doGlobalCPR(struct aircraft *a, struct modesMessage *mm, double *lat,
     // check speed limit
     if (!speed_check(a, mm->source, *lat, *lon, mm, CPR_GLOBAL)) {
         if (mm->source != SOURCE_MLAT)
-            Modes.stats_current.cpr_global_speed_checks++;
+            trackStats(mm)->cpr_global_speed_checks++;
         return -2;
     }
 
@@ -918,7 +940,7 @@ static int doLocalCPR(struct aircraft *a, struct modesMessage *mm, double *lat,
         double range = greatcircle(reflat, reflon, *lat, *lon, 0);
         if (range > range_limit) {
             if (mm->source != SOURCE_MLAT)
-                Modes.stats_current.cpr_local_range_checks++;
+                trackStats(mm)->cpr_local_range_checks++;
             return (-1);
         }
     }
@@ -935,7 +957,7 @@ static int doLocalCPR(struct aircraft *a, struct modesMessage *mm, double *lat,
             }
 
             if (mm->source != SOURCE_MLAT) {
-                Modes.stats_current.cpr_local_range_checks++;
+                trackStats(mm)->cpr_local_range_checks++;
                 if (Modes.debug_maxRange) {
                     showPositionDebug(a, mm, mm->sysTimestamp, *lat, *lon);
                 }
@@ -948,7 +970,7 @@ static int doLocalCPR(struct aircraft *a, struct modesMessage *mm, double *lat,
     // check speed limit
     if (!speed_check(a, mm->source, *lat, *lon, mm, CPR_LOCAL)) {
         if (mm->source != SOURCE_MLAT)
-            Modes.stats_current.cpr_local_speed_checks++;
+            trackStats(mm)->cpr_local_speed_checks++;
         return -2;
     }
 
@@ -993,12 +1015,12 @@ static void setPosition(struct aircraft *a, struct modesMessage *mm, int64_t now
         return;
     }
 
-    Modes.stats_current.pos_by_type[mm->addrtype]++;
-    Modes.stats_current.pos_all++;
+    trackStats(mm)->pos_by_type[mm->addrtype]++;
+    trackStats(mm)->pos_all++;
 
     // mm->pos_bad should never arrive here, handle it just in case
     if (mm->cpr_valid && (mm->garbage || mm->pos_bad)) {
-        Modes.stats_current.pos_garbage++;
+        trackStats(mm)->pos_garbage++;
         return;
     }
 
@@ -1007,7 +1029,7 @@ static void setPosition(struct aircraft *a, struct modesMessage *mm, int64_t now
     }
 
     if (mm->duplicate) {
-        Modes.stats_current.pos_duplicate++;
+        trackStats(mm)->pos_duplicate++;
         return;
     }
 
@@ -1081,7 +1103,7 @@ static void setPosition(struct aircraft *a, struct modesMessage *mm, int64_t now
     {
         int done = 0;
         for (int i = 0; i < RECENT_RECEIVER_IDS; i++) {
-            idTime *entry = &a->recentReceiverIds[i];
+            idTime *entry = &a->cold->recentReceiverIds[i];
             if (entry->id == mm->receiverId) {
                 entry->time = now;
                 done = 1;
@@ -1089,8 +1111,8 @@ static void setPosition(struct aircraft *a, struct modesMessage *mm, int64_t now
             }
         }
         if (!done) {
-            a->recentReceiverIdsNext = (a->recentReceiverIdsNext + 1) % RECENT_RECEIVER_IDS;
-            idTime *entry = &a->recentReceiverIds[a->recentReceiverIdsNext];
+            a->cold->recentReceiverIdsNext = (a->cold->recentReceiverIdsNext + 1) % RECENT_RECEIVER_IDS;
+            idTime *entry = &a->cold->recentReceiverIds[a->cold->recentReceiverIdsNext];
             entry->id = mm->receiverId;
             entry->time = now;
         }
@@ -1106,7 +1128,7 @@ static void setPosition(struct aircraft *a, struct modesMessage *mm, int64_t now
         if (
                 (valid_elapsed > 10 * MINUTES || override_elapsed < 10 * MINUTES)
                 && (mm->msgtype == 17 || (mm->addrtype == ADDR_ADSB_ICAO_NT && mm->cpr_type != CPR_SURFACE
-                        && !(a->dbFlags & (1 << 7)) && ((a->addr >= 0xa00000 && a->addr <= 0xafffff) || (a->dbFlags & (1 << 0))) ))
+                        && !(a->cold->dbFlags & (1 << 7)) && ((a->addr >= 0xa00000 && a->addr <= 0xafffff) || (a->cold->dbFlags & (1 << 0))) ))
                 && mm->cpr_valid
                 && status_elapsed > 5 * MINUTES
            ) {
@@ -1125,7 +1147,7 @@ static void setPosition(struct aircraft *a, struct modesMessage *mm, int64_t now
                             (int) imin(9999, (override_elapsed / 1000)),
                             a->receiverCount,
                             uuid,
-                            a->dbFlags,
+                            a->cold->dbFlags,
                             mm->msgtype);
                 }
                 if (!(Modes.debug_lastStatus & 2)) {
@@ -1203,7 +1225,7 @@ static void setPosition(struct aircraft *a, struct modesMessage *mm, int64_t now
             a->receiver_direction = bearing(Modes.fUserLat, Modes.fUserLon, a->lat, a->lon);
 
             if (mm->source == SOURCE_ADSB || mm->source == SOURCE_ADSR) {
-                update_range_histogram(a, now);
+                update_range_histogram(a, mm, now);
             }
 
         }
@@ -1232,7 +1254,7 @@ static void updatePosition(struct aircraft *a, struct modesMessage *mm, int64_t
 
     if (surface) {
         if (mm->source != SOURCE_MLAT)
-            Modes.stats_current.cpr_surface++;
+            trackStats(mm)->cpr_surface++;
 
         // Surface: 25 seconds if >25kt or speed unknown, 50 seconds otherwise
         if (mm->gs_valid && mm->gs.selected <= 25)
@@ -1241,7 +1263,7 @@ static void updatePosition(struct aircraft *a, struct modesMessage *mm, int64_t
             max_elapsed = 25000;
     } else {
         if (mm->source != SOURCE_MLAT)
-            Modes.stats_current.cpr_airborne++;
+            trackStats(mm)->cpr_airborne++;
 
         // Airborne: 10 seconds
         max_elapsed = 10000;
@@ -1262,7 +1284,7 @@ static void updatePosition(struct aircraft *a, struct modesMessage *mm, int64_t
             // Global CPR failed because the position produced implausible results.
             // This is bad data.
             if (mm->source != SOURCE_MLAT)
-                Modes.stats_current.cpr_global_bad++;
+                trackStats(mm)->cpr_global_bad++;
 
             mm->pos_bad = 1;
 
@@ -1278,16 +1300,16 @@ static void updatePosition(struct aircraft *a, struct modesMessage *mm, int64_t
             // No local reference for surface position available, or the two messages crossed a zone.
             // Nonfatal, try again later.
             if (mm->source != SOURCE_MLAT)
-                Modes.stats_current.cpr_global_skipped++;
+                trackStats(mm)->cpr_global_skipped++;
         } else {
             if (accept_data(&a->position_valid, mm->source, mm, a, REDUCE_OFTEN)) {
                 if (mm->source != SOURCE_MLAT)
-                    Modes.stats_current.cpr_global_ok++;
+                    trackStats(mm)->cpr_global_ok++;
 
                 globalCPR = 1;
             } else {
                 if (mm->source != SOURCE_MLAT)
-                    Modes.stats_current.cpr_global_skipped++;
+                    trackStats(mm)->cpr_global_skipped++;
                 location_result = -2;
             }
         }
@@ -1311,20 +1333,20 @@ static void updatePosition(struct aircraft *a, struct modesMessage *mm, int64_t
             mm->decoded_lon = new_lon;
         } else if (location_result >= 0 && accept_data(&a->position_valid, mm->source, mm, a, REDUCE_OFTEN)) {
             if (mm->source != SOURCE_MLAT)
-                Modes.stats_current.cpr_local_ok++;
+                trackStats(mm)->cpr_local_ok++;
             mm->cpr_relative = 1;
 
             if (location_result == 1) {
                 if (mm->source != SOURCE_MLAT)
-                    Modes.stats_current.cpr_local_aircraft_relative++;
+                    trackStats(mm)->cpr_local_aircraft_relative++;
             }
             if (location_result == 2) {
                 if (mm->source != SOURCE_MLAT)
-                    Modes.stats_current.cpr_local_receiver_relative++;
+                    trackStats(mm)->cpr_local_receiver_relative++;
             }
         } else {
             if (mm->source != SOURCE_MLAT)
-                Modes.stats_current.cpr_local_skipped++;
+                trackStats(mm)->cpr_local_skipped++;
             location_result = -1;
         }
     }
@@ -1805,13 +1827,18 @@ discard_alt:
 
 struct aircraft *trackUpdateFromMessage(struct modesMessage *mm) {
     struct aircraft *res = NULL;
+    struct aircraft *changed = NULL;
     int64_t now = mm->sysTimestamp;
 
-    ++Modes.stats_current.messages_total;
+    ++trackStats(mm)->messages_total;
 
-    Modes.messageRateAcc[0]++;
-    if (now > Modes.nextMessageRateCalc) {
-        calculateMessageRateGlobal(now);
+    if (Modes.decodeThreads > 1) {
+        mm->messageBuffer->messageRateAcc++;
+    } else {
+        Modes.messageRateAcc[0]++;
+        if (now > Modes.nextMessageRateCalc) {
+            calculateMessageRateGlobal(now);
+        }
     }
 
     if (mm->msgtype == DFTYPE_MODEAC) {
@@ -1860,11 +1887,12 @@ struct aircraft *trackUpdateFromMessage(struct modesMessage *mm) {
             goto exit;
         }
     }
+    changed = a;
 
     struct aircraft scratch;
     bool haveScratch = false;
     if (mm->cpr_valid || mm->sbs_pos_valid) {
-        memcpy(&scratch, a, offsetof(struct aircraft, traceCache));
+        memcpy(&scratch, a, offsetof(struct aircraft, zeroEnd));
         haveScratch = true;
         // messages from receivers classified garbage with position get processed to see if they still send garbage
     } else if (mm->garbage) {
@@ -2502,14 +2530,14 @@ struct aircraft *trackUpdateFromMessage(struct modesMessage *mm) {
         double reflon;
         struct receiver *r = receiverGetReference(mm->receiverId, &reflat, &reflon, a, 1);
         if (r) {
-            if (now - a->rr_seen < 600 * SECONDS && fabs(a->lon - reflon) < 5 && fabs(a->lon - reflon) < 5) {
-                a->rr_lat = 0.1 * reflat + 0.9 * a->rr_lat;
-                a->rr_lon = 0.1 * reflon + 0.9 * a->rr_lon;
+            if (now - a->cold->rr_seen < 600 * SECONDS && fabs(a->lon - reflon) < 5 && fabs(a->lon - reflon) < 5) {
+                a->cold->rr_lat = 0.1 * reflat + 0.9 * a->cold->rr_lat;
+                a->cold->rr_lon = 0.1 * reflon + 0.9 * a->cold->rr_lon;
             } else {
-                a->rr_lat = reflat;
-                a->rr_lon = reflon;
+                a->cold->rr_lat = reflat;
+                a->cold->rr_lon = reflon;
             }
-            a->rr_seen = now;
+            a->cold->rr_seen = now;
             if (Modes.debug_rough_receiver_location) {
                 if (
                         (a->position_valid.last_source == SOURCE_INDIRECT && trackDataAge(now, &a->position_valid) > TRACK_EXPIRE_ROUGH - 30 * SECONDS)
@@ -2522,8 +2550,8 @@ struct aircraft *trackUpdateFromMessage(struct modesMessage *mm) {
                             mm->decoded_lat = a->lat;
                             mm->decoded_lon = a->lon;
                         } else {
-                            mm->decoded_lat = a->rr_lat;
-                            mm->decoded_lon = a->rr_lon;
+                            mm->decoded_lat = a->cold->rr_lat;
+                            mm->decoded_lon = a->cold->rr_lon;
                         }
                         set_globe_index(a, globe_index(mm->decoded_lat, mm->decoded_lon));
                         setPosition(a, mm, now);
@@ -2581,7 +2609,7 @@ struct aircraft *trackUpdateFromMessage(struct modesMessage *mm) {
     }
 
     if (haveScratch && (mm->garbage || mm->pos_bad || mm->duplicate)) {
-        memcpy(a, &scratch, offsetof(struct aircraft, traceCache));
+        memcpy(a, &scratch, offsetof(struct aircraft, zeroEnd));
     }
 
     if (!(mm->source < a->position_valid.source || mm->in_disc_cache || mm->garbage || mm->pos_ignore || mm->pos_receiver_range_exceeded)) {
@@ -2636,6 +2664,10 @@ struct aircraft *trackUpdateFromMessage(struct modesMessage *mm) {
 
 exit:
 
+    if (changed) {
+        aircraftChanged(changed);
+    }
+
     ac = res;
 
     //fprintf(stderr, "epoch: %.6f\n", mm->sysTimestamp / 1000.0);
@@ -2659,7 +2691,7 @@ exit:
         if (mm->addr != HEX_UNKNOWN && !(mm->addr & MODES_NON_ICAO_ADDRESS)) {
             ac = aircraftCreate(mm->addr);
         }
-        if (ac && ac->messages == 1 && ac->registration[0] == 0) {
+        if (ac && ac->messages == 1 && ac->cold->registration[0] == 0) {
             fprintf(stdout, "%6llx %5.1f not in DB: %06x\n",
                     (long long) mm->timestamp % 0x1000000,
                     10 * log10(mm->signalLevel),
@@ -2675,6 +2707,54 @@ exit:
     return res;
 }
 
+// merge the counters of the track shards into the global stats
+// caller needs to hold Modes.decodeLock
+void trackMergeStats(struct messageBuffer *buf) {
+    struct stats *from = &buf->trackStats;
+    struct stats *to = &Modes.stats_current;
+
+    to->messages_total += from->messages_total;
+
+    to->cpr_surface += from->cpr_surface;
+    to->cpr_airborne += from->cpr_airborne;
+    to->cpr_global_ok += from->cpr_global_ok;
+    to->cpr_global_bad += from->cpr_global_bad;
+    to->cpr_global_skipped += from->cpr_global_skipped;
+    to->cpr_global_range_checks += from->cpr_global_range_checks;
+    to->cpr_global_speed_checks += from->cpr_global_speed_checks;
+    to->cpr_local_ok += from->cpr_local_ok;
+    to->cpr_local_skipped += from->cpr_local_skipped;
+    to->cpr_local_range_checks += from->cpr_local_range_checks;
+    to->cpr_local_speed_checks += from->cpr_local_speed_checks;
+    to->cpr_local_aircraft_relative += from->cpr_local_aircraft_relative;
+    to->cpr_local_receiver_relative += from->cpr_local_receiver_relative;
+
+    to->pos_all += from->pos_all;
+    to->pos_duplicate += from->pos_duplicate;
+    to->pos_garbage += from->pos_garbage;
+    for (int i = 0; i < NUM_TYPES; i++) {
+        to->pos_by_type[i] += from->pos_by_type[i];
+    }
+
+    for (int i = 0; i < RANGE_BUCKET_COUNT; i++) {
+        to->range_histogram[i] += from->range_histogram[i];
+    }
+    if (from->distance_max > to->distance_max)
+        to->distance_max = from->distance_max;
+    if (from->distance_min < to->distance_min)
+        to->distance_min = from->distance_min;
+
+    reset_stats(from);
+
+    Modes.messageRateAcc[0] += buf->messageRateAcc;
+    buf->messageRateAcc = 0;
+
+    int64_t now = mstime();
+    if (now > Modes.nextMessageRateCalc) {
+        calculateMessageRateGlobal(now);
+    }
+}
+
 //
 // Periodic updates of tracking state
 //
@@ -2893,7 +2973,7 @@ static void activeUpdate(int64_t now) {
             }
         }
     }
-    quickInit();
+    aircraftIndexMaintenance(&Modes.aircraftIndex);
     pthread_mutex_unlock(&ca->change_mutex);
 }
 
@@ -3516,8 +3596,12 @@ void updateValidities(struct aircraft *a, int64_t now) {
         set_globe_index(a, -5);
     }
 
-    if (a->category != 0 && now > a->category_updated + Modes.trackExpireMax)
+    int changed = 0;
+
+    if (a->category != 0 && now > a->category_updated + Modes.trackExpireMax) {
         a->category = 0;
+        changed = 1;
+    }
 
     // reset position reliability when no position was received for 60 minutes
     if (a->pos_reliable_odd != 0 && a->pos_reliable_even != 0 && elapsed_seen_global > POS_RELIABLE_TIMEOUT) {
@@ -3528,61 +3612,66 @@ void updateValidities(struct aircraft *a, int64_t now) {
         traceUsePosBuffered(a);
     }
 
-    updateValidity(&a->baro_alt_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->baro_alt_valid, now, TRACK_EXPIRE);
 
     if (a->alt_reliable != 0 && a->baro_alt_valid.source == SOURCE_INVALID) {
         a->alt_reliable = 0;
-    }
-
-    updateValidity(&a->callsign_valid, now, TRACK_EXPIRE_LONG);
-    updateValidity(&a->geom_alt_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->geom_delta_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->gs_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->ias_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->tas_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->mach_valid, now, TRACK_EXPIRE);
-
-    updateValidity(&a->track_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->track_rate_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->roll_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->mag_heading_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->true_heading_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->baro_rate_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->geom_rate_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->nic_a_valid, now, TRACK_EXPIRE);
-
-    updateValidity(&a->nic_c_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->nic_baro_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->nac_p_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->nac_v_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->sil_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->gva_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->sda_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->squawk_valid, now, TRACK_EXPIRE);
-
-    updateValidity(&a->emergency_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->airground_valid, now, TRACK_EXPIRE_LONG);
-    updateValidity(&a->nav_qnh_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->nav_altitude_mcp_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->nav_altitude_fms_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->nav_altitude_src_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->nav_heading_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->nav_modes_valid, now, TRACK_EXPIRE);
-
-    updateValidity(&a->cpr_odd_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->cpr_even_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->position_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->alert_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->spi_valid, now, TRACK_EXPIRE);
-
-    updateValidity(&a->acas_ra_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->mlat_pos_valid, now, TRACK_EXPIRE);
-    updateValidity(&a->pos_reliable_valid, now, TRACK_EXPIRE);
+        changed = 1;
+    }
+
+    changed |= updateValidity(&a->callsign_valid, now, TRACK_EXPIRE_LONG);
+    changed |= updateValidity(&a->geom_alt_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->geom_delta_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->gs_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->ias_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->tas_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->mach_valid, now, TRACK_EXPIRE);
+
+    changed |= updateValidity(&a->track_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->track_rate_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->roll_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->mag_heading_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->true_heading_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->baro_rate_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->geom_rate_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->nic_a_valid, now, TRACK_EXPIRE);
+
+    changed |= updateValidity(&a->nic_c_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->nic_baro_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->nac_p_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->nac_v_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->sil_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->gva_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->sda_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->squawk_valid, now, TRACK_EXPIRE);
+
+    changed |= updateValidity(&a->emergency_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->airground_valid, now, TRACK_EXPIRE_LONG);
+    changed |= updateValidity(&a->nav_qnh_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->nav_altitude_mcp_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->nav_altitude_fms_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->nav_altitude_src_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->nav_heading_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->nav_modes_valid, now, TRACK_EXPIRE);
+
+    changed |= updateValidity(&a->cpr_odd_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->cpr_even_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->position_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->alert_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->spi_valid, now, TRACK_EXPIRE);
+
+    changed |= updateValidity(&a->acas_ra_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->mlat_pos_valid, now, TRACK_EXPIRE);
+    changed |= updateValidity(&a->pos_reliable_valid, now, TRACK_EXPIRE);
 
 
     if (now > a->nextMessageRateCalc) {
         calculateMessageRate(a, now);
     }
+
+    if (changed) {
+        aircraftChanged(a);
+    }
 }
 
 static void showPositionDebug(struct aircraft *a, struct modesMessage *mm, int64_t now, double bad_lat, double bad_lon) {
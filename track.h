@@ -310,10 +310,49 @@ struct traceCache {
     char *json;
 };
 
+/* Members of an aircraft the message decoding doesn't use: trace chunks, database info, caches used for output.
+ * Separately allocated so the struct aircraft cache lines touched for each message stay few and dense.
+ */
+struct aircraftCold
+{
+  int64_t trace_next_mw; // timestamp for next full trace write to /run (tmpfs)
+  int64_t trace_next_perm; // timestamp for next trace write to history_dir (disk)
+  int64_t trace_perm_last_timestamp; // timestamp for last trace point written to disk
+  stateChunk *trace_chunks; // compressed chunks of trace
+  int32_t trace_chunk_len; // how many stateChunks are saved for this aircraft
+  int16_t traceWrittenForYesterday; // the permanent trace has been written for the previous day
+  uint8_t dbFlags;
+  char typeCode[4];
+  char registration[12];
+  char typeLong[63];
+
+  float rr_lat; // very rough receiver latitude
+  float rr_lon; // very rough receiver longitude
+  int64_t rr_seen; // when we noted this rough position
+
+  // DANGER, this section is zeroed when saving and loading data
+
+  char zeroStart;
+
+  struct traceCache traceCache;
+
+  uint32_t trace_chunk_overall_bytes;
+
+  int8_t initialTraceWriteDone;
+
+#if defined(PRINT_UUIDS)
+  int recentReceiverIdsNext;
+  idTime recentReceiverIds[RECENT_RECEIVER_IDS];
+#endif
+
+  char zeroEnd;
+};
+
 /* Structure used to describe the state of one tracked aircraft */
 struct aircraft
 {
   struct aircraft *next; // Next aircraft in our linked list
+  struct aircraftCold *cold; // always allocated, see aircraftCreate()
   uint32_t addr; // ICAO address
   addrtype_t addrtype; // highest priority address type seen for this aircraft
   int64_t seen; // Time (millis) at which the last packet with reliable address was received
@@ -328,18 +367,13 @@ struct aircraft
 
   // ----
 
-  int64_t trace_next_mw; // timestamp for next full trace write to /run (tmpfs)
-  int64_t trace_next_perm; // timestamp for next trace write to history_dir (disk)
   int64_t lastSignalTimestamp; // timestamp the last message with RSSI was received
-  int64_t trace_perm_last_timestamp; // timestamp for last trace point written to disk
 
   fourState *trace_current; // uncompressed most recent points in the trace
-  stateChunk *trace_chunks; // compressed chunks of trace
 
   int32_t trace_current_max;
   int32_t trace_current_len; // number of points in our uncompressed most recent trace portion
   int32_t trace_len; // total number of points in the trace
-  int32_t trace_chunk_len; // how many stateChunks are saved for this aircraft
   int32_t trace_write; // signal for writing the trace
 
   int32_t trace_writeCounter; // how many points where added since the complete trace was written to memory
@@ -356,11 +390,6 @@ struct aircraft
 
   // ----
 
-  float rr_lat; // very rough receiver latitude
-  float rr_lon; // very rough receiver longitude
-  int64_t rr_seen; // when we noted this rough position
-
-
   int64_t seenAdsbReliable; // last time we saw a reliable SOURCE_ADSB positions from this aircraft
   int64_t addrtype_updated;
   float tat;
@@ -377,7 +406,6 @@ struct aircraft
   double lon; // Coordinates obtained from CPR encoded data
   float pos_reliable_odd; // Number of good global CPRs, indicates position reliability
   float pos_reliable_even;
-  int16_t traceWrittenForYesterday; // the permanent trace has been written for the previous day
   uint16_t mlatEPU;
   float gs_last_pos; // Save a groundspeed associated with the last position
 
@@ -512,10 +540,6 @@ struct aircraft
   int64_t seenPosGlobal; // seen global CPR or other hopefully reliable position
   double latReliable; // last reliable position based on json_reliable threshold
   double lonReliable; // last reliable position based on json_reliable threshold
-  char typeCode[4];
-  char registration[12];
-  char typeLong[63];
-  uint8_t dbFlags;
   uint16_t receiverIds[RECEIVERIDBUFFER]; // RECEIVERIDBUFFER = 12
 
   int64_t next_reduce_forward_status;
@@ -565,6 +589,8 @@ struct aircraft
 
   char zeroStart;
 
+  uint32_t jsonGen; // see aircraftChanged()
+
   float messageRate;
   uint16_t messageRateAcc[MESSAGE_RATE_CALC_POINTS];
   int64_t nextMessageRateCalc;
@@ -574,20 +600,6 @@ struct aircraft
   struct cpr_cache disc_cache[DISCARD_CACHE];
   struct cpr_cache cpr_cache[CPR_CACHE];
 
-  // keep trace cache after cpr / disc cache
-  // stuff above is put into
-
-  struct traceCache traceCache;
-
-  uint32_t trace_chunk_overall_bytes;
-
-  int8_t initialTraceWriteDone;
-
-#if defined(PRINT_UUIDS)
-  int recentReceiverIdsNext;
-  idTime recentReceiverIds[RECENT_RECEIVER_IDS];
-#endif
-
   char zeroEnd;
 };
 
@@ -600,11 +612,12 @@ extern uint32_t modeAC_match[4096];
 extern uint32_t modeAC_age[4096];
 
 /* is this bit of data valid? */
-static inline void
+/* returns 1 if the data just expired */
+static inline int
 updateValidity (data_validity *v, int64_t now, int64_t expiration_timeout)
 {
     if (v->source == SOURCE_INVALID)
-        return;
+        return 0;
     int stale = (now > v->updated + TRACK_STALE);
     if (stale != v->stale)
         v->stale = stale;
@@ -619,6 +632,13 @@ updateValidity (data_validity *v, int64_t now, int64_t expiration_timeout)
         if (now > v->updated + expiration_timeout)
             v->source = SOURCE_INVALID;
     }
+    return (v->source == SOURCE_INVALID);
+}
+
+// the API reuses the json / binCraft of an aircraft from the previous snapshot while jsonGen is unchanged
+// call after changing anything toBinCraft or sprintAircraftObject print
+static inline void aircraftChanged(struct aircraft *a) {
+    __atomic_store_n(&a->jsonGen, a->jsonGen + 1, __ATOMIC_RELEASE);
 }
 
 /* is this bit of data valid? */
@@ -706,6 +726,9 @@ void from_state_all(struct state_all *in, struct state *in2, struct aircraft *a
 struct modesMessage;
 struct aircraft *trackUpdateFromMessage (struct modesMessage *mm);
 
+struct messageBuffer;
+void trackMergeStats(struct messageBuffer *buf);
+
 void trackMatchAC(int64_t now);
 void trackRemoveStale(int64_t now);
 
@@ -0,0 +1,176 @@
+#include "readsb.h"
+
+#include <sys/syscall.h>
+
+static int uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int) syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+int uringInit(struct uring *u, unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(u, 0, sizeof(struct uring));
+    u->fd = -1;
+
+    int fd = uring_setup(entries, &p);
+    if (fd < 0) {
+        return -errno;
+    }
+    u->fd = fd;
+    u->entries = p.sq_entries;
+
+    u->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    u->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    u->sq_ptr = mmap(NULL, u->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    u->cq_ptr = mmap(NULL, u->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    u->sqes = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+    if (u->sq_ptr == MAP_FAILED || u->cq_ptr == MAP_FAILED || u->sqes == MAP_FAILED) {
+        int err = errno;
+        if (u->sq_ptr == MAP_FAILED)
+            u->sq_ptr = NULL;
+        if (u->cq_ptr == MAP_FAILED)
+            u->cq_ptr = NULL;
+        if (u->sqes == MAP_FAILED)
+            u->sqes = NULL;
+        uringDestroy(u);
+        return -err;
+    }
+
+    char *sq = u->sq_ptr;
+    u->sq_head = (unsigned *) (sq + p.sq_off.head);
+    u->sq_tail = (unsigned *) (sq + p.sq_off.tail);
+    u->sq_mask = (unsigned *) (sq + p.sq_off.ring_mask);
+    u->sq_array = (unsigned *) (sq + p.sq_off.array);
+
+    char *cq = u->cq_ptr;
+    u->cq_head = (unsigned *) (cq + p.cq_off.head);
+    u->cq_tail = (unsigned *) (cq + p.cq_off.tail);
+    u->cq_mask = (unsigned *) (cq + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+
+    return 0;
+}
+
+void uringDestroy(struct uring *u) {
+    if (u->sqes)
+        munmap(u->sqes, u->sqes_size);
+    if (u->cq_ptr)
+        munmap(u->cq_ptr, u->cq_size);
+    if (u->sq_ptr)
+        munmap(u->sq_ptr, u->sq_size);
+    if (u->fd >= 0)
+        close(u->fd);
+    memset(u, 0, sizeof(struct uring));
+    u->fd = -1;
+}
+
+// collect the completions in the ring, returns the number collected
+static int uringReap(struct uring *u, int *results) {
+    int reaped = 0;
+    unsigned head = *u->cq_head;
+    unsigned cqTail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != cqTail) {
+        struct io_uring_cqe *cqe = &u->cqes[head & *u->cq_mask];
+        results[cqe->user_data] = cqe->res;
+        reaped++;
+        head++;
+    }
+    __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+    return reaped;
+}
+
+// EAGAIN / EBUSY: the kernel is short of memory or the completion queue overflowed, give it some time
+static void uringBackoff(int retry) {
+    struct timespec ts = { 0, imin(URING_BACKOFF_MAX_US, 50 << retry) * 1000 };
+    nanosleep(&ts, NULL);
+}
+
+int uringSendmsgBatch(struct uring *u, const int *fds, struct msghdr *msgs, int *results, int count) {
+    int enterCalls = 0;
+    int done = 0;
+    while (done < count) {
+        int batch = imin(count - done, u->entries);
+
+        unsigned sqStart = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+        unsigned tail = *u->sq_tail;
+        for (int k = 0; k < batch; k++) {
+            int i = done + k;
+            unsigned index = tail & *u->sq_mask;
+            struct io_uring_sqe *sqe = &u->sqes[index];
+            memset(sqe, 0, sizeof(struct io_uring_sqe));
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->fd = fds[i];
+            sqe->addr = (uint64_t) (uintptr_t) &msgs[i];
+            sqe->len = 1;
+            sqe->msg_flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+            sqe->user_data = i;
+            u->sq_array[index] = index;
+            results[i] = URING_PENDING;
+            tail++;
+        }
+        // make the sqes visible to the kernel before the tail update
+        __atomic_store_n(u->sq_tail, tail, __ATOMIC_RELEASE);
+
+        int completed = 0;
+        int stopped = 0; // nothing more is submitted, the sends already in flight are waited for
+        int err = 0; // hard error, the ring can't be used anymore
+        int retry = 0;
+        while (1) {
+            // the kernel advances sq_head over the sqes it consumed, only those can complete
+            int submitted = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) - sqStart;
+            int want = stopped ? submitted : batch;
+            if (completed >= want)
+                break;
+            int res = uring_enter(u->fd, stopped ? 0 : batch - submitted, want - completed, IORING_ENTER_GETEVENTS);
+            enterCalls++;
+            int e = errno;
+            completed += uringReap(u, results);
+            if (res >= 0 || e == EINTR) {
+                retry = 0;
+                continue;
+            }
+            if ((e == EAGAIN || e == EBUSY) && retry < URING_RETRIES) {
+                uringBackoff(retry++);
+                continue;
+            }
+            if (stopped) {
+                // waiting for the sends in flight failed as well, the ring may still complete
+                // them into a later batch, it has to go
+                if (!err)
+                    err = e;
+                break;
+            }
+            if (e != EAGAIN && e != EBUSY)
+                err = e;
+            // the sqes the kernel didn't take are taken back, it only reads the tail in io_uring_enter()
+            stopped = 1;
+            retry = 0;
+            __atomic_store_n(u->sq_tail, sqStart + submitted, __ATOMIC_RELEASE);
+        }
+
+        if (stopped) {
+            int submitted = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) - sqStart;
+            for (int k = 0; k < count - done; k++) {
+                int i = done + k;
+                if (k >= batch || (k >= submitted && results[i] == URING_PENDING)) {
+                    // never reached the kernel, the caller can send it another way
+                    results[i] = -ECANCELED;
+                } else if (results[i] == URING_PENDING) {
+                    // taken by the kernel without a completion, the data may or may not have been sent
+                    results[i] = -EIO;
+                }
+            }
+            // after EAGAIN / EBUSY the ring stays in use, the rest of this call goes out with writev
+            return err ? -err : enterCalls;
+        }
+        done += batch;
+    }
+    return enterCalls;
+}
@@ -0,0 +1,50 @@
+#ifndef URING_H
+#define URING_H
+
+#include <linux/io_uring.h>
+
+// minimal io_uring wrapper using the raw syscalls, no liburing required
+// used to batch the socket sends of one flushWrites() into a single io_uring_enter()
+
+#define URING_ENTRIES (256)
+// results[] of a message submitted but not completed yet
+#define URING_PENDING (INT_MIN)
+#define URING_RETRIES (8)
+#define URING_BACKOFF_MAX_US (5000)
+
+struct uring {
+    int fd;
+    unsigned entries;
+
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    void *sq_ptr;
+    size_t sq_size;
+    void *cq_ptr;
+    size_t cq_size;
+    size_t sqes_size;
+};
+
+// returns 0 on success, -errno if the kernel doesn't support io_uring
+int uringInit(struct uring *u, unsigned entries);
+void uringDestroy(struct uring *u);
+
+// send count messages with one submission per URING_ENTRIES messages
+// results[i] is set to the return value of sendmsg(fds[i], &msgs[i], MSG_DONTWAIT | MSG_NOSIGNAL) or -errno
+// returns the number of io_uring_enter() calls, or -errno if the ring failed and can't be used anymore
+// EAGAIN / EBUSY from io_uring_enter() are retried URING_RETRIES times with a growing sleep, if that
+// doesn't help the ring is kept but the messages not submitted yet are left to the caller (-ECANCELED).
+// Before returning, the sends the kernel already took are always waited for. Only if even that fails,
+// their messages are set to -EIO (outcome unknown) and -errno is returned.
+int uringSendmsgBatch(struct uring *u, const int *fds, struct msghdr *msgs, int *results, int count);
+
+#endif